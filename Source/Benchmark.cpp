@@ -0,0 +1,1278 @@
+#include "Library.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include "EASTL/algorithm.h"
+#include "CPURaytracer.h"
+#include "SceneTables.h"
+#include "ShaderTable.h"
+
+#define mz_DEMO_NAME "SimpleRaytracerBenchmark"
+#define mz_MAX_BENCHMARK_CAMERAS 2
+
+struct mz_BenchmarkOptions
+{
+	const char* OutputFileName; // JSON.
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t NumThreads; // 0 - use all hardware threads.
+	uint32_t NumIterations;
+	uint32_t BVHWidth; // 0 - widest available.
+	bool bUsePackets;
+	bool bBenchmarkJobs; // Job system stress test and scaling instead of scenes.
+	bool bBenchmarkTables; // Scene tables (material descriptors, hit groups) of a synthetic scene instead of scenes.
+	bool bBenchmarkPools; // Handle pool checks and timing instead of scenes.
+	bool bBenchmarkUpload; // Upload ring checks against a simulated GPU fence instead of scenes.
+};
+
+struct mz_BenchmarkCamera
+{
+	mz_Float3 Position;
+	mz_Float3 Target;
+};
+
+struct mz_BenchmarkScene
+{
+	const char* Name;
+	const char* RequiredFiles[4]; // Scene is skipped when any of them is missing.
+	void (*Load)(mz_SceneData* OutScene);
+	mz_BenchmarkCamera Cameras[mz_MAX_BENCHMARK_CAMERAS];
+};
+
+static void
+mz_LoadSponza(mz_SceneData* OutScene)
+{
+	mz_LoadGLTFSceneData("Data/Sponza/Sponza.gltf", 0, OutScene);
+}
+
+static void
+mz_LoadScene(mz_SceneData* OutScene)
+{
+	mz_LoadGLTFSceneData("Data/Meshes/Scene.gltf", 0, OutScene);
+}
+
+static void
+mz_LoadScene2(mz_SceneData* OutScene)
+{
+	mz_LoadGLTFSceneData("Data/Meshes/Scene2.gltf", 0, OutScene);
+}
+
+static void
+mz_LoadPLYMeshes(mz_SceneData* OutScene)
+{
+	XMFLOAT3X4 ObjectToWorld = {};
+	ObjectToWorld.m[0][0] = ObjectToWorld.m[1][1] = ObjectToWorld.m[2][2] = 1.0f;
+	mz_LoadPLYMeshData("Data/Meshes/Ground.ply", ObjectToWorld, OutScene);
+
+	ObjectToWorld.m[0][3] = -1.2f;
+	ObjectToWorld.m[1][3] = 0.8f;
+	ObjectToWorld.m[2][3] = 4.0f;
+	mz_LoadPLYMeshData("Data/Meshes/Sphere.ply", ObjectToWorld, OutScene);
+
+	ObjectToWorld.m[0][3] = 1.2f;
+	ObjectToWorld.m[1][3] = 0.6f;
+	ObjectToWorld.m[2][3] = 3.5f;
+	mz_LoadPLYMeshData("Data/Meshes/Monkey.ply", ObjectToWorld, OutScene);
+}
+
+// NOTE: Cameras are fixed so that results can be compared across builds. First one is the demo camera.
+static const mz_BenchmarkScene GBenchmarkScenes[] =
+{
+	{ "Sponza", { "Data/Sponza/Sponza.gltf", "Data/Sponza/Sponza.bin" }, mz_LoadSponza, { { { 0.0f, 0.5f, 0.0f }, { 0.0f, 0.5f, 1.0f } }, { { -10.0f, 2.0f, 0.5f }, { 10.0f, 4.0f, -0.5f } } } },
+	{ "Scene", { "Data/Meshes/Scene.gltf", "Data/Meshes/Scene.bin" }, mz_LoadScene, { { { 0.0f, 0.5f, 0.0f }, { 0.0f, 0.5f, 1.0f } }, { { 7.36f, 4.96f, 6.93f }, { 0.0f, 1.0f, -1.0f } } } },
+	{ "Scene2", { "Data/Meshes/Scene2.gltf", "Data/Meshes/Scene2_data.bin" }, mz_LoadScene2, { { { 0.0f, 0.5f, 0.0f }, { 0.0f, 0.5f, 1.0f } }, { { 3.0f, 2.5f, 3.0f }, { 0.0f, 0.8f, -0.8f } } } },
+	{ "PLYMeshes", { "Data/Meshes/Ground.ply", "Data/Meshes/Sphere.ply", "Data/Meshes/Monkey.ply" }, mz_LoadPLYMeshes, { { { 0.0f, 0.5f, 0.0f }, { 0.0f, 0.5f, 1.0f } }, { { 0.0f, 3.0f, 0.5f }, { 0.0f, 0.5f, 3.8f } } } },
+};
+
+static const char* GRayClassNames[mz_RAY_CLASS_COUNT] = { "primary", "shadow", "diffuse" };
+
+static bool
+mz_ParseCommandLine(int32_t Argc, char** Argv, mz_BenchmarkOptions* OutOptions)
+{
+	OutOptions->OutputFileName = "Benchmark.json";
+	OutOptions->Width = 1280;
+	OutOptions->Height = 720;
+	OutOptions->NumThreads = 0;
+	OutOptions->NumIterations = 3;
+	OutOptions->BVHWidth = 0;
+	OutOptions->bUsePackets = false;
+	OutOptions->bBenchmarkJobs = false;
+	OutOptions->bBenchmarkTables = false;
+	OutOptions->bBenchmarkPools = false;
+	OutOptions->bBenchmarkUpload = false;
+
+	for (int32_t Idx = 1; Idx < Argc; ++Idx)
+	{
+		const char* Arg = Argv[Idx];
+		bool bHasValue = Idx + 1 < Argc;
+
+		if (strcmp(Arg, "-output") == 0 && bHasValue)
+		{
+			OutOptions->OutputFileName = Argv[++Idx];
+		}
+		else if (strcmp(Arg, "-width") == 0 && bHasValue)
+		{
+			OutOptions->Width = (uint32_t)atoi(Argv[++Idx]);
+		}
+		else if (strcmp(Arg, "-height") == 0 && bHasValue)
+		{
+			OutOptions->Height = (uint32_t)atoi(Argv[++Idx]);
+		}
+		else if (strcmp(Arg, "-threads") == 0 && bHasValue)
+		{
+			OutOptions->NumThreads = (uint32_t)atoi(Argv[++Idx]);
+		}
+		else if (strcmp(Arg, "-iterations") == 0 && bHasValue)
+		{
+			OutOptions->NumIterations = (uint32_t)atoi(Argv[++Idx]);
+		}
+		else if (strcmp(Arg, "-bvh") == 0 && bHasValue)
+		{
+			OutOptions->BVHWidth = (uint32_t)atoi(Argv[++Idx]);
+		}
+		else if (strcmp(Arg, "-packets") == 0)
+		{
+			OutOptions->bUsePackets = true;
+		}
+		else if (strcmp(Arg, "-jobs") == 0)
+		{
+			OutOptions->bBenchmarkJobs = true;
+		}
+		else if (strcmp(Arg, "-tables") == 0)
+		{
+			OutOptions->bBenchmarkTables = true;
+		}
+		else if (strcmp(Arg, "-pools") == 0)
+		{
+			OutOptions->bBenchmarkPools = true;
+		}
+		else if (strcmp(Arg, "-upload") == 0)
+		{
+			OutOptions->bBenchmarkUpload = true;
+		}
+		else
+		{
+			printf("Usage: %s [-output file.json] [-width N] [-height N] [-threads N] [-iterations N] [-bvh 2|4|8] [-packets] [-jobs] [-tables] [-pools] [-upload]\n", mz_DEMO_NAME);
+			return false;
+		}
+	}
+	if (OutOptions->BVHWidth != 0 && OutOptions->BVHWidth != 2 && OutOptions->BVHWidth != 4 && !(OutOptions->BVHWidth == 8 && mz_HAS_BVH8))
+	{
+		printf("Unsupported BVH width: %u.\n", OutOptions->BVHWidth);
+		return false;
+	}
+	return OutOptions->Width > 0 && OutOptions->Height > 0 && OutOptions->NumIterations > 0;
+}
+
+static bool
+mz_FileExists(const char* FileName)
+{
+	FILE* File = fopen(FileName, "rb");
+	if (!File)
+	{
+		return false;
+	}
+	fclose(File);
+	return true;
+}
+
+//
+// Job system.
+//
+static void
+mz_SimulateWork(uint32_t NumIterations, uint32_t* InOutState)
+{
+	uint32_t X = *InOutState | 1;
+	for (uint32_t Idx = 0; Idx < NumIterations; ++Idx)
+	{
+		X ^= X << 13;
+		X ^= X >> 17;
+		X ^= X << 5;
+	}
+	*InOutState = X;
+}
+
+// Body of the jobs timed by mz_BenchmarkJobs, the serial reference runs it over the whole range.
+static void
+mz_RunWorkJobs(uint32_t* States, uint32_t Begin, uint32_t End, uint32_t NumWorkIterations)
+{
+	for (uint32_t Idx = Begin; Idx < End; ++Idx)
+	{
+		mz_SimulateWork(NumWorkIterations, &States[Idx]);
+	}
+}
+
+static void
+mz_ForkJoin(uint32_t Depth, std::atomic<uint32_t>* InOutNumLeaves)
+{
+	if (Depth == 0)
+	{
+		InOutNumLeaves->fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	mz_ParallelFor(2, 1, [Depth, InOutNumLeaves](uint32_t Begin, uint32_t End)
+	{
+		for (uint32_t Idx = Begin; Idx < End; ++Idx)
+		{
+			mz_ForkJoin(Depth - 1, InOutNumLeaves);
+		}
+	});
+}
+
+struct mz_StressJobData
+{
+	std::atomic<uint64_t> Sum;
+	mz_JobCounter* ChildCounter;
+};
+
+// Submits one child job per element of the range, they are waited for by the submitter of this job.
+static void
+mz_StressJob(void* Data, uint32_t Begin, uint32_t End)
+{
+	mz_StressJobData* JobData = (mz_StressJobData*)Data;
+	for (uint32_t Idx = Begin; Idx < End; ++Idx)
+	{
+		mz_Job Child = {};
+		Child.Function = [](void* Data, uint32_t Begin, uint32_t End) { ((mz_StressJobData*)Data)->Sum.fetch_add((uint64_t)Begin + End); };
+		Child.Data = JobData;
+		Child.Begin = Idx;
+		Child.End = Idx + 1;
+		Child.Counter = JobData->ChildCounter;
+		mz_SubmitJob(Child);
+	}
+}
+
+// Every way of submitting work, including from a thread the job system doesn't own. Returns number of failed checks.
+static uint32_t
+mz_RunJobStressTest(uint32_t NumIterations)
+{
+	uint32_t NumFailures = 0;
+	eastl::vector<uint32_t> Visits(100000);
+
+	for (uint32_t Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		// Every element exactly once, for any granularity.
+		static const uint32_t Granularities[] = { 1, 3, 64, 1000, 100000 };
+		for (uint32_t Granularity : Granularities)
+		{
+			eastl::fill(Visits.begin(), Visits.end(), 0u);
+			mz_ParallelFor((uint32_t)Visits.size(), Granularity, [&Visits](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t Idx = Begin; Idx < End; ++Idx)
+				{
+					Visits[Idx]++;
+				}
+			});
+			NumFailures += (size_t)eastl::count(Visits.begin(), Visits.end(), 1u) != Visits.size();
+		}
+
+		// Nested waits.
+		std::atomic<uint32_t> NumLeaves(0);
+		mz_ForkJoin(12, &NumLeaves);
+		NumFailures += NumLeaves.load() != 4096;
+
+		// Jobs submitting jobs, counters of both levels.
+		mz_JobCounter ParentCounter = {};
+		mz_JobCounter ChildCounter = {};
+		mz_StressJobData JobData;
+		JobData.Sum = 0;
+		JobData.ChildCounter = &ChildCounter;
+
+		mz_Job Parent = {};
+		Parent.Function = mz_StressJob;
+		Parent.Data = &JobData;
+		Parent.End = 2000;
+		Parent.Granularity = 16;
+		Parent.Counter = &ParentCounter;
+		mz_SubmitJob(Parent);
+		mz_WaitForCounter(&ParentCounter);
+		mz_WaitForCounter(&ChildCounter);
+		NumFailures += JobData.Sum.load() != 2000ull * 2000;
+
+		// Outside thread shares a queue with this one.
+		std::atomic<uint32_t> NumOutsideLeaves(0);
+		std::thread Outside([&NumOutsideLeaves]() { mz_ForkJoin(10, &NumOutsideLeaves); });
+		std::atomic<uint32_t> NumInsideLeaves(0);
+		mz_ForkJoin(10, &NumInsideLeaves);
+		Outside.join();
+		NumFailures += NumOutsideLeaves.load() != 1024 || NumInsideLeaves.load() != 1024;
+	}
+	return NumFailures;
+}
+
+// Runs the stress test and measures how 10 us jobs scale from one thread to MaxThreads.
+static bool
+mz_BenchmarkJobs(uint32_t MaxThreads, uint32_t NumIterations)
+{
+	const uint32_t NumJobs = 20000;
+	eastl::vector<uint32_t> States(NumJobs, 1u);
+
+	// NOTE: Scheduling overhead is measured with empty jobs. Subtracting the serial time from the parallel one is
+	// below run to run noise with 10 us jobs. Timings are the best of several runs after a discarded warm-up run.
+	const uint32_t NumRepeats = eastl::max(NumIterations, 3u);
+	uint32_t NumWorkIterations = 1000;
+	auto RunSerial = [&States, &NumWorkIterations]()
+	{
+		double Time = mz_GetTime();
+		mz_RunWorkJobs(States.data(), 0, NumJobs, NumWorkIterations);
+		return mz_GetTime() - Time;
+	};
+
+	// First run calibrates the work to 10 us per job (and warms up).
+	double SerialTime = RunSerial();
+	NumWorkIterations = eastl::max((uint32_t)(NumWorkIterations * NumJobs * 10.0e-6 / eastl::max(SerialTime, 1.0e-9)), 1u);
+	RunSerial();
+	SerialTime = 1.0e9;
+	for (uint32_t Repeat = 0; Repeat < NumRepeats; ++Repeat)
+	{
+		SerialTime = eastl::min(SerialTime, RunSerial());
+	}
+	printf("Jobs: %.2f us of work per job.\n", SerialTime / NumJobs * 1.0e6);
+
+	bool bHasPassed = true;
+	double BaselineTime = 0.0;
+	for (uint32_t NumThreads = 1;; NumThreads = eastl::min(NumThreads * 2, MaxThreads))
+	{
+		mz_InitJobSystem(NumThreads);
+
+		uint32_t NumFailures = mz_RunJobStressTest(NumIterations);
+		bHasPassed &= NumFailures == 0;
+
+		double EmptyTime = 1.0e9;
+		for (uint32_t Repeat = 0; Repeat <= NumRepeats; ++Repeat)
+		{
+			double RepeatTime = mz_GetTime();
+			mz_ParallelFor(NumJobs * 10, 1, [](uint32_t, uint32_t) {});
+			RepeatTime = mz_GetTime() - RepeatTime;
+			EmptyTime = Repeat == 0 ? EmptyTime : eastl::min(EmptyTime, RepeatTime);
+		}
+
+		double Time = 1.0e9;
+		for (uint32_t Repeat = 0; Repeat <= NumRepeats; ++Repeat)
+		{
+			double RepeatTime = mz_GetTime();
+			mz_ParallelFor(NumJobs, 1, [&States, NumWorkIterations](uint32_t Begin, uint32_t End)
+			{
+				mz_RunWorkJobs(States.data(), Begin, End, NumWorkIterations);
+			});
+			RepeatTime = mz_GetTime() - RepeatTime;
+			Time = Repeat == 0 ? Time : eastl::min(Time, RepeatTime); // First run is a warm-up.
+		}
+		BaselineTime = NumThreads == 1 ? Time : BaselineTime;
+
+		// NOTE: Threads beyond hardware threads add no compute, they are not counted.
+		uint32_t NumCores = eastl::min(NumThreads, eastl::max(std::thread::hardware_concurrency(), 1u));
+		printf("Jobs: %2u threads, stress test %s, %6.3f Mjobs/s, %.2fx (%.0f%% efficiency), %.0f ns per empty job.\n",
+			NumThreads, NumFailures == 0 ? "passed" : "FAILED", NumJobs / Time * 1.0e-6, BaselineTime / Time, 100.0 * BaselineTime / (Time * NumCores),
+			EmptyTime / (NumJobs * 10) * 1.0e9);
+
+		mz_ShutdownJobSystem();
+		if (NumThreads == MaxThreads)
+		{
+			break;
+		}
+	}
+	return bHasPassed;
+}
+
+//
+// Scene tables.
+//
+// NOTE: Descriptors are emulated with 32 byte blocks, "GPU heap" holds mz_MATERIAL_NUM_TEXTURES of them per
+// material and shader table records have the same layout as in SimpleRaytracer.cpp (descriptor table handle is the
+// index of the first descriptor, shader identifiers are constant bytes).
+struct mz_FakeDescriptor
+{
+	uint32_t Data[8];
+};
+
+enum mz_FakeShaderID
+{
+	mz_FAKE_SHADER_ID_RAY_GENERATION = 1,
+	mz_FAKE_SHADER_ID_RADIANCE_MISS,
+	mz_FAKE_SHADER_ID_SHADOW_MISS,
+	mz_FAKE_SHADER_ID_RADIANCE_HIT_GROUP,
+	mz_FAKE_SHADER_ID_SHADOW_HIT_GROUP,
+};
+
+#define mz_FAKE_RECORD_SIZE 96
+
+static void
+mz_CreateTablesScene(uint32_t NumMeshes, uint32_t NumSectionsPerMesh, uint32_t NumMaterials, uint32_t NumImages, mz_SceneData* OutScene)
+{
+	uint32_t State = 1;
+	auto Random = [&State](uint32_t Range) { mz_SimulateWork(1, &State); return State % Range; };
+
+	OutScene->Images.resize(NumImages, mz_Image{});
+	OutScene->Materials.resize(NumMaterials);
+	for (mz_Material& Material : OutScene->Materials)
+	{
+		Material = {};
+		Material.BaseColorTextureIndex = (uint16_t)Random(NumImages);
+		Material.PBRFactorsTextureIndex = Random(4) ? (uint16_t)Random(NumImages) : (uint16_t)~0;
+		Material.NormalTextureIndex = Random(4) ? (uint16_t)Random(NumImages) : (uint16_t)~0;
+	}
+
+	OutScene->Meshes.resize(NumMeshes);
+	for (mz_Mesh& Mesh : OutScene->Meshes)
+	{
+		Mesh = {};
+		Mesh.NumSections = (uint16_t)NumSectionsPerMesh;
+		if (NumSectionsPerMesh > 1)
+		{
+			Mesh.Sections = (mz_MeshSection*)calloc(NumSectionsPerMesh, sizeof(mz_MeshSection));
+		}
+		mz_MeshSection* Sections = mz_GetMeshSections(&Mesh);
+		for (uint32_t SectionIdx = 0; SectionIdx < NumSectionsPerMesh; ++SectionIdx)
+		{
+			Sections[SectionIdx].BaseVertex = Random(1 << 20);
+			Sections[SectionIdx].IndexOffset = Random(1 << 20) * 4;
+			Sections[SectionIdx].IndexSize = 4;
+			Sections[SectionIdx].MaterialIndex = (uint16_t)Random(NumMaterials);
+		}
+	}
+}
+
+// What mz_Draw did before the tables: fallbacks resolved and descriptors copied for every section, every frame.
+static void
+mz_WriteTablesFromScratch(mz_SceneData* Scene, const mz_FakeDescriptor* ImageDescriptors, mz_FakeDescriptor* OutHeap, uint8_t* OutRecords)
+{
+	uint32_t NumDescriptors = 0;
+	for (mz_Mesh& Mesh : Scene->Meshes)
+	{
+		mz_MeshSection* Sections = mz_GetMeshSections(&Mesh);
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh.NumSections; ++SectionIdx)
+		{
+			const mz_Material* Material = &Scene->Materials[Sections[SectionIdx].MaterialIndex];
+			uint32_t TableBase = NumDescriptors;
+			OutHeap[NumDescriptors++] = ImageDescriptors[Material->BaseColorTextureIndex];
+			OutHeap[NumDescriptors++] = ImageDescriptors[Material->PBRFactorsTextureIndex != (uint16_t)~0 ? Material->PBRFactorsTextureIndex : Material->BaseColorTextureIndex];
+			OutHeap[NumDescriptors++] = ImageDescriptors[Material->NormalTextureIndex != (uint16_t)~0 ? Material->NormalTextureIndex : Material->BaseColorTextureIndex];
+
+			mz_PerGeometryRootData Geometry = {};
+			Geometry.BaseVertex = Sections[SectionIdx].BaseVertex;
+			Geometry.IndexOffset = Sections[SectionIdx].IndexOffset;
+			Geometry.IndexSize = Sections[SectionIdx].IndexSize;
+			Geometry.PositionExtent = XMFLOAT3(1.0f, 1.0f, 1.0f);
+			memcpy(OutRecords + 32, &Geometry, sizeof(Geometry));
+			memcpy(OutRecords + 32 + sizeof(Geometry), &TableBase, sizeof(TableBase));
+			OutRecords += 2 * mz_FAKE_RECORD_SIZE;
+		}
+	}
+}
+
+// Consumer of the tables, same as one frame index of SimpleRaytracer.cpp.
+struct mz_FakeTablesConsumer
+{
+	eastl::vector<mz_FakeDescriptor> Heap;
+	mz_ShaderTable ShaderTable;
+	eastl::vector<uint8_t> GPUShaderTable; // Receives only dirty ranges, like the GPU buffer.
+	eastl::vector<mz_ByteRange> UploadRanges;
+	uint64_t AppliedVersion;
+	uint64_t NumUploadedBytes;
+	uint32_t NumUploads;
+};
+
+static void
+mz_WriteFakeShaderID(mz_ShaderTable* Table, uint32_t Offset, mz_FakeShaderID ShaderID)
+{
+	uint8_t Identifier[mz_SHADER_IDENTIFIER_SIZE];
+	memset(Identifier, ShaderID, sizeof(Identifier));
+	mz_WriteShaderRecord(Table, Offset, Identifier, sizeof(Identifier));
+}
+
+static void
+mz_WriteFakeHitGroupRecords(const mz_SceneTables* Tables, uint32_t HitGroupIdx, mz_ShaderTable* Table)
+{
+	const mz_HitGroupData& HitGroup = Tables->HitGroups[HitGroupIdx];
+	uint64_t TableBase = HitGroup.MaterialIndex * mz_MATERIAL_NUM_TEXTURES;
+
+	uint8_t Record[mz_SHADER_IDENTIFIER_SIZE + sizeof(mz_PerGeometryRootData) + sizeof(TableBase)];
+	memset(Record, mz_FAKE_SHADER_ID_RADIANCE_HIT_GROUP, mz_SHADER_IDENTIFIER_SIZE);
+	memcpy(Record + mz_SHADER_IDENTIFIER_SIZE, &HitGroup.Geometry, sizeof(HitGroup.Geometry));
+	memcpy(Record + mz_SHADER_IDENTIFIER_SIZE + sizeof(HitGroup.Geometry), &TableBase, sizeof(TableBase));
+	mz_WriteShaderRecord(Table, mz_GetHitGroupRecordOffset(Table, HitGroupIdx * 2 + 0), Record, sizeof(Record));
+	mz_WriteFakeShaderID(Table, mz_GetHitGroupRecordOffset(Table, HitGroupIdx * 2 + 1), mz_FAKE_SHADER_ID_SHADOW_HIT_GROUP);
+}
+
+static void
+mz_WriteFakeShaderTable(const mz_SceneTables* Tables, mz_ShaderTable* Table)
+{
+	mz_ShaderTableLayout Layout;
+	mz_ComputeShaderTableLayout(0, 2, 0, (uint32_t)Tables->HitGroups.size() * 2, sizeof(mz_PerGeometryRootData) + sizeof(uint64_t), &Layout);
+	mz_SetShaderTableLayout(Table, Layout);
+
+	mz_WriteFakeShaderID(Table, Table->Layout.RayGenerationOffset, mz_FAKE_SHADER_ID_RAY_GENERATION);
+	mz_WriteFakeShaderID(Table, mz_GetMissRecordOffset(Table, 0), mz_FAKE_SHADER_ID_RADIANCE_MISS);
+	mz_WriteFakeShaderID(Table, mz_GetMissRecordOffset(Table, 1), mz_FAKE_SHADER_ID_SHADOW_MISS);
+	for (uint32_t HitGroupIdx = 0; HitGroupIdx < Tables->HitGroups.size(); ++HitGroupIdx)
+	{
+		mz_WriteFakeHitGroupRecords(Tables, HitGroupIdx, Table);
+	}
+}
+
+// Same as mz_UploadShaderTable in SimpleRaytracer.cpp, "GPU buffer" grows geometrically.
+static void
+mz_UploadFakeShaderTable(mz_FakeTablesConsumer* InOutConsumer)
+{
+	mz_ShaderTable* Table = &InOutConsumer->ShaderTable;
+	if (InOutConsumer->GPUShaderTable.size() < Table->Layout.Size)
+	{
+		InOutConsumer->GPUShaderTable.resize(eastl::max(InOutConsumer->GPUShaderTable.size() * 2, (size_t)mz_AlignUp(Table->Layout.Size, 64u * 1024u)));
+		mz_MarkShaderTableDirty(Table, 0, Table->Layout.Size);
+	}
+
+	InOutConsumer->NumUploadedBytes += mz_TakeShaderTableDirtyRanges(Table, &InOutConsumer->UploadRanges);
+	for (const mz_ByteRange& Range : InOutConsumer->UploadRanges)
+	{
+		memcpy(&InOutConsumer->GPUShaderTable[Range.Offset], &Table->Data[Range.Offset], Range.Size);
+	}
+	InOutConsumer->NumUploads += (uint32_t)InOutConsumer->UploadRanges.size();
+}
+
+static void
+mz_WriteFakeMaterialDescriptors(const mz_SceneTables* Tables, const mz_FakeDescriptor* ImageDescriptors, uint32_t MaterialIdx, mz_FakeTablesConsumer* InOutConsumer)
+{
+	for (uint32_t Slot = 0; Slot < mz_MATERIAL_NUM_TEXTURES; ++Slot)
+	{
+		uint32_t Idx = MaterialIdx * mz_MATERIAL_NUM_TEXTURES + Slot;
+		InOutConsumer->Heap[Idx] = ImageDescriptors[Tables->MaterialTextures[Idx]];
+	}
+}
+
+// Returns number of materials whose descriptors were written.
+static uint32_t
+mz_ApplySceneTables(const mz_SceneTables* Tables, const mz_FakeDescriptor* ImageDescriptors, mz_FakeTablesConsumer* InOutConsumer)
+{
+	uint32_t NumWritten = 0;
+	const mz_SceneTableChange* Changes;
+	uint32_t NumChanges;
+	if (mz_GetSceneTableChanges(Tables, InOutConsumer->AppliedVersion, &Changes, &NumChanges))
+	{
+		for (uint32_t Idx = 0; Idx < NumChanges; ++Idx)
+		{
+			if (Changes[Idx].Type == mz_SCENE_TABLE_CHANGE_MATERIAL)
+			{
+				mz_WriteFakeMaterialDescriptors(Tables, ImageDescriptors, Changes[Idx].Index, InOutConsumer);
+				++NumWritten;
+			}
+			else
+			{
+				mz_WriteFakeHitGroupRecords(Tables, Changes[Idx].Index, &InOutConsumer->ShaderTable);
+			}
+		}
+	}
+	else
+	{
+		uint32_t NumMaterials = (uint32_t)Tables->MaterialTextures.size() / mz_MATERIAL_NUM_TEXTURES;
+		InOutConsumer->Heap.resize(Tables->MaterialTextures.size());
+		for (uint32_t MaterialIdx = 0; MaterialIdx < NumMaterials; ++MaterialIdx)
+		{
+			mz_WriteFakeMaterialDescriptors(Tables, ImageDescriptors, MaterialIdx, InOutConsumer);
+		}
+		NumWritten = NumMaterials;
+		mz_WriteFakeShaderTable(Tables, &InOutConsumer->ShaderTable);
+	}
+	mz_UploadFakeShaderTable(InOutConsumer);
+	InOutConsumer->AppliedVersion = Tables->Version;
+	return NumWritten;
+}
+
+// Every descriptor table and record of the consumer matches the scene and the "GPU" shader table matches a table built
+// from scratch. Returns number of mismatches.
+static uint32_t
+mz_ValidateSceneTables(mz_SceneData* Scene, const mz_SceneTables* Tables, const mz_FakeDescriptor* ImageDescriptors, const mz_FakeTablesConsumer& Consumer)
+{
+	mz_ShaderTable Reference = {};
+	mz_WriteFakeShaderTable(Tables, &Reference);
+	const mz_ShaderTableLayout& Layout = Consumer.ShaderTable.Layout;
+
+	uint32_t NumFailures = memcmp(&Reference.Layout, &Layout, sizeof(Layout)) != 0;
+	NumFailures += memcmp(Reference.Data.data(), Consumer.GPUShaderTable.data(), Reference.Data.size()) != 0;
+	uint32_t HitGroupIdx = 0;
+	for (mz_Mesh& Mesh : Scene->Meshes)
+	{
+		mz_MeshSection* Sections = mz_GetMeshSections(&Mesh);
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh.NumSections; ++SectionIdx, ++HitGroupIdx)
+		{
+			uint64_t TableBase;
+			memcpy(&TableBase, &Consumer.GPUShaderTable[Layout.HitGroupOffset + HitGroupIdx * 2 * Layout.HitGroupStride + mz_SHADER_IDENTIFIER_SIZE + sizeof(mz_PerGeometryRootData)], sizeof(TableBase));
+			NumFailures += TableBase != Sections[SectionIdx].MaterialIndex * mz_MATERIAL_NUM_TEXTURES;
+
+			const mz_Material* Material = &Scene->Materials[Sections[SectionIdx].MaterialIndex];
+			uint16_t Expected[mz_MATERIAL_NUM_TEXTURES] =
+			{
+				Material->BaseColorTextureIndex,
+				Material->PBRFactorsTextureIndex != (uint16_t)~0 ? Material->PBRFactorsTextureIndex : Material->BaseColorTextureIndex,
+				Material->NormalTextureIndex != (uint16_t)~0 ? Material->NormalTextureIndex : Material->BaseColorTextureIndex,
+			};
+			for (uint32_t Slot = 0; Slot < mz_MATERIAL_NUM_TEXTURES; ++Slot)
+			{
+				NumFailures += memcmp(&Consumer.Heap[TableBase + Slot], &ImageDescriptors[Expected[Slot]], sizeof(mz_FakeDescriptor)) != 0;
+			}
+		}
+	}
+	return NumFailures;
+}
+
+// Random record writes against a byte mask of what really changed: every changed byte has to be in some dirty range,
+// ranges have to be sorted and disjoint. Returns number of failures.
+static uint32_t
+mz_ValidateShaderTableDirtyRanges(uint32_t NumRounds)
+{
+	mz_ShaderTableLayout Layout;
+	mz_ComputeShaderTableLayout(8, 3, 24, 1000, 40, &Layout);
+	mz_ShaderTable Table = {};
+	mz_SetShaderTableLayout(&Table, Layout);
+
+	uint32_t NumFailures = Layout.MissOffset % mz_SHADER_TABLE_ALIGNMENT + Layout.HitGroupOffset % mz_SHADER_TABLE_ALIGNMENT;
+	NumFailures += Layout.MissStride != 64 || Layout.HitGroupStride != 96 || Layout.Size != Layout.HitGroupOffset + 1000 * 96;
+
+	eastl::vector<mz_ByteRange> Ranges;
+	mz_TakeShaderTableDirtyRanges(&Table, &Ranges);
+	NumFailures += Ranges.size() != 1 || Ranges[0].Offset != 0 || Ranges[0].Size != Layout.Size;
+
+	uint32_t State = 3;
+	eastl::vector<uint8_t> Previous;
+	for (uint32_t Round = 0; Round < NumRounds; ++Round)
+	{
+		Previous = Table.Data;
+		mz_SimulateWork(1, &State);
+		uint32_t NumWrites = State % 64;
+		for (uint32_t Idx = 0; Idx < NumWrites; ++Idx)
+		{
+			mz_SimulateWork(1, &State);
+			uint8_t Record[mz_SHADER_IDENTIFIER_SIZE + 40];
+			memcpy(Record, &Table.Data[mz_GetHitGroupRecordOffset(&Table, State % 1000)], sizeof(Record));
+			for (uint32_t Byte = 0; Byte < (State >> 10) % 4; ++Byte)
+			{
+				Record[(State >> (12 + Byte * 4)) % sizeof(Record)] ^= 0x5a;
+			}
+			mz_WriteShaderRecord(&Table, mz_GetHitGroupRecordOffset(&Table, State % 1000), Record, sizeof(Record));
+		}
+
+		mz_TakeShaderTableDirtyRanges(&Table, &Ranges);
+		uint32_t End = 0;
+		for (const mz_ByteRange& Range : Ranges)
+		{
+			NumFailures += Range.Size == 0 || Range.Offset < End || Range.Offset + Range.Size > Layout.Size;
+			End = Range.Offset + Range.Size;
+		}
+		for (uint32_t Byte = 0; Byte < Layout.Size; ++Byte)
+		{
+			if (Previous[Byte] != Table.Data[Byte])
+			{
+				const mz_ByteRange* Range = eastl::upper_bound(Ranges.begin(), Ranges.end(), Byte,
+					[](uint32_t Value, const mz_ByteRange& R) { return Value < R.Offset; });
+				NumFailures += Range == Ranges.begin() || Byte >= (Range - 1)->Offset + (Range - 1)->Size;
+			}
+		}
+		NumFailures += !Table.DirtyRanges.empty();
+	}
+	return NumFailures;
+}
+
+// Two consumers (frames in flight) follow random image, material and section changes, then time full rewrite against
+// replaying the changes of one frame.
+static bool
+mz_BenchmarkTables(uint32_t NumIterations)
+{
+	const uint32_t NumMeshes = 4000;
+	const uint32_t NumSectionsPerMesh = 4;
+	const uint32_t NumMaterials = 2000;
+	const uint32_t NumImages = 4000;
+	const uint32_t NumFrames = 200;
+	const uint32_t NumImagesPerFrame = 8; // Streamed in.
+
+	mz_SceneData Scene = {};
+	mz_CreateTablesScene(NumMeshes, NumSectionsPerMesh, NumMaterials, NumImages, &Scene);
+	uint32_t NumSections = NumMeshes * NumSectionsPerMesh;
+
+	eastl::vector<mz_FakeDescriptor> ImageDescriptors(NumImages);
+	for (uint32_t ImageIdx = 0; ImageIdx < NumImages; ++ImageIdx)
+	{
+		eastl::fill(eastl::begin(ImageDescriptors[ImageIdx].Data), eastl::end(ImageDescriptors[ImageIdx].Data), ImageIdx);
+	}
+
+	mz_SceneTables Tables;
+	double BuildTime = mz_GetTime();
+	mz_BuildSceneTables(&Scene, &Tables);
+	BuildTime = mz_GetTime() - BuildTime;
+
+	// Correctness: frames alternate between the consumers like frame indices do, changes are trimmed after each frame.
+	uint32_t NumFailures = 0;
+	mz_FakeTablesConsumer Consumers[2] = {};
+	uint32_t State = 7;
+	for (uint32_t Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		mz_SimulateWork(1, &State);
+		if (State % 3 == 0)
+		{
+			mz_Material* Material = &Scene.Materials[State % NumMaterials];
+			Material->NormalTextureIndex = Material->NormalTextureIndex == (uint16_t)~0 ? (uint16_t)(State % NumImages) : (uint16_t)~0;
+			mz_UpdateSceneMaterial(&Tables, &Scene, State % NumMaterials);
+		}
+		if (State % 5 == 0)
+		{
+			uint32_t MeshIdx = (State >> 8) % NumMeshes;
+			mz_SetSectionMaterial(&Tables, &Scene, MeshIdx, (State >> 4) % NumSectionsPerMesh, (uint16_t)((State >> 12) % NumMaterials));
+		}
+		for (uint32_t Idx = 0; Idx < NumImagesPerFrame; ++Idx)
+		{
+			uint32_t ImageIdx = (Frame * NumImagesPerFrame + Idx) % NumImages;
+			ImageDescriptors[ImageIdx].Data[0] += NumImages;
+			mz_MarkImageChanged(&Tables, ImageIdx);
+		}
+
+		mz_FakeTablesConsumer* Consumer = &Consumers[Frame % 2];
+		mz_ApplySceneTables(&Tables, ImageDescriptors.data(), Consumer);
+		mz_TrimSceneTableChanges(&Tables, eastl::min(Consumers[0].AppliedVersion, Consumers[1].AppliedVersion));
+		NumFailures += mz_ValidateSceneTables(&Scene, &Tables, ImageDescriptors.data(), *Consumer);
+	}
+	uint32_t TableSize = Consumers[0].ShaderTable.Layout.Size;
+	double UploadedBytesPerFrame = (double)(Consumers[0].NumUploadedBytes + Consumers[1].NumUploadedBytes - 2 * TableSize) / (NumFrames - 2);
+	double UploadsPerFrame = (double)(Consumers[0].NumUploads + Consumers[1].NumUploads - 2) / (NumFrames - 2);
+	uint32_t NumDirtyRangeFailures = mz_ValidateShaderTableDirtyRanges(500);
+
+	// Timing: one frame of streaming against rewriting everything.
+	eastl::vector<mz_FakeDescriptor> ScratchHeap(NumSections * mz_MATERIAL_NUM_TEXTURES);
+	eastl::vector<uint8_t> ScratchRecords(NumSections * 2 * mz_FAKE_RECORD_SIZE);
+	double FullTime = mz_GetTime();
+	for (uint32_t Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		mz_WriteTablesFromScratch(&Scene, ImageDescriptors.data(), ScratchHeap.data(), ScratchRecords.data());
+	}
+	FullTime = (mz_GetTime() - FullTime) / NumIterations;
+
+	double StreamingTime = 0.0;
+	double IdleTime = 0.0;
+	uint32_t NumWritten = 0;
+	for (uint32_t Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		for (uint32_t Idx = 0; Idx < NumImagesPerFrame; ++Idx)
+		{
+			mz_MarkImageChanged(&Tables, (Iteration * NumImagesPerFrame + Idx) % NumImages);
+		}
+		double Time = mz_GetTime();
+		NumWritten += mz_ApplySceneTables(&Tables, ImageDescriptors.data(), &Consumers[0]);
+		StreamingTime += mz_GetTime() - Time;
+
+		Time = mz_GetTime();
+		mz_ApplySceneTables(&Tables, ImageDescriptors.data(), &Consumers[0]);
+		IdleTime += mz_GetTime() - Time;
+	}
+	StreamingTime /= NumIterations;
+	IdleTime /= NumIterations;
+
+	printf("Tables: %u sections, %u materials, %u images, built in %.3f ms, %u frames of changes %s.\n", NumSections, NumMaterials, NumImages,
+		BuildTime * 1000.0, NumFrames, NumFailures == 0 ? "passed" : "FAILED");
+	printf("Tables: full rewrite %.1f us, frame with %u streamed images %.2f us (%.1f materials written), frame without changes %.3f us.\n",
+		FullTime * 1.0e6, NumImagesPerFrame, StreamingTime * 1.0e6, (double)NumWritten / NumIterations, IdleTime * 1.0e6);
+	printf("Shader table: %u bytes, %.1f bytes uploaded per frame in %.2f copies, dirty ranges %s.\n", TableSize, UploadedBytesPerFrame, UploadsPerFrame,
+		NumDirtyRangeFailures == 0 ? "passed" : "FAILED");
+
+	mz_DestroySceneData(&Scene);
+	return NumFailures == 0 && NumDirtyRangeFailures == 0;
+}
+
+//
+// Handle pools.
+//
+// NOTE: Items have the size of mz_DX12Resource. Each live item stores its own handle, so a slot reached through
+// a wrong handle is noticed.
+struct mz_PoolTestItem
+{
+	void* Raw;
+	uint32_t State;
+	uint32_t Format;
+	mz_Handle Handle;
+};
+
+struct mz_LivePoolItem
+{
+	mz_Handle Handle;
+	mz_PoolTestItem* Item; // Pointer taken at allocation, must stay valid while the pool grows.
+};
+
+// Random allocations and releases against a list of live handles, every released handle is checked to stay invalid.
+// Returns number of failures.
+static uint32_t
+mz_ValidateHandlePool(uint32_t NumOperations)
+{
+	mz_HandlePool Pool;
+	mz_InitHandlePool(&Pool, sizeof(mz_PoolTestItem), 64);
+
+	uint32_t NumFailures = 0;
+	eastl::vector<mz_LivePoolItem> Live;
+	eastl::vector<mz_Handle> Released;
+	uint32_t State = 11;
+	for (uint32_t Operation = 0; Operation < NumOperations; ++Operation)
+	{
+		mz_SimulateWork(1, &State);
+		// Mostly allocations in the first half, mostly releases in the second one.
+		bool bShouldAllocate = Live.empty() || State % 100 < (Operation < NumOperations / 2 ? 65u : 35u);
+		if (bShouldAllocate)
+		{
+			mz_PoolTestItem* Item;
+			mz_Handle Handle = mz_AllocateHandle(&Pool, (void**)&Item);
+			NumFailures += Handle == 0 || Item->Raw != nullptr || Item->Handle != 0;
+			Item->Raw = Item;
+			Item->Handle = Handle;
+			Live.push_back({ Handle, Item });
+		}
+		else
+		{
+			uint32_t Idx = (State >> 8) % Live.size();
+			mz_FreeHandle(&Pool, Live[Idx].Handle);
+			Released.push_back(Live[Idx].Handle);
+			Live.erase_unsorted(Live.begin() + Idx);
+		}
+
+		if (Operation % 1024 == 0 || Operation + 1 == NumOperations)
+		{
+			for (const mz_LivePoolItem& Entry : Live)
+			{
+				auto Item = (mz_PoolTestItem*)mz_GetHandleItem(&Pool, Entry.Handle);
+				NumFailures += !mz_IsHandleValid(&Pool, Entry.Handle) || Item != Entry.Item || Item->Handle != Entry.Handle || Item->Raw != Item;
+			}
+			for (mz_Handle Handle : Released)
+			{
+				NumFailures += mz_IsHandleValid(&Pool, Handle);
+			}
+			uint32_t NumLiveSlots = 0;
+			for (uint32_t SlotIdx = 0; SlotIdx < Pool.Slots.size(); ++SlotIdx)
+			{
+				NumLiveSlots += mz_GetLiveSlotItem(&Pool, SlotIdx) != nullptr;
+			}
+			NumFailures += NumLiveSlots != Live.size() || Pool.NumLive != Live.size();
+		}
+	}
+	NumFailures += mz_IsHandleValid(&Pool, 0) || mz_IsHandleValid(&Pool, ~0u);
+
+	// One slot reused until its generation runs out is retired, the handle of its last use stays invalid.
+	mz_HandlePool SmallPool;
+	mz_InitHandlePool(&SmallPool, sizeof(mz_PoolTestItem), 1);
+	mz_Handle LastHandle = 0;
+	for (uint32_t Idx = 0; Idx < mz_HANDLE_MAX_GENERATION; ++Idx)
+	{
+		void* Item;
+		LastHandle = mz_AllocateHandle(&SmallPool, &Item);
+		NumFailures += (LastHandle & ((1u << mz_HANDLE_INDEX_BITS) - 1)) != 0;
+		mz_FreeHandle(&SmallPool, LastHandle);
+	}
+	void* Item;
+	mz_Handle Handle = mz_AllocateHandle(&SmallPool, &Item);
+	NumFailures += (Handle & ((1u << mz_HANDLE_INDEX_BITS) - 1)) != 1 || mz_IsHandleValid(&SmallPool, LastHandle);
+
+	mz_DestroyHandlePool(&SmallPool);
+	mz_DestroyHandlePool(&Pool);
+	return NumFailures;
+}
+
+// What mz_AddDX12Resource did before the pools: first free slot of a fixed array.
+static mz_PoolTestItem*
+mz_AddItemLinearScan(mz_PoolTestItem* Items, uint32_t NumItems)
+{
+	for (uint32_t Idx = 0; Idx < NumItems; ++Idx)
+	{
+		if (Items[Idx].Raw == nullptr)
+		{
+			Items[Idx].Raw = &Items[Idx];
+			return &Items[Idx];
+		}
+	}
+	return nullptr;
+}
+
+// Creating N resources (textures of a big scene) and then releasing and creating one resource at a time, pool against
+// the linear scan of a fixed array.
+static bool
+mz_BenchmarkPools(uint32_t NumIterations)
+{
+	const uint32_t NumItems = 32 * 1024;
+	const uint32_t NumReplacements = 4 * 1024;
+
+	uint32_t NumFailures = mz_ValidateHandlePool(200000);
+
+	double PoolCreateTime = 1.0e9;
+	double PoolReplaceTime = 1.0e9;
+	double ScanCreateTime = 1.0e9;
+	double ScanReplaceTime = 1.0e9;
+	eastl::vector<mz_Handle> Handles(NumItems);
+	eastl::vector<mz_PoolTestItem> ScanItems(NumItems);
+	for (uint32_t Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		mz_HandlePool Pool;
+		mz_InitHandlePool(&Pool, sizeof(mz_PoolTestItem), 256);
+
+		double Time = mz_GetTime();
+		for (uint32_t Idx = 0; Idx < NumItems; ++Idx)
+		{
+			mz_PoolTestItem* Item;
+			Handles[Idx] = mz_AllocateHandle(&Pool, (void**)&Item);
+			Item->Raw = Item;
+		}
+		PoolCreateTime = eastl::min(PoolCreateTime, mz_GetTime() - Time);
+
+		Time = mz_GetTime();
+		for (uint32_t Idx = 0; Idx < NumReplacements; ++Idx)
+		{
+			uint32_t ItemIdx = (Idx * 7919) % NumItems;
+			mz_FreeHandle(&Pool, Handles[ItemIdx]);
+			mz_PoolTestItem* Item;
+			Handles[ItemIdx] = mz_AllocateHandle(&Pool, (void**)&Item);
+			Item->Raw = Item;
+		}
+		PoolReplaceTime = eastl::min(PoolReplaceTime, mz_GetTime() - Time);
+		mz_DestroyHandlePool(&Pool);
+
+		eastl::fill(ScanItems.begin(), ScanItems.end(), mz_PoolTestItem{});
+		Time = mz_GetTime();
+		for (uint32_t Idx = 0; Idx < NumItems; ++Idx)
+		{
+			NumFailures += mz_AddItemLinearScan(ScanItems.data(), NumItems) == nullptr;
+		}
+		ScanCreateTime = eastl::min(ScanCreateTime, mz_GetTime() - Time);
+
+		// Released slots are spread over the array, like resources released at random.
+		Time = mz_GetTime();
+		for (uint32_t Idx = 0; Idx < NumReplacements; ++Idx)
+		{
+			ScanItems[(Idx * 7919) % NumItems].Raw = nullptr;
+			NumFailures += mz_AddItemLinearScan(ScanItems.data(), NumItems) == nullptr;
+		}
+		ScanReplaceTime = eastl::min(ScanReplaceTime, mz_GetTime() - Time);
+	}
+
+	printf("Pools: 200000 random operations %s.\n", NumFailures == 0 ? "passed" : "FAILED");
+	printf("Pools: %u creations %.3f ms (linear scan %.3f ms), %u release+create pairs %.3f ms (linear scan %.3f ms).\n",
+		NumItems, PoolCreateTime * 1000.0, ScanCreateTime * 1000.0, NumReplacements, PoolReplaceTime * 1000.0, ScanReplaceTime * 1000.0);
+	return NumFailures == 0;
+}
+
+//
+// Upload rings.
+//
+// NOTE: GPU is simulated by a fence value: frame N completes a random number of frames after it was submitted,
+// but never more than one frame stays in flight (like mz_PresentFrame).
+struct mz_SimulatedFence
+{
+	uint64_t NumFrames; // Last value signaled.
+	uint64_t CompletedValue;
+};
+
+// Same policy as mz_AllocateUploadMemory, false means a dedicated buffer.
+static bool
+mz_AllocateSimulatedUpload(mz_UploadRing* Ring, mz_SimulatedFence* Fence, uint64_t Size, uint64_t Alignment, uint64_t* OutOffset, uint32_t* InOutNumWaits)
+{
+	if (Size > Ring->Capacity / 4)
+	{
+		return false;
+	}
+	bool bIsAllocated = mz_AllocateFromUploadRing(Ring, Size, Alignment, OutOffset);
+	while (!bIsAllocated && mz_GetOldestUploadRingFence(Ring) != 0)
+	{
+		uint64_t FenceValue = mz_GetOldestUploadRingFence(Ring);
+		if (Fence->CompletedValue < FenceValue)
+		{
+			Fence->CompletedValue = FenceValue;
+			++*InOutNumWaits;
+		}
+		mz_RetireUploadRing(Ring, FenceValue);
+		bIsAllocated = mz_AllocateFromUploadRing(Ring, Size, Alignment, OutOffset);
+	}
+	return bIsAllocated;
+}
+
+// Frames of random uploads (constants, textures, rare bursts bigger than the ring), every byte remembers the frame which
+// wrote it last and must not be handed out again before that frame completes. Returns number of failures.
+static uint32_t
+mz_ValidateUploadRing(uint32_t NumFrames, uint32_t* OutNumResourceUploads, uint32_t* OutNumDedicatedBuffers, uint32_t* OutNumWaits)
+{
+	static const uint64_t Alignments[8] = { 16, 16, 16, 256, 256, 256, 512, 64 * 1024 };
+	const uint64_t Capacity = 1024 * 1024;
+
+	uint32_t NumFailures = 0;
+
+	// Wrap: allocation which would cross the end starts at 0 and the skipped tail counts until it is retired.
+	{
+		mz_UploadRing Ring;
+		mz_InitUploadRing(&Ring, 1024);
+		uint64_t Offset = ~0ull;
+		NumFailures += !mz_AllocateFromUploadRing(&Ring, 600, 16, &Offset) || Offset != 0;
+		NumFailures += mz_AllocateFromUploadRing(&Ring, 600, 16, &Offset);
+		mz_SubmitUploadRing(&Ring, 1);
+		mz_SubmitUploadRing(&Ring, 2); // Nothing new, no submission.
+		NumFailures += Ring.Submissions.size() != 1 || mz_GetOldestUploadRingFence(&Ring) != 1;
+		mz_RetireUploadRing(&Ring, 0);
+		NumFailures += mz_AllocateFromUploadRing(&Ring, 600, 16, &Offset);
+		mz_RetireUploadRing(&Ring, 1);
+		NumFailures += !mz_AllocateFromUploadRing(&Ring, 600, 16, &Offset) || Offset != 0 || Ring.Head != 1624;
+		NumFailures += mz_AllocateFromUploadRing(&Ring, 16, 16, &Offset); // Bytes 600 to 1024 were skipped.
+		mz_SubmitUploadRing(&Ring, 3);
+		mz_RetireUploadRing(&Ring, 3);
+		NumFailures += Ring.Head != Ring.Tail || !Ring.Submissions.empty() || mz_GetOldestUploadRingFence(&Ring) != 0;
+	}
+
+	mz_UploadRing Ring;
+	mz_InitUploadRing(&Ring, Capacity);
+	mz_SimulatedFence Fence = {};
+	eastl::vector<uint64_t> Owners(Capacity, 0); // Fence value of the frame which used the byte last.
+
+	*OutNumResourceUploads = 0;
+	*OutNumDedicatedBuffers = 0;
+	*OutNumWaits = 0;
+	uint32_t State = 23;
+	for (uint32_t Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		uint64_t FrameFenceValue = Fence.NumFrames + 1; // Signaled after the frame.
+
+		mz_SimulateWork(1, &State);
+		uint32_t NumUploads = 1 + State % 48;
+		bool bIsBurst = (State >> 8) % 64 == 0; // Load time, more than the ring holds before anything is submitted.
+		for (uint32_t UploadIdx = 0; UploadIdx < NumUploads; ++UploadIdx)
+		{
+			mz_SimulateWork(1, &State);
+			uint32_t Kind = State % 100;
+			uint64_t Size;
+			if (Kind < 70 && !bIsBurst)
+			{
+				Size = 16 + (State >> 8) % 1024;
+			}
+			else
+			{
+				Size = 1 + (State >> 8) % (Kind < 97 ? 96 * 1024 : Capacity / 2);
+				++*OutNumResourceUploads;
+			}
+			uint64_t Alignment = Alignments[(State >> 28) % 8];
+
+			uint64_t Offset;
+			if (!mz_AllocateSimulatedUpload(&Ring, &Fence, Size, Alignment, &Offset, OutNumWaits))
+			{
+				++*OutNumDedicatedBuffers;
+				continue;
+			}
+			if (Offset % Alignment != 0 || Offset + Size > Capacity)
+			{
+				++NumFailures;
+				continue;
+			}
+
+			bool bIsInUse = false;
+			for (uint64_t Byte = Offset; Byte < Offset + Size; ++Byte)
+			{
+				bIsInUse |= Owners[Byte] > Fence.CompletedValue;
+				Owners[Byte] = FrameFenceValue;
+			}
+			NumFailures += bIsInUse;
+		}
+
+		mz_SubmitUploadRing(&Ring, ++Fence.NumFrames);
+
+		mz_SimulateWork(1, &State);
+		uint64_t Latency = State % 3;
+		if (Fence.NumFrames > Latency)
+		{
+			Fence.CompletedValue = eastl::max(Fence.CompletedValue, Fence.NumFrames - Latency);
+		}
+		if (Fence.NumFrames - Fence.CompletedValue >= 2)
+		{
+			Fence.CompletedValue = Fence.NumFrames - 1;
+		}
+		mz_RetireUploadRing(&Ring, Fence.CompletedValue);
+		NumFailures += Ring.Head - Ring.Tail > Capacity;
+	}
+
+	mz_RetireUploadRing(&Ring, Fence.NumFrames);
+	NumFailures += Ring.Head != Ring.Tail || !Ring.Submissions.empty();
+	return NumFailures;
+}
+
+// Steady stream of constant buffer sized allocations, frame retired two frames later (what the renderer does).
+static bool
+mz_BenchmarkUploadRing(uint32_t NumIterations)
+{
+	const uint32_t NumFrames = 5000;
+	const uint32_t NumAllocationsPerFrame = 1000;
+	const uint32_t NumTimedFrames = 1000;
+
+	uint32_t NumResourceUploads, NumDedicatedBuffers, NumWaits;
+	uint32_t NumFailures = mz_ValidateUploadRing(NumFrames, &NumResourceUploads, &NumDedicatedBuffers, &NumWaits);
+
+	double AllocationTime = 1.0e9;
+	for (uint32_t Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		mz_UploadRing Ring;
+		mz_InitUploadRing(&Ring, 64 * 1024 * 1024);
+
+		double Time = mz_GetTime();
+		for (uint64_t Frame = 1; Frame <= NumTimedFrames; ++Frame)
+		{
+			for (uint32_t Idx = 0; Idx < NumAllocationsPerFrame; ++Idx)
+			{
+				uint64_t Offset;
+				NumFailures += !mz_AllocateFromUploadRing(&Ring, 256, 256, &Offset);
+			}
+			mz_SubmitUploadRing(&Ring, Frame);
+			mz_RetireUploadRing(&Ring, Frame - 1);
+		}
+		AllocationTime = eastl::min(AllocationTime, mz_GetTime() - Time);
+	}
+
+	printf("Upload: %u simulated frames %s (%u waits for the GPU).\n", NumFrames, NumFailures == 0 ? "passed" : "FAILED", NumWaits);
+	printf("Upload: %u resource uploads, %u dedicated upload buffers (one per upload before).\n", NumResourceUploads, NumDedicatedBuffers);
+	printf("Upload: %u ring allocations %.3f ms (%.1f ns each).\n", NumTimedFrames * NumAllocationsPerFrame, AllocationTime * 1000.0,
+		AllocationTime * 1.0e9 / (NumTimedFrames * NumAllocationsPerFrame));
+	return NumFailures == 0;
+}
+
+static void
+mz_SetupCamera(const mz_BenchmarkCamera& Camera, uint32_t Width, uint32_t Height, mz_PerFrameConstantData* OutFrameData)
+{
+	// Same light and projection as SimpleRaytracer.cpp, yaw and pitch are computed from the camera target.
+	mz_Float3 Forward = mz_Normalize(Camera.Target - Camera.Position);
+	float Yaw = atan2f(Forward.x, Forward.z);
+	float Pitch = -asinf(Forward.y);
+
+	*OutFrameData = {};
+	mz_ComputeProjectionToWorld(Camera.Position, Yaw, Pitch, 3.1415926f / 3, (float)Width / Height, 0.1f, 100.0f, &OutFrameData->ProjectionToWorld);
+	OutFrameData->CameraPosition = XMFLOAT4(Camera.Position.x, Camera.Position.y, Camera.Position.z, 1.0f);
+	OutFrameData->LightPositions[0] = XMFLOAT4(0.0f, 10.0f, 0.0f, 1.0f);
+	OutFrameData->LightColors[0] = XMFLOAT4(600.0f, 600.0f, 400.0f, 1.0f);
+}
+
+int32_t
+main(int32_t Argc, char** Argv)
+{
+	mz_BenchmarkOptions Options;
+	if (!mz_ParseCommandLine(Argc, Argv, &Options))
+	{
+		return 1;
+	}
+
+	if (Options.bBenchmarkJobs)
+	{
+		uint32_t MaxThreads = Options.NumThreads ? Options.NumThreads : eastl::max(std::thread::hardware_concurrency(), 1u);
+		return mz_BenchmarkJobs(MaxThreads, Options.NumIterations) ? 0 : 1;
+	}
+	if (Options.bBenchmarkTables)
+	{
+		return mz_BenchmarkTables(Options.NumIterations) ? 0 : 1;
+	}
+	if (Options.bBenchmarkPools)
+	{
+		return mz_BenchmarkPools(Options.NumIterations) ? 0 : 1;
+	}
+	if (Options.bBenchmarkUpload)
+	{
+		return mz_BenchmarkUploadRing(Options.NumIterations) ? 0 : 1;
+	}
+
+	FILE* File = fopen(Options.OutputFileName, "wb");
+	if (!File)
+	{
+		printf("Failed to open %s.\n", Options.OutputFileName);
+		return 1;
+	}
+
+	mz_InitJobSystem(Options.NumThreads);
+
+	uint32_t BVHWidth = Options.BVHWidth ? Options.BVHWidth : (mz_HAS_BVH8 ? 8 : 4);
+
+	// NOTE: Format is versioned, bump "version" whenever meaning of an existing field changes.
+	fprintf(File, "{\n");
+	fprintf(File, "\t\"version\": 3,\n");
+	fprintf(File, "\t\"width\": %u,\n\t\"height\": %u,\n", Options.Width, Options.Height);
+	fprintf(File, "\t\"threads\": %u,\n\t\"iterations\": %u,\n", mz_GetNumJobThreads(), Options.NumIterations);
+	fprintf(File, "\t\"bvh_width\": %u,\n\t\"packets\": %s,\n", BVHWidth, Options.bUsePackets ? "true" : "false");
+	fprintf(File, "\t\"scenes\": [");
+
+	uint32_t NumHitMismatches = 0; // Cameras whose shadow rays got different number of hits from different traversals.
+
+	for (uint32_t SceneIdx = 0; SceneIdx < eastl::size(GBenchmarkScenes); ++SceneIdx)
+	{
+		const mz_BenchmarkScene& BenchmarkScene = GBenchmarkScenes[SceneIdx];
+		fprintf(File, "%s\n\t\t{\n\t\t\t\"name\": \"%s\",\n", SceneIdx > 0 ? "," : "", BenchmarkScene.Name);
+
+		const char* MissingFile = nullptr;
+		for (const char* RequiredFile : BenchmarkScene.RequiredFiles)
+		{
+			if (RequiredFile && !mz_FileExists(RequiredFile))
+			{
+				MissingFile = RequiredFile;
+				break;
+			}
+		}
+		if (MissingFile)
+		{
+			printf("%s: skipped (%s not found).\n", BenchmarkScene.Name, MissingFile);
+			fprintf(File, "\t\t\t\"skipped\": true\n\t\t}");
+			continue;
+		}
+
+		mz_SceneData Scene = {};
+		BenchmarkScene.Load(&Scene);
+
+		mz_CPUScene* CPUScene = mz_CreateCPUScene(&Scene, nullptr, Options.NumThreads);
+		CPUScene->BVHWidth = BVHWidth;
+		CPUScene->bUsePackets = Options.bUsePackets;
+
+		printf("%s: %u triangles, %u instances, BVH built in %.2f ms.\n", BenchmarkScene.Name, mz_GetNumTriangles(&Scene), (uint32_t)CPUScene->Instances.size(), CPUScene->BVHBuildTime * 1000.0);
+		fprintf(File, "\t\t\t\"skipped\": false,\n");
+		fprintf(File, "\t\t\t\"triangles\": %u,\n\t\t\t\"instances\": %u,\n", mz_GetNumTriangles(&Scene), (uint32_t)CPUScene->Instances.size());
+		fprintf(File, "\t\t\t\"bvh_build_ms\": %.3f,\n\t\t\t\"bvh_sah_cost\": %.3f,\n", CPUScene->BVHBuildTime * 1000.0, CPUScene->BVHSAHCost);
+		fprintf(File, "\t\t\t\"cameras\": [");
+
+		for (uint32_t CameraIdx = 0; CameraIdx < mz_MAX_BENCHMARK_CAMERAS; ++CameraIdx)
+		{
+			const mz_BenchmarkCamera& Camera = BenchmarkScene.Cameras[CameraIdx];
+
+			mz_PerFrameConstantData FrameData;
+			mz_SetupCamera(Camera, Options.Width, Options.Height, &FrameData);
+
+			mz_RayBenchmarkResult Result;
+			mz_BenchmarkRays(CPUScene, &FrameData, Options.Width, Options.Height, Options.NumThreads, Options.NumIterations, &Result);
+
+			printf("  Camera %u:", CameraIdx);
+			fprintf(File, "%s\n\t\t\t\t{\n", CameraIdx > 0 ? "," : "");
+			fprintf(File, "\t\t\t\t\t\"position\": [%.3f, %.3f, %.3f],\n", Camera.Position.x, Camera.Position.y, Camera.Position.z);
+			fprintf(File, "\t\t\t\t\t\"target\": [%.3f, %.3f, %.3f]", Camera.Target.x, Camera.Target.y, Camera.Target.z);
+
+			for (uint32_t RayClass = 0; RayClass < mz_RAY_CLASS_COUNT; ++RayClass)
+			{
+				printf(" %s %.2f Mrays/s", GRayClassNames[RayClass], Result.MRaysPerSecond[RayClass]);
+				fprintf(File, ",\n\t\t\t\t\t\"%s\": { \"rays\": %llu, \"hits\": %llu, \"seconds\": %.6f, \"mrays_per_second\": %.3f",
+					GRayClassNames[RayClass], (unsigned long long)Result.NumRays[RayClass], (unsigned long long)Result.NumHits[RayClass], Result.Seconds[RayClass], Result.MRaysPerSecond[RayClass]);
+				if (RayClass == mz_RAY_CLASS_SHADOW)
+				{
+					fprintf(File, ", \"closest_hit_mrays_per_second\": %.3f, \"first_hit_mrays_per_second\": %.3f", Result.ShadowClosestHitMRaysPerSecond, Result.ShadowFirstHitMRaysPerSecond);
+					fprintf(File, ", \"closest_hit_hits\": %llu, \"first_hit_hits\": %llu", (unsigned long long)Result.ShadowClosestHitNumHits, (unsigned long long)Result.ShadowFirstHitNumHits);
+				}
+				fprintf(File, " }");
+			}
+			printf("\n");
+			printf("  Camera %u: occlusion query speedup %.2fx vs. closest hit, %.2fx vs. first hit traversal\n", CameraIdx,
+				Result.MRaysPerSecond[mz_RAY_CLASS_SHADOW] / Result.ShadowClosestHitMRaysPerSecond, Result.MRaysPerSecond[mz_RAY_CLASS_SHADOW] / Result.ShadowFirstHitMRaysPerSecond);
+
+			// NOTE: All three traversals see the same rays, so a different number of hits is a traversal bug.
+			uint64_t NumShadowHits = Result.NumHits[mz_RAY_CLASS_SHADOW];
+			if (Result.ShadowClosestHitNumHits != NumShadowHits || Result.ShadowFirstHitNumHits != NumShadowHits)
+			{
+				printf("  Camera %u: FAILED, shadow ray hits differ (occlusion query %llu, closest hit %llu, first hit %llu)\n", CameraIdx,
+					(unsigned long long)NumShadowHits, (unsigned long long)Result.ShadowClosestHitNumHits, (unsigned long long)Result.ShadowFirstHitNumHits);
+				NumHitMismatches++;
+			}
+			fprintf(File, "\n\t\t\t\t}");
+		}
+		fprintf(File, "\n\t\t\t]\n\t\t}");
+
+		mz_DestroyCPUScene(CPUScene);
+		mz_DestroySceneData(&Scene);
+	}
+
+	fprintf(File, "\n\t],\n\t\"hit_mismatches\": %u\n}\n", NumHitMismatches);
+	fclose(File);
+	printf("Results written to %s.\n", Options.OutputFileName);
+	mz_ShutdownJobSystem();
+	return NumHitMismatches == 0 ? 0 : 1;
+}
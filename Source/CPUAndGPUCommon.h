@@ -1,8 +1,35 @@
 #pragma once
 
 #ifdef __cplusplus
+#if defined(_MSC_VER)
 #include "DirectXMath/DirectXMath.h"
 using namespace DirectX;
+#else
+// NOTE: Bundled DirectXMath requires MSVC. Other compilers (headless builds) get storage types only.
+#include <stdint.h>
+struct XMFLOAT2
+{
+	float x, y;
+	XMFLOAT2() = default;
+	constexpr XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+};
+struct XMFLOAT3
+{
+	float x, y, z;
+	XMFLOAT3() = default;
+	constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+};
+struct XMFLOAT4
+{
+	float x, y, z, w;
+	XMFLOAT4() = default;
+	constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	explicit XMFLOAT4(const float* Array) : x(Array[0]), y(Array[1]), z(Array[2]), w(Array[3]) {}
+};
+struct XMFLOAT3X4 { float m[3][4]; };
+struct XMFLOAT4X3 { float m[4][3]; };
+struct XMFLOAT4X4 { float m[4][4]; };
+#endif
 typedef XMFLOAT4X4 float4x4;
 typedef XMFLOAT4X3 float4x3;
 typedef XMFLOAT2 float2;
@@ -33,16 +60,34 @@ struct mz_Vertex
 	float2 Texcoord;
 };
 
+// NOTE: GPU path stores vertices as mz_CompactVertex when set (loader and shaders must agree).
+#define mz_USE_COMPACT_VERTICES 0
+
+// 20 bytes instead of 48. Position is SNORM16 relative to mesh bounds (see mz_PerGeometryRootData), normal and tangent
+// are octahedral SNORM16 pairs, texcoord is half precision.
+struct mz_CompactVertex
+{
+	uint PositionXY;
+	uint PositionZW; // W is tangent handedness (+-1).
+	uint Normal;
+	uint Tangent;
+	uint Texcoord;
+};
+
 struct mz_Transform4x3
 {
 	float4x3 Transform;
 };
 
+// One per (mesh, section) pair. Object is identified by InstanceID().
 struct mz_PerGeometryRootData
 {
-	uint ObjectIndex;
+	float3 PositionCenter; // Dequantization of mz_CompactVertex positions: Center + Extent * Position.
 	uint BaseVertex;
-	uint BaseIndex;
+	float3 PositionExtent;
+	uint IndexOffset; // In bytes, into the raw index buffer.
+	uint IndexSize; // 2 or 4.
+	uint Unused;
 };
 
 #ifdef __cplusplus
@@ -0,0 +1,3207 @@
+#include "CPURaytracer.h"
+#include <atomic>
+#include <immintrin.h>
+#include "EASTL/sort.h"
+
+#define mz_PI 3.1415926f
+#define mz_MAX_RECURSION_DEPTH 3
+#define mz_MAX_LEAF_PRIMITIVES 4
+#define mz_BVH_MAX_DEPTH 63 // Of any leaf, root is 0 (see mz_BuildBVHRecursive).
+#define mz_BVH_STACK_SIZE (mz_BVH_MAX_DEPTH + 1) // One sibling per level above plus both children of the current node.
+#define mz_WIDE_BVH_STACK_SIZE (mz_BVH_MAX_DEPTH * 7 + 8) // Same for BVH8, wide nodes are never deeper than binary ones.
+#define mz_SAH_MAX_BINS 16
+#define mz_BVH_PARALLEL_THRESHOLD 4096
+#define mz_BVH_PARALLEL_BINNING_THRESHOLD 65536
+#define mz_BVH_MAX_CHUNKS 32
+#define mz_TILE_SIZE 16
+#define mz_PACKET_MIN_RAYS 4
+
+static inline uint32_t
+mz_CountTrailingZeros(uint32_t Mask)
+{
+#if defined(_MSC_VER)
+	unsigned long Index;
+	_BitScanForward(&Index, Mask);
+	return (uint32_t)Index;
+#else
+	return (uint32_t)__builtin_ctz(Mask);
+#endif
+}
+
+static inline uint32_t
+mz_PopCount64(uint64_t Mask)
+{
+#if defined(_MSC_VER)
+	return (uint32_t)__popcnt64(Mask);
+#else
+	return (uint32_t)__builtin_popcountll(Mask);
+#endif
+}
+
+static inline uint32_t
+mz_CountTrailingZeros64(uint64_t Mask)
+{
+#if defined(_MSC_VER)
+	unsigned long Index;
+	_BitScanForward64(&Index, Mask);
+	return (uint32_t)Index;
+#else
+	return (uint32_t)__builtin_ctzll(Mask);
+#endif
+}
+
+//
+// BVH.
+//
+struct mz_BVHBuildContext
+{
+	const mz_AABB* PrimitiveBounds;
+	eastl::vector<mz_Float3> Centroids;
+	mz_BVH* BVH;
+	std::atomic<uint32_t> NumNodes;
+	std::atomic<uint32_t> NumActiveThreads;
+	uint32_t MaxThreads;
+};
+
+struct mz_SAHBin
+{
+	mz_AABB Bounds;
+	uint32_t NumPrimitives;
+};
+
+static inline uint32_t
+mz_GetBinIndex(float Centroid, float Min, float Scale, uint32_t NumBins)
+{
+	int32_t Bin = (int32_t)((Centroid - Min) * Scale);
+	return Bin < 0 ? 0 : (Bin >= (int32_t)NumBins ? NumBins - 1 : (uint32_t)Bin);
+}
+
+static void
+mz_ComputeBounds(const mz_BVHBuildContext* Context, uint32_t Begin, uint32_t End, mz_AABB* OutBounds, mz_AABB* OutCentroidBounds)
+{
+	const uint32_t* Indices = Context->BVH->PrimitiveIndices.data();
+
+	mz_AABB Bounds = mz_EmptyAABB();
+	mz_AABB CentroidBounds = mz_EmptyAABB();
+	for (uint32_t Idx = Begin; Idx < End; ++Idx)
+	{
+		mz_GrowAABB(&Bounds, Context->PrimitiveBounds[Indices[Idx]]);
+		mz_GrowAABB(&CentroidBounds, Context->Centroids[Indices[Idx]]);
+	}
+	*OutBounds = Bounds;
+	*OutCentroidBounds = CentroidBounds;
+}
+
+// All three axes are binned in one pass.
+static void
+mz_BinPrimitives(const mz_BVHBuildContext* Context, uint32_t Begin, uint32_t End, uint32_t NumBins, mz_Float3 CentroidMin, const float BinScale[3], mz_SAHBin OutBins[3][mz_SAH_MAX_BINS])
+{
+	const uint32_t* Indices = Context->BVH->PrimitiveIndices.data();
+
+	for (uint32_t Axis = 0; Axis < 3; ++Axis)
+	{
+		for (uint32_t BinIdx = 0; BinIdx < NumBins; ++BinIdx)
+		{
+			OutBins[Axis][BinIdx].Bounds = mz_EmptyAABB();
+			OutBins[Axis][BinIdx].NumPrimitives = 0;
+		}
+	}
+	for (uint32_t Idx = Begin; Idx < End; ++Idx)
+	{
+		const mz_AABB& PrimBounds = Context->PrimitiveBounds[Indices[Idx]];
+		mz_Float3 Centroid = Context->Centroids[Indices[Idx]];
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			mz_SAHBin& Bin = OutBins[Axis][mz_GetBinIndex(mz_GetComponent(Centroid, Axis), mz_GetComponent(CentroidMin, Axis), BinScale[Axis], NumBins)];
+			mz_GrowAABB(&Bin.Bounds, PrimBounds);
+			Bin.NumPrimitives++;
+		}
+	}
+}
+
+// Splits [Begin, End) into NumChunks ranges and runs 'Function(ChunkIdx, ChunkBegin, ChunkEnd)' for each one as a job.
+template<typename F> static void
+mz_ForEachChunk(uint32_t NumChunks, uint32_t Begin, uint32_t End, F Function)
+{
+	uint32_t ChunkSize = (End - Begin + NumChunks - 1) / NumChunks;
+	mz_ParallelFor(NumChunks, 1, [Begin, End, ChunkSize, &Function](uint32_t FirstChunk, uint32_t EndChunk)
+	{
+		for (uint32_t ChunkIdx = FirstChunk; ChunkIdx < EndChunk; ++ChunkIdx)
+		{
+			uint32_t ChunkBegin = Begin + ChunkIdx * ChunkSize;
+			uint32_t ChunkEnd = ChunkBegin + ChunkSize < End ? ChunkBegin + ChunkSize : End;
+			Function(ChunkIdx, ChunkBegin, ChunkEnd);
+		}
+	});
+}
+
+static bool
+mz_TryAcquireBuildThread(mz_BVHBuildContext* Context)
+{
+	uint32_t NumActive = Context->NumActiveThreads.load();
+	while (NumActive < Context->MaxThreads)
+	{
+		if (Context->NumActiveThreads.compare_exchange_weak(NumActive, NumActive + 1))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static void
+mz_BuildBVHRecursive(mz_BVHBuildContext* Context, uint32_t NodeIdx, uint32_t Depth, uint32_t Begin, uint32_t End)
+{
+	mz_BVH* BVH = Context->BVH;
+	uint32_t* Indices = BVH->PrimitiveIndices.data();
+	const mz_Float3* Centroids = Context->Centroids.data();
+	uint32_t NumPrimitives = End - Begin;
+
+	// Top-level nodes are too big to be processed by one thread, binning is split into chunks.
+	uint32_t NumChunks = 1;
+	if (NumPrimitives >= mz_BVH_PARALLEL_BINNING_THRESHOLD)
+	{
+		uint32_t NumIdle = Context->MaxThreads - eastl::min(Context->NumActiveThreads.load(), Context->MaxThreads);
+		NumChunks = eastl::min(eastl::min(NumIdle + 1, (uint32_t)mz_BVH_MAX_CHUNKS), NumPrimitives / mz_BVH_PARALLEL_THRESHOLD);
+	}
+
+	mz_AABB Bounds, CentroidBounds;
+	if (NumChunks > 1)
+	{
+		mz_AABB ChunkBounds[mz_BVH_MAX_CHUNKS][2];
+		mz_ForEachChunk(NumChunks, Begin, End, [Context, &ChunkBounds](uint32_t ChunkIdx, uint32_t ChunkBegin, uint32_t ChunkEnd)
+		{
+			mz_ComputeBounds(Context, ChunkBegin, ChunkEnd, &ChunkBounds[ChunkIdx][0], &ChunkBounds[ChunkIdx][1]);
+		});
+
+		Bounds = ChunkBounds[0][0];
+		CentroidBounds = ChunkBounds[0][1];
+		for (uint32_t ChunkIdx = 1; ChunkIdx < NumChunks; ++ChunkIdx)
+		{
+			mz_GrowAABB(&Bounds, ChunkBounds[ChunkIdx][0]);
+			mz_GrowAABB(&CentroidBounds, ChunkBounds[ChunkIdx][1]);
+		}
+	}
+	else
+	{
+		mz_ComputeBounds(Context, Begin, End, &Bounds, &CentroidBounds);
+	}
+
+	mz_BVHNode* Node = &BVH->Nodes[NodeIdx];
+	Node->Bounds = Bounds;
+
+	if (NumPrimitives == 1)
+	{
+		Node->FirstChildOrPrimitive = Begin;
+		Node->NumPrimitives = NumPrimitives;
+		return;
+	}
+
+	// Binned SAH over all three axes. Cost of traversal step is 1, cost of triangle test is 1.
+	// NOTE: Small nodes use fewer bins, otherwise clearing and sweeping bins dominates build time.
+	uint32_t NumBins = NumPrimitives < mz_SAH_MAX_BINS ? NumPrimitives : mz_SAH_MAX_BINS;
+	float BinScale[3];
+	for (uint32_t Axis = 0; Axis < 3; ++Axis)
+	{
+		float Extent = mz_GetComponent(CentroidBounds.Max, Axis) - mz_GetComponent(CentroidBounds.Min, Axis);
+		BinScale[Axis] = Extent > 0.0f ? NumBins / Extent : 0.0f;
+	}
+
+	mz_SAHBin Bins[3][mz_SAH_MAX_BINS];
+	if (NumChunks > 1)
+	{
+		eastl::vector<mz_SAHBin> ChunkBins(NumChunks * 3 * mz_SAH_MAX_BINS);
+		mz_ForEachChunk(NumChunks, Begin, End, [Context, NumBins, &ChunkBins, &CentroidBounds, &BinScale](uint32_t ChunkIdx, uint32_t ChunkBegin, uint32_t ChunkEnd)
+		{
+			mz_BinPrimitives(Context, ChunkBegin, ChunkEnd, NumBins, CentroidBounds.Min, BinScale, (mz_SAHBin(*)[mz_SAH_MAX_BINS])&ChunkBins[ChunkIdx * 3 * mz_SAH_MAX_BINS]);
+		});
+
+		memcpy(Bins, ChunkBins.data(), sizeof(Bins));
+		for (uint32_t ChunkIdx = 1; ChunkIdx < NumChunks; ++ChunkIdx)
+		{
+			const mz_SAHBin* Src = &ChunkBins[ChunkIdx * 3 * mz_SAH_MAX_BINS];
+			for (uint32_t Axis = 0; Axis < 3; ++Axis)
+			{
+				for (uint32_t BinIdx = 0; BinIdx < NumBins; ++BinIdx)
+				{
+					mz_GrowAABB(&Bins[Axis][BinIdx].Bounds, Src[Axis * mz_SAH_MAX_BINS + BinIdx].Bounds);
+					Bins[Axis][BinIdx].NumPrimitives += Src[Axis * mz_SAH_MAX_BINS + BinIdx].NumPrimitives;
+				}
+			}
+		}
+	}
+	else
+	{
+		mz_BinPrimitives(Context, Begin, End, NumBins, CentroidBounds.Min, BinScale, Bins);
+	}
+
+	float BestCost = FLT_MAX;
+	uint32_t BestAxis = 0;
+	uint32_t BestSplit = 0;
+	for (uint32_t Axis = 0; Axis < 3; ++Axis)
+	{
+		if (BinScale[Axis] == 0.0f)
+		{
+			continue;
+		}
+
+		// Sweep from the right, then from the left, evaluating every plane between bins.
+		float RightCosts[mz_SAH_MAX_BINS];
+		mz_AABB RightBounds = mz_EmptyAABB();
+		uint32_t NumRight = 0;
+		for (uint32_t BinIdx = NumBins - 1; BinIdx > 0; --BinIdx)
+		{
+			mz_GrowAABB(&RightBounds, Bins[Axis][BinIdx].Bounds);
+			NumRight += Bins[Axis][BinIdx].NumPrimitives;
+			RightCosts[BinIdx] = NumRight > 0 ? mz_GetHalfArea(RightBounds) * NumRight : 0.0f;
+		}
+
+		mz_AABB LeftBounds = mz_EmptyAABB();
+		uint32_t NumLeft = 0;
+		for (uint32_t BinIdx = 0; BinIdx < NumBins - 1; ++BinIdx)
+		{
+			mz_GrowAABB(&LeftBounds, Bins[Axis][BinIdx].Bounds);
+			NumLeft += Bins[Axis][BinIdx].NumPrimitives;
+			if (NumLeft == 0 || NumLeft == NumPrimitives)
+			{
+				continue;
+			}
+
+			float Cost = mz_GetHalfArea(LeftBounds) * NumLeft + RightCosts[BinIdx + 1];
+			if (Cost < BestCost)
+			{
+				BestCost = Cost;
+				BestAxis = Axis;
+				BestSplit = BinIdx + 1;
+			}
+		}
+	}
+
+	float NodeArea = mz_GetHalfArea(Bounds);
+	float LeafCost = (float)NumPrimitives;
+	float SplitCost = NodeArea > 0.0f ? 1.0f + BestCost / NodeArea : FLT_MAX;
+
+	if (NumPrimitives <= mz_MAX_LEAF_PRIMITIVES && LeafCost <= SplitCost)
+	{
+		Node->FirstChildOrPrimitive = Begin;
+		Node->NumPrimitives = NumPrimitives;
+		return;
+	}
+
+	// NOTE: Median split of N primitives adds at most ceil(log2(N)) levels. Once an unbalanced SAH split could leave
+	// children too few levels for that, median is used so that no leaf is deeper than mz_BVH_MAX_DEPTH.
+	uint32_t MedianDepth = 0;
+	while ((1ull << MedianDepth) < NumPrimitives)
+	{
+		MedianDepth++;
+	}
+	bool bIsDepthLimited = Depth + 1 + MedianDepth > mz_BVH_MAX_DEPTH;
+
+	uint32_t Middle;
+	if (BestCost < FLT_MAX && bIsDepthLimited)
+	{
+		uint32_t Axis = 0;
+		mz_Float3 Extent = CentroidBounds.Max - CentroidBounds.Min;
+		Axis = Extent.y > mz_GetComponent(Extent, Axis) ? 1 : Axis;
+		Axis = Extent.z > mz_GetComponent(Extent, Axis) ? 2 : Axis;
+
+		Middle = (Begin + End) / 2;
+		eastl::nth_element(Indices + Begin, Indices + Middle, Indices + End, [Centroids, Axis](uint32_t A, uint32_t B)
+		{
+			return mz_GetComponent(Centroids[A], Axis) < mz_GetComponent(Centroids[B], Axis);
+		});
+	}
+	else if (BestCost < FLT_MAX)
+	{
+		float Min = mz_GetComponent(CentroidBounds.Min, BestAxis);
+		float Scale = BinScale[BestAxis];
+		uint32_t* Split = eastl::partition(Indices + Begin, Indices + End, [Centroids, BestAxis, BestSplit, Min, Scale, NumBins](uint32_t Idx)
+		{
+			return mz_GetBinIndex(mz_GetComponent(Centroids[Idx], BestAxis), Min, Scale, NumBins) < BestSplit;
+		});
+		Middle = (uint32_t)(Split - Indices);
+	}
+	else
+	{
+		// NOTE: All centroids are in the same place (or all land in one bin), SAH can't separate them.
+		Middle = (Begin + End) / 2;
+	}
+	mz_ASSERT(Middle > Begin && Middle < End);
+
+	// Children are allocated as a pair so that the second child is always 'FirstChild + 1'.
+	uint32_t FirstChildIdx = Context->NumNodes.fetch_add(2);
+	mz_ASSERT(FirstChildIdx + 2 <= BVH->Nodes.size());
+
+	Node->FirstChildOrPrimitive = FirstChildIdx;
+	Node->NumPrimitives = 0;
+
+	// Big subtrees are built as separate jobs, until all threads are busy.
+	if (Middle - Begin >= mz_BVH_PARALLEL_THRESHOLD && End - Middle >= mz_BVH_PARALLEL_THRESHOLD && mz_TryAcquireBuildThread(Context))
+	{
+		mz_ParallelFor(2, 1, [Context, FirstChildIdx, Depth, Begin, Middle, End](uint32_t FirstChild, uint32_t EndChild)
+		{
+			for (uint32_t ChildIdx = FirstChild; ChildIdx < EndChild; ++ChildIdx)
+			{
+				mz_BuildBVHRecursive(Context, FirstChildIdx + ChildIdx, Depth + 1, ChildIdx == 0 ? Begin : Middle, ChildIdx == 0 ? Middle : End);
+			}
+		});
+		Context->NumActiveThreads.fetch_sub(1);
+	}
+	else
+	{
+		mz_BuildBVHRecursive(Context, FirstChildIdx, Depth + 1, Begin, Middle);
+		mz_BuildBVHRecursive(Context, FirstChildIdx + 1, Depth + 1, Middle, End);
+	}
+}
+
+void
+mz_BuildBVH(const mz_AABB* PrimitiveBounds, uint32_t NumPrimitives, uint32_t NumThreads, mz_BVH* OutBVH)
+{
+	mz_ASSERT(PrimitiveBounds && OutBVH && NumPrimitives > 0);
+
+	if (NumThreads == 0)
+	{
+		NumThreads = mz_GetNumJobThreads();
+	}
+
+	mz_BVHBuildContext Context;
+	Context.PrimitiveBounds = PrimitiveBounds;
+	Context.BVH = OutBVH;
+	Context.NumNodes = 1;
+	Context.NumActiveThreads = 1;
+	Context.MaxThreads = NumThreads > 0 ? NumThreads : 1;
+
+	Context.Centroids.resize(NumPrimitives);
+	for (uint32_t Idx = 0; Idx < NumPrimitives; ++Idx)
+	{
+		Context.Centroids[Idx] = mz_GetCenter(PrimitiveBounds[Idx]);
+	}
+
+	// Binary tree with single-primitive leaves has at most 2N - 1 nodes.
+	OutBVH->Nodes.resize(NumPrimitives * 2);
+	OutBVH->PrimitiveIndices.resize(NumPrimitives);
+	for (uint32_t Idx = 0; Idx < NumPrimitives; ++Idx)
+	{
+		OutBVH->PrimitiveIndices[Idx] = Idx;
+	}
+
+	mz_BuildBVHRecursive(&Context, 0, 0, 0, NumPrimitives);
+
+	OutBVH->Nodes.resize(Context.NumNodes);
+	OutBVH->Nodes.shrink_to_fit();
+}
+
+float
+mz_ComputeSAHCost(const mz_BVH* BVH)
+{
+	mz_ASSERT(BVH && !BVH->Nodes.empty());
+
+	float RootArea = mz_GetHalfArea(BVH->Nodes[0].Bounds);
+	if (RootArea <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	// Same cost model as the builder: traversal step costs 1, triangle test costs 1.
+	float Cost = 0.0f;
+	for (const mz_BVHNode& Node : BVH->Nodes)
+	{
+		float Area = mz_GetHalfArea(Node.Bounds) / RootArea;
+		Cost += Node.NumPrimitives > 0 ? Area * Node.NumPrimitives : Area;
+	}
+	return Cost;
+}
+
+//
+// Wide BVH.
+//
+template<uint32_t Width> static uint32_t
+mz_CollapseBVHRecursive(const mz_BVH* BVH, uint32_t BinaryNodeIdx, eastl::vector<mz_WideBVHNode<Width>>* OutNodes)
+{
+	const mz_BVHNode* BinaryNodes = BVH->Nodes.data();
+
+	// Open the biggest interior child until all slots are used (or only leaves are left).
+	uint32_t Slots[Width];
+	uint32_t NumSlots = 0;
+	if (BinaryNodes[BinaryNodeIdx].NumPrimitives > 0)
+	{
+		Slots[NumSlots++] = BinaryNodeIdx;
+	}
+	else
+	{
+		Slots[NumSlots++] = BinaryNodes[BinaryNodeIdx].FirstChildOrPrimitive;
+		Slots[NumSlots++] = BinaryNodes[BinaryNodeIdx].FirstChildOrPrimitive + 1;
+	}
+
+	while (NumSlots < Width)
+	{
+		int32_t BestSlot = -1;
+		float BestArea = -1.0f;
+		for (uint32_t SlotIdx = 0; SlotIdx < NumSlots; ++SlotIdx)
+		{
+			const mz_BVHNode& Node = BinaryNodes[Slots[SlotIdx]];
+			if (Node.NumPrimitives == 0 && mz_GetHalfArea(Node.Bounds) > BestArea)
+			{
+				BestArea = mz_GetHalfArea(Node.Bounds);
+				BestSlot = (int32_t)SlotIdx;
+			}
+		}
+		if (BestSlot < 0)
+		{
+			break;
+		}
+
+		uint32_t FirstChildIdx = BinaryNodes[Slots[BestSlot]].FirstChildOrPrimitive;
+		Slots[BestSlot] = FirstChildIdx;
+		Slots[NumSlots++] = FirstChildIdx + 1;
+	}
+
+	uint32_t NodeIdx = (uint32_t)OutNodes->size();
+	OutNodes->push_back(mz_WideBVHNode<Width>{});
+
+	for (uint32_t SlotIdx = 0; SlotIdx < Width; ++SlotIdx)
+	{
+		mz_AABB Bounds = mz_EmptyAABB();
+		uint32_t Child = ~0u;
+		uint32_t NumPrimitives = 0;
+
+		if (SlotIdx < NumSlots)
+		{
+			const mz_BVHNode& Node = BinaryNodes[Slots[SlotIdx]];
+			Bounds = Node.Bounds;
+			if (Node.NumPrimitives > 0)
+			{
+				Child = Node.FirstChildOrPrimitive;
+				NumPrimitives = Node.NumPrimitives;
+			}
+			else
+			{
+				Child = mz_CollapseBVHRecursive<Width>(BVH, Slots[SlotIdx], OutNodes);
+			}
+		}
+
+		// NOTE: 'OutNodes' may have been reallocated by the recursive call.
+		mz_WideBVHNode<Width>& WideNode = (*OutNodes)[NodeIdx];
+		WideNode.Bounds[0][0][SlotIdx] = Bounds.Min.x;
+		WideNode.Bounds[0][1][SlotIdx] = Bounds.Min.y;
+		WideNode.Bounds[0][2][SlotIdx] = Bounds.Min.z;
+		WideNode.Bounds[1][0][SlotIdx] = Bounds.Max.x;
+		WideNode.Bounds[1][1][SlotIdx] = Bounds.Max.y;
+		WideNode.Bounds[1][2][SlotIdx] = Bounds.Max.z;
+		WideNode.Children[SlotIdx] = Child;
+		WideNode.NumPrimitives[SlotIdx] = NumPrimitives;
+	}
+
+	return NodeIdx;
+}
+
+template<uint32_t Width> void
+mz_CollapseBVH(const mz_BVH* BVH, eastl::vector<mz_WideBVHNode<Width>>* OutNodes)
+{
+	mz_ASSERT(BVH && OutNodes && !BVH->Nodes.empty());
+
+	OutNodes->clear();
+	OutNodes->reserve(BVH->Nodes.size() / (Width - 1) + 1);
+	mz_CollapseBVHRecursive<Width>(BVH, 0, OutNodes);
+}
+
+template void mz_CollapseBVH<4>(const mz_BVH*, eastl::vector<mz_BVH4Node>*);
+template void mz_CollapseBVH<8>(const mz_BVH*, eastl::vector<mz_BVH8Node>*);
+
+//
+// Scene.
+//
+template<uint32_t Width> static void
+mz_SetBlockTriangle(mz_TriangleBlock<Width>* Block, uint32_t Lane, const mz_CPUTriangle& Triangle)
+{
+	for (uint32_t Idx = 0; Idx < 3; ++Idx)
+	{
+		Block->Vertices[Idx][0][Lane] = Triangle.Vertices[Idx].x;
+		Block->Vertices[Idx][1][Lane] = Triangle.Vertices[Idx].y;
+		Block->Vertices[Idx][2][Lane] = Triangle.Vertices[Idx].z;
+	}
+	Block->GeometryIndex[Lane] = Triangle.GeometryIndex;
+	Block->PrimitiveIndex[Lane] = Triangle.PrimitiveIndex;
+}
+
+template<uint32_t Width> static void
+mz_RemapWideLeaves(const eastl::vector<uint32_t>& FirstTriangleToBlock, eastl::vector<mz_WideBVHNode<Width>>* Nodes)
+{
+	for (mz_WideBVHNode<Width>& Node : *Nodes)
+	{
+		for (uint32_t ChildIdx = 0; ChildIdx < Width; ++ChildIdx)
+		{
+			if (Node.NumPrimitives[ChildIdx] > 0)
+			{
+				Node.Children[ChildIdx] = FirstTriangleToBlock[Node.Children[ChildIdx]];
+				mz_ASSERT(Node.Children[ChildIdx] != ~0u);
+			}
+		}
+	}
+}
+
+static void
+mz_InvertTransform(const XMFLOAT3X4& M, XMFLOAT3X4* OutInverse)
+{
+	// Inverse of the 3x3 part is its adjugate divided by determinant, translation is -Inverse3x3 * Translation.
+	float A[3][3];
+	for (uint32_t Row = 0; Row < 3; ++Row)
+	{
+		for (uint32_t Column = 0; Column < 3; ++Column)
+		{
+			A[Row][Column] = M.m[Row][Column];
+		}
+	}
+	float Cofactor[3][3];
+	for (uint32_t Row = 0; Row < 3; ++Row)
+	{
+		uint32_t R0 = (Row + 1) % 3;
+		uint32_t R1 = (Row + 2) % 3;
+		for (uint32_t Column = 0; Column < 3; ++Column)
+		{
+			uint32_t C0 = (Column + 1) % 3;
+			uint32_t C1 = (Column + 2) % 3;
+			Cofactor[Row][Column] = A[R0][C0] * A[R1][C1] - A[R0][C1] * A[R1][C0];
+		}
+	}
+	float Det = A[0][0] * Cofactor[0][0] + A[0][1] * Cofactor[0][1] + A[0][2] * Cofactor[0][2];
+	mz_ASSERT(Det != 0.0f);
+	float InvDet = 1.0f / Det;
+
+	for (uint32_t Row = 0; Row < 3; ++Row)
+	{
+		for (uint32_t Column = 0; Column < 3; ++Column)
+		{
+			OutInverse->m[Row][Column] = Cofactor[Column][Row] * InvDet;
+		}
+	}
+	for (uint32_t Row = 0; Row < 3; ++Row)
+	{
+		OutInverse->m[Row][3] = -(OutInverse->m[Row][0] * M.m[0][3] + OutInverse->m[Row][1] * M.m[1][3] + OutInverse->m[Row][2] * M.m[2][3]);
+	}
+}
+
+static void
+mz_BuildCPUMesh(const mz_SceneData* Scene, const mz_Mesh* Mesh, uint32_t NumThreads, mz_CPUMesh* OutMesh)
+{
+	mz_MeshSection* Sections = mz_GetMeshSections((mz_Mesh*)Mesh);
+
+	eastl::vector<mz_CPUTriangle> Triangles;
+	for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
+	{
+		const mz_MeshSection& Section = Sections[SectionIdx];
+
+		for (uint32_t PrimitiveIdx = 0; PrimitiveIdx < Section.NumIndices / 3; ++PrimitiveIdx)
+		{
+			mz_CPUTriangle Triangle;
+			for (uint32_t Idx = 0; Idx < 3; ++Idx)
+			{
+				const XMFLOAT3& P = Scene->Vertices[Section.BaseVertex + mz_GetIndex(Scene, Section, PrimitiveIdx * 3 + Idx)].Position;
+				Triangle.Vertices[Idx] = mz_Float3{ P.x, P.y, P.z };
+			}
+			Triangle.GeometryIndex = SectionIdx;
+			Triangle.PrimitiveIndex = PrimitiveIdx;
+			Triangles.push_back(Triangle);
+		}
+	}
+	mz_ASSERT(!Triangles.empty());
+
+	eastl::vector<mz_AABB> TriangleBounds(Triangles.size());
+	for (uint32_t Idx = 0; Idx < Triangles.size(); ++Idx)
+	{
+		TriangleBounds[Idx] = mz_EmptyAABB();
+		mz_GrowAABB(&TriangleBounds[Idx], Triangles[Idx].Vertices[0]);
+		mz_GrowAABB(&TriangleBounds[Idx], Triangles[Idx].Vertices[1]);
+		mz_GrowAABB(&TriangleBounds[Idx], Triangles[Idx].Vertices[2]);
+	}
+
+	mz_BuildBVH(TriangleBounds.data(), (uint32_t)TriangleBounds.size(), NumThreads, &OutMesh->BVH);
+	mz_CollapseBVH(&OutMesh->BVH, &OutMesh->BVH4);
+#if mz_HAS_BVH8
+	mz_CollapseBVH(&OutMesh->BVH, &OutMesh->BVH8);
+#endif
+
+	// Store triangles in leaf order so that a leaf is a contiguous range.
+	OutMesh->Triangles.resize(Triangles.size());
+	for (uint32_t Idx = 0; Idx < Triangles.size(); ++Idx)
+	{
+		OutMesh->Triangles[Idx] = Triangles[OutMesh->BVH.PrimitiveIndices[Idx]];
+	}
+
+	// One triangle block per leaf, wide BVH leaf children are redirected from the first triangle to the block.
+	eastl::vector<uint32_t> FirstTriangleToBlock(Triangles.size(), ~0u);
+	for (const mz_BVHNode& Node : OutMesh->BVH.Nodes)
+	{
+		if (Node.NumPrimitives == 0)
+		{
+			continue;
+		}
+		mz_ASSERT(Node.NumPrimitives <= 4);
+
+		FirstTriangleToBlock[Node.FirstChildOrPrimitive] = (uint32_t)OutMesh->TriangleBlocks.size();
+		OutMesh->TriangleBlocks.push_back();
+		mz_TriangleBlock4* Block = &OutMesh->TriangleBlocks.back();
+
+		// NOTE: Unused lanes repeat the last triangle. Degenerate (all zero) triangles are not safe, with FMA contraction
+		// their edge functions can be tiny non-zero values of the same sign, so they could be hit.
+		for (uint32_t Idx = 0; Idx < 4; ++Idx)
+		{
+			uint32_t TriangleIdx = Idx < Node.NumPrimitives ? Idx : Node.NumPrimitives - 1;
+			mz_SetBlockTriangle(Block, Idx, OutMesh->Triangles[Node.FirstChildOrPrimitive + TriangleIdx]);
+		}
+	}
+	mz_RemapWideLeaves(FirstTriangleToBlock, &OutMesh->BVH4);
+	mz_RemapWideLeaves(FirstTriangleToBlock, &OutMesh->BVH8);
+}
+
+mz_CPUScene*
+mz_CreateCPUScene(const mz_SceneData* Scene, const uint32_t* ObjectLODs, uint32_t NumThreads)
+{
+	mz_ASSERT(Scene && !Scene->Vertices.empty() && !Scene->IndexData.empty());
+
+	mz_CPUScene* CPUScene = new mz_CPUScene();
+	CPUScene->Scene = Scene;
+
+	// NOTE: LOD meshes follow the scene meshes, CPU mesh index of LOD mesh is Meshes.size() + LODMeshes index.
+	uint32_t NumMeshes = (uint32_t)(Scene->Meshes.size() + Scene->LODMeshes.size());
+	auto GetMesh = [Scene](uint32_t MeshIdx)
+	{
+		return (mz_Mesh*)(MeshIdx < Scene->Meshes.size() ? &Scene->Meshes[MeshIdx] : &Scene->LODMeshes[MeshIdx - Scene->Meshes.size()]);
+	};
+
+	eastl::vector<uint32_t> ObjectMeshes(Scene->Objects.size());
+	eastl::vector<uint8_t> bIsMeshUsed(NumMeshes, 0);
+	for (uint32_t ObjectIdx = 0; ObjectIdx < Scene->Objects.size(); ++ObjectIdx)
+	{
+		uint32_t MeshIdx = Scene->Objects[ObjectIdx].MeshIndex;
+		uint32_t Level = ObjectLODs ? ObjectLODs[ObjectIdx] : 0;
+		if (Level > 0)
+		{
+			mz_ASSERT(Level <= Scene->MeshLODChains[MeshIdx].NumLODs);
+			MeshIdx = (uint32_t)Scene->Meshes.size() + Scene->MeshLODChains[MeshIdx].FirstLOD + Level - 1;
+		}
+		ObjectMeshes[ObjectIdx] = MeshIdx;
+		bIsMeshUsed[MeshIdx] = 1;
+	}
+
+	// One geometry per (mesh, section) pair, same order as hit group records in the shader table.
+	CPUScene->Meshes.resize(NumMeshes);
+	for (uint32_t MeshIdx = 0; MeshIdx < NumMeshes; ++MeshIdx)
+	{
+		mz_Mesh* Mesh = GetMesh(MeshIdx);
+		mz_MeshSection* Sections = mz_GetMeshSections(Mesh);
+
+		CPUScene->Meshes[MeshIdx].FirstGeometry = (uint32_t)CPUScene->Geometries.size();
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
+		{
+			mz_CPUGeometry Geometry = {};
+			Geometry.RootData.BaseVertex = Sections[SectionIdx].BaseVertex;
+			Geometry.RootData.IndexOffset = Sections[SectionIdx].IndexOffset;
+			Geometry.RootData.IndexSize = Sections[SectionIdx].IndexSize;
+			Geometry.MaterialIndex = Sections[SectionIdx].MaterialIndex;
+			CPUScene->Geometries.push_back(Geometry);
+		}
+	}
+
+	// BLAS per mesh, in object space. Memory scales with unique meshes, not with objects.
+	double Time = mz_GetTime();
+	eastl::vector<float> MeshSAHCosts(NumMeshes, 0.0f);
+	for (uint32_t MeshIdx = 0; MeshIdx < NumMeshes; ++MeshIdx)
+	{
+		if (!bIsMeshUsed[MeshIdx])
+		{
+			continue;
+		}
+		mz_BuildCPUMesh(Scene, GetMesh(MeshIdx), NumThreads, &CPUScene->Meshes[MeshIdx]);
+		MeshSAHCosts[MeshIdx] = mz_ComputeSAHCost(&CPUScene->Meshes[MeshIdx].BVH);
+	}
+
+	// TLAS over world-space bounds of all objects.
+	CPUScene->Instances.resize(Scene->Objects.size());
+	eastl::vector<mz_AABB> InstanceBounds(Scene->Objects.size());
+	CPUScene->BVHSAHCost = 0.0f;
+	for (uint32_t ObjectIdx = 0; ObjectIdx < Scene->Objects.size(); ++ObjectIdx)
+	{
+		const mz_Object* Object = &Scene->Objects[ObjectIdx];
+		const mz_CPUMesh& Mesh = CPUScene->Meshes[ObjectMeshes[ObjectIdx]];
+		mz_CPUInstance* Instance = &CPUScene->Instances[ObjectIdx];
+
+		Instance->MeshIndex = ObjectMeshes[ObjectIdx];
+		Instance->bIsIdentity = mz_IsIdentity(Object->ObjectToWorld);
+		mz_InvertTransform(Object->ObjectToWorld, &Instance->WorldToObject);
+
+		const mz_AABB& MeshBounds = Mesh.BVH.Nodes[0].Bounds;
+		Instance->Bounds = mz_EmptyAABB();
+		for (uint32_t Corner = 0; Corner < 8; ++Corner)
+		{
+			mz_Float3 P =
+			{
+				(Corner & 1) ? MeshBounds.Max.x : MeshBounds.Min.x,
+				(Corner & 2) ? MeshBounds.Max.y : MeshBounds.Min.y,
+				(Corner & 4) ? MeshBounds.Max.z : MeshBounds.Min.z,
+			};
+			mz_GrowAABB(&Instance->Bounds, mz_TransformPoint(Object->ObjectToWorld, P));
+		}
+		InstanceBounds[ObjectIdx] = Instance->Bounds;
+
+		CPUScene->BVHSAHCost += MeshSAHCosts[ObjectMeshes[ObjectIdx]];
+	}
+	mz_BuildBVH(InstanceBounds.data(), (uint32_t)InstanceBounds.size(), NumThreads, &CPUScene->TLAS);
+	CPUScene->BVHBuildTime = mz_GetTime() - Time;
+
+#if mz_HAS_BVH8
+	CPUScene->BVHWidth = 8;
+#else
+	CPUScene->BVHWidth = 4;
+#endif
+	CPUScene->bUsePackets = false;
+
+	return CPUScene;
+}
+
+void
+mz_DestroyCPUScene(mz_CPUScene* CPUScene)
+{
+	mz_ASSERT(CPUScene);
+	delete CPUScene;
+}
+
+uint32_t
+mz_GetNumBVHNodes(const mz_CPUScene* CPUScene, uint32_t BVHWidth)
+{
+	uint32_t NumNodes = 0;
+	for (const mz_CPUMesh& Mesh : CPUScene->Meshes)
+	{
+		NumNodes += (uint32_t)(BVHWidth == 2 ? Mesh.BVH.Nodes.size() : (BVHWidth == 4 ? Mesh.BVH4.size() : Mesh.BVH8.size()));
+	}
+	return NumNodes;
+}
+
+size_t
+mz_GetCPUSceneMemory(const mz_CPUScene* CPUScene)
+{
+	size_t Size = CPUScene->Geometries.size() * sizeof(mz_CPUGeometry) + CPUScene->Instances.size() * sizeof(mz_CPUInstance);
+	Size += CPUScene->TLAS.Nodes.size() * sizeof(mz_BVHNode) + CPUScene->TLAS.PrimitiveIndices.size() * sizeof(uint32_t);
+	for (const mz_CPUMesh& Mesh : CPUScene->Meshes)
+	{
+		Size += Mesh.Triangles.size() * sizeof(mz_CPUTriangle) + Mesh.TriangleBlocks.size() * sizeof(mz_TriangleBlock4);
+		Size += Mesh.BVH.Nodes.size() * sizeof(mz_BVHNode) + Mesh.BVH.PrimitiveIndices.size() * sizeof(uint32_t);
+		Size += Mesh.BVH4.size() * sizeof(mz_BVH4Node) + Mesh.BVH8.size() * sizeof(mz_BVH8Node);
+	}
+	return Size;
+}
+
+//
+// Traversal.
+//
+static inline bool
+mz_IntersectAABB(const mz_AABB& Bounds, mz_Float3 Origin, mz_Float3 InvDirection, float TMin, float TMax, float* OutTEntry)
+{
+	mz_Float3 T0 = (Bounds.Min - Origin) * InvDirection;
+	mz_Float3 T1 = (Bounds.Max - Origin) * InvDirection;
+	mz_Float3 TNear = mz_Min(T0, T1);
+	mz_Float3 TFar = mz_Max(T0, T1);
+	float TEntry = fmaxf(fmaxf(TNear.x, TNear.y), fmaxf(TNear.z, TMin));
+	float TExit = fminf(fminf(TFar.x, TFar.y), fminf(TFar.z, TMax));
+	*OutTEntry = TEntry;
+	return TEntry <= TExit;
+}
+
+// Moller-Trumbore. Front faces have clockwise winding, same as D3D12 default.
+static inline bool
+mz_IntersectTriangle(const mz_CPUTriangle& Triangle, const mz_Ray& Ray, float TMax, uint32_t RayFlags, float* OutT, float* OutU, float* OutV)
+{
+	mz_Float3 E1 = Triangle.Vertices[1] - Triangle.Vertices[0];
+	mz_Float3 E2 = Triangle.Vertices[2] - Triangle.Vertices[0];
+	mz_Float3 P = mz_Cross(Ray.Direction, E2);
+	float Det = mz_Dot(E1, P);
+
+	if (RayFlags & mz_RAY_FLAG_CULL_BACK_FACING_TRIANGLES)
+	{
+		if (Det <= 1e-12f)
+		{
+			return false;
+		}
+	}
+	else if (fabsf(Det) <= 1e-12f)
+	{
+		return false;
+	}
+
+	float InvDet = 1.0f / Det;
+	mz_Float3 S = Ray.Origin - Triangle.Vertices[0];
+	float U = mz_Dot(S, P) * InvDet;
+	if (U < 0.0f || U > 1.0f)
+	{
+		return false;
+	}
+
+	mz_Float3 Q = mz_Cross(S, E1);
+	float V = mz_Dot(Ray.Direction, Q) * InvDet;
+	if (V < 0.0f || U + V > 1.0f)
+	{
+		return false;
+	}
+
+	float T = mz_Dot(E2, Q) * InvDet;
+	if (T < Ray.TMin || T >= TMax)
+	{
+		return false;
+	}
+
+	*OutT = T;
+	*OutU = U;
+	*OutV = V;
+	return true;
+}
+
+static bool
+mz_TraceRayBinary(const mz_CPUMesh* Mesh, uint32_t RootIdx, const mz_Ray& Ray, uint32_t RayFlags, mz_RayHit* OutHit)
+{
+	const mz_BVHNode* Nodes = Mesh->BVH.Nodes.data();
+	const mz_CPUTriangle* Triangles = Mesh->Triangles.data();
+
+	mz_Float3 InvDirection = mz_Float3{ 1.0f, 1.0f, 1.0f } / Ray.Direction;
+
+	float ClosestT = Ray.TMax;
+	bool bHasHit = false;
+
+	uint32_t Stack[mz_BVH_STACK_SIZE];
+	uint32_t StackSize = 0;
+
+	float TEntry;
+	if (!mz_IntersectAABB(Nodes[RootIdx].Bounds, Ray.Origin, InvDirection, Ray.TMin, ClosestT, &TEntry))
+	{
+		return false;
+	}
+	Stack[StackSize++] = RootIdx;
+
+	while (StackSize > 0)
+	{
+		const mz_BVHNode& Node = Nodes[Stack[--StackSize]];
+
+		if (Node.NumPrimitives > 0)
+		{
+			for (uint32_t Idx = 0; Idx < Node.NumPrimitives; ++Idx)
+			{
+				const mz_CPUTriangle& Triangle = Triangles[Node.FirstChildOrPrimitive + Idx];
+
+				float T, U, V;
+				if (mz_IntersectTriangle(Triangle, Ray, ClosestT, RayFlags, &T, &U, &V))
+				{
+					ClosestT = T;
+					bHasHit = true;
+					OutHit->T = T;
+					OutHit->Barycentrics[0] = U;
+					OutHit->Barycentrics[1] = V;
+					OutHit->GeometryIndex = Triangle.GeometryIndex;
+					OutHit->PrimitiveIndex = Triangle.PrimitiveIndex;
+
+					if (RayFlags & mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH)
+					{
+						return true;
+					}
+				}
+			}
+			continue;
+		}
+
+		uint32_t ChildIdx[2] = { Node.FirstChildOrPrimitive, Node.FirstChildOrPrimitive + 1 };
+		float ChildT[2];
+		bool bChildHit[2];
+		bChildHit[0] = mz_IntersectAABB(Nodes[ChildIdx[0]].Bounds, Ray.Origin, InvDirection, Ray.TMin, ClosestT, &ChildT[0]);
+		bChildHit[1] = mz_IntersectAABB(Nodes[ChildIdx[1]].Bounds, Ray.Origin, InvDirection, Ray.TMin, ClosestT, &ChildT[1]);
+
+		// Push far child first so that the near one is visited next.
+		if (bChildHit[0] && bChildHit[1])
+		{
+			uint32_t Near = ChildT[0] <= ChildT[1] ? 0 : 1;
+			mz_ASSERT(StackSize + 2 <= mz_BVH_STACK_SIZE);
+			Stack[StackSize++] = ChildIdx[1 - Near];
+			Stack[StackSize++] = ChildIdx[Near];
+		}
+		else if (bChildHit[0] || bChildHit[1])
+		{
+			mz_ASSERT(StackSize + 1 <= mz_BVH_STACK_SIZE);
+			Stack[StackSize++] = bChildHit[0] ? ChildIdx[0] : ChildIdx[1];
+		}
+	}
+
+	return bHasHit;
+}
+
+struct mz_SIMD4
+{
+	typedef __m128 Type;
+	static Type Set1(float X) { return _mm_set1_ps(X); }
+	static Type Load(const float* Addr) { return _mm_load_ps(Addr); }
+	static void Store(float* Addr, Type X) { _mm_store_ps(Addr, X); }
+	static Type Sub(Type A, Type B) { return _mm_sub_ps(A, B); }
+	static Type Mul(Type A, Type B) { return _mm_mul_ps(A, B); }
+	static Type Min(Type A, Type B) { return _mm_min_ps(A, B); }
+	static Type Max(Type A, Type B) { return _mm_max_ps(A, B); }
+	static uint32_t LessEqualMask(Type A, Type B) { return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(A, B)); }
+	static Type Add(Type A, Type B) { return _mm_add_ps(A, B); }
+	static Type Div(Type A, Type B) { return _mm_div_ps(A, B); }
+	static Type Abs(Type A) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), A); }
+	static Type And(Type A, Type B) { return _mm_and_ps(A, B); }
+	static Type Or(Type A, Type B) { return _mm_or_ps(A, B); }
+	static Type CmpLT(Type A, Type B) { return _mm_cmplt_ps(A, B); }
+	static Type CmpLE(Type A, Type B) { return _mm_cmple_ps(A, B); }
+	static Type CmpGT(Type A, Type B) { return _mm_cmpgt_ps(A, B); }
+	static Type CmpGE(Type A, Type B) { return _mm_cmpge_ps(A, B); }
+	static uint32_t MoveMask(Type A) { return (uint32_t)_mm_movemask_ps(A); }
+	static Type Select(Type Mask, Type A, Type B) { return _mm_or_ps(_mm_and_ps(Mask, A), _mm_andnot_ps(Mask, B)); }
+};
+
+#if mz_HAS_BVH8
+struct mz_SIMD8
+{
+	typedef __m256 Type;
+	static Type Set1(float X) { return _mm256_set1_ps(X); }
+	static Type Load(const float* Addr) { return _mm256_load_ps(Addr); }
+	static void Store(float* Addr, Type X) { _mm256_store_ps(Addr, X); }
+	static Type Sub(Type A, Type B) { return _mm256_sub_ps(A, B); }
+	static Type Mul(Type A, Type B) { return _mm256_mul_ps(A, B); }
+	static Type Min(Type A, Type B) { return _mm256_min_ps(A, B); }
+	static Type Max(Type A, Type B) { return _mm256_max_ps(A, B); }
+	static uint32_t LessEqualMask(Type A, Type B) { return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(A, B, _CMP_LE_OQ)); }
+	static Type Add(Type A, Type B) { return _mm256_add_ps(A, B); }
+	static Type Div(Type A, Type B) { return _mm256_div_ps(A, B); }
+	static Type Abs(Type A) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), A); }
+	static Type And(Type A, Type B) { return _mm256_and_ps(A, B); }
+	static Type Or(Type A, Type B) { return _mm256_or_ps(A, B); }
+	static Type CmpLT(Type A, Type B) { return _mm256_cmp_ps(A, B, _CMP_LT_OQ); }
+	static Type CmpLE(Type A, Type B) { return _mm256_cmp_ps(A, B, _CMP_LE_OQ); }
+	static Type CmpGT(Type A, Type B) { return _mm256_cmp_ps(A, B, _CMP_GT_OQ); }
+	static Type CmpGE(Type A, Type B) { return _mm256_cmp_ps(A, B, _CMP_GE_OQ); }
+	static uint32_t MoveMask(Type A) { return (uint32_t)_mm256_movemask_ps(A); }
+	static Type Select(Type Mask, Type A, Type B) { return _mm256_blendv_ps(B, A, Mask); }
+};
+#endif
+
+// Per-ray constants of the watertight test (Woop, Benthin, Wald: "Watertight Ray/Triangle Intersection").
+struct mz_WatertightRay
+{
+	uint32_t Kx, Ky, Kz; // Kz is the dominant axis of ray direction.
+	float Sx, Sy, Sz; // Shear that maps ray direction to (0, 0, 1).
+	float Origin[3];
+};
+
+static inline void
+mz_InitWatertightRay(const mz_Ray& Ray, mz_WatertightRay* OutRay)
+{
+	float AbsDirection[3] = { fabsf(Ray.Direction.x), fabsf(Ray.Direction.y), fabsf(Ray.Direction.z) };
+	uint32_t Kz = AbsDirection[0] > AbsDirection[1] ? (AbsDirection[0] > AbsDirection[2] ? 0 : 2) : (AbsDirection[1] > AbsDirection[2] ? 1 : 2);
+	uint32_t Kx = Kz == 2 ? 0 : Kz + 1;
+	uint32_t Ky = Kx == 2 ? 0 : Kx + 1;
+
+	// Keep winding of the projected triangle independent of the ray direction.
+	float DirectionKz = mz_GetComponent(Ray.Direction, Kz);
+	if (DirectionKz < 0.0f)
+	{
+		uint32_t Temp = Kx;
+		Kx = Ky;
+		Ky = Temp;
+	}
+
+	OutRay->Kx = Kx;
+	OutRay->Ky = Ky;
+	OutRay->Kz = Kz;
+	OutRay->Sx = mz_GetComponent(Ray.Direction, Kx) / DirectionKz;
+	OutRay->Sy = mz_GetComponent(Ray.Direction, Ky) / DirectionKz;
+	OutRay->Sz = 1.0f / DirectionKz;
+	OutRay->Origin[0] = Ray.Origin.x;
+	OutRay->Origin[1] = Ray.Origin.y;
+	OutRay->Origin[2] = Ray.Origin.z;
+}
+
+// Tests one ray against all triangles of the block, returns mask of hit triangles.
+// Barycentrics follow BuiltInTriangleIntersectionAttributes (weights of the second and third vertex).
+template<uint32_t Width, typename SIMD> static inline uint32_t
+mz_IntersectTriangleBlock(const mz_TriangleBlock<Width>& Block, const mz_WatertightRay& Ray, float TMin, float TMax, uint32_t RayFlags, float* OutT, float* OutU, float* OutV)
+{
+	typedef typename SIMD::Type Type;
+
+	// Vertices relative to ray origin, then sheared and scaled so that the ray is (0, 0, 1).
+	Type X[3], Y[3], Z[3];
+	Type Sx = SIMD::Set1(Ray.Sx);
+	Type Sy = SIMD::Set1(Ray.Sy);
+	Type Sz = SIMD::Set1(Ray.Sz);
+	for (uint32_t Idx = 0; Idx < 3; ++Idx)
+	{
+		Type Px = SIMD::Sub(SIMD::Load(Block.Vertices[Idx][Ray.Kx]), SIMD::Set1(Ray.Origin[Ray.Kx]));
+		Type Py = SIMD::Sub(SIMD::Load(Block.Vertices[Idx][Ray.Ky]), SIMD::Set1(Ray.Origin[Ray.Ky]));
+		Type Pz = SIMD::Sub(SIMD::Load(Block.Vertices[Idx][Ray.Kz]), SIMD::Set1(Ray.Origin[Ray.Kz]));
+		X[Idx] = SIMD::Sub(Px, SIMD::Mul(Sx, Pz));
+		Y[Idx] = SIMD::Sub(Py, SIMD::Mul(Sy, Pz));
+		Z[Idx] = SIMD::Mul(Sz, Pz);
+	}
+
+	// Scaled barycentrics (edge functions). Weight of vertex 0 is U, vertex 1 is V, vertex 2 is W.
+	Type U = SIMD::Sub(SIMD::Mul(X[2], Y[1]), SIMD::Mul(Y[2], X[1]));
+	Type V = SIMD::Sub(SIMD::Mul(X[0], Y[2]), SIMD::Mul(Y[0], X[2]));
+	Type W = SIMD::Sub(SIMD::Mul(X[1], Y[0]), SIMD::Mul(Y[1], X[0]));
+
+	// NOTE: Front faces (clockwise winding, D3D12 default) have non-negative edge functions with this projection.
+	Type Zero = SIMD::Set1(0.0f);
+	Type Valid = SIMD::And(SIMD::And(SIMD::CmpGE(U, Zero), SIMD::CmpGE(V, Zero)), SIMD::CmpGE(W, Zero));
+	if (!(RayFlags & mz_RAY_FLAG_CULL_BACK_FACING_TRIANGLES))
+	{
+		Type BackFacing = SIMD::And(SIMD::And(SIMD::CmpLE(U, Zero), SIMD::CmpLE(V, Zero)), SIMD::CmpLE(W, Zero));
+		Valid = SIMD::Or(Valid, BackFacing);
+	}
+
+	Type Det = SIMD::Add(SIMD::Add(U, V), W);
+	Valid = SIMD::And(Valid, SIMD::CmpGT(SIMD::Abs(Det), Zero));
+	if (SIMD::MoveMask(Valid) == 0)
+	{
+		return 0;
+	}
+
+	Type InvDet = SIMD::Div(SIMD::Set1(1.0f), Det);
+	Type T = SIMD::Mul(SIMD::Add(SIMD::Add(SIMD::Mul(U, Z[0]), SIMD::Mul(V, Z[1])), SIMD::Mul(W, Z[2])), InvDet);
+	Valid = SIMD::And(Valid, SIMD::And(SIMD::CmpGE(T, SIMD::Set1(TMin)), SIMD::CmpLT(T, SIMD::Set1(TMax))));
+
+	uint32_t Mask = SIMD::MoveMask(Valid);
+	if (Mask)
+	{
+		SIMD::Store(OutT, T);
+		SIMD::Store(OutU, SIMD::Mul(V, InvDet));
+		SIMD::Store(OutV, SIMD::Mul(W, InvDet));
+	}
+	return Mask;
+}
+
+// Closest (or any, for mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH) hit in the block.
+template<uint32_t Width, typename SIMD> static inline bool
+mz_IntersectTriangleBlockClosest(const mz_TriangleBlock<Width>& Block, const mz_WatertightRay& Ray, float TMin, float TMax, uint32_t RayFlags, mz_RayHit* OutHit)
+{
+	alignas(32) float T[Width], U[Width], V[Width];
+	uint32_t Mask = mz_IntersectTriangleBlock<Width, SIMD>(Block, Ray, TMin, TMax, RayFlags, T, U, V);
+	if (Mask == 0)
+	{
+		return false;
+	}
+
+	uint32_t Lane = mz_CountTrailingZeros(Mask);
+	for (Mask &= Mask - 1; Mask; Mask &= Mask - 1)
+	{
+		uint32_t Idx = mz_CountTrailingZeros(Mask);
+		Lane = T[Idx] < T[Lane] ? Idx : Lane;
+	}
+
+	OutHit->T = T[Lane];
+	OutHit->Barycentrics[0] = U[Lane];
+	OutHit->Barycentrics[1] = V[Lane];
+	OutHit->GeometryIndex = Block.GeometryIndex[Lane];
+	OutHit->PrimitiveIndex = Block.PrimitiveIndex[Lane];
+	return true;
+}
+
+struct mz_WideStackEntry
+{
+	uint32_t Child;
+	uint32_t NumPrimitives;
+	float TEntry;
+};
+
+template<uint32_t Width, typename SIMD> static bool
+mz_TraceRayWide(const mz_CPUMesh* Mesh, const mz_WideBVHNode<Width>* Nodes, uint32_t NodeIdx, const mz_Ray& Ray, uint32_t RayFlags, mz_RayHit* OutHit)
+{
+	const mz_TriangleBlock4* Blocks = Mesh->TriangleBlocks.data();
+
+	mz_WatertightRay WatertightRay;
+	mz_InitWatertightRay(Ray, &WatertightRay);
+
+	mz_Float3 InvDirection = mz_Float3{ 1.0f, 1.0f, 1.0f } / Ray.Direction;
+
+	// Near plane of every child is picked by the sign of ray direction, so no min/max is needed per axis
+	// and unused (inverted) children are always missed.
+	uint32_t Near[3] = { InvDirection.x < 0.0f, InvDirection.y < 0.0f, InvDirection.z < 0.0f };
+	typename SIMD::Type Origin[3] = { SIMD::Set1(Ray.Origin.x), SIMD::Set1(Ray.Origin.y), SIMD::Set1(Ray.Origin.z) };
+	typename SIMD::Type InvDir[3] = { SIMD::Set1(InvDirection.x), SIMD::Set1(InvDirection.y), SIMD::Set1(InvDirection.z) };
+	typename SIMD::Type TMin = SIMD::Set1(Ray.TMin);
+
+	float ClosestT = Ray.TMax;
+	bool bHasHit = false;
+
+	mz_WideStackEntry Stack[mz_WIDE_BVH_STACK_SIZE];
+	uint32_t StackSize = 0;
+	Stack[StackSize++] = { NodeIdx, 0, Ray.TMin };
+
+	while (StackSize > 0)
+	{
+		mz_WideStackEntry Entry = Stack[--StackSize];
+		if (Entry.TEntry > ClosestT)
+		{
+			continue;
+		}
+
+		if (Entry.NumPrimitives > 0)
+		{
+			if (mz_IntersectTriangleBlockClosest<4, mz_SIMD4>(Blocks[Entry.Child], WatertightRay, Ray.TMin, ClosestT, RayFlags, OutHit))
+			{
+				ClosestT = OutHit->T;
+				bHasHit = true;
+
+				if (RayFlags & mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH)
+				{
+					return true;
+				}
+			}
+			continue;
+		}
+
+		// Slab test against all children at once.
+		const mz_WideBVHNode<Width>& Node = Nodes[Entry.Child];
+		typename SIMD::Type TNear = TMin;
+		typename SIMD::Type TFar = SIMD::Set1(ClosestT);
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			TNear = SIMD::Max(TNear, SIMD::Mul(SIMD::Sub(SIMD::Load(Node.Bounds[Near[Axis]][Axis]), Origin[Axis]), InvDir[Axis]));
+			TFar = SIMD::Min(TFar, SIMD::Mul(SIMD::Sub(SIMD::Load(Node.Bounds[1 - Near[Axis]][Axis]), Origin[Axis]), InvDir[Axis]));
+		}
+		uint32_t HitMask = SIMD::LessEqualMask(TNear, TFar);
+		if (HitMask == 0)
+		{
+			continue;
+		}
+
+		alignas(32) float ChildT[Width];
+		SIMD::Store(ChildT, TNear);
+
+		// Sort hit children far-to-near (insertion sort, at most 'Width' entries) and push them so that the nearest is popped first.
+		mz_WideStackEntry Hits[Width];
+		uint32_t NumHits = 0;
+		for (; HitMask; HitMask &= HitMask - 1)
+		{
+			uint32_t ChildIdx = mz_CountTrailingZeros(HitMask);
+			mz_WideStackEntry Hit = { Node.Children[ChildIdx], Node.NumPrimitives[ChildIdx], ChildT[ChildIdx] };
+
+			uint32_t Idx = NumHits++;
+			for (; Idx > 0 && Hits[Idx - 1].TEntry < Hit.TEntry; --Idx)
+			{
+				Hits[Idx] = Hits[Idx - 1];
+			}
+			Hits[Idx] = Hit;
+		}
+
+		mz_ASSERT(StackSize + NumHits <= mz_WIDE_BVH_STACK_SIZE);
+		for (uint32_t Idx = 0; Idx < NumHits; ++Idx)
+		{
+			Stack[StackSize++] = Hits[Idx];
+		}
+	}
+
+	return bHasHit;
+}
+
+// Ray and hit are in object space, GeometryIndex is the section index within the mesh.
+static bool
+mz_TraceRayBLAS(const mz_CPUScene* CPUScene, const mz_CPUMesh* Mesh, const mz_Ray& Ray, uint32_t RayFlags, mz_RayHit* OutHit)
+{
+#if mz_HAS_BVH8
+	if (CPUScene->BVHWidth == 8)
+	{
+		bool bHasHit = mz_TraceRayWide<8, mz_SIMD8>(Mesh, Mesh->BVH8.data(), 0, Ray, RayFlags, OutHit);
+		// NOTE: Early exit paths can leave upper halves of YMM registers dirty, following SSE code would pay for AVX-SSE transitions.
+		_mm256_zeroupper();
+		return bHasHit;
+	}
+#endif
+	if (CPUScene->BVHWidth == 4)
+	{
+		return mz_TraceRayWide<4, mz_SIMD4>(Mesh, Mesh->BVH4.data(), 0, Ray, RayFlags, OutHit);
+	}
+	return mz_TraceRayBinary(Mesh, 0, Ray, RayFlags, OutHit);
+}
+
+// Direction is not normalized, so T is the same in world and object space.
+static inline void
+mz_TransformRayToObject(const mz_CPUInstance& Instance, const mz_Ray& Ray, mz_Ray* OutRay)
+{
+	*OutRay = Ray;
+	if (!Instance.bIsIdentity)
+	{
+		OutRay->Origin = mz_TransformPoint(Instance.WorldToObject, Ray.Origin);
+		OutRay->Direction = mz_TransformVector(Instance.WorldToObject, Ray.Direction);
+	}
+}
+
+static bool
+mz_TraceRayTLAS(const mz_CPUScene* CPUScene, uint32_t RootIdx, const mz_Ray& Ray, uint32_t RayFlags, mz_RayHit* OutHit)
+{
+	const mz_BVHNode* Nodes = CPUScene->TLAS.Nodes.data();
+	const uint32_t* InstanceIndices = CPUScene->TLAS.PrimitiveIndices.data();
+
+	mz_Float3 InvDirection = mz_Float3{ 1.0f, 1.0f, 1.0f } / Ray.Direction;
+
+	float ClosestT = Ray.TMax;
+	bool bHasHit = false;
+
+	struct mz_TLASStackEntry
+	{
+		uint32_t NodeIdx;
+		float TEntry;
+	};
+	mz_TLASStackEntry Stack[mz_BVH_STACK_SIZE];
+	uint32_t StackSize = 0;
+
+	float TEntry;
+	if (!mz_IntersectAABB(Nodes[RootIdx].Bounds, Ray.Origin, InvDirection, Ray.TMin, ClosestT, &TEntry))
+	{
+		return false;
+	}
+	Stack[StackSize++] = { RootIdx, TEntry };
+
+	while (StackSize > 0)
+	{
+		mz_TLASStackEntry Entry = Stack[--StackSize];
+		if (Entry.TEntry > ClosestT)
+		{
+			continue;
+		}
+		const mz_BVHNode& Node = Nodes[Entry.NodeIdx];
+
+		if (Node.NumPrimitives > 0)
+		{
+			for (uint32_t Idx = 0; Idx < Node.NumPrimitives; ++Idx)
+			{
+				uint32_t InstanceIdx = InstanceIndices[Node.FirstChildOrPrimitive + Idx];
+				const mz_CPUInstance& Instance = CPUScene->Instances[InstanceIdx];
+				const mz_CPUMesh* Mesh = &CPUScene->Meshes[Instance.MeshIndex];
+
+				mz_Ray ObjectRay;
+				mz_TransformRayToObject(Instance, Ray, &ObjectRay);
+				ObjectRay.TMax = ClosestT;
+
+				if (mz_TraceRayBLAS(CPUScene, Mesh, ObjectRay, RayFlags, OutHit))
+				{
+					ClosestT = OutHit->T;
+					bHasHit = true;
+					OutHit->GeometryIndex += Mesh->FirstGeometry;
+					OutHit->InstanceIndex = InstanceIdx;
+
+					if (RayFlags & mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH)
+					{
+						return true;
+					}
+				}
+			}
+			continue;
+		}
+
+		uint32_t ChildIdx[2] = { Node.FirstChildOrPrimitive, Node.FirstChildOrPrimitive + 1 };
+		float ChildT[2];
+		bool bChildHit[2];
+		bChildHit[0] = mz_IntersectAABB(Nodes[ChildIdx[0]].Bounds, Ray.Origin, InvDirection, Ray.TMin, ClosestT, &ChildT[0]);
+		bChildHit[1] = mz_IntersectAABB(Nodes[ChildIdx[1]].Bounds, Ray.Origin, InvDirection, Ray.TMin, ClosestT, &ChildT[1]);
+
+		// Push far child first so that the near one is visited next.
+		uint32_t Near = ChildT[0] <= ChildT[1] ? 0 : 1;
+		mz_ASSERT(StackSize + 2 <= mz_BVH_STACK_SIZE);
+		if (bChildHit[1 - Near])
+		{
+			Stack[StackSize++] = { ChildIdx[1 - Near], ChildT[1 - Near] };
+		}
+		if (bChildHit[Near])
+		{
+			Stack[StackSize++] = { ChildIdx[Near], ChildT[Near] };
+		}
+	}
+
+	return bHasHit;
+}
+
+bool
+mz_TraceRay(const mz_CPUScene* CPUScene, const mz_Ray& Ray, uint32_t RayFlags, mz_RayHit* OutHit)
+{
+	return mz_TraceRayTLAS(CPUScene, 0, Ray, RayFlags, OutHit);
+}
+
+//
+// Occlusion.
+//
+// NOTE: Any hit ends the query, so children are not ordered by distance, no hit data is recorded
+// and the ray interval never shrinks. Triangles are tested from both sides (shadow rays don't cull).
+static bool
+mz_OccludedBinary(const mz_CPUMesh* Mesh, const mz_Ray& Ray)
+{
+	const mz_BVHNode* Nodes = Mesh->BVH.Nodes.data();
+	const mz_CPUTriangle* Triangles = Mesh->Triangles.data();
+
+	mz_Float3 InvDirection = mz_Float3{ 1.0f, 1.0f, 1.0f } / Ray.Direction;
+
+	uint32_t Stack[mz_BVH_STACK_SIZE];
+	uint32_t StackSize = 0;
+	Stack[StackSize++] = 0;
+
+	while (StackSize > 0)
+	{
+		const mz_BVHNode& Node = Nodes[Stack[--StackSize]];
+
+		float TEntry;
+		if (!mz_IntersectAABB(Node.Bounds, Ray.Origin, InvDirection, Ray.TMin, Ray.TMax, &TEntry))
+		{
+			continue;
+		}
+
+		if (Node.NumPrimitives > 0)
+		{
+			for (uint32_t Idx = 0; Idx < Node.NumPrimitives; ++Idx)
+			{
+				float T, U, V;
+				if (mz_IntersectTriangle(Triangles[Node.FirstChildOrPrimitive + Idx], Ray, Ray.TMax, mz_RAY_FLAG_NONE, &T, &U, &V))
+				{
+					return true;
+				}
+			}
+			continue;
+		}
+
+		mz_ASSERT(StackSize + 2 <= mz_BVH_STACK_SIZE);
+		Stack[StackSize++] = Node.FirstChildOrPrimitive + 1;
+		Stack[StackSize++] = Node.FirstChildOrPrimitive;
+	}
+
+	return false;
+}
+
+template<uint32_t Width, typename SIMD> static bool
+mz_OccludedWide(const mz_CPUMesh* Mesh, const mz_WideBVHNode<Width>* Nodes, const mz_Ray& Ray)
+{
+	const mz_TriangleBlock4* Blocks = Mesh->TriangleBlocks.data();
+
+	mz_WatertightRay WatertightRay;
+	mz_InitWatertightRay(Ray, &WatertightRay);
+
+	mz_Float3 InvDirection = mz_Float3{ 1.0f, 1.0f, 1.0f } / Ray.Direction;
+	uint32_t Near[3] = { InvDirection.x < 0.0f, InvDirection.y < 0.0f, InvDirection.z < 0.0f };
+	typename SIMD::Type Origin[3] = { SIMD::Set1(Ray.Origin.x), SIMD::Set1(Ray.Origin.y), SIMD::Set1(Ray.Origin.z) };
+	typename SIMD::Type InvDir[3] = { SIMD::Set1(InvDirection.x), SIMD::Set1(InvDirection.y), SIMD::Set1(InvDirection.z) };
+	typename SIMD::Type TMin = SIMD::Set1(Ray.TMin);
+	typename SIMD::Type TMax = SIMD::Set1(Ray.TMax);
+
+	uint32_t Stack[mz_WIDE_BVH_STACK_SIZE];
+	uint32_t StackSize = 0;
+	Stack[StackSize++] = 0;
+
+	while (StackSize > 0)
+	{
+		const mz_WideBVHNode<Width>& Node = Nodes[Stack[--StackSize]];
+
+		typename SIMD::Type TNear = TMin;
+		typename SIMD::Type TFar = TMax;
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			TNear = SIMD::Max(TNear, SIMD::Mul(SIMD::Sub(SIMD::Load(Node.Bounds[Near[Axis]][Axis]), Origin[Axis]), InvDir[Axis]));
+			TFar = SIMD::Min(TFar, SIMD::Mul(SIMD::Sub(SIMD::Load(Node.Bounds[1 - Near[Axis]][Axis]), Origin[Axis]), InvDir[Axis]));
+		}
+
+		// Leaves are tested right away, any of them can end the query before we descend further.
+		for (uint32_t HitMask = SIMD::LessEqualMask(TNear, TFar); HitMask; HitMask &= HitMask - 1)
+		{
+			uint32_t ChildIdx = mz_CountTrailingZeros(HitMask);
+			if (Node.NumPrimitives[ChildIdx] == 0)
+			{
+				mz_ASSERT(StackSize + 1 <= mz_WIDE_BVH_STACK_SIZE);
+				Stack[StackSize++] = Node.Children[ChildIdx];
+				continue;
+			}
+
+			alignas(16) float T[4], U[4], V[4];
+			if (mz_IntersectTriangleBlock<4, mz_SIMD4>(Blocks[Node.Children[ChildIdx]], WatertightRay, Ray.TMin, Ray.TMax, mz_RAY_FLAG_NONE, T, U, V))
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static bool
+mz_OccludedBLAS(const mz_CPUScene* CPUScene, const mz_CPUMesh* Mesh, const mz_Ray& Ray)
+{
+#if mz_HAS_BVH8
+	if (CPUScene->BVHWidth == 8)
+	{
+		bool bIsOccluded = mz_OccludedWide<8, mz_SIMD8>(Mesh, Mesh->BVH8.data(), Ray);
+		_mm256_zeroupper(); // See mz_TraceRayBLAS.
+		return bIsOccluded;
+	}
+#endif
+	if (CPUScene->BVHWidth == 4)
+	{
+		return mz_OccludedWide<4, mz_SIMD4>(Mesh, Mesh->BVH4.data(), Ray);
+	}
+	return mz_OccludedBinary(Mesh, Ray);
+}
+
+bool
+mz_Occluded(const mz_CPUScene* CPUScene, const mz_Ray& Ray)
+{
+	const mz_BVHNode* Nodes = CPUScene->TLAS.Nodes.data();
+	const uint32_t* InstanceIndices = CPUScene->TLAS.PrimitiveIndices.data();
+
+	mz_Float3 InvDirection = mz_Float3{ 1.0f, 1.0f, 1.0f } / Ray.Direction;
+
+	uint32_t Stack[mz_BVH_STACK_SIZE];
+	uint32_t StackSize = 0;
+	Stack[StackSize++] = 0;
+
+	while (StackSize > 0)
+	{
+		const mz_BVHNode& Node = Nodes[Stack[--StackSize]];
+
+		float TEntry;
+		if (!mz_IntersectAABB(Node.Bounds, Ray.Origin, InvDirection, Ray.TMin, Ray.TMax, &TEntry))
+		{
+			continue;
+		}
+
+		if (Node.NumPrimitives > 0)
+		{
+			for (uint32_t Idx = 0; Idx < Node.NumPrimitives; ++Idx)
+			{
+				const mz_CPUInstance& Instance = CPUScene->Instances[InstanceIndices[Node.FirstChildOrPrimitive + Idx]];
+
+				mz_Ray ObjectRay;
+				mz_TransformRayToObject(Instance, Ray, &ObjectRay);
+
+				if (mz_OccludedBLAS(CPUScene, &CPUScene->Meshes[Instance.MeshIndex], ObjectRay))
+				{
+					return true;
+				}
+			}
+			continue;
+		}
+
+		mz_ASSERT(StackSize + 2 <= mz_BVH_STACK_SIZE);
+		Stack[StackSize++] = Node.FirstChildOrPrimitive + 1;
+		Stack[StackSize++] = Node.FirstChildOrPrimitive;
+	}
+
+	return false;
+}
+
+//
+// Intersection benchmark.
+//
+static inline float
+mz_RandomFloat(uint32_t* State)
+{
+	// Xorshift32, [0, 1).
+	uint32_t X = *State;
+	X ^= X << 13;
+	X ^= X >> 17;
+	X ^= X << 5;
+	*State = X;
+	return (X >> 8) * (1.0f / 16777216.0f);
+}
+
+template<uint32_t Width, typename SIMD> static uint32_t
+mz_BenchmarkTriangleBlocks(const eastl::vector<mz_CPUTriangle>& Triangles, const eastl::vector<mz_Ray>& Rays, double* OutMTestsPerSecond)
+{
+	eastl::vector<mz_TriangleBlock<Width>> Blocks(Triangles.size() / Width);
+	for (uint32_t Idx = 0; Idx < Triangles.size(); ++Idx)
+	{
+		mz_SetBlockTriangle(&Blocks[Idx / Width], Idx % Width, Triangles[Idx]);
+	}
+
+	uint32_t NumHits = 0;
+	double Time = mz_GetTime();
+	for (const mz_Ray& Ray : Rays)
+	{
+		mz_WatertightRay WatertightRay;
+		mz_InitWatertightRay(Ray, &WatertightRay);
+
+		mz_RayHit Hit;
+		float ClosestT = Ray.TMax;
+		for (const mz_TriangleBlock<Width>& Block : Blocks)
+		{
+			if (mz_IntersectTriangleBlockClosest<Width, SIMD>(Block, WatertightRay, Ray.TMin, ClosestT, mz_RAY_FLAG_NONE, &Hit))
+			{
+				ClosestT = Hit.T;
+			}
+		}
+		NumHits += ClosestT < Ray.TMax ? 1 : 0;
+	}
+	*OutMTestsPerSecond = (double)Rays.size() * Triangles.size() / (mz_GetTime() - Time) * 1.0e-6;
+	return NumHits;
+}
+
+void
+mz_BenchmarkTriangleIntersection(uint32_t NumTriangles, uint32_t NumRays, mz_IntersectionBenchmarkResult* OutResult)
+{
+	mz_ASSERT(NumTriangles > 0 && NumRays > 0 && OutResult);
+	memset(OutResult, 0, sizeof(*OutResult));
+
+	// Small random triangles in a unit cube and random rays starting inside it. Every ray is tested against every
+	// triangle, there is no acceleration structure so only the intersection kernels are measured.
+	NumTriangles = (NumTriangles + 7) & ~7u;
+	uint32_t RandomState = 0x12345678;
+
+	eastl::vector<mz_CPUTriangle> Triangles(NumTriangles);
+	for (uint32_t Idx = 0; Idx < NumTriangles; ++Idx)
+	{
+		mz_Float3 Center = { mz_RandomFloat(&RandomState), mz_RandomFloat(&RandomState), mz_RandomFloat(&RandomState) };
+		for (uint32_t VertexIdx = 0; VertexIdx < 3; ++VertexIdx)
+		{
+			mz_Float3 Offset = { mz_RandomFloat(&RandomState), mz_RandomFloat(&RandomState), mz_RandomFloat(&RandomState) };
+			Triangles[Idx].Vertices[VertexIdx] = Center + (Offset - mz_Float3{ 0.5f, 0.5f, 0.5f }) * 0.2f;
+		}
+		Triangles[Idx].GeometryIndex = 0;
+		Triangles[Idx].PrimitiveIndex = Idx;
+	}
+
+	eastl::vector<mz_Ray> Rays(NumRays);
+	for (mz_Ray& Ray : Rays)
+	{
+		mz_Float3 Direction = { mz_RandomFloat(&RandomState), mz_RandomFloat(&RandomState), mz_RandomFloat(&RandomState) };
+		Ray.Origin = { mz_RandomFloat(&RandomState), mz_RandomFloat(&RandomState), mz_RandomFloat(&RandomState) };
+		Ray.Direction = mz_Normalize(Direction * 2.0f - mz_Float3{ 1.0f, 1.0f, 1.0f });
+		Ray.TMin = 0.0f;
+		Ray.TMax = 100.0f;
+	}
+
+	double Time = mz_GetTime();
+	for (const mz_Ray& Ray : Rays)
+	{
+		float ClosestT = Ray.TMax;
+		for (const mz_CPUTriangle& Triangle : Triangles)
+		{
+			float T, U, V;
+			if (mz_IntersectTriangle(Triangle, Ray, ClosestT, mz_RAY_FLAG_NONE, &T, &U, &V))
+			{
+				ClosestT = T;
+			}
+		}
+		OutResult->NumHits[0] += ClosestT < Ray.TMax ? 1 : 0;
+	}
+	OutResult->MTestsPerSecond[0] = (double)NumRays * NumTriangles / (mz_GetTime() - Time) * 1.0e-6;
+
+	OutResult->NumHits[1] = mz_BenchmarkTriangleBlocks<4, mz_SIMD4>(Triangles, Rays, &OutResult->MTestsPerSecond[1]);
+#if mz_HAS_BVH8
+	OutResult->NumHits[2] = mz_BenchmarkTriangleBlocks<8, mz_SIMD8>(Triangles, Rays, &OutResult->MTestsPerSecond[2]);
+#endif
+}
+
+//
+// Packet traversal.
+//
+#if mz_HAS_BVH8
+typedef mz_SIMD8 mz_PacketSIMD;
+#else
+typedef mz_SIMD4 mz_PacketSIMD;
+#endif
+#define mz_PACKET_LANES ((uint32_t)(sizeof(mz_PacketSIMD::Type) / sizeof(float)))
+
+struct alignas(32) mz_PacketState
+{
+	float InvDirection[3][mz_PACKET_SIZE];
+	float TMax[mz_PACKET_SIZE]; // Shrinks as hits are found. -FLT_MAX for finished any-hit rays.
+	const mz_RayPacket* Packet;
+	uint32_t RayFlags;
+	mz_RayHit* Hits;
+	uint64_t HitMask;
+	uint32_t NumActiveRays;
+
+	// Bounds of all ray segments [TMin, TMax]. Valid for any packet.
+	mz_AABB SegmentBounds;
+
+	// Interval arithmetic frustum. Valid only if all rays have the same direction signs.
+	bool bHasFrustum;
+	uint32_t Near[3];
+	float OriginMin[3];
+	float OriginMax[3];
+	float InvDirectionMin[3];
+	float InvDirectionMax[3];
+	float TMinMin;
+	float TMaxMax;
+};
+
+static inline uint32_t
+mz_GetHighestBit(uint32_t Mask)
+{
+#if defined(_MSC_VER)
+	unsigned long Index;
+	_BitScanReverse(&Index, Mask);
+	return (uint32_t)Index;
+#else
+	return 31 - (uint32_t)__builtin_clz(Mask);
+#endif
+}
+
+// Bit N is set if ray 'Group + N' is within [First, Last].
+static inline uint32_t
+mz_GetRangeMask(uint32_t Group, uint32_t First, uint32_t Last)
+{
+	uint32_t Mask = (1u << mz_PACKET_LANES) - 1;
+	if (First > Group)
+	{
+		Mask &= ~((1u << (First - Group)) - 1);
+	}
+	if (Last < Group + mz_PACKET_LANES - 1)
+	{
+		Mask &= (1u << (Last - Group + 1)) - 1;
+	}
+	return Mask;
+}
+
+// Slab test of 'mz_PACKET_LANES' rays starting at 'Group' against one box.
+static inline uint32_t
+mz_IntersectPacketAABB(const mz_PacketState* State, const mz_AABB& Bounds, uint32_t Group)
+{
+	typedef mz_PacketSIMD S;
+	const mz_RayPacket* Packet = State->Packet;
+
+	S::Type TNear = S::Load(&Packet->TMin[Group]);
+	S::Type TFar = S::Load(&State->TMax[Group]);
+	for (uint32_t Axis = 0; Axis < 3; ++Axis)
+	{
+		S::Type Origin = S::Load(&Packet->Origin[Axis][Group]);
+		S::Type InvDirection = S::Load(&State->InvDirection[Axis][Group]);
+		S::Type T0 = S::Mul(S::Sub(S::Set1(mz_GetComponent(Bounds.Min, Axis)), Origin), InvDirection);
+		S::Type T1 = S::Mul(S::Sub(S::Set1(mz_GetComponent(Bounds.Max, Axis)), Origin), InvDirection);
+		TNear = S::Max(TNear, S::Min(T0, T1));
+		TFar = S::Min(TFar, S::Max(T0, T1));
+	}
+	return S::LessEqualMask(TNear, TFar);
+}
+
+// Conservative test for the whole packet. Returns true if no ray can hit the box.
+static bool
+mz_IsPacketCulled(const mz_PacketState* State, const mz_AABB& Bounds)
+{
+	const mz_AABB& Segments = State->SegmentBounds;
+	if (Segments.Min.x > Bounds.Max.x || Segments.Min.y > Bounds.Max.y || Segments.Min.z > Bounds.Max.z ||
+		Segments.Max.x < Bounds.Min.x || Segments.Max.y < Bounds.Min.y || Segments.Max.z < Bounds.Min.z)
+	{
+		return true;
+	}
+
+	if (State->bHasFrustum)
+	{
+		// Interval of t = (Plane - Origin) * InvDirection over all rays of the packet, for near and far planes.
+		float TNear = State->TMinMin;
+		float TFar = State->TMaxMax;
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			float NearPlane = State->Near[Axis] ? mz_GetComponent(Bounds.Max, Axis) : mz_GetComponent(Bounds.Min, Axis);
+			float FarPlane = State->Near[Axis] ? mz_GetComponent(Bounds.Min, Axis) : mz_GetComponent(Bounds.Max, Axis);
+
+			float NearD[2] = { NearPlane - State->OriginMax[Axis], NearPlane - State->OriginMin[Axis] };
+			float FarD[2] = { FarPlane - State->OriginMax[Axis], FarPlane - State->OriginMin[Axis] };
+
+			float NearLo = FLT_MAX;
+			float FarHi = -FLT_MAX;
+			for (uint32_t Idx = 0; Idx < 2; ++Idx)
+			{
+				NearLo = fminf(NearLo, fminf(NearD[Idx] * State->InvDirectionMin[Axis], NearD[Idx] * State->InvDirectionMax[Axis]));
+				FarHi = fmaxf(FarHi, fmaxf(FarD[Idx] * State->InvDirectionMin[Axis], FarD[Idx] * State->InvDirectionMax[Axis]));
+			}
+			TNear = fmaxf(TNear, NearLo);
+			TFar = fminf(TFar, FarHi);
+		}
+		if (TNear > TFar)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Shrinks [First, Last] to the first and the last ray that hit the box. Returns false if no ray hits.
+static bool
+mz_FindActiveRange(const mz_PacketState* State, const mz_AABB& Bounds, uint32_t* InOutFirst, uint32_t* InOutLast)
+{
+	uint32_t First = *InOutFirst;
+	uint32_t Last = *InOutLast;
+
+	uint32_t Group = First & ~(mz_PACKET_LANES - 1);
+	for (;; Group += mz_PACKET_LANES)
+	{
+		if (Group > Last)
+		{
+			return false;
+		}
+		uint32_t Mask = mz_IntersectPacketAABB(State, Bounds, Group) & mz_GetRangeMask(Group, First, Last);
+		if (Mask)
+		{
+			First = Group + mz_CountTrailingZeros(Mask);
+			break;
+		}
+	}
+
+	for (Group = Last & ~(mz_PACKET_LANES - 1);; Group -= mz_PACKET_LANES)
+	{
+		uint32_t Mask = mz_IntersectPacketAABB(State, Bounds, Group) & mz_GetRangeMask(Group, First, Last);
+		if (Mask)
+		{
+			Last = Group + mz_GetHighestBit(Mask);
+			break;
+		}
+	}
+
+	*InOutFirst = First;
+	*InOutLast = Last;
+	return true;
+}
+
+static inline void
+mz_RecordPacketHit(mz_PacketState* State, uint32_t RayIdx, const mz_RayHit& Hit)
+{
+	State->HitMask |= 1ull << RayIdx;
+
+	if (State->RayFlags & mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH)
+	{
+		State->TMax[RayIdx] = -FLT_MAX;
+		State->NumActiveRays--;
+	}
+	else
+	{
+		State->TMax[RayIdx] = Hit.T;
+	}
+
+	if (State->Hits)
+	{
+		State->Hits[RayIdx] = Hit;
+	}
+}
+
+// Same math as mz_IntersectTriangle, one triangle against 'mz_PACKET_LANES' rays.
+static void
+mz_IntersectPacketTriangle(mz_PacketState* State, const mz_CPUTriangle& Triangle, uint32_t First, uint32_t Last)
+{
+	typedef mz_PacketSIMD S;
+	const mz_RayPacket* Packet = State->Packet;
+
+	mz_Float3 E1 = Triangle.Vertices[1] - Triangle.Vertices[0];
+	mz_Float3 E2 = Triangle.Vertices[2] - Triangle.Vertices[0];
+	S::Type E1V[3] = { S::Set1(E1.x), S::Set1(E1.y), S::Set1(E1.z) };
+	S::Type E2V[3] = { S::Set1(E2.x), S::Set1(E2.y), S::Set1(E2.z) };
+	S::Type V0[3] = { S::Set1(Triangle.Vertices[0].x), S::Set1(Triangle.Vertices[0].y), S::Set1(Triangle.Vertices[0].z) };
+	S::Type Zero = S::Set1(0.0f);
+	S::Type One = S::Set1(1.0f);
+	S::Type Epsilon = S::Set1(1e-12f);
+	bool bCullBackFaces = (State->RayFlags & mz_RAY_FLAG_CULL_BACK_FACING_TRIANGLES) != 0;
+
+	for (uint32_t Group = First & ~(mz_PACKET_LANES - 1); Group <= Last; Group += mz_PACKET_LANES)
+	{
+		S::Type D[3] = { S::Load(&Packet->Direction[0][Group]), S::Load(&Packet->Direction[1][Group]), S::Load(&Packet->Direction[2][Group]) };
+
+		S::Type P[3] =
+		{
+			S::Sub(S::Mul(D[1], E2V[2]), S::Mul(D[2], E2V[1])),
+			S::Sub(S::Mul(D[2], E2V[0]), S::Mul(D[0], E2V[2])),
+			S::Sub(S::Mul(D[0], E2V[1]), S::Mul(D[1], E2V[0])),
+		};
+		S::Type Det = S::Add(S::Add(S::Mul(E1V[0], P[0]), S::Mul(E1V[1], P[1])), S::Mul(E1V[2], P[2]));
+		S::Type Valid = bCullBackFaces ? S::CmpGT(Det, Epsilon) : S::CmpGT(S::Abs(Det), Epsilon);
+		if (S::MoveMask(Valid) == 0)
+		{
+			continue;
+		}
+
+		S::Type InvDet = S::Div(One, Det);
+		S::Type SV[3] =
+		{
+			S::Sub(S::Load(&Packet->Origin[0][Group]), V0[0]),
+			S::Sub(S::Load(&Packet->Origin[1][Group]), V0[1]),
+			S::Sub(S::Load(&Packet->Origin[2][Group]), V0[2]),
+		};
+		S::Type U = S::Mul(S::Add(S::Add(S::Mul(SV[0], P[0]), S::Mul(SV[1], P[1])), S::Mul(SV[2], P[2])), InvDet);
+		Valid = S::And(Valid, S::And(S::CmpGE(U, Zero), S::CmpLE(U, One)));
+
+		S::Type Q[3] =
+		{
+			S::Sub(S::Mul(SV[1], E1V[2]), S::Mul(SV[2], E1V[1])),
+			S::Sub(S::Mul(SV[2], E1V[0]), S::Mul(SV[0], E1V[2])),
+			S::Sub(S::Mul(SV[0], E1V[1]), S::Mul(SV[1], E1V[0])),
+		};
+		S::Type V = S::Mul(S::Add(S::Add(S::Mul(D[0], Q[0]), S::Mul(D[1], Q[1])), S::Mul(D[2], Q[2])), InvDet);
+		Valid = S::And(Valid, S::And(S::CmpGE(V, Zero), S::CmpLE(S::Add(U, V), One)));
+
+		S::Type T = S::Mul(S::Add(S::Add(S::Mul(E2V[0], Q[0]), S::Mul(E2V[1], Q[1])), S::Mul(E2V[2], Q[2])), InvDet);
+		Valid = S::And(Valid, S::And(S::CmpGE(T, S::Load(&Packet->TMin[Group])), S::CmpLT(T, S::Load(&State->TMax[Group]))));
+
+		uint32_t Mask = S::MoveMask(Valid) & mz_GetRangeMask(Group, First, Last);
+		if (Mask)
+		{
+			alignas(32) float TValues[mz_PACKET_LANES], UValues[mz_PACKET_LANES], VValues[mz_PACKET_LANES];
+			S::Store(TValues, T);
+			S::Store(UValues, U);
+			S::Store(VValues, V);
+			for (; Mask; Mask &= Mask - 1)
+			{
+				uint32_t Lane = mz_CountTrailingZeros(Mask);
+				mz_RayHit Hit;
+				Hit.T = TValues[Lane];
+				Hit.Barycentrics[0] = UValues[Lane];
+				Hit.Barycentrics[1] = VValues[Lane];
+				Hit.GeometryIndex = Triangle.GeometryIndex;
+				Hit.PrimitiveIndex = Triangle.PrimitiveIndex;
+				mz_RecordPacketHit(State, Group + Lane, Hit);
+			}
+		}
+	}
+}
+
+static inline float
+mz_ReduceMin(mz_PacketSIMD::Type X)
+{
+	alignas(32) float Values[mz_PACKET_LANES];
+	mz_PacketSIMD::Store(Values, X);
+	float Result = Values[0];
+	for (uint32_t Lane = 1; Lane < mz_PACKET_LANES; ++Lane)
+	{
+		Result = Values[Lane] < Result ? Values[Lane] : Result;
+	}
+	return Result;
+}
+
+static inline float
+mz_ReduceMax(mz_PacketSIMD::Type X)
+{
+	alignas(32) float Values[mz_PACKET_LANES];
+	mz_PacketSIMD::Store(Values, X);
+	float Result = Values[0];
+	for (uint32_t Lane = 1; Lane < mz_PACKET_LANES; ++Lane)
+	{
+		Result = Values[Lane] > Result ? Values[Lane] : Result;
+	}
+	return Result;
+}
+
+// Rays outside [First, Last] are ignored. 'TMax' is the initial (current closest) TMax of every ray.
+// Done for every instance the packet reaches, so all rays of a group are set up at once.
+static void
+mz_InitPacketState(mz_PacketState* State, const mz_RayPacket* Packet, const float* TMax, uint32_t First, uint32_t Last, uint32_t RayFlags, mz_RayHit* Hits)
+{
+	typedef mz_PacketSIMD S;
+	alignas(32) static const float LaneIndices[8] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+
+	State->Packet = Packet;
+	State->RayFlags = RayFlags;
+	State->Hits = Hits;
+	State->HitMask = 0;
+	State->NumActiveRays = 0;
+
+	S::Type One = S::Set1(1.0f);
+	S::Type Zero = S::Set1(0.0f);
+	S::Type PositiveMax = S::Set1(FLT_MAX);
+	S::Type NegativeMax = S::Set1(-FLT_MAX);
+	S::Type RangeFirst = S::Set1((float)First);
+	S::Type RangeLast = S::Set1((float)Last);
+
+	S::Type TMinMin = PositiveMax, TMaxMax = NegativeMax;
+	S::Type SegmentMin[3], SegmentMax[3], OriginMin[3], OriginMax[3], InvDirectionMin[3], InvDirectionMax[3];
+	for (uint32_t Axis = 0; Axis < 3; ++Axis)
+	{
+		SegmentMin[Axis] = OriginMin[Axis] = InvDirectionMin[Axis] = PositiveMax;
+		SegmentMax[Axis] = OriginMax[Axis] = InvDirectionMax[Axis] = NegativeMax;
+	}
+	uint32_t NegativeMask[3] = {}, PositiveMask[3] = {};
+	bool bHasZeroDirection = false;
+
+	for (uint32_t Group = 0; Group < mz_PACKET_SIZE; Group += mz_PACKET_LANES)
+	{
+		// NOTE: Padding and finished rays can't hit anything (TMin > TMax). Their data may be garbage, so every value
+		// of an inactive lane is replaced before it is used.
+		S::Type RayIdx = S::Add(S::Set1((float)Group), S::Load(LaneIndices));
+		S::Type RayTMin = S::Load(&Packet->TMin[Group]);
+		S::Type RayTMax = S::Load(&TMax[Group]);
+		S::Type Active = S::And(S::CmpGE(RayTMax, RayTMin), S::And(S::CmpGE(RayIdx, RangeFirst), S::CmpLE(RayIdx, RangeLast)));
+		uint32_t ActiveMask = S::MoveMask(Active);
+
+		S::Store(&State->TMax[Group], S::Select(Active, RayTMax, NegativeMax));
+		if (ActiveMask == 0)
+		{
+			for (uint32_t Axis = 0; Axis < 3; ++Axis)
+			{
+				S::Store(&State->InvDirection[Axis][Group], One);
+			}
+			continue;
+		}
+
+		State->NumActiveRays += mz_PopCount64(ActiveMask);
+		RayTMin = S::Select(Active, RayTMin, Zero);
+		RayTMax = S::Select(Active, RayTMax, Zero);
+		TMinMin = S::Min(TMinMin, S::Select(Active, RayTMin, PositiveMax));
+		TMaxMax = S::Max(TMaxMax, S::Select(Active, RayTMax, NegativeMax));
+
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			S::Type Origin = S::Select(Active, S::Load(&Packet->Origin[Axis][Group]), Zero);
+			S::Type Direction = S::Select(Active, S::Load(&Packet->Direction[Axis][Group]), One);
+			S::Type InvDirection = S::Div(One, Direction);
+			S::Store(&State->InvDirection[Axis][Group], InvDirection);
+
+			S::Type Segment0 = S::Add(Origin, S::Mul(Direction, RayTMin));
+			S::Type Segment1 = S::Add(Origin, S::Mul(Direction, RayTMax));
+			SegmentMin[Axis] = S::Min(SegmentMin[Axis], S::Select(Active, S::Min(Segment0, Segment1), PositiveMax));
+			SegmentMax[Axis] = S::Max(SegmentMax[Axis], S::Select(Active, S::Max(Segment0, Segment1), NegativeMax));
+			OriginMin[Axis] = S::Min(OriginMin[Axis], S::Select(Active, Origin, PositiveMax));
+			OriginMax[Axis] = S::Max(OriginMax[Axis], S::Select(Active, Origin, NegativeMax));
+			InvDirectionMin[Axis] = S::Min(InvDirectionMin[Axis], S::Select(Active, InvDirection, PositiveMax));
+			InvDirectionMax[Axis] = S::Max(InvDirectionMax[Axis], S::Select(Active, InvDirection, NegativeMax));
+
+			uint32_t Negative = S::MoveMask(S::CmpLT(Direction, Zero)) & ActiveMask;
+			uint32_t Positive = S::MoveMask(S::CmpGT(Direction, Zero)) & ActiveMask;
+			bHasZeroDirection |= (Negative | Positive) != ActiveMask;
+			NegativeMask[Axis] |= Negative;
+			PositiveMask[Axis] |= Positive;
+		}
+	}
+
+	// Interval arithmetic frustum needs the same direction signs for all rays.
+	State->bHasFrustum = !bHasZeroDirection;
+	State->TMinMin = mz_ReduceMin(TMinMin);
+	State->TMaxMax = mz_ReduceMax(TMaxMax);
+	State->SegmentBounds.Min = { mz_ReduceMin(SegmentMin[0]), mz_ReduceMin(SegmentMin[1]), mz_ReduceMin(SegmentMin[2]) };
+	State->SegmentBounds.Max = { mz_ReduceMax(SegmentMax[0]), mz_ReduceMax(SegmentMax[1]), mz_ReduceMax(SegmentMax[2]) };
+	for (uint32_t Axis = 0; Axis < 3; ++Axis)
+	{
+		State->bHasFrustum = State->bHasFrustum && !(NegativeMask[Axis] && PositiveMask[Axis]);
+		State->Near[Axis] = NegativeMask[Axis] ? 1 : 0;
+		State->OriginMin[Axis] = mz_ReduceMin(OriginMin[Axis]);
+		State->OriginMax[Axis] = mz_ReduceMax(OriginMax[Axis]);
+		State->InvDirectionMin[Axis] = mz_ReduceMin(InvDirectionMin[Axis]);
+		State->InvDirectionMax[Axis] = mz_ReduceMax(InvDirectionMax[Axis]);
+	}
+}
+
+// Ranged traversal of a binary BVH, shared by TLAS and BLAS. 'IntersectLeaf(Node, First, Last)' handles leaves,
+// 'TraceSingleRay(NodeIdx, RayIdx)' continues with one ray when the packet has diverged.
+template<typename LeafFunction, typename SingleRayFunction> static void
+mz_TraversePacket(const mz_BVHNode* Nodes, mz_PacketState* State, uint32_t First, uint32_t Last, LeafFunction IntersectLeaf, SingleRayFunction TraceSingleRay)
+{
+	const mz_RayPacket* Packet = State->Packet;
+
+	struct mz_PacketStackEntry
+	{
+		uint32_t NodeIdx;
+		uint32_t First;
+		uint32_t Last;
+	};
+	mz_PacketStackEntry Stack[mz_BVH_STACK_SIZE];
+	uint32_t StackSize = 0;
+	Stack[StackSize++] = { 0, First, Last };
+
+	while (StackSize > 0 && State->NumActiveRays > 0)
+	{
+		mz_PacketStackEntry Entry = Stack[--StackSize];
+		const mz_BVHNode& Node = Nodes[Entry.NodeIdx];
+
+		// Whole packet culling is only worth it when many rays are left, first active ray test is cheaper otherwise.
+		if (Entry.Last - Entry.First >= mz_PACKET_LANES && mz_IsPacketCulled(State, Node.Bounds))
+		{
+			continue;
+		}
+		if (!mz_FindActiveRange(State, Node.Bounds, &Entry.First, &Entry.Last))
+		{
+			continue;
+		}
+
+		// Packet has diverged, continue with single rays from this node.
+		if (Entry.Last - Entry.First < mz_PACKET_MIN_RAYS)
+		{
+			for (uint32_t RayIdx = Entry.First; RayIdx <= Entry.Last; ++RayIdx)
+			{
+				if (State->TMax[RayIdx] >= Packet->TMin[RayIdx])
+				{
+					TraceSingleRay(Entry.NodeIdx, RayIdx);
+				}
+			}
+			continue;
+		}
+
+		if (Node.NumPrimitives > 0)
+		{
+			IntersectLeaf(Node, Entry.First, Entry.Last);
+			continue;
+		}
+
+		// Visit the child that is closer along the first active ray direction first.
+		const mz_AABB& Bounds0 = Nodes[Node.FirstChildOrPrimitive].Bounds;
+		const mz_AABB& Bounds1 = Nodes[Node.FirstChildOrPrimitive + 1].Bounds;
+		mz_Float3 Delta = mz_GetCenter(Bounds1) - mz_GetCenter(Bounds0);
+		mz_Float3 Direction = { Packet->Direction[0][Entry.First], Packet->Direction[1][Entry.First], Packet->Direction[2][Entry.First] };
+		uint32_t Near = mz_Dot(Delta, Direction) < 0.0f ? 1 : 0;
+
+		mz_ASSERT(StackSize + 2 <= mz_BVH_STACK_SIZE);
+		Stack[StackSize++] = { Node.FirstChildOrPrimitive + 1 - Near, Entry.First, Entry.Last };
+		Stack[StackSize++] = { Node.FirstChildOrPrimitive + Near, Entry.First, Entry.Last };
+	}
+}
+
+static inline mz_Ray
+mz_GetPacketRay(const mz_PacketState* State, uint32_t RayIdx)
+{
+	const mz_RayPacket* Packet = State->Packet;
+	mz_Ray Ray;
+	Ray.Origin = { Packet->Origin[0][RayIdx], Packet->Origin[1][RayIdx], Packet->Origin[2][RayIdx] };
+	Ray.Direction = { Packet->Direction[0][RayIdx], Packet->Direction[1][RayIdx], Packet->Direction[2][RayIdx] };
+	Ray.TMin = Packet->TMin[RayIdx];
+	Ray.TMax = State->TMax[RayIdx];
+	return Ray;
+}
+
+// Watertight constants of packet rays, initialized per group of 'mz_PACKET_LANES' rays when the group reaches its first leaf.
+struct alignas(32) mz_PacketWatertightRays
+{
+	float Sx[mz_PACKET_SIZE];
+	float Sy[mz_PACKET_SIZE];
+	float Sz[mz_PACKET_SIZE];
+	mz_WatertightRay Rays[mz_PACKET_SIZE];
+	uint32_t GroupK[mz_PACKET_SIZE / mz_PACKET_LANES][3]; // Kx, Ky, Kz of the group, valid if it is in 'UniformGroupMask'.
+	uint32_t InitGroupMask;
+	uint32_t UniformGroupMask; // Active rays of the group share the projection axes, the group is tested as a whole.
+};
+
+static void
+mz_InitPacketWatertightGroup(const mz_PacketState* State, uint32_t Group, mz_PacketWatertightRays* InOutRays)
+{
+	uint32_t GroupIdx = Group / mz_PACKET_LANES;
+	bool bIsUniform = true;
+	bool bIsFirstRay = true;
+
+	for (uint32_t RayIdx = Group; RayIdx < Group + mz_PACKET_LANES; ++RayIdx)
+	{
+		// NOTE: Finished and padding rays never pass the box test, their constants are only kept finite.
+		mz_WatertightRay& Ray = InOutRays->Rays[RayIdx];
+		if (State->TMax[RayIdx] < State->Packet->TMin[RayIdx])
+		{
+			InOutRays->Sx[RayIdx] = InOutRays->Sy[RayIdx] = InOutRays->Sz[RayIdx] = 0.0f;
+			continue;
+		}
+
+		mz_InitWatertightRay(mz_GetPacketRay(State, RayIdx), &Ray);
+		InOutRays->Sx[RayIdx] = Ray.Sx;
+		InOutRays->Sy[RayIdx] = Ray.Sy;
+		InOutRays->Sz[RayIdx] = Ray.Sz;
+
+		uint32_t* K = InOutRays->GroupK[GroupIdx];
+		if (!bIsFirstRay && (K[0] != Ray.Kx || K[1] != Ray.Ky || K[2] != Ray.Kz))
+		{
+			bIsUniform = false;
+		}
+		K[0] = Ray.Kx;
+		K[1] = Ray.Ky;
+		K[2] = Ray.Kz;
+		bIsFirstRay = false;
+	}
+
+	InOutRays->InitGroupMask |= 1u << GroupIdx;
+	InOutRays->UniformGroupMask |= bIsUniform ? 1u << GroupIdx : 0;
+}
+
+// Same math as mz_IntersectTriangleBlock, one triangle at a time against 'mz_PACKET_LANES' rays of a uniform group.
+// 'RayMask' selects rays of the group that hit the leaf box.
+static void
+mz_IntersectPacketTriangleBlock(mz_PacketState* State, const mz_PacketWatertightRays* Rays, const mz_TriangleBlock4& Block, uint32_t NumTriangles, uint32_t Group, uint32_t RayMask)
+{
+	typedef mz_PacketSIMD S;
+	const mz_RayPacket* Packet = State->Packet;
+	const uint32_t* K = Rays->GroupK[Group / mz_PACKET_LANES];
+
+	S::Type Origin[3] = { S::Load(&Packet->Origin[K[0]][Group]), S::Load(&Packet->Origin[K[1]][Group]), S::Load(&Packet->Origin[K[2]][Group]) };
+	S::Type Sx = S::Load(&Rays->Sx[Group]);
+	S::Type Sy = S::Load(&Rays->Sy[Group]);
+	S::Type Sz = S::Load(&Rays->Sz[Group]);
+	S::Type TMin = S::Load(&Packet->TMin[Group]);
+	S::Type Zero = S::Set1(0.0f);
+	bool bCullBackFaces = (State->RayFlags & mz_RAY_FLAG_CULL_BACK_FACING_TRIANGLES) != 0;
+
+	for (uint32_t Lane = 0; Lane < NumTriangles; ++Lane)
+	{
+		S::Type X[3], Y[3], Z[3];
+		for (uint32_t Idx = 0; Idx < 3; ++Idx)
+		{
+			S::Type Px = S::Sub(S::Set1(Block.Vertices[Idx][K[0]][Lane]), Origin[0]);
+			S::Type Py = S::Sub(S::Set1(Block.Vertices[Idx][K[1]][Lane]), Origin[1]);
+			S::Type Pz = S::Sub(S::Set1(Block.Vertices[Idx][K[2]][Lane]), Origin[2]);
+			X[Idx] = S::Sub(Px, S::Mul(Sx, Pz));
+			Y[Idx] = S::Sub(Py, S::Mul(Sy, Pz));
+			Z[Idx] = S::Mul(Sz, Pz);
+		}
+
+		S::Type U = S::Sub(S::Mul(X[2], Y[1]), S::Mul(Y[2], X[1]));
+		S::Type V = S::Sub(S::Mul(X[0], Y[2]), S::Mul(Y[0], X[2]));
+		S::Type W = S::Sub(S::Mul(X[1], Y[0]), S::Mul(Y[1], X[0]));
+
+		S::Type Valid = S::And(S::And(S::CmpGE(U, Zero), S::CmpGE(V, Zero)), S::CmpGE(W, Zero));
+		if (!bCullBackFaces)
+		{
+			Valid = S::Or(Valid, S::And(S::And(S::CmpLE(U, Zero), S::CmpLE(V, Zero)), S::CmpLE(W, Zero)));
+		}
+
+		S::Type Det = S::Add(S::Add(U, V), W);
+		Valid = S::And(Valid, S::CmpGT(S::Abs(Det), Zero));
+		if ((S::MoveMask(Valid) & RayMask) == 0)
+		{
+			continue;
+		}
+
+		S::Type InvDet = S::Div(S::Set1(1.0f), Det);
+		S::Type T = S::Mul(S::Add(S::Add(S::Mul(U, Z[0]), S::Mul(V, Z[1])), S::Mul(W, Z[2])), InvDet);
+		Valid = S::And(Valid, S::And(S::CmpGE(T, TMin), S::CmpLT(T, S::Load(&State->TMax[Group]))));
+
+		uint32_t HitMask = S::MoveMask(Valid) & RayMask;
+		if (HitMask == 0)
+		{
+			continue;
+		}
+
+		alignas(32) float TValues[mz_PACKET_LANES], UValues[mz_PACKET_LANES], VValues[mz_PACKET_LANES];
+		S::Store(TValues, T);
+		S::Store(UValues, S::Mul(V, InvDet));
+		S::Store(VValues, S::Mul(W, InvDet));
+		for (; HitMask; HitMask &= HitMask - 1)
+		{
+			uint32_t RayLane = mz_CountTrailingZeros(HitMask);
+			mz_RayHit Hit;
+			Hit.T = TValues[RayLane];
+			Hit.Barycentrics[0] = UValues[RayLane];
+			Hit.Barycentrics[1] = VValues[RayLane];
+			Hit.GeometryIndex = Block.GeometryIndex[Lane];
+			Hit.PrimitiveIndex = Block.PrimitiveIndex[Lane];
+			mz_RecordPacketHit(State, Group + RayLane, Hit);
+		}
+	}
+}
+
+// mz_IsPacketCulled for all children of a wide node at once. Bit N is set if child N may be hit by some ray.
+template<uint32_t Width, typename SIMD> static inline uint32_t
+mz_GetPacketChildMask(const mz_PacketState* State, const mz_WideBVHNode<Width>& Node)
+{
+	typedef typename SIMD::Type Type;
+	const mz_AABB& Segments = State->SegmentBounds;
+
+	// NOTE: Unused (inverted) children never overlap the segment bounds.
+	Type Overlap[3];
+	for (uint32_t Axis = 0; Axis < 3; ++Axis)
+	{
+		Overlap[Axis] = SIMD::And(SIMD::CmpLE(SIMD::Load(Node.Bounds[0][Axis]), SIMD::Set1(mz_GetComponent(Segments.Max, Axis))),
+			SIMD::CmpGE(SIMD::Load(Node.Bounds[1][Axis]), SIMD::Set1(mz_GetComponent(Segments.Min, Axis))));
+	}
+	Type Valid = SIMD::And(SIMD::And(Overlap[0], Overlap[1]), Overlap[2]);
+
+	if (State->bHasFrustum)
+	{
+		Type TNear = SIMD::Set1(State->TMinMin);
+		Type TFar = SIMD::Set1(State->TMaxMax);
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			Type NearPlane = SIMD::Load(Node.Bounds[State->Near[Axis]][Axis]);
+			Type FarPlane = SIMD::Load(Node.Bounds[1 - State->Near[Axis]][Axis]);
+			Type OriginMin = SIMD::Set1(State->OriginMin[Axis]);
+			Type OriginMax = SIMD::Set1(State->OriginMax[Axis]);
+			Type InvDirectionMin = SIMD::Set1(State->InvDirectionMin[Axis]);
+			Type InvDirectionMax = SIMD::Set1(State->InvDirectionMax[Axis]);
+
+			Type NearD[2] = { SIMD::Sub(NearPlane, OriginMax), SIMD::Sub(NearPlane, OriginMin) };
+			Type FarD[2] = { SIMD::Sub(FarPlane, OriginMax), SIMD::Sub(FarPlane, OriginMin) };
+			Type NearLo = SIMD::Min(SIMD::Min(SIMD::Mul(NearD[0], InvDirectionMin), SIMD::Mul(NearD[0], InvDirectionMax)),
+				SIMD::Min(SIMD::Mul(NearD[1], InvDirectionMin), SIMD::Mul(NearD[1], InvDirectionMax)));
+			Type FarHi = SIMD::Max(SIMD::Max(SIMD::Mul(FarD[0], InvDirectionMin), SIMD::Mul(FarD[0], InvDirectionMax)),
+				SIMD::Max(SIMD::Mul(FarD[1], InvDirectionMin), SIMD::Mul(FarD[1], InvDirectionMax)));
+			TNear = SIMD::Max(TNear, NearLo);
+			TFar = SIMD::Min(TFar, FarHi);
+		}
+		Valid = SIMD::And(Valid, SIMD::CmpLE(TNear, TFar));
+	}
+	return SIMD::MoveMask(Valid);
+}
+
+// Ranged traversal of a BVH4/BVH8. Children of a node are culled for the whole packet at once and the range of active
+// rays is narrowed when a child is popped. Leaves use the watertight test of mz_TraceRayWide, so hits are the same.
+template<uint32_t Width, typename SIMD> static void
+mz_TracePacketWide(const mz_CPUMesh* Mesh, const mz_WideBVHNode<Width>* Nodes, mz_PacketState* State, uint32_t First, uint32_t Last)
+{
+	typedef typename SIMD::Type Type;
+	const mz_RayPacket* Packet = State->Packet;
+	const mz_TriangleBlock4* Blocks = Mesh->TriangleBlocks.data();
+
+	mz_PacketWatertightRays WatertightRays;
+	WatertightRays.InitGroupMask = 0;
+	WatertightRays.UniformGroupMask = 0;
+
+	// Child bounds are read from the parent when the entry is popped, TMax of the rays may have shrunk since the push.
+	struct mz_WidePacketStackEntry
+	{
+		uint32_t NodeIdx;
+		uint32_t Slot;
+		uint32_t First;
+		uint32_t Last;
+	};
+	mz_WidePacketStackEntry Stack[mz_WIDE_BVH_STACK_SIZE];
+	uint32_t StackSize = 0;
+
+	auto PushChildren = [&](uint32_t NodeIdx, uint32_t EntryFirst, uint32_t EntryLast)
+	{
+		const mz_WideBVHNode<Width>& Node = Nodes[NodeIdx];
+		uint32_t HitMask = mz_GetPacketChildMask<Width, SIMD>(State, Node);
+		if (HitMask == 0)
+		{
+			return;
+		}
+
+		// Children are sorted far-to-near along the first active ray, like in mz_TraceRayWide.
+		Type TNear = SIMD::Set1(Packet->TMin[EntryFirst]);
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			float InvDirection = State->InvDirection[Axis][EntryFirst];
+			TNear = SIMD::Max(TNear, SIMD::Mul(SIMD::Sub(SIMD::Load(Node.Bounds[InvDirection < 0.0f][Axis]), SIMD::Set1(Packet->Origin[Axis][EntryFirst])), SIMD::Set1(InvDirection)));
+		}
+		alignas(32) float ChildT[Width];
+		SIMD::Store(ChildT, TNear);
+
+		uint32_t Slots[Width];
+		uint32_t NumHits = 0;
+		for (; HitMask; HitMask &= HitMask - 1)
+		{
+			uint32_t Slot = mz_CountTrailingZeros(HitMask);
+			uint32_t Idx = NumHits++;
+			for (; Idx > 0 && ChildT[Slots[Idx - 1]] < ChildT[Slot]; --Idx)
+			{
+				Slots[Idx] = Slots[Idx - 1];
+			}
+			Slots[Idx] = Slot;
+		}
+
+		mz_ASSERT(StackSize + NumHits <= mz_WIDE_BVH_STACK_SIZE);
+		for (uint32_t Idx = 0; Idx < NumHits; ++Idx)
+		{
+			Stack[StackSize++] = { NodeIdx, Slots[Idx], EntryFirst, EntryLast };
+		}
+	};
+
+	// NOTE: Root is not tested, the range is already narrowed to the instance bounds.
+	PushChildren(0, First, Last);
+
+	while (StackSize > 0 && State->NumActiveRays > 0)
+	{
+		mz_WidePacketStackEntry Entry = Stack[--StackSize];
+		const mz_WideBVHNode<Width>& Parent = Nodes[Entry.NodeIdx];
+		uint32_t Slot = Entry.Slot;
+
+		mz_AABB Bounds;
+		Bounds.Min = { Parent.Bounds[0][0][Slot], Parent.Bounds[0][1][Slot], Parent.Bounds[0][2][Slot] };
+		Bounds.Max = { Parent.Bounds[1][0][Slot], Parent.Bounds[1][1][Slot], Parent.Bounds[1][2][Slot] };
+		// NOTE: Leaves test the box per group anyway, the range is only narrowed for interior nodes.
+		uint32_t Child = Parent.Children[Slot];
+		if (Parent.NumPrimitives[Slot] > 0)
+		{
+			const mz_TriangleBlock4& Block = Blocks[Child];
+			for (uint32_t Group = Entry.First & ~(mz_PACKET_LANES - 1); Group <= Entry.Last; Group += mz_PACKET_LANES)
+			{
+				uint32_t RayMask = mz_IntersectPacketAABB(State, Bounds, Group) & mz_GetRangeMask(Group, Entry.First, Entry.Last);
+				if (RayMask == 0)
+				{
+					continue;
+				}
+
+				uint32_t GroupBit = 1u << (Group / mz_PACKET_LANES);
+				if (!(WatertightRays.InitGroupMask & GroupBit))
+				{
+					mz_InitPacketWatertightGroup(State, Group, &WatertightRays);
+				}
+				if (WatertightRays.UniformGroupMask & GroupBit)
+				{
+					mz_IntersectPacketTriangleBlock(State, &WatertightRays, Block, Parent.NumPrimitives[Slot], Group, RayMask);
+					continue;
+				}
+
+				for (; RayMask; RayMask &= RayMask - 1)
+				{
+					uint32_t RayIdx = Group + mz_CountTrailingZeros(RayMask);
+					mz_RayHit Hit;
+					if (mz_IntersectTriangleBlockClosest<4, mz_SIMD4>(Block, WatertightRays.Rays[RayIdx], Packet->TMin[RayIdx], State->TMax[RayIdx], State->RayFlags, &Hit))
+					{
+						mz_RecordPacketHit(State, RayIdx, Hit);
+					}
+				}
+			}
+			continue;
+		}
+
+		if (!mz_FindActiveRange(State, Bounds, &Entry.First, &Entry.Last))
+		{
+			continue;
+		}
+
+		// Packet has diverged, continue with single rays from this node.
+		if (Entry.Last - Entry.First < mz_PACKET_MIN_RAYS)
+		{
+			for (uint32_t RayIdx = Entry.First; RayIdx <= Entry.Last; ++RayIdx)
+			{
+				mz_RayHit Hit;
+				if (State->TMax[RayIdx] >= Packet->TMin[RayIdx] &&
+					mz_TraceRayWide<Width, SIMD>(Mesh, Nodes, Child, mz_GetPacketRay(State, RayIdx), State->RayFlags, &Hit))
+				{
+					mz_RecordPacketHit(State, RayIdx, Hit);
+				}
+			}
+			continue;
+		}
+
+		PushChildren(Child, Entry.First, Entry.Last);
+	}
+}
+
+static void
+mz_TracePacketBinary(const mz_CPUMesh* Mesh, mz_PacketState* State, uint32_t First, uint32_t Last)
+{
+	const mz_CPUTriangle* Triangles = Mesh->Triangles.data();
+
+	mz_TraversePacket(Mesh->BVH.Nodes.data(), State, First, Last,
+		[State, Triangles](const mz_BVHNode& Node, uint32_t LeafFirst, uint32_t LeafLast)
+		{
+			for (uint32_t Idx = 0; Idx < Node.NumPrimitives; ++Idx)
+			{
+				mz_IntersectPacketTriangle(State, Triangles[Node.FirstChildOrPrimitive + Idx], LeafFirst, LeafLast);
+			}
+		},
+		[State, Mesh](uint32_t NodeIdx, uint32_t RayIdx)
+		{
+			mz_RayHit Hit;
+			if (mz_TraceRayBinary(Mesh, NodeIdx, mz_GetPacketRay(State, RayIdx), State->RayFlags, &Hit))
+			{
+				mz_RecordPacketHit(State, RayIdx, Hit);
+			}
+		});
+}
+
+// Packet is in object space of the mesh, hits have section index as GeometryIndex.
+static void
+mz_TracePacketBLAS(const mz_CPUScene* CPUScene, const mz_CPUMesh* Mesh, mz_PacketState* State, uint32_t First, uint32_t Last)
+{
+#if mz_HAS_BVH8
+	if (CPUScene->BVHWidth == 8)
+	{
+		mz_TracePacketWide<8, mz_SIMD8>(Mesh, Mesh->BVH8.data(), State, First, Last);
+		_mm256_zeroupper();
+		return;
+	}
+#endif
+	if (CPUScene->BVHWidth == 4)
+	{
+		mz_TracePacketWide<4, mz_SIMD4>(Mesh, Mesh->BVH4.data(), State, First, Last);
+		return;
+	}
+	mz_TracePacketBinary(Mesh, State, First, Last);
+}
+
+static void
+mz_TracePacketInstance(const mz_CPUScene* CPUScene, uint32_t InstanceIdx, mz_PacketState* State, uint32_t First, uint32_t Last)
+{
+	const mz_CPUInstance& Instance = CPUScene->Instances[InstanceIdx];
+	const mz_CPUMesh* Mesh = &CPUScene->Meshes[Instance.MeshIndex];
+	const mz_RayPacket* Packet = State->Packet;
+
+	alignas(32) mz_RayPacket ObjectPacket;
+	if (!Instance.bIsIdentity)
+	{
+		for (uint32_t RayIdx = First; RayIdx <= Last; ++RayIdx)
+		{
+			mz_Ray Ray;
+			mz_TransformRayToObject(Instance, mz_GetPacketRay(State, RayIdx), &Ray);
+			ObjectPacket.Origin[0][RayIdx] = Ray.Origin.x;
+			ObjectPacket.Origin[1][RayIdx] = Ray.Origin.y;
+			ObjectPacket.Origin[2][RayIdx] = Ray.Origin.z;
+			ObjectPacket.Direction[0][RayIdx] = Ray.Direction.x;
+			ObjectPacket.Direction[1][RayIdx] = Ray.Direction.y;
+			ObjectPacket.Direction[2][RayIdx] = Ray.Direction.z;
+			ObjectPacket.TMin[RayIdx] = Ray.TMin;
+		}
+		ObjectPacket.NumRays = Last + 1;
+		Packet = &ObjectPacket;
+	}
+
+	mz_PacketState ObjectState;
+	mz_InitPacketState(&ObjectState, Packet, State->TMax, First, Last, State->RayFlags, State->Hits);
+	if (ObjectState.NumActiveRays == 0)
+	{
+		return;
+	}
+	mz_TracePacketBLAS(CPUScene, Mesh, &ObjectState, First, Last);
+
+	State->HitMask |= ObjectState.HitMask;
+	for (uint64_t Mask = ObjectState.HitMask; Mask; Mask &= Mask - 1)
+	{
+		uint32_t RayIdx = mz_CountTrailingZeros64(Mask);
+		State->TMax[RayIdx] = ObjectState.TMax[RayIdx];
+		if (State->RayFlags & mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH)
+		{
+			State->NumActiveRays--;
+		}
+		if (State->Hits)
+		{
+			State->Hits[RayIdx].GeometryIndex += Mesh->FirstGeometry;
+			State->Hits[RayIdx].InstanceIndex = InstanceIdx;
+		}
+	}
+}
+
+uint64_t
+mz_TracePacket(const mz_CPUScene* CPUScene, const mz_RayPacket* Packet, uint32_t RayFlags, mz_RayHit* OutHits)
+{
+	mz_ASSERT(CPUScene && Packet && Packet->NumRays > 0 && Packet->NumRays <= mz_PACKET_SIZE);
+	mz_ASSERT(OutHits || (RayFlags & mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH));
+
+	const uint32_t* InstanceIndices = CPUScene->TLAS.PrimitiveIndices.data();
+	uint32_t Last = Packet->NumRays - 1;
+
+	mz_PacketState State;
+	mz_InitPacketState(&State, Packet, Packet->TMax, 0, Last, RayFlags, OutHits);
+
+	mz_TraversePacket(CPUScene->TLAS.Nodes.data(), &State, 0, Last,
+		[CPUScene, InstanceIndices, &State](const mz_BVHNode& Node, uint32_t LeafFirst, uint32_t LeafLast)
+		{
+			for (uint32_t Idx = 0; Idx < Node.NumPrimitives; ++Idx)
+			{
+				mz_TracePacketInstance(CPUScene, InstanceIndices[Node.FirstChildOrPrimitive + Idx], &State, LeafFirst, LeafLast);
+			}
+		},
+		[CPUScene, &State](uint32_t NodeIdx, uint32_t RayIdx)
+		{
+			mz_RayHit Hit;
+			if (mz_TraceRayTLAS(CPUScene, NodeIdx, mz_GetPacketRay(&State, RayIdx), State.RayFlags, &Hit))
+			{
+				mz_RecordPacketHit(&State, RayIdx, Hit);
+			}
+		});
+
+	return State.HitMask;
+}
+
+//
+// Shading (mirrors Raytracing.hlsl).
+//
+struct mz_ShadingContext
+{
+	const mz_CPUScene* CPUScene;
+	const mz_PerFrameConstantData* FrameData;
+	uint64_t NumRays;
+};
+
+static inline float
+mz_Saturate(float X)
+{
+	return X < 0.0f ? 0.0f : (X > 1.0f ? 1.0f : X);
+}
+
+static inline mz_Float3
+mz_Saturate(mz_Float3 X)
+{
+	return { mz_Saturate(X.x), mz_Saturate(X.y), mz_Saturate(X.z) };
+}
+
+static inline mz_Float3
+mz_Pow(mz_Float3 X, float Y)
+{
+	return { powf(X.x, Y), powf(X.y, Y), powf(X.z, Y) };
+}
+
+static inline mz_Float3
+mz_Lerp(mz_Float3 A, mz_Float3 B, float T)
+{
+	return A + (B - A) * T;
+}
+
+static inline mz_Float3
+mz_ToFloat3(const XMFLOAT3& V)
+{
+	return { V.x, V.y, V.z };
+}
+
+// Bilinear filter, wrap addressing, mip level 0 (SampleLevel(GSampler, UV, 0)).
+static mz_Float3
+mz_SampleImage(const mz_Image& Image, float U, float V)
+{
+	float X = (U - floorf(U)) * Image.Width - 0.5f;
+	float Y = (V - floorf(V)) * Image.Height - 0.5f;
+	float FloorX = floorf(X);
+	float FloorY = floorf(Y);
+	float FracX = X - FloorX;
+	float FracY = Y - FloorY;
+
+	int32_t X0 = (int32_t)FloorX;
+	int32_t Y0 = (int32_t)FloorY;
+	int32_t W = (int32_t)Image.Width;
+	int32_t H = (int32_t)Image.Height;
+	int32_t X1 = X0 + 1 >= W ? 0 : X0 + 1;
+	int32_t Y1 = Y0 + 1 >= H ? 0 : Y0 + 1;
+	X0 = X0 < 0 ? W - 1 : X0;
+	Y0 = Y0 < 0 ? H - 1 : Y0;
+
+	const uint8_t* T00 = &Image.Pixels[((size_t)Y0 * W + X0) * 4];
+	const uint8_t* T10 = &Image.Pixels[((size_t)Y0 * W + X1) * 4];
+	const uint8_t* T01 = &Image.Pixels[((size_t)Y1 * W + X0) * 4];
+	const uint8_t* T11 = &Image.Pixels[((size_t)Y1 * W + X1) * 4];
+
+	float Result[3];
+	for (uint32_t C = 0; C < 3; ++C)
+	{
+		float Top = T00[C] + (T10[C] - T00[C]) * FracX;
+		float Bottom = T01[C] + (T11[C] - T01[C]) * FracX;
+		Result[C] = (Top + (Bottom - Top) * FracY) * (1.0f / 255.0f);
+	}
+	return { Result[0], Result[1], Result[2] };
+}
+
+static float
+mz_GeometrySchlickGGX(float CosTheta, float Roughness)
+{
+	float K = (Roughness * Roughness) * 0.5f;
+	return CosTheta / (CosTheta * (1.0f - K) + K);
+}
+
+static float
+mz_GeometrySmith(float NoL, float NoV, float Roughness)
+{
+	return mz_Saturate(mz_GeometrySchlickGGX(NoV, Roughness) * mz_GeometrySchlickGGX(NoL, Roughness));
+}
+
+static float
+mz_DistributionGGX(mz_Float3 N, mz_Float3 H, float Roughness)
+{
+	float Alpha = Roughness * Roughness;
+	float Alpha2 = Alpha * Alpha;
+	float NoH = mz_Dot(N, H);
+	float NoH2 = NoH * NoH;
+	float K = NoH2 * Alpha2 + (1.0f - NoH2);
+	return Alpha2 / (mz_PI * K * K);
+}
+
+static mz_Float3
+mz_FresnelSchlick(float CosTheta, mz_Float3 F0)
+{
+	return mz_Saturate(F0 + (mz_Float3{ 1.0f, 1.0f, 1.0f } - F0) * powf(1.0f - CosTheta, 5.0f));
+}
+
+static void
+mz_InitShadowRay(mz_Float3 Origin, mz_Float3 Direction, mz_Float3 N, mz_Ray* OutRay)
+{
+	OutRay->Origin = Origin + 0.001f * N;
+	OutRay->Direction = Direction;
+	OutRay->TMin = 0.0f;
+	OutRay->TMax = 100.0f;
+}
+
+static bool
+mz_TraceShadowRay(mz_ShadingContext* Context, mz_Float3 Origin, mz_Float3 Direction, mz_Float3 N, int32_t RecursionDepth)
+{
+	if (RecursionDepth >= mz_MAX_RECURSION_DEPTH)
+	{
+		return false;
+	}
+
+	mz_Ray Ray;
+	mz_InitShadowRay(Origin, Direction, N, &Ray);
+
+	Context->NumRays++;
+
+	return mz_Occluded(Context->CPUScene, Ray);
+}
+
+// Same as LoadIndices() in Raytracing.hlsl.
+static inline void
+mz_LoadIndices(const mz_SceneData* Scene, const mz_PerGeometryRootData& RootData, uint32_t PrimitiveIdx, uint32_t* OutIndices)
+{
+	const uint8_t* Data = &Scene->IndexData[RootData.IndexOffset];
+	for (uint32_t Idx = 0; Idx < 3; ++Idx)
+	{
+		OutIndices[Idx] = RootData.IndexSize == 2 ? ((const uint16_t*)Data)[PrimitiveIdx * 3 + Idx] : ((const uint32_t*)Data)[PrimitiveIdx * 3 + Idx];
+	}
+}
+
+// Everything RadianceClosestHit computes before TraceRay(ShadowRay).
+struct mz_SurfacePoint
+{
+	const mz_Material* Material;
+	mz_Float3 PositionWS;
+	mz_Float3 N;
+	mz_Float3 LightVector;
+	mz_Float3 L;
+	float Texcoord[2];
+};
+
+static void
+mz_ComputeSurfacePoint(const mz_ShadingContext* Context, const mz_RayHit& Hit, mz_SurfacePoint* OutSurface)
+{
+	const mz_CPUScene* CPUScene = Context->CPUScene;
+	const mz_PerFrameConstantData* FrameData = Context->FrameData;
+	const mz_SceneData* Scene = CPUScene->Scene;
+	const mz_CPUGeometry& Geometry = CPUScene->Geometries[Hit.GeometryIndex];
+	const XMFLOAT3X4& ObjectToWorld = Scene->Objects[Hit.InstanceIndex].ObjectToWorld;
+	const mz_Material& Material = Scene->Materials[Geometry.MaterialIndex];
+	OutSurface->Material = &Material;
+
+	mz_Float3 N, PositionWS;
+	float* Texcoord = OutSurface->Texcoord;
+	{
+		uint32_t Indices[3];
+		mz_LoadIndices(Scene, Geometry.RootData, Hit.PrimitiveIndex, Indices);
+		const mz_Vertex* V[3] =
+		{
+			&Scene->Vertices[Geometry.RootData.BaseVertex + Indices[0]],
+			&Scene->Vertices[Geometry.RootData.BaseVertex + Indices[1]],
+			&Scene->Vertices[Geometry.RootData.BaseVertex + Indices[2]],
+		};
+
+		float Bary[3] = { 1.0f - Hit.Barycentrics[0] - Hit.Barycentrics[1], Hit.Barycentrics[0], Hit.Barycentrics[1] };
+
+		PositionWS = mz_ToFloat3(V[0]->Position) * Bary[0] + mz_ToFloat3(V[1]->Position) * Bary[1] + mz_ToFloat3(V[2]->Position) * Bary[2];
+		Texcoord[0] = V[0]->Texcoord.x * Bary[0] + V[1]->Texcoord.x * Bary[1] + V[2]->Texcoord.x * Bary[2];
+		Texcoord[1] = V[0]->Texcoord.y * Bary[0] + V[1]->Texcoord.y * Bary[1] + V[2]->Texcoord.y * Bary[2];
+
+		PositionWS = mz_TransformPoint(ObjectToWorld, PositionWS);
+
+		mz_Float3 Normal = mz_Normalize(mz_ToFloat3(V[0]->Normal) * Bary[0] + mz_ToFloat3(V[1]->Normal) * Bary[1] + mz_ToFloat3(V[2]->Normal) * Bary[2]);
+		mz_Float3 Tangent = mz_Normalize(
+			mz_Float3{ V[0]->Tangent.x, V[0]->Tangent.y, V[0]->Tangent.z } * Bary[0] +
+			mz_Float3{ V[1]->Tangent.x, V[1]->Tangent.y, V[1]->Tangent.z } * Bary[1] +
+			mz_Float3{ V[2]->Tangent.x, V[2]->Tangent.y, V[2]->Tangent.z } * Bary[2]);
+		mz_Float3 Bitangent = mz_Normalize(mz_Cross(Normal, Tangent)) * V[0]->Tangent.w;
+
+		// NOTE: Without normal map we use interpolated vertex normal.
+		N = mz_Float3{ 0.0f, 0.0f, 1.0f };
+		if (Material.NormalTextureIndex != (uint16_t)~0)
+		{
+			// NOTE: Only XY is used, like Raytracing.hlsl (BC5 normal maps have no Z).
+			mz_Float3 Sample = mz_SampleImage(Scene->Images[Material.NormalTextureIndex], Texcoord[0], Texcoord[1]);
+			float X = Sample.x * 2.0f - 1.0f;
+			float Y = Sample.y * 2.0f - 1.0f;
+			N = mz_Normalize(mz_Float3{ X, Y, sqrtf(mz_Saturate(1.0f - X * X - Y * Y)) });
+		}
+
+		N = Tangent * N.x + Bitangent * N.y + Normal * N.z;
+		N = mz_Normalize(mz_TransformVector(ObjectToWorld, N));
+	}
+	OutSurface->PositionWS = PositionWS;
+	OutSurface->N = N;
+	OutSurface->LightVector = mz_Float3{ FrameData->LightPositions[0].x, FrameData->LightPositions[0].y, FrameData->LightPositions[0].z } - PositionWS;
+	OutSurface->L = mz_Normalize(OutSurface->LightVector);
+}
+
+// Everything RadianceClosestHit computes after TraceRay(ShadowRay).
+static mz_Float3
+mz_ShadeSurfacePoint(const mz_ShadingContext* Context, const mz_SurfacePoint& Surface, bool bIsInShadow)
+{
+	const mz_PerFrameConstantData* FrameData = Context->FrameData;
+	const mz_SceneData* Scene = Context->CPUScene->Scene;
+	const mz_Material& Material = *Surface.Material;
+	const float* Texcoord = Surface.Texcoord;
+	mz_Float3 N = Surface.N;
+	mz_Float3 LightVector = Surface.LightVector;
+	mz_Float3 L = Surface.L;
+
+	mz_Float3 CameraPosition = { FrameData->CameraPosition.x, FrameData->CameraPosition.y, FrameData->CameraPosition.z };
+	mz_Float3 V = mz_Normalize(CameraPosition - Surface.PositionWS);
+	float NoV = mz_Saturate(mz_Dot(N, V));
+
+	// NOTE: Materials without textures use glTF factors.
+	mz_Float3 Albedo = { Material.BaseColorFactor.x, Material.BaseColorFactor.y, Material.BaseColorFactor.z };
+	if (Material.BaseColorTextureIndex != (uint16_t)~0)
+	{
+		Albedo = mz_Pow(mz_SampleImage(Scene->Images[Material.BaseColorTextureIndex], Texcoord[0], Texcoord[1]), 2.2f);
+	}
+	mz_Float3 PBRFactors = { 1.0f, Material.RoughnessFactor, Material.MetallicFactor };
+	if (Material.PBRFactorsTextureIndex != (uint16_t)~0)
+	{
+		PBRFactors = mz_SampleImage(Scene->Images[Material.PBRFactorsTextureIndex], Texcoord[0], Texcoord[1]);
+	}
+	float Roughness = PBRFactors.y;
+	float Metallic = PBRFactors.z;
+	float AO = PBRFactors.x;
+	mz_Float3 F0 = mz_Lerp(mz_Float3{ 0.04f, 0.04f, 0.04f }, Albedo, Metallic);
+
+	mz_Float3 Lo = { 0.0f, 0.0f, 0.0f };
+
+	// Light contribution.
+	{
+		mz_Float3 H = mz_Normalize(L + V);
+		float NoL = mz_Saturate(mz_Dot(N, L));
+		float HoV = mz_Saturate(mz_Dot(H, V));
+
+		float Attenuation = fmaxf(1.0f / mz_Dot(LightVector, LightVector), 0.001f);
+		mz_Float3 Radiance = mz_Float3{ FrameData->LightColors[0].x, FrameData->LightColors[0].y, FrameData->LightColors[0].z } * Attenuation;
+
+		mz_Float3 F = mz_FresnelSchlick(HoV, F0);
+		float ND = mz_DistributionGGX(N, H, Roughness);
+		float G = mz_GeometrySmith(NoL, NoV, (Roughness + 1.0f) * 0.5f);
+
+		mz_Float3 Specular = (ND * G * F) * (1.0f / fmaxf(4.0f * NoV * NoL, 0.001f));
+
+		mz_Float3 KD = (mz_Float3{ 1.0f, 1.0f, 1.0f } - F) * (1.0f - Metallic);
+
+		Lo = Lo + (KD * (Albedo * (1.0f / mz_PI)) + Specular) * Radiance * NoL;
+	}
+
+	mz_Float3 Ambient = 0.03f * Albedo * AO;
+	mz_Float3 Color = Ambient + Lo;
+
+	Color = Color * (bIsInShadow ? 0.05f : 1.0f);
+
+	Color = Color / (Color + mz_Float3{ 1.0f, 1.0f, 1.0f });
+	Color = mz_Pow(Color, 1.0f / 2.2f);
+
+	return Color;
+}
+
+static mz_Float3
+mz_RadianceClosestHit(mz_ShadingContext* Context, const mz_RayHit& Hit, int32_t CurrentRecursionDepth)
+{
+	mz_SurfacePoint Surface;
+	mz_ComputeSurfacePoint(Context, Hit, &Surface);
+
+	bool bIsInShadow = mz_TraceShadowRay(Context, Surface.PositionWS, Surface.L, Surface.N, CurrentRecursionDepth);
+
+	return mz_ShadeSurfacePoint(Context, Surface, bIsInShadow);
+}
+
+static mz_Float3
+mz_TraceRadianceRay(mz_ShadingContext* Context, mz_Float3 Origin, mz_Float3 Direction, mz_Float3 N, int32_t RecursionDepth)
+{
+	if (RecursionDepth >= mz_MAX_RECURSION_DEPTH)
+	{
+		return { 0.0f, 0.0f, 0.0f };
+	}
+
+	mz_Ray Ray;
+	Ray.Origin = Origin + 0.001f * N;
+	Ray.Direction = Direction;
+	Ray.TMin = 0.0f;
+	Ray.TMax = 100.0f;
+
+	Context->NumRays++;
+
+	mz_RayHit Hit;
+	if (!mz_TraceRay(Context->CPUScene, Ray, mz_RAY_FLAG_CULL_BACK_FACING_TRIANGLES, &Hit))
+	{
+		// RadianceMiss.
+		return { 0.1f, 0.2f, 0.4f };
+	}
+	return mz_RadianceClosestHit(Context, Hit, RecursionDepth + 1);
+}
+
+static void
+mz_GenerateCameraRay(const mz_PerFrameConstantData* FrameData, uint32_t X, uint32_t Y, uint32_t Width, uint32_t Height, mz_Float3* OutOrigin, mz_Float3* OutDirection)
+{
+	float ScreenPos[2] = { (X + 0.5f) / Width * 2.0f - 1.0f, (Y + 0.5f) / Height * 2.0f - 1.0f };
+
+	ScreenPos[1] = -ScreenPos[1];
+
+	// ProjectionToWorld is stored transposed (HLSL reads it as column-major).
+	const XMFLOAT4X4& M = FrameData->ProjectionToWorld;
+	float World[4];
+	for (uint32_t Idx = 0; Idx < 4; ++Idx)
+	{
+		World[Idx] = ScreenPos[0] * M.m[Idx][0] + ScreenPos[1] * M.m[Idx][1] + M.m[Idx][3];
+	}
+
+	*OutOrigin = { FrameData->CameraPosition.x, FrameData->CameraPosition.y, FrameData->CameraPosition.z };
+	*OutDirection = mz_Normalize(mz_Float3{ World[0] / World[3], World[1] / World[3], World[2] / World[3] } - *OutOrigin);
+}
+
+void
+mz_ComputeProjectionToWorld(mz_Float3 Position, float Yaw, float Pitch, float FovY, float AspectRatio, float Near, float Far, XMFLOAT4X4* OutProjectionToWorld)
+{
+	// Same as XMMatrixTranspose(XMMatrixInverse(nullptr, XMMatrixLookToLH(...) * XMMatrixPerspectiveFovLH(...))) in mz_Draw.
+	mz_Float3 Forward = { cosf(Pitch) * sinf(Yaw), -sinf(Pitch), cosf(Pitch) * cosf(Yaw) };
+	mz_Float3 Right = mz_Normalize(mz_Cross(mz_Float3{ 0.0f, 1.0f, 0.0f }, Forward));
+	mz_Float3 Up = mz_Cross(Forward, Right);
+
+	float ScaleY = 1.0f / tanf(FovY * 0.5f);
+	float ScaleX = ScaleY / AspectRatio;
+	float A = Far / (Far - Near);
+	float B = -Near * Far / (Far - Near);
+
+	// Rows of inverse(View * Projection).
+	float Rows[4][4] =
+	{
+		{ Right.x / ScaleX, Right.y / ScaleX, Right.z / ScaleX, 0.0f },
+		{ Up.x / ScaleY, Up.y / ScaleY, Up.z / ScaleY, 0.0f },
+		{ Position.x / B, Position.y / B, Position.z / B, 1.0f / B },
+		{ Forward.x - Position.x * A / B, Forward.y - Position.y * A / B, Forward.z - Position.z * A / B, -A / B },
+	};
+
+	for (uint32_t Row = 0; Row < 4; ++Row)
+	{
+		for (uint32_t Column = 0; Column < 4; ++Column)
+		{
+			OutProjectionToWorld->m[Column][Row] = Rows[Row][Column];
+		}
+	}
+}
+
+static void
+mz_WritePixel(uint8_t* OutPixels, uint32_t Width, uint32_t X, uint32_t Y, mz_Float3 Color)
+{
+	uint8_t* Pixel = &OutPixels[((size_t)Y * Width + X) * 4];
+	Pixel[0] = (uint8_t)(mz_Saturate(Color.x) * 255.0f + 0.5f);
+	Pixel[1] = (uint8_t)(mz_Saturate(Color.y) * 255.0f + 0.5f);
+	Pixel[2] = (uint8_t)(mz_Saturate(Color.z) * 255.0f + 0.5f);
+	Pixel[3] = 255;
+}
+
+static inline void
+mz_SetPacketRay(mz_RayPacket* Packet, uint32_t RayIdx, const mz_Ray& Ray)
+{
+	Packet->Origin[0][RayIdx] = Ray.Origin.x;
+	Packet->Origin[1][RayIdx] = Ray.Origin.y;
+	Packet->Origin[2][RayIdx] = Ray.Origin.z;
+	Packet->Direction[0][RayIdx] = Ray.Direction.x;
+	Packet->Direction[1][RayIdx] = Ray.Direction.y;
+	Packet->Direction[2][RayIdx] = Ray.Direction.z;
+	Packet->TMin[RayIdx] = Ray.TMin;
+	Packet->TMax[RayIdx] = Ray.TMax;
+}
+
+// Same result as mz_TraceRadianceRay for every pixel of the block, but primary and shadow rays are traced as packets.
+static void
+mz_RenderPacketBlock(mz_ShadingContext* Context, uint32_t BeginX, uint32_t BeginY, uint32_t EndX, uint32_t EndY, uint32_t Width, uint32_t Height, uint8_t* OutPixels)
+{
+	const mz_CPUScene* CPUScene = Context->CPUScene;
+
+	alignas(32) mz_RayPacket Packet;
+	mz_RayHit Hits[mz_PACKET_SIZE];
+	mz_SurfacePoint Surfaces[mz_PACKET_SIZE];
+	uint32_t ShadowRayToPrimaryRay[mz_PACKET_SIZE];
+
+	Packet.NumRays = 0;
+	for (uint32_t Y = BeginY; Y < EndY; ++Y)
+	{
+		for (uint32_t X = BeginX; X < EndX; ++X)
+		{
+			mz_Ray Ray;
+			mz_GenerateCameraRay(Context->FrameData, X, Y, Width, Height, &Ray.Origin, &Ray.Direction);
+			Ray.TMin = 0.0f;
+			Ray.TMax = 100.0f;
+			mz_SetPacketRay(&Packet, Packet.NumRays++, Ray);
+		}
+	}
+	uint32_t NumPrimaryRays = Packet.NumRays;
+	Context->NumRays += NumPrimaryRays;
+
+	uint64_t HitMask = mz_TracePacket(CPUScene, &Packet, mz_RAY_FLAG_CULL_BACK_FACING_TRIANGLES, Hits);
+
+	// Shadow rays of all surface points go into one (compacted) packet.
+	Packet.NumRays = 0;
+	for (uint32_t RayIdx = 0; RayIdx < NumPrimaryRays; ++RayIdx)
+	{
+		if (HitMask & (1ull << RayIdx))
+		{
+			mz_ComputeSurfacePoint(Context, Hits[RayIdx], &Surfaces[RayIdx]);
+
+			mz_Ray Ray;
+			mz_InitShadowRay(Surfaces[RayIdx].PositionWS, Surfaces[RayIdx].L, Surfaces[RayIdx].N, &Ray);
+			ShadowRayToPrimaryRay[Packet.NumRays] = RayIdx;
+			mz_SetPacketRay(&Packet, Packet.NumRays++, Ray);
+		}
+	}
+
+	uint64_t ShadowMask = 0;
+	if (Packet.NumRays > 0)
+	{
+		Context->NumRays += Packet.NumRays;
+		uint64_t ShadowHitMask = mz_TracePacket(CPUScene, &Packet, mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH, nullptr);
+		for (uint32_t RayIdx = 0; RayIdx < Packet.NumRays; ++RayIdx)
+		{
+			if (ShadowHitMask & (1ull << RayIdx))
+			{
+				ShadowMask |= 1ull << ShadowRayToPrimaryRay[RayIdx];
+			}
+		}
+	}
+
+	uint32_t RayIdx = 0;
+	for (uint32_t Y = BeginY; Y < EndY; ++Y)
+	{
+		for (uint32_t X = BeginX; X < EndX; ++X, ++RayIdx)
+		{
+			// RadianceMiss.
+			mz_Float3 Color = { 0.1f, 0.2f, 0.4f };
+			if (HitMask & (1ull << RayIdx))
+			{
+				Color = mz_ShadeSurfacePoint(Context, Surfaces[RayIdx], (ShadowMask & (1ull << RayIdx)) != 0);
+			}
+			mz_WritePixel(OutPixels, Width, X, Y, Color);
+		}
+	}
+}
+
+// Runs 'Worker()' as NumThreads jobs (0 - one per job thread), calling thread is one of them.
+template<typename WorkerFunction> static void
+mz_RunWorkers(uint32_t NumThreads, WorkerFunction Worker)
+{
+	if (NumThreads == 0)
+	{
+		NumThreads = mz_GetNumJobThreads();
+	}
+	mz_ParallelFor(NumThreads, 1, [&Worker](uint32_t, uint32_t) { Worker(); });
+}
+
+uint64_t
+mz_RenderFrameCPU(const mz_CPUScene* CPUScene, const mz_PerFrameConstantData* FrameData, uint32_t Width, uint32_t Height, uint32_t NumThreads, uint8_t* OutPixels)
+{
+	mz_ASSERT(CPUScene && FrameData && OutPixels && Width > 0 && Height > 0);
+
+	uint32_t NumTilesX = (Width + mz_TILE_SIZE - 1) / mz_TILE_SIZE;
+	uint32_t NumTilesY = (Height + mz_TILE_SIZE - 1) / mz_TILE_SIZE;
+	uint32_t NumTiles = NumTilesX * NumTilesY;
+
+	// Tiles are handed out dynamically, rays in different parts of the frame have very different cost.
+	std::atomic<uint32_t> NextTile(0);
+	std::atomic<uint64_t> NumRays(0);
+
+	auto Worker = [&]()
+	{
+		mz_ShadingContext Context = { CPUScene, FrameData, 0 };
+
+		for (;;)
+		{
+			uint32_t TileIdx = NextTile.fetch_add(1);
+			if (TileIdx >= NumTiles)
+			{
+				break;
+			}
+
+			uint32_t BeginX = (TileIdx % NumTilesX) * mz_TILE_SIZE;
+			uint32_t BeginY = (TileIdx / NumTilesX) * mz_TILE_SIZE;
+			uint32_t EndX = BeginX + mz_TILE_SIZE < Width ? BeginX + mz_TILE_SIZE : Width;
+			uint32_t EndY = BeginY + mz_TILE_SIZE < Height ? BeginY + mz_TILE_SIZE : Height;
+
+			if (CPUScene->bUsePackets)
+			{
+				for (uint32_t Y = BeginY; Y < EndY; Y += mz_PACKET_WIDTH)
+				{
+					for (uint32_t X = BeginX; X < EndX; X += mz_PACKET_WIDTH)
+					{
+						uint32_t BlockEndX = X + mz_PACKET_WIDTH < EndX ? X + mz_PACKET_WIDTH : EndX;
+						uint32_t BlockEndY = Y + mz_PACKET_WIDTH < EndY ? Y + mz_PACKET_WIDTH : EndY;
+						mz_RenderPacketBlock(&Context, X, Y, BlockEndX, BlockEndY, Width, Height, OutPixels);
+					}
+				}
+				continue;
+			}
+
+			for (uint32_t Y = BeginY; Y < EndY; ++Y)
+			{
+				for (uint32_t X = BeginX; X < EndX; ++X)
+				{
+					mz_Float3 Origin, Direction;
+					mz_GenerateCameraRay(FrameData, X, Y, Width, Height, &Origin, &Direction);
+
+					mz_Float3 Color = mz_TraceRadianceRay(&Context, Origin, Direction, mz_Float3{ 0.0f, 0.0f, 0.0f }, 0);
+					mz_WritePixel(OutPixels, Width, X, Y, Color);
+				}
+			}
+		}
+
+		NumRays.fetch_add(Context.NumRays);
+	};
+
+	mz_RunWorkers(NumThreads, Worker);
+	return NumRays;
+}
+
+//
+// Ray benchmark.
+//
+static inline uint32_t
+mz_HashUInt32(uint32_t X)
+{
+	// PCG hash.
+	uint32_t State = X * 747796405u + 2891336453u;
+	uint32_t Word = ((State >> ((State >> 28u) + 4u)) ^ State) * 277803737u;
+	return (Word >> 22u) ^ Word;
+}
+
+// Traces rays in chunks handed out dynamically. Misses have T = FLT_MAX. Returns number of hits.
+// With bIsOcclusionQuery single rays use mz_Occluded and only T of the hits is valid (0 for occluded rays).
+static uint64_t
+mz_TraceRays(const mz_CPUScene* CPUScene, const mz_Ray* Rays, uint32_t NumRays, uint32_t RayFlags, bool bIsOcclusionQuery, uint32_t NumThreads, mz_RayHit* OutHits)
+{
+	std::atomic<uint32_t> NextChunk(0);
+	std::atomic<uint64_t> NumHits(0);
+	uint32_t NumChunks = (NumRays + mz_PACKET_SIZE - 1) / mz_PACKET_SIZE;
+
+	auto Worker = [&]()
+	{
+		uint64_t NumWorkerHits = 0;
+		mz_RayPacket Packet;
+
+		for (;;)
+		{
+			uint32_t ChunkIdx = NextChunk.fetch_add(1);
+			if (ChunkIdx >= NumChunks)
+			{
+				break;
+			}
+
+			uint32_t Begin = ChunkIdx * mz_PACKET_SIZE;
+			uint32_t End = Begin + mz_PACKET_SIZE < NumRays ? Begin + mz_PACKET_SIZE : NumRays;
+
+			if (CPUScene->bUsePackets)
+			{
+				Packet.NumRays = End - Begin;
+				for (uint32_t Idx = Begin; Idx < End; ++Idx)
+				{
+					mz_SetPacketRay(&Packet, Idx - Begin, Rays[Idx]);
+				}
+				uint64_t HitMask = mz_TracePacket(CPUScene, &Packet, RayFlags, &OutHits[Begin]);
+				for (uint32_t Idx = Begin; Idx < End; ++Idx)
+				{
+					if ((HitMask & (1ull << (Idx - Begin))) == 0)
+					{
+						OutHits[Idx].T = FLT_MAX;
+					}
+				}
+				NumWorkerHits += mz_PopCount64(HitMask);
+				continue;
+			}
+
+			if (bIsOcclusionQuery)
+			{
+				for (uint32_t Idx = Begin; Idx < End; ++Idx)
+				{
+					bool bIsOccluded = mz_Occluded(CPUScene, Rays[Idx]);
+					OutHits[Idx].T = bIsOccluded ? 0.0f : FLT_MAX;
+					NumWorkerHits += bIsOccluded ? 1 : 0;
+				}
+				continue;
+			}
+
+			for (uint32_t Idx = Begin; Idx < End; ++Idx)
+			{
+				if (mz_TraceRay(CPUScene, Rays[Idx], RayFlags, &OutHits[Idx]))
+				{
+					NumWorkerHits++;
+				}
+				else
+				{
+					OutHits[Idx].T = FLT_MAX;
+				}
+			}
+		}
+
+		NumHits.fetch_add(NumWorkerHits);
+	};
+
+	mz_RunWorkers(NumThreads, Worker);
+	return NumHits;
+}
+
+void
+mz_BenchmarkRays(const mz_CPUScene* CPUScene, const mz_PerFrameConstantData* FrameData, uint32_t Width, uint32_t Height, uint32_t NumThreads, uint32_t NumIterations, mz_RayBenchmarkResult* OutResult)
+{
+	mz_ASSERT(CPUScene && FrameData && OutResult && Width > 0 && Height > 0 && NumIterations > 0);
+
+	eastl::vector<mz_Ray> Rays[mz_RAY_CLASS_COUNT];
+	eastl::vector<mz_RayHit> Hits((size_t)Width * Height);
+	const uint32_t RayFlags[mz_RAY_CLASS_COUNT] =
+	{
+		mz_RAY_FLAG_CULL_BACK_FACING_TRIANGLES,
+		mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH,
+		mz_RAY_FLAG_CULL_BACK_FACING_TRIANGLES,
+	};
+
+	// Primary rays in 8x8 blocks, so that consecutive rays are coherent (and form one packet).
+	Rays[mz_RAY_CLASS_PRIMARY].reserve((size_t)Width * Height);
+	for (uint32_t BlockY = 0; BlockY < Height; BlockY += mz_PACKET_WIDTH)
+	{
+		for (uint32_t BlockX = 0; BlockX < Width; BlockX += mz_PACKET_WIDTH)
+		{
+			for (uint32_t Y = BlockY; Y < BlockY + mz_PACKET_WIDTH && Y < Height; ++Y)
+			{
+				for (uint32_t X = BlockX; X < BlockX + mz_PACKET_WIDTH && X < Width; ++X)
+				{
+					mz_Ray Ray;
+					mz_GenerateCameraRay(FrameData, X, Y, Width, Height, &Ray.Origin, &Ray.Direction);
+					Ray.TMin = 0.0f;
+					Ray.TMax = 100.0f;
+					Rays[mz_RAY_CLASS_PRIMARY].push_back(Ray);
+				}
+			}
+		}
+	}
+
+	// Returns best time of all iterations.
+	auto MeasureRays = [&](const eastl::vector<mz_Ray>& ClassRays, uint32_t ClassRayFlags, bool bIsOcclusionQuery, uint64_t* OutNumHits)
+	{
+		double BestTime = DBL_MAX;
+		for (uint32_t Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			double Time = mz_GetTime();
+			*OutNumHits = mz_TraceRays(CPUScene, ClassRays.data(), (uint32_t)ClassRays.size(), ClassRayFlags, bIsOcclusionQuery, NumThreads, Hits.data());
+			Time = mz_GetTime() - Time;
+			BestTime = Time < BestTime ? Time : BestTime;
+		}
+		return BestTime;
+	};
+
+	for (uint32_t RayClass = 0; RayClass < mz_RAY_CLASS_COUNT; ++RayClass)
+	{
+		const eastl::vector<mz_Ray>& ClassRays = Rays[RayClass];
+		uint64_t NumHits = 0;
+		double BestTime = MeasureRays(ClassRays, RayFlags[RayClass], RayClass == mz_RAY_CLASS_SHADOW, &NumHits);
+
+		OutResult->NumRays[RayClass] = ClassRays.size();
+		OutResult->NumHits[RayClass] = NumHits;
+		OutResult->Seconds[RayClass] = BestTime;
+		OutResult->MRaysPerSecond[RayClass] = BestTime > 0.0 ? ClassRays.size() / BestTime * 1.0e-6 : 0.0;
+
+		if (RayClass == mz_RAY_CLASS_SHADOW)
+		{
+			// Same shadow rays with mz_TraceRay, closest hit and first hit.
+			double ClosestHitTime = MeasureRays(ClassRays, mz_RAY_FLAG_NONE, false, &OutResult->ShadowClosestHitNumHits);
+			double FirstHitTime = MeasureRays(ClassRays, mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH, false, &OutResult->ShadowFirstHitNumHits);
+
+			OutResult->ShadowClosestHitMRaysPerSecond = ClosestHitTime > 0.0 ? ClassRays.size() / ClosestHitTime * 1.0e-6 : 0.0;
+			OutResult->ShadowFirstHitMRaysPerSecond = FirstHitTime > 0.0 ? ClassRays.size() / FirstHitTime * 1.0e-6 : 0.0;
+		}
+		if (RayClass != mz_RAY_CLASS_PRIMARY)
+		{
+			continue;
+		}
+
+		// Secondary rays start at primary hits: shadow rays go to the light (same as TraceShadowRay),
+		// diffuse rays are cosine distributed around the shading normal.
+		mz_ShadingContext Context = { CPUScene, FrameData, 0 };
+		Rays[mz_RAY_CLASS_SHADOW].reserve(NumHits);
+		Rays[mz_RAY_CLASS_DIFFUSE].reserve(NumHits);
+
+		for (uint32_t RayIdx = 0; RayIdx < (uint32_t)ClassRays.size(); ++RayIdx)
+		{
+			if (Hits[RayIdx].T == FLT_MAX)
+			{
+				continue;
+			}
+
+			mz_SurfacePoint Surface;
+			mz_ComputeSurfacePoint(&Context, Hits[RayIdx], &Surface);
+
+			mz_Ray Ray;
+			mz_InitShadowRay(Surface.PositionWS, Surface.L, Surface.N, &Ray);
+			Rays[mz_RAY_CLASS_SHADOW].push_back(Ray);
+
+			uint32_t Seed = mz_HashUInt32(RayIdx);
+			float U0 = (Seed & 0xffff) / 65536.0f;
+			float U1 = (Seed >> 16) / 65536.0f;
+			float Radius = sqrtf(U0);
+			float Phi = 2.0f * mz_PI * U1;
+
+			mz_Float3 N = Surface.N;
+			mz_Float3 T = mz_Normalize(mz_Cross(fabsf(N.y) < 0.999f ? mz_Float3{ 0.0f, 1.0f, 0.0f } : mz_Float3{ 1.0f, 0.0f, 0.0f }, N));
+			mz_Float3 B = mz_Cross(N, T);
+			mz_Float3 Direction = mz_Normalize(T * (Radius * cosf(Phi)) + B * (Radius * sinf(Phi)) + N * sqrtf(1.0f - U0));
+			mz_InitShadowRay(Surface.PositionWS, Direction, Surface.N, &Ray);
+			Rays[mz_RAY_CLASS_DIFFUSE].push_back(Ray);
+		}
+	}
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <math.h>
+#include <float.h>
+#include "Library.h"
+
+// Same values as D3D12_RAY_FLAGS.
+#define mz_RAY_FLAG_NONE 0
+#define mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH 0x4
+#define mz_RAY_FLAG_CULL_BACK_FACING_TRIANGLES 0x10
+
+struct mz_Float3
+{
+	float x, y, z;
+};
+
+struct mz_AABB
+{
+	mz_Float3 Min;
+	mz_Float3 Max;
+};
+
+struct mz_Ray
+{
+	mz_Float3 Origin;
+	float TMin;
+	mz_Float3 Direction;
+	float TMax;
+};
+
+struct mz_RayHit
+{
+	float T;
+	float Barycentrics[2]; // Same convention as BuiltInTriangleIntersectionAttributes.
+	uint32_t GeometryIndex; // mz_CPUScene::Geometries index, same as hit group record index / 2.
+	uint32_t PrimitiveIndex;
+	uint32_t InstanceIndex; // Same as InstanceID() (object index).
+};
+
+struct mz_BVHNode
+{
+	mz_AABB Bounds;
+	uint32_t FirstChildOrPrimitive; // Interior node: index of the first child (second child follows it). Leaf: first primitive.
+	uint32_t NumPrimitives; // 0 for interior nodes.
+};
+
+struct mz_BVH
+{
+	eastl::vector<mz_BVHNode> Nodes;
+	eastl::vector<uint32_t> PrimitiveIndices;
+};
+
+// NOTE: BVH8 needs AVX2, BVH4 only needs SSE which every x64 CPU has.
+#if defined(__AVX2__)
+#define mz_HAS_BVH8 1
+#else
+#define mz_HAS_BVH8 0
+#endif
+
+// Binary BVH collapsed to 4 or 8 children per node. Child bounds are stored SoA so that one load gives one plane of all children.
+template<uint32_t Width>
+struct alignas(Width * 4) mz_WideBVHNode
+{
+	float Bounds[2][3][Width]; // [Min/Max][Axis][Child]. Unused children have empty (inverted) bounds.
+	uint32_t Children[Width]; // Interior child: node index. Leaf child: first primitive (mz_CPUScene replaces it with mz_TriangleBlock index).
+	uint32_t NumPrimitives[Width]; // 0 for interior children.
+};
+typedef mz_WideBVHNode<4> mz_BVH4Node;
+typedef mz_WideBVHNode<8> mz_BVH8Node;
+
+// 8x8 rays stored SoA, traced together by mz_TracePacket (through the BLASes of BVHWidth, like single rays).
+#define mz_PACKET_WIDTH 8
+#define mz_PACKET_SIZE (mz_PACKET_WIDTH * mz_PACKET_WIDTH)
+
+struct alignas(32) mz_RayPacket
+{
+	float Origin[3][mz_PACKET_SIZE];
+	float Direction[3][mz_PACKET_SIZE];
+	float TMin[mz_PACKET_SIZE];
+	float TMax[mz_PACKET_SIZE];
+	uint32_t NumRays; // Rays [NumRays, mz_PACKET_SIZE) are ignored.
+};
+
+// Triangles of one BVH leaf stored SoA for the watertight SIMD intersection. Unused lanes repeat the last triangle.
+template<uint32_t Width>
+struct alignas(Width * 4) mz_TriangleBlock
+{
+	float Vertices[3][3][Width]; // [Vertex][Axis][Triangle].
+	uint32_t GeometryIndex[Width];
+	uint32_t PrimitiveIndex[Width];
+};
+typedef mz_TriangleBlock<4> mz_TriangleBlock4;
+typedef mz_TriangleBlock<8> mz_TriangleBlock8;
+
+// Object-space triangle, one per primitive of every (mesh, section) pair.
+struct mz_CPUTriangle
+{
+	mz_Float3 Vertices[3];
+	uint32_t GeometryIndex; // Section index within the mesh.
+	uint32_t PrimitiveIndex;
+};
+
+// CPU counterpart of the hit group shader record.
+struct mz_CPUGeometry
+{
+	mz_PerGeometryRootData RootData;
+	uint32_t MaterialIndex;
+};
+
+// Bottom level acceleration structure, one per mz_Mesh (shared by all objects that use the mesh).
+struct mz_CPUMesh
+{
+	eastl::vector<mz_CPUTriangle> Triangles; // In BVH leaf order.
+	eastl::vector<mz_TriangleBlock4> TriangleBlocks; // One per BVH leaf, used by BVH4 and BVH8 traversal.
+	mz_BVH BVH;
+	eastl::vector<mz_BVH4Node> BVH4;
+	eastl::vector<mz_BVH8Node> BVH8; // Empty if !mz_HAS_BVH8.
+	uint32_t FirstGeometry; // mz_CPUScene::Geometries index of the first section (InstanceContributionToHitGroupIndex / 2).
+};
+
+// Top level acceleration structure leaf, one per mz_Object.
+struct mz_CPUInstance
+{
+	XMFLOAT3X4 WorldToObject;
+	mz_AABB Bounds; // World space.
+	uint32_t MeshIndex;
+	bool bIsIdentity; // Rays are not transformed, mz_TraceRay gives exactly the same result as for a flattened scene.
+};
+
+struct mz_CPUScene
+{
+	const mz_SceneData* Scene;
+	eastl::vector<mz_CPUGeometry> Geometries; // One per (mesh, section) pair, same order as hit group records in the shader table.
+	eastl::vector<mz_CPUMesh> Meshes; // mz_SceneData::Meshes followed by LODMeshes, BLAS is built only for used ones.
+	eastl::vector<mz_CPUInstance> Instances; // Same order as mz_SceneData::Objects.
+	mz_BVH TLAS; // Binary BVH over instance bounds, leaves index Instances through TLAS.PrimitiveIndices.
+	uint32_t BVHWidth; // BLAS traversal used by mz_TraceRay: 2, 4 or 8.
+	bool bUsePackets; // mz_RenderFrameCPU traces primary and shadow rays with mz_TracePacket.
+	double BVHBuildTime; // Seconds, all BLASes and TLAS.
+	float BVHSAHCost; // Sum over BLASes weighted by number of instances.
+};
+
+struct mz_IntersectionBenchmarkResult
+{
+	double MTestsPerSecond[3]; // Scalar Moller-Trumbore, watertight mz_TriangleBlock4, watertight mz_TriangleBlock8 (0 if !mz_HAS_BVH8).
+	uint32_t NumHits[3]; // Closest hits found, should (almost) match. Watertight test doesn't miss hits on shared edges.
+};
+
+enum mz_RayClass
+{
+	mz_RAY_CLASS_PRIMARY, // Camera rays, closest hit.
+	mz_RAY_CLASS_SHADOW, // From primary hits to the light, any hit.
+	mz_RAY_CLASS_DIFFUSE, // From primary hits, cosine distributed around the normal (incoherent), closest hit.
+	mz_RAY_CLASS_COUNT,
+};
+
+struct mz_RayBenchmarkResult
+{
+	uint64_t NumRays[mz_RAY_CLASS_COUNT];
+	uint64_t NumHits[mz_RAY_CLASS_COUNT];
+	double Seconds[mz_RAY_CLASS_COUNT]; // Best of all iterations.
+	double MRaysPerSecond[mz_RAY_CLASS_COUNT]; // Shadow rays use mz_Occluded (mz_TracePacket if bUsePackets).
+	double ShadowClosestHitMRaysPerSecond; // Same shadow rays with mz_TraceRay (or mz_TracePacket), closest hit.
+	double ShadowFirstHitMRaysPerSecond; // Same shadow rays with mz_TraceRay (or mz_TracePacket) and mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH.
+	uint64_t ShadowClosestHitNumHits; // Both have to match NumHits[mz_RAY_CLASS_SHADOW].
+	uint64_t ShadowFirstHitNumHits;
+};
+
+//
+// CPU raytracer.
+//
+mz_CPUScene* mz_CreateCPUScene(const mz_SceneData* Scene, const uint32_t* ObjectLODs, uint32_t NumThreads); // ObjectLODs (level per object, see mz_GetMeshLOD) can be null.
+void mz_DestroyCPUScene(mz_CPUScene* CPUScene);
+void mz_BuildBVH(const mz_AABB* PrimitiveBounds, uint32_t NumPrimitives, uint32_t NumThreads, mz_BVH* OutBVH);
+float mz_ComputeSAHCost(const mz_BVH* BVH);
+template<uint32_t Width> void mz_CollapseBVH(const mz_BVH* BVH, eastl::vector<mz_WideBVHNode<Width>>* OutNodes);
+uint32_t mz_GetNumBVHNodes(const mz_CPUScene* CPUScene, uint32_t BVHWidth); // All BLASes, TLAS is not included.
+size_t mz_GetCPUSceneMemory(const mz_CPUScene* CPUScene); // Bytes used by triangles and acceleration structures.
+bool mz_TraceRay(const mz_CPUScene* CPUScene, const mz_Ray& Ray, uint32_t RayFlags, mz_RayHit* OutHit);
+bool mz_Occluded(const mz_CPUScene* CPUScene, const mz_Ray& Ray); // Same result as mz_TraceRay with mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH, but faster.
+uint64_t mz_TracePacket(const mz_CPUScene* CPUScene, const mz_RayPacket* Packet, uint32_t RayFlags, mz_RayHit* OutHits); // Returns hit mask. OutHits can be null for mz_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH.
+void mz_ComputeProjectionToWorld(mz_Float3 Position, float Yaw, float Pitch, float FovY, float AspectRatio, float Near, float Far, XMFLOAT4X4* OutProjectionToWorld);
+void mz_BenchmarkTriangleIntersection(uint32_t NumTriangles, uint32_t NumRays, mz_IntersectionBenchmarkResult* OutResult);
+uint64_t mz_RenderFrameCPU(const mz_CPUScene* CPUScene, const mz_PerFrameConstantData* FrameData, uint32_t Width, uint32_t Height, uint32_t NumThreads, uint8_t* OutPixels); // Returns number of traced rays.
+void mz_BenchmarkRays(const mz_CPUScene* CPUScene, const mz_PerFrameConstantData* FrameData, uint32_t Width, uint32_t Height, uint32_t NumThreads, uint32_t NumIterations, mz_RayBenchmarkResult* OutResult); // Uses BVHWidth and bUsePackets of the scene.
+
+
+//
+// Inline implementation.
+//
+inline mz_Float3 mz_MakeFloat3(float X, float Y, float Z) { return { X, Y, Z }; }
+inline mz_Float3 operator+(mz_Float3 A, mz_Float3 B) { return { A.x + B.x, A.y + B.y, A.z + B.z }; }
+inline mz_Float3 operator-(mz_Float3 A, mz_Float3 B) { return { A.x - B.x, A.y - B.y, A.z - B.z }; }
+inline mz_Float3 operator*(mz_Float3 A, mz_Float3 B) { return { A.x * B.x, A.y * B.y, A.z * B.z }; }
+inline mz_Float3 operator*(mz_Float3 A, float S) { return { A.x * S, A.y * S, A.z * S }; }
+inline mz_Float3 operator*(float S, mz_Float3 A) { return { A.x * S, A.y * S, A.z * S }; }
+inline mz_Float3 operator/(mz_Float3 A, mz_Float3 B) { return { A.x / B.x, A.y / B.y, A.z / B.z }; }
+inline mz_Float3 operator-(mz_Float3 A) { return { -A.x, -A.y, -A.z }; }
+
+inline float
+mz_Dot(mz_Float3 A, mz_Float3 B)
+{
+	return A.x * B.x + A.y * B.y + A.z * B.z;
+}
+
+inline mz_Float3
+mz_Cross(mz_Float3 A, mz_Float3 B)
+{
+	return { A.y * B.z - A.z * B.y, A.z * B.x - A.x * B.z, A.x * B.y - A.y * B.x };
+}
+
+inline mz_Float3
+mz_Normalize(mz_Float3 A)
+{
+	float Length = sqrtf(mz_Dot(A, A));
+	return Length > 0.0f ? A * (1.0f / Length) : A;
+}
+
+inline mz_Float3
+mz_Min(mz_Float3 A, mz_Float3 B)
+{
+	return { A.x < B.x ? A.x : B.x, A.y < B.y ? A.y : B.y, A.z < B.z ? A.z : B.z };
+}
+
+inline mz_Float3
+mz_Max(mz_Float3 A, mz_Float3 B)
+{
+	return { A.x > B.x ? A.x : B.x, A.y > B.y ? A.y : B.y, A.z > B.z ? A.z : B.z };
+}
+
+inline float
+mz_GetComponent(mz_Float3 A, uint32_t Axis)
+{
+	return Axis == 0 ? A.x : (Axis == 1 ? A.y : A.z);
+}
+
+inline mz_AABB
+mz_EmptyAABB()
+{
+	return { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+}
+
+inline void
+mz_GrowAABB(mz_AABB* Bounds, mz_Float3 Point)
+{
+	Bounds->Min = mz_Min(Bounds->Min, Point);
+	Bounds->Max = mz_Max(Bounds->Max, Point);
+}
+
+inline void
+mz_GrowAABB(mz_AABB* Bounds, const mz_AABB& Other)
+{
+	Bounds->Min = mz_Min(Bounds->Min, Other.Min);
+	Bounds->Max = mz_Max(Bounds->Max, Other.Max);
+}
+
+inline mz_Float3
+mz_GetCenter(const mz_AABB& Bounds)
+{
+	return (Bounds.Min + Bounds.Max) * 0.5f;
+}
+
+inline float
+mz_GetHalfArea(const mz_AABB& Bounds)
+{
+	mz_Float3 E = Bounds.Max - Bounds.Min;
+	return E.x * E.y + E.y * E.z + E.z * E.x;
+}
+
+// Applies ObjectToWorld (three rows of a column-vector transform) to a point.
+inline mz_Float3
+mz_TransformPoint(const XMFLOAT3X4& M, mz_Float3 P)
+{
+	return {
+		M.m[0][0] * P.x + M.m[0][1] * P.y + M.m[0][2] * P.z + M.m[0][3],
+		M.m[1][0] * P.x + M.m[1][1] * P.y + M.m[1][2] * P.z + M.m[1][3],
+		M.m[2][0] * P.x + M.m[2][1] * P.y + M.m[2][2] * P.z + M.m[2][3],
+	};
+}
+
+inline mz_Float3
+mz_TransformVector(const XMFLOAT3X4& M, mz_Float3 V)
+{
+	return {
+		M.m[0][0] * V.x + M.m[0][1] * V.y + M.m[0][2] * V.z,
+		M.m[1][0] * V.x + M.m[1][1] * V.y + M.m[1][2] * V.z,
+		M.m[2][0] * V.x + M.m[2][1] * V.y + M.m[2][2] * V.z,
+	};
+}
+
+inline bool
+mz_IsIdentity(const XMFLOAT3X4& M)
+{
+	for (uint32_t Row = 0; Row < 3; ++Row)
+	{
+		for (uint32_t Column = 0; Column < 4; ++Column)
+		{
+			if (M.m[Row][Column] != (Row == Column ? 1.0f : 0.0f))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
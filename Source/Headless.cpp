@@ -0,0 +1,438 @@
+#include "Library.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <chrono>
+#include "CPURaytracer.h"
+#include "MeshOptimization.h"
+
+#define mz_DEMO_NAME "SimpleRaytracerHeadless"
+
+struct mz_HeadlessOptions
+{
+	const char* SceneFileName;
+	const char* OutputFileName;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t NumThreads; // 0 - use all hardware threads.
+	uint32_t BVHWidth; // 0 - widest available.
+	bool bCompareBVHs; // Renders with every BVH layout, single rays and packets, prints rays/s relative to binary BVH single rays.
+	bool bUsePackets; // 8x8 primary and shadow ray packets through the selected BVH (single rays when a packet diverges).
+	bool bBenchmarkIntersection; // Times ray/triangle kernels alone: scalar Moller-Trumbore vs. 4 and 8 wide SoA blocks.
+	bool bCompactVertices; // Renders from decoded compact vertices, prints memory saved and quantization error.
+	bool bMeshStats; // Vertex cache statistics and vertex/index memory, as stored in glTF and after optimization.
+	float MaxLODPixelError; // Negative - full resolution meshes, otherwise coarsest LOD within this many pixels.
+	bool bMeshlets; // Prints meshlet statistics and how many meshlets face away from the camera.
+	bool bStream; // Images are decoded in background after geometry is loaded (see mz_BeginStreamingGLTFSceneData).
+};
+
+static bool
+mz_ParseCommandLine(int32_t Argc, char** Argv, mz_HeadlessOptions* OutOptions)
+{
+	OutOptions->SceneFileName = "Data/Sponza/Sponza.gltf";
+	OutOptions->OutputFileName = "Frame.ppm";
+	OutOptions->Width = 1920;
+	OutOptions->Height = 1080;
+	OutOptions->NumThreads = 0;
+	OutOptions->BVHWidth = 0;
+	OutOptions->bCompareBVHs = false;
+	OutOptions->bUsePackets = false;
+	OutOptions->bBenchmarkIntersection = false;
+	OutOptions->bCompactVertices = false;
+	OutOptions->bMeshStats = false;
+	OutOptions->MaxLODPixelError = -1.0f;
+	OutOptions->bMeshlets = false;
+	OutOptions->bStream = false;
+
+	for (int32_t Idx = 1; Idx < Argc; ++Idx)
+	{
+		const char* Arg = Argv[Idx];
+		bool bHasValue = Idx + 1 < Argc;
+
+		if (strcmp(Arg, "-scene") == 0 && bHasValue)
+		{
+			OutOptions->SceneFileName = Argv[++Idx];
+		}
+		else if (strcmp(Arg, "-output") == 0 && bHasValue)
+		{
+			OutOptions->OutputFileName = Argv[++Idx];
+		}
+		else if (strcmp(Arg, "-width") == 0 && bHasValue)
+		{
+			OutOptions->Width = (uint32_t)atoi(Argv[++Idx]);
+		}
+		else if (strcmp(Arg, "-height") == 0 && bHasValue)
+		{
+			OutOptions->Height = (uint32_t)atoi(Argv[++Idx]);
+		}
+		else if (strcmp(Arg, "-threads") == 0 && bHasValue)
+		{
+			OutOptions->NumThreads = (uint32_t)atoi(Argv[++Idx]);
+		}
+		else if (strcmp(Arg, "-bvh") == 0 && bHasValue)
+		{
+			OutOptions->BVHWidth = (uint32_t)atoi(Argv[++Idx]);
+		}
+		else if (strcmp(Arg, "-compare") == 0)
+		{
+			OutOptions->bCompareBVHs = true;
+		}
+		else if (strcmp(Arg, "-packets") == 0)
+		{
+			OutOptions->bUsePackets = true;
+		}
+		else if (strcmp(Arg, "-intersection") == 0)
+		{
+			OutOptions->bBenchmarkIntersection = true;
+		}
+		else if (strcmp(Arg, "-compact") == 0)
+		{
+			OutOptions->bCompactVertices = true;
+		}
+		else if (strcmp(Arg, "-meshstats") == 0)
+		{
+			OutOptions->bMeshStats = true;
+		}
+		else if (strcmp(Arg, "-lod") == 0 && bHasValue)
+		{
+			OutOptions->MaxLODPixelError = (float)atof(Argv[++Idx]);
+		}
+		else if (strcmp(Arg, "-meshlets") == 0)
+		{
+			OutOptions->bMeshlets = true;
+		}
+		else if (strcmp(Arg, "-stream") == 0)
+		{
+			OutOptions->bStream = true;
+		}
+		else
+		{
+			printf("Usage: %s [-scene file.gltf] [-output file.ppm] [-width N] [-height N] [-threads N] [-bvh 2|4|8] [-packets] [-compare] [-intersection] [-compact] [-meshstats] [-lod PixelError] [-meshlets] [-stream]\n", mz_DEMO_NAME);
+			return false;
+		}
+	}
+	if (OutOptions->BVHWidth != 0 && OutOptions->BVHWidth != 2 && OutOptions->BVHWidth != 4 && !(OutOptions->BVHWidth == 8 && mz_HAS_BVH8))
+	{
+		printf("Unsupported BVH width: %u.\n", OutOptions->BVHWidth);
+		return false;
+	}
+	return OutOptions->Width > 0 && OutOptions->Height > 0;
+}
+
+static void
+mz_FormatImageDifference(const eastl::vector<uint8_t>& Pixels, const eastl::vector<uint8_t>& BaselinePixels, char* OutText, uint32_t TextSize)
+{
+	// NOTE: Watertight and Moller-Trumbore tests can disagree on shared edges, a handful of pixels may differ.
+	uint32_t NumDifferent = 0;
+	for (size_t Idx = 0; Idx < Pixels.size(); Idx += 4)
+	{
+		NumDifferent += memcmp(&Pixels[Idx], &BaselinePixels[Idx], 4) != 0 ? 1 : 0;
+	}
+	if (NumDifferent == 0)
+	{
+		OutText[0] = '\0';
+		return;
+	}
+	snprintf(OutText, TextSize, " (%u pixels differ, %.3f%%)", NumDifferent, 100.0 * NumDifferent / (Pixels.size() / 4));
+}
+
+static void
+mz_AnalyzeSceneVertexCache(mz_SceneData* Scene, mz_VertexCacheStats* OutStats)
+{
+	*OutStats = {};
+	eastl::vector<uint32_t> Indices;
+	for (mz_Mesh& Mesh : Scene->Meshes)
+	{
+		const mz_MeshSection* Sections = mz_GetMeshSections(&Mesh);
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh.NumSections; ++SectionIdx)
+		{
+			const mz_MeshSection& Section = Sections[SectionIdx];
+			Indices.resize(Section.NumIndices);
+			mz_GetSectionIndices(Scene, Section, Indices.data());
+			mz_AnalyzeVertexCache(Indices.data(), Section.NumIndices, Section.NumVertices, OutStats);
+		}
+	}
+}
+
+static void
+mz_PrintVertexCacheStats(const char* Name, const mz_SceneData& Scene, const mz_VertexCacheStats& Stats)
+{
+	printf("%-8s %u vertices (%.2f MB), %.2f MB of indices.\n", Name, (uint32_t)Scene.Vertices.size(), Scene.Vertices.size() * sizeof(mz_Vertex) / (1024.0 * 1024.0), Scene.IndexData.size() / (1024.0 * 1024.0));
+	printf("%-8s ACMR %.3f, ATVR %.3f, average fetch distance %.1f vertices.\n", Name, (double)Stats.NumCacheMisses / eastl::max(Stats.NumTriangles, (uint64_t)1),
+		(double)Stats.NumCacheMisses / eastl::max(Stats.NumVertices, (uint64_t)1), (double)Stats.FetchDistance / eastl::max(Stats.NumCacheMisses, (uint64_t)1));
+}
+
+static bool
+mz_WritePPM(const char* FileName, const uint8_t* Pixels, uint32_t Width, uint32_t Height)
+{
+	FILE* File = fopen(FileName, "wb");
+	if (!File)
+	{
+		return false;
+	}
+
+	fprintf(File, "P6\n%u %u\n255\n", Width, Height);
+
+	eastl::vector<uint8_t> Row(Width * 3);
+	for (uint32_t Y = 0; Y < Height; ++Y)
+	{
+		for (uint32_t X = 0; X < Width; ++X)
+		{
+			const uint8_t* Pixel = &Pixels[((size_t)Y * Width + X) * 4];
+			Row[X * 3 + 0] = Pixel[0];
+			Row[X * 3 + 1] = Pixel[1];
+			Row[X * 3 + 2] = Pixel[2];
+		}
+		fwrite(Row.data(), 1, Row.size(), File);
+	}
+
+	fclose(File);
+	return true;
+}
+
+int32_t
+main(int32_t Argc, char** Argv)
+{
+	mz_HeadlessOptions Options;
+	if (!mz_ParseCommandLine(Argc, Argv, &Options))
+	{
+		return 1;
+	}
+
+	if (Options.bBenchmarkIntersection)
+	{
+		const char* KernelNames[] = { "Scalar Moller-Trumbore", "Watertight block x4", "Watertight block x8" };
+		mz_IntersectionBenchmarkResult Result;
+		mz_BenchmarkTriangleIntersection(4096, 8192, &Result);
+		for (uint32_t Idx = 0; Idx < 3; ++Idx)
+		{
+			if (Result.MTestsPerSecond[Idx] > 0.0)
+			{
+				printf("%-24s %8.1f Mtests/s, %.2fx (%u hits)\n", KernelNames[Idx], Result.MTestsPerSecond[Idx], Result.MTestsPerSecond[Idx] / Result.MTestsPerSecond[0], Result.NumHits[Idx]);
+			}
+		}
+		return 0;
+	}
+
+	mz_InitJobSystem(Options.NumThreads);
+
+	mz_SceneData Scene = {};
+	double Time = mz_GetTime();
+	uint32_t LoadFlags = Options.bMeshStats ? mz_SCENE_LOAD_SKIP_MESH_OPTIMIZATION : 0;
+	LoadFlags |= Options.MaxLODPixelError >= 0.0f && !Options.bMeshStats ? mz_SCENE_LOAD_GENERATE_LODS : 0;
+	if (Options.bStream)
+	{
+		mz_SceneStreamer* Streamer = mz_BeginStreamingGLTFSceneData(Options.SceneFileName, LoadFlags, &Scene);
+		printf("Scene renderable in %.3f s (%u images streaming).\n", mz_GetTime() - Time, mz_GetNumPendingImages(Streamer));
+
+		// NOTE: Frame is rendered with all textures, so it matches the one of regular load.
+		eastl::vector<uint32_t> ImageIndices(Scene.Images.size());
+		while (mz_GetNumPendingImages(Streamer) > 0)
+		{
+			if (mz_UpdateStreamedImages(Streamer, &Scene, ImageIndices.data(), (uint32_t)ImageIndices.size()) == 0)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+		mz_EndStreaming(Streamer);
+	}
+	else
+	{
+		mz_LoadGLTFSceneData(Options.SceneFileName, LoadFlags, &Scene);
+	}
+	printf("Scene loaded in %.3f s (%u vertices, %u triangles, %u objects).\n", mz_GetTime() - Time, (uint32_t)Scene.Vertices.size(), mz_GetNumTriangles(&Scene), (uint32_t)Scene.Objects.size());
+
+	if (Options.bMeshStats)
+	{
+		// NOTE: Scene was loaded as stored in glTF, optimizing it here gives the same meshes as regular load.
+		mz_VertexCacheStats Stats;
+		mz_AnalyzeSceneVertexCache(&Scene, &Stats);
+		printf("Vertex cache (%u entries FIFO):\n", mz_VERTEX_CACHE_SIZE);
+		mz_PrintVertexCacheStats("Before", Scene, Stats);
+
+		Time = mz_GetTime();
+		mz_OptimizeSceneMeshes(&Scene);
+		Time = mz_GetTime() - Time;
+
+		mz_AnalyzeSceneVertexCache(&Scene, &Stats);
+		mz_PrintVertexCacheStats("After", Scene, Stats);
+		printf("Meshes optimized in %.3f s.\n", Time);
+	}
+
+	if (Options.bMeshlets)
+	{
+		// NOTE: Same as mz_SCENE_LOAD_BUILD_MESHLETS, done here to measure it (loader result may come from cache).
+		Time = mz_GetTime();
+		mz_BuildSceneMeshlets(&Scene);
+		Time = mz_GetTime() - Time;
+
+		uint32_t NumMeshlets = (uint32_t)Scene.Meshlets.size();
+		printf("Meshlets: %u built in %.3f s, %.1f vertices and %.1f triangles on average (max %u and %u), %.2f MB.\n", NumMeshlets, Time,
+			(double)Scene.MeshletVertices.size() / eastl::max(NumMeshlets, 1u), (double)Scene.MeshletTriangles.size() / 3 / eastl::max(NumMeshlets, 1u), mz_MESHLET_MAX_VERTICES, mz_MESHLET_MAX_TRIANGLES,
+			(NumMeshlets * sizeof(mz_Meshlet) + Scene.MeshletVertices.size() * sizeof(uint32_t) + Scene.MeshletTriangles.size()) / (1024.0 * 1024.0));
+	}
+
+	if (Options.bCompactVertices)
+	{
+		// NOTE: Same conversion as mz_SCENE_LOAD_COMPACT_VERTICES, done here so that it sees optimized meshes.
+		mz_CompactSceneVertices(&Scene);
+
+		mz_CompactVertexError Error = {};
+		double PositionErrorSum = 0.0;
+		double PositionErrorWeight = 0.0;
+		for (const mz_CompactMesh& Mesh : Scene.CompactMeshes)
+		{
+			Error.MaxPositionError = eastl::max(Error.MaxPositionError, Mesh.Error.MaxPositionError);
+			Error.MaxNormalError = eastl::max(Error.MaxNormalError, Mesh.Error.MaxNormalError);
+			Error.MaxTangentError = eastl::max(Error.MaxTangentError, Mesh.Error.MaxTangentError);
+			Error.MaxTexcoordError = eastl::max(Error.MaxTexcoordError, Mesh.Error.MaxTexcoordError);
+		}
+		for (uint32_t MeshIdx = 0; MeshIdx < Scene.Meshes.size(); ++MeshIdx)
+		{
+			const mz_MeshSection* Sections = mz_GetMeshSections(&Scene.Meshes[MeshIdx]);
+			for (uint32_t SectionIdx = 0; SectionIdx < Scene.Meshes[MeshIdx].NumSections; ++SectionIdx)
+			{
+				PositionErrorSum += (double)Scene.CompactMeshes[MeshIdx].Error.AveragePositionError * Sections[SectionIdx].NumVertices;
+				PositionErrorWeight += Sections[SectionIdx].NumVertices;
+			}
+		}
+		uint32_t NumVertices = (uint32_t)Scene.CompactVertices.size();
+		printf("Compact vertices: %.2f MB instead of %.2f MB (%u bytes per vertex instead of %u).\n", NumVertices * sizeof(mz_CompactVertex) / (1024.0 * 1024.0), NumVertices * sizeof(mz_Vertex) / (1024.0 * 1024.0), (uint32_t)sizeof(mz_CompactVertex), (uint32_t)sizeof(mz_Vertex));
+		printf("Max error: position %.6f (average %.6f), normal %.3f deg, tangent %.3f deg, texcoord %.6f.\n", Error.MaxPositionError, PositionErrorWeight > 0.0 ? PositionErrorSum / PositionErrorWeight : 0.0, Error.MaxNormalError, Error.MaxTangentError, Error.MaxTexcoordError);
+
+		// NOTE: CPU renderer works on full vertices, decoded ones carry the quantization error so the frame shows it.
+		mz_DecodeSceneVertices(&Scene);
+	}
+
+	// Same camera as SimpleRaytracer.cpp.
+	mz_Float3 CameraPosition = { 0.0f, 0.5f, 0.0f };
+	float FovY = 3.1415926f / 3;
+
+	eastl::vector<uint32_t> ObjectLODs;
+	if (!Scene.MeshLODChains.empty())
+	{
+		uint32_t NumLODTriangles = 0;
+		uint32_t MaxLevel = 0;
+		ObjectLODs.resize(Scene.Objects.size());
+		for (uint32_t ObjectIdx = 0; ObjectIdx < Scene.Objects.size(); ++ObjectIdx)
+		{
+			const mz_Object& Object = Scene.Objects[ObjectIdx];
+			ObjectLODs[ObjectIdx] = mz_SelectMeshLOD(&Scene, Object.MeshIndex, Object.ObjectToWorld, XMFLOAT3(CameraPosition.x, CameraPosition.y, CameraPosition.z), Options.Height / (2.0f * tanf(0.5f * FovY)), Options.MaxLODPixelError);
+			MaxLevel = eastl::max(MaxLevel, ObjectLODs[ObjectIdx]);
+
+			const mz_Mesh* Mesh = mz_GetMeshLOD(&Scene, Object.MeshIndex, ObjectLODs[ObjectIdx]);
+			const mz_MeshSection* Sections = mz_GetMeshSections((mz_Mesh*)Mesh);
+			for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
+			{
+				NumLODTriangles += Sections[SectionIdx].NumIndices / 3;
+			}
+		}
+		uint32_t NumTriangles = 0;
+		for (const mz_Object& Object : Scene.Objects)
+		{
+			const mz_MeshSection* Sections = mz_GetMeshSections(&Scene.Meshes[Object.MeshIndex]);
+			for (uint32_t SectionIdx = 0; SectionIdx < Scene.Meshes[Object.MeshIndex].NumSections; ++SectionIdx)
+			{
+				NumTriangles += Sections[SectionIdx].NumIndices / 3;
+			}
+		}
+		printf("LODs: %u levels in %u meshes, %u of %u object triangles selected for %.2f pixels of error (coarsest level %u).\n", (uint32_t)Scene.LODMeshes.size(), (uint32_t)Scene.Meshes.size(), NumLODTriangles, NumTriangles, Options.MaxLODPixelError, MaxLevel);
+	}
+
+	Time = mz_GetTime();
+	mz_CPUScene* CPUScene = mz_CreateCPUScene(&Scene, ObjectLODs.empty() ? nullptr : ObjectLODs.data(), Options.NumThreads);
+	printf("CPU scene created in %.3f s.\n", mz_GetTime() - Time);
+	printf("BVH built in %.2f ms (%u BLAS nodes, SAH cost %.2f).\n", CPUScene->BVHBuildTime * 1000.0, mz_GetNumBVHNodes(CPUScene, 2), CPUScene->BVHSAHCost);
+	if (Options.bMeshlets)
+	{
+		// Meshlets of all objects that rays from the camera with RAY_FLAG_CULL_BACK_FACING_TRIANGLES could skip.
+		uint32_t NumVisited = 0;
+		uint32_t NumBackFacing = 0;
+		for (uint32_t ObjectIdx = 0; ObjectIdx < Scene.Objects.size(); ++ObjectIdx)
+		{
+			const XMFLOAT3X4& M = CPUScene->Instances[ObjectIdx].WorldToObject;
+			XMFLOAT3 Eye;
+			Eye.x = M.m[0][0] * CameraPosition.x + M.m[0][1] * CameraPosition.y + M.m[0][2] * CameraPosition.z + M.m[0][3];
+			Eye.y = M.m[1][0] * CameraPosition.x + M.m[1][1] * CameraPosition.y + M.m[1][2] * CameraPosition.z + M.m[1][3];
+			Eye.z = M.m[2][0] * CameraPosition.x + M.m[2][1] * CameraPosition.y + M.m[2][2] * CameraPosition.z + M.m[2][3];
+
+			const mz_Mesh* Mesh = mz_GetMeshLOD(&Scene, Scene.Objects[ObjectIdx].MeshIndex, ObjectLODs.empty() ? 0 : ObjectLODs[ObjectIdx]);
+			const mz_MeshSection* Sections = mz_GetMeshSections((mz_Mesh*)Mesh);
+			for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
+			{
+				for (uint32_t Idx = 0; Idx < Sections[SectionIdx].NumMeshlets; ++Idx)
+				{
+					NumBackFacing += mz_IsMeshletBackFacing(Scene.Meshlets[Sections[SectionIdx].FirstMeshlet + Idx], Eye) ? 1 : 0;
+					NumVisited++;
+				}
+			}
+		}
+		printf("Meshlets: %u of %u (%.1f%%) of all objects face away from the camera.\n", NumBackFacing, NumVisited, 100.0 * NumBackFacing / eastl::max(NumVisited, 1u));
+	}
+	printf("Two-level BVH: %u meshes, %u instances, %u TLAS nodes, %.2f MB.\n", (uint32_t)CPUScene->Meshes.size(), (uint32_t)CPUScene->Instances.size(), (uint32_t)CPUScene->TLAS.Nodes.size(), mz_GetCPUSceneMemory(CPUScene) / (1024.0 * 1024.0));
+
+	// Same light as SimpleRaytracer.cpp.
+	mz_PerFrameConstantData FrameData = {};
+	mz_ComputeProjectionToWorld(CameraPosition, 0.0f, 0.0f, FovY, (float)Options.Width / Options.Height, 0.1f, 100.0f, &FrameData.ProjectionToWorld);
+	FrameData.CameraPosition = XMFLOAT4(CameraPosition.x, CameraPosition.y, CameraPosition.z, 1.0f);
+	FrameData.LightPositions[0] = XMFLOAT4(0.0f, 10.0f, 0.0f, 1.0f);
+	FrameData.LightColors[0] = XMFLOAT4(600.0f, 600.0f, 400.0f, 1.0f);
+
+	eastl::vector<uint8_t> Pixels((size_t)Options.Width * Options.Height * 4);
+
+	if (Options.bCompareBVHs)
+	{
+		// Same frame with every BVH layout, with single rays and with packets of primary and shadow rays (secondary rays
+		// are always single). Single rays through the binary BVH are the baseline, all of them must produce identical image.
+		const uint32_t Widths[] = { 2, 4, 8 };
+		double BaselineRaysPerSecond = 0.0;
+		char DiffText[64];
+		eastl::vector<uint8_t> BaselinePixels;
+
+		for (uint32_t Width : Widths)
+		{
+			if (Width == 8 && !mz_HAS_BVH8)
+			{
+				continue;
+			}
+			CPUScene->BVHWidth = Width;
+			uint32_t NumNodes = mz_GetNumBVHNodes(CPUScene, Width);
+
+			for (uint32_t Mode = 0; Mode < 2; ++Mode)
+			{
+				CPUScene->bUsePackets = Mode == 1;
+
+				Time = mz_GetTime();
+				uint64_t NumRays = mz_RenderFrameCPU(CPUScene, &FrameData, Options.Width, Options.Height, Options.NumThreads, Pixels.data());
+				double RaysPerSecond = NumRays / (mz_GetTime() - Time);
+
+				if (BaselinePixels.empty())
+				{
+					BaselinePixels = Pixels;
+					BaselineRaysPerSecond = RaysPerSecond;
+				}
+				mz_FormatImageDifference(Pixels, BaselinePixels, DiffText, sizeof(DiffText));
+				printf("BVH%u %-7s %8u nodes, %7.2f Mrays/s, %.2fx%s\n", Width, CPUScene->bUsePackets ? "packets" : "rays", NumNodes, RaysPerSecond * 1.0e-6, RaysPerSecond / BaselineRaysPerSecond, DiffText);
+			}
+		}
+		CPUScene->bUsePackets = false;
+	}
+
+	CPUScene->BVHWidth = Options.BVHWidth ? Options.BVHWidth : (mz_HAS_BVH8 ? 8 : 4);
+	CPUScene->bUsePackets = Options.bUsePackets;
+
+	Time = mz_GetTime();
+	uint64_t NumRays = mz_RenderFrameCPU(CPUScene, &FrameData, Options.Width, Options.Height, Options.NumThreads, Pixels.data());
+	double RenderTime = mz_GetTime() - Time;
+	printf("Frame rendered in %.3f s using BVH%u%s (%.2f Mrays/s).\n", RenderTime, CPUScene->BVHWidth, CPUScene->bUsePackets ? " and ray packets" : "", NumRays / RenderTime * 1.0e-6);
+
+	if (!mz_WritePPM(Options.OutputFileName, Pixels.data(), Options.Width, Options.Height))
+	{
+		printf("Failed to write %s.\n", Options.OutputFileName);
+	}
+
+	mz_DestroyCPUScene(CPUScene);
+	mz_DestroySceneData(&Scene);
+	mz_ShutdownJobSystem();
+	return 0;
+}
@@ -1,15 +1,39 @@
 #include "Library.h"
 #include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <stddef.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <immintrin.h>
+#if !defined(mz_HEADLESS)
 #include "d3dx12.h"
 #include "imgui/imgui.h"
 #include "meow_hash_x64_aesni.h"
+#endif
+#if !defined(_WIN32)
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "EASTL/sort.h"
 #include "cgltf.h"
 #include "stb_image.h"
 #include "CPUAndGPUCommon.h"
+#include "TextureCompression.h"
+#include "MeshOptimization.h"
+#include "SceneTables.h"
 
-#define mz_MAX_NUM_RESOURCES 256
-#define mz_MAX_NUM_PIPELINES 64
+#define mz_RESOURCE_POOL_CHUNK_SIZE 256 // Items, pools grow by one chunk when full.
+#define mz_PIPELINE_POOL_CHUNK_SIZE 64
+#define mz_UPLOAD_RING_CAPACITY (64 * 1024 * 1024) // Bytes, allocations above a quarter of it get dedicated buffers.
 
+#if !defined(mz_HEADLESS)
 struct mz_UIFrameResources
 {
 	ID3D12Resource* VertexBuffer;
@@ -39,6 +63,36 @@ struct mz_MipmapGenerator
 };
 
 static void mz_CreateHeaps(mz_GraphicsContext* Gfx);
+#endif // !mz_HEADLESS
+
+#if !defined(_WIN32)
+void*
+mz_AlignedOffsetMalloc(size_t Size, size_t Alignment, size_t Offset)
+{
+	mz_ASSERT(mz_IsPowerOf2(Alignment));
+	if (Alignment < sizeof(void*))
+	{
+		Alignment = sizeof(void*);
+	}
+
+	// Original block address is stored just before the returned (aligned) address.
+	uint8_t* Block = (uint8_t*)malloc(Size + Alignment + sizeof(void*));
+	if (Block == nullptr)
+	{
+		return nullptr;
+	}
+	uintptr_t Addr = (uintptr_t)Block + sizeof(void*) + Offset;
+	Addr = ((Addr + Alignment - 1) & ~(uintptr_t)(Alignment - 1)) - Offset;
+	((void**)Addr)[-1] = Block;
+	return (void*)Addr;
+}
+
+void
+mz_AlignedFree(void* Addr)
+{
+	free(((void**)Addr)[-1]);
+}
+#endif
 
 void* operator new(size_t Size)
 {
@@ -60,6 +114,16 @@ void operator delete[](void* P)
 	mz_FREE(P);
 }
 
+void operator delete(void* P, size_t /*Size*/)
+{
+	mz_FREE(P);
+}
+
+void operator delete[](void* P, size_t /*Size*/)
+{
+	mz_FREE(P);
+}
+
 void* operator new[](size_t Size, const char* /*Name*/, int /*Flags*/, unsigned /*DebugFlags*/, const char* /*File*/, int /*Line*/)
 {
 	return mz_MALLOC(Size);
@@ -70,6 +134,7 @@ void* operator new[](size_t Size, size_t Alignment, size_t AlignmentOffset, cons
 	return mz_MALLOC_ALIGNED_OFFSET(Size, Alignment, AlignmentOffset);
 }
 
+#if !defined(mz_HEADLESS)
 mz_GraphicsContext*
 mz_CreateGraphicsContext(HWND Window, bool bShouldCreateDepthBuffer)
 {
@@ -133,11 +198,8 @@ mz_CreateGraphicsContext(HWND Window, bool bShouldCreateDepthBuffer)
 	mz_SAFE_RELEASE(TempSwapChain);
 	mz_SAFE_RELEASE(Factory);
 
-	Gfx.Resources = (mz_DX12Resource*)mz_MALLOC(mz_MAX_NUM_RESOURCES * sizeof(mz_DX12Resource));
-	memset(Gfx.Resources, 0, mz_MAX_NUM_RESOURCES * sizeof(mz_DX12Resource));
-
-	Gfx.Pipelines = (mz_DX12PipelineState*)mz_MALLOC(mz_MAX_NUM_PIPELINES * sizeof(mz_DX12PipelineState));
-	memset(Gfx.Pipelines, 0, mz_MAX_NUM_PIPELINES * sizeof(mz_DX12PipelineState));
+	mz_InitHandlePool(&Gfx.ResourcePool, sizeof(mz_DX12Resource), mz_RESOURCE_POOL_CHUNK_SIZE);
+	mz_InitHandlePool(&Gfx.PipelinePool, sizeof(mz_DX12PipelineState), mz_PIPELINE_POOL_CHUNK_SIZE);
 
 	RECT Rect;
 	GetClientRect(Window, &Rect);
@@ -193,6 +255,8 @@ mz_CreateGraphicsContext(HWND Window, bool bShouldCreateDepthBuffer)
 	mz_VHR(Gfx.Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&Gfx.FrameFence)));
 	Gfx.FrameFenceEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
 
+	mz_InitArena(&Gfx.FrameArena, 1024 * 1024);
+
 	mz_CmdInit(&Gfx);
 
 	return &Gfx;
@@ -203,14 +267,22 @@ mz_DestroyGraphicsContext(mz_GraphicsContext* Gfx)
 {
 	mz_ASSERT(Gfx);
 	CloseHandle(Gfx->FrameFenceEvent);
-	for (uint32_t Idx = 0; Idx < mz_MAX_NUM_RESOURCES; ++Idx)
+	for (uint32_t Idx = 0; Idx < Gfx->ResourcePool.Slots.size(); ++Idx)
 	{
-		mz_ReleaseResource(&Gfx->Resources[Idx]);
+		auto Resource = (mz_DX12Resource*)mz_GetLiveSlotItem(&Gfx->ResourcePool, Idx);
+		if (Resource)
+		{
+			mz_SAFE_RELEASE(Resource->Raw);
+		}
 	}
-	for (uint32_t Idx = 0; Idx < mz_MAX_NUM_PIPELINES; ++Idx)
+	for (uint32_t Idx = 0; Idx < Gfx->PipelinePool.Slots.size(); ++Idx)
 	{
-		mz_SAFE_RELEASE(Gfx->Pipelines[Idx].PSO);
-		mz_SAFE_RELEASE(Gfx->Pipelines[Idx].RS);
+		auto Pipeline = (mz_DX12PipelineState*)mz_GetLiveSlotItem(&Gfx->PipelinePool, Idx);
+		if (Pipeline)
+		{
+			mz_SAFE_RELEASE(Pipeline->PSO);
+			mz_SAFE_RELEASE(Pipeline->RS);
+		}
 	}
 	Gfx->GraphicsPipelinesMap.clear();
 	Gfx->ComputePipelinesMap.clear();
@@ -221,16 +293,44 @@ mz_DestroyGraphicsContext(mz_GraphicsContext* Gfx)
 	{
 		mz_SAFE_RELEASE(Gfx->CmdAlloc[Idx]);
 		mz_SAFE_RELEASE(Gfx->GPUDescriptorHeaps[Idx].Heap);
-		mz_SAFE_RELEASE(Gfx->GPUUploadMemoryHeaps[Idx].Heap);
 	}
+	for (ID3D12Resource* UploadBuffer : Gfx->PendingUploadBuffers)
+	{
+		mz_SAFE_RELEASE(UploadBuffer);
+	}
+	Gfx->PendingUploadBuffers.clear();
+	Gfx->PendingUploadFenceValues.clear();
+	mz_SAFE_RELEASE(Gfx->UploadRingBuffer);
 	mz_SAFE_RELEASE(Gfx->CPUDescriptorHeap.Heap);
-	mz_ReleaseResource(Gfx->DepthStencilBuffer);
 	mz_SAFE_RELEASE(Gfx->FrameFence);
 	mz_SAFE_RELEASE(Gfx->SwapChain);
 	mz_SAFE_RELEASE(Gfx->CmdQueue);
 	mz_SAFE_RELEASE(Gfx->Device);
-	mz_FREE(Gfx->Pipelines);
-	mz_FREE(Gfx->Resources);
+	mz_DestroyHandlePool(&Gfx->PipelinePool);
+	mz_DestroyHandlePool(&Gfx->ResourcePool);
+	mz_DestroyArena(&Gfx->FrameArena);
+}
+
+// Frees upload memory of the frames the GPU has finished.
+static void
+mz_RetireUploadMemory(mz_GraphicsContext* Gfx)
+{
+	uint64_t CompletedValue = Gfx->FrameFence->GetCompletedValue();
+	mz_RetireUploadRing(&Gfx->UploadRing, CompletedValue);
+
+	for (uint32_t Idx = 0; Idx < Gfx->PendingUploadBuffers.size();)
+	{
+		if (Gfx->PendingUploadFenceValues[Idx] <= CompletedValue)
+		{
+			mz_SAFE_RELEASE(Gfx->PendingUploadBuffers[Idx]);
+			Gfx->PendingUploadBuffers.erase_unsorted(Gfx->PendingUploadBuffers.begin() + Idx);
+			Gfx->PendingUploadFenceValues.erase_unsorted(Gfx->PendingUploadFenceValues.begin() + Idx);
+		}
+		else
+		{
+			++Idx;
+		}
+	}
 }
 
 void
@@ -238,6 +338,7 @@ mz_PresentFrame(mz_GraphicsContext* Gfx, uint32_t SwapInterval)
 {
 	Gfx->SwapChain->Present(SwapInterval, 0);
 	Gfx->CmdQueue->Signal(Gfx->FrameFence, ++Gfx->NumFrames);
+	mz_SubmitUploadRing(&Gfx->UploadRing, Gfx->NumFrames);
 
 	uint64_t GPUFrameCount = Gfx->FrameFence->GetCompletedValue();
 
@@ -250,18 +351,71 @@ mz_PresentFrame(mz_GraphicsContext* Gfx, uint32_t SwapInterval)
 	Gfx->FrameIndex = !Gfx->FrameIndex;
 	Gfx->BackBufferIndex = Gfx->SwapChain->GetCurrentBackBufferIndex();
 	Gfx->GPUDescriptorHeaps[Gfx->FrameIndex].Size = 0;
-	Gfx->GPUUploadMemoryHeaps[Gfx->FrameIndex].Size = 0;
+	mz_RetireUploadMemory(Gfx);
+	mz_ResetArena(&Gfx->FrameArena);
 }
 
 void
 mz_WaitForGPU(mz_GraphicsContext* Gfx)
 {
 	Gfx->CmdQueue->Signal(Gfx->FrameFence, ++Gfx->NumFrames);
+	mz_SubmitUploadRing(&Gfx->UploadRing, Gfx->NumFrames);
 	Gfx->FrameFence->SetEventOnCompletion(Gfx->NumFrames, Gfx->FrameFenceEvent);
 	WaitForSingleObject(Gfx->FrameFenceEvent, INFINITE);
 
 	Gfx->GPUDescriptorHeaps[Gfx->FrameIndex].Size = 0;
-	Gfx->GPUUploadMemoryHeaps[Gfx->FrameIndex].Size = 0;
+	mz_RetireUploadMemory(Gfx);
+}
+
+void
+mz_AllocateUploadMemory(mz_GraphicsContext* Gfx, uint64_t Size, uint64_t Alignment, mz_UploadAllocation* OutAllocation)
+{
+	mz_ASSERT(Gfx && OutAllocation && Size > 0);
+	mz_UploadRing& Ring = Gfx->UploadRing;
+
+	// NOTE: Big allocations would evict a lot of in flight memory at once, they get a buffer of their own.
+	if (Size <= Ring.Capacity / 4)
+	{
+		uint64_t Offset;
+		bool bIsAllocated = mz_AllocateFromUploadRing(&Ring, Size, Alignment, &Offset);
+
+		// Wait for the oldest frame which still uses the ring. When nothing is submitted the ring is full of commands
+		// being recorded now (e.g. at load time), waiting would not help.
+		while (!bIsAllocated && mz_GetOldestUploadRingFence(&Ring) != 0)
+		{
+			uint64_t FenceValue = mz_GetOldestUploadRingFence(&Ring);
+			if (Gfx->FrameFence->GetCompletedValue() < FenceValue)
+			{
+				Gfx->FrameFence->SetEventOnCompletion(FenceValue, Gfx->FrameFenceEvent);
+				WaitForSingleObject(Gfx->FrameFenceEvent, INFINITE);
+			}
+			mz_RetireUploadRing(&Ring, FenceValue);
+			bIsAllocated = mz_AllocateFromUploadRing(&Ring, Size, Alignment, &Offset);
+		}
+
+		if (bIsAllocated)
+		{
+			OutAllocation->Buffer = Gfx->UploadRingBuffer;
+			OutAllocation->Offset = Offset;
+			OutAllocation->CPUAddress = Gfx->UploadRingCPUStart + Offset;
+			OutAllocation->GPUAddress = Gfx->UploadRingGPUStart + Offset;
+			return;
+		}
+	}
+
+	// Dedicated buffer, base address of a committed buffer is 64 KB aligned.
+	mz_ASSERT(Alignment <= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+	ID3D12Resource* UploadBuffer;
+	mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(Size), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&UploadBuffer)));
+
+	// NOTE: Commands being recorded are done when FrameFence reaches the next value signaled.
+	Gfx->PendingUploadBuffers.push_back(UploadBuffer);
+	Gfx->PendingUploadFenceValues.push_back(Gfx->NumFrames + 1);
+
+	OutAllocation->Buffer = UploadBuffer;
+	OutAllocation->Offset = 0;
+	mz_VHR(UploadBuffer->Map(0, &CD3DX12_RANGE(0, 0), (void**)&OutAllocation->CPUAddress));
+	OutAllocation->GPUAddress = UploadBuffer->GetGPUVirtualAddress();
 }
 
 mz_DescriptorHeap*
@@ -347,26 +501,19 @@ mz_CreateHeaps(mz_GraphicsContext* Gfx)
 			Heap.GPUStart = Heap.Heap->GetGPUDescriptorHandleForHeapStart();
 		}
 	}
-	// Upload Memory Heaps.
+	// Upload ring (shared by all frames, memory is reclaimed as FrameFence advances).
 	{
-		for (uint32_t Index = 0; Index < 2; ++Index)
-		{
-			mz_GPUMemoryHeap& UploadHeap = Gfx->GPUUploadMemoryHeaps[Index];
-			UploadHeap.Size = 0;
-			UploadHeap.Capacity = 8 * 1024 * 1024;
-			UploadHeap.CPUStart = nullptr;
-			UploadHeap.GPUStart = 0;
+		mz_InitUploadRing(&Gfx->UploadRing, mz_UPLOAD_RING_CAPACITY);
 
-			mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(UploadHeap.Capacity), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&UploadHeap.Heap)));
+		mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(mz_UPLOAD_RING_CAPACITY), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&Gfx->UploadRingBuffer)));
 
-			mz_VHR(UploadHeap.Heap->Map(0, &CD3DX12_RANGE(0, 0), (void**)&UploadHeap.CPUStart));
-			UploadHeap.GPUStart = UploadHeap.Heap->GetGPUVirtualAddress();
-		}
+		mz_VHR(Gfx->UploadRingBuffer->Map(0, &CD3DX12_RANGE(0, 0), (void**)&Gfx->UploadRingCPUStart));
+		Gfx->UploadRingGPUStart = Gfx->UploadRingBuffer->GetGPUVirtualAddress();
 	}
 }
 
 mz_UIContext*
-mz_CreateUIContext(mz_GraphicsContext* Gfx, uint32_t NumSamples, eastl::vector<ID3D12Resource*>* OutTempResources)
+mz_CreateUIContext(mz_GraphicsContext* Gfx, uint32_t NumSamples)
 {
 	// NOTE(mziulek): Only one UI context can exist.
 	static mz_UIContext UI = {};
@@ -408,13 +555,11 @@ mz_CreateUIContext(mz_GraphicsContext* Gfx, uint32_t NumSamples, eastl::vector<I
 
 	mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, Width, Height, 1, 1), D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&UI.Font)));
 	{
-		auto BufferDesc = CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(UI.Font, 0, 1));
-		ID3D12Resource* StagingBuffer;
-		mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &BufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&StagingBuffer)));
-		OutTempResources->push_back(StagingBuffer);
+		mz_UploadAllocation Staging;
+		mz_AllocateUploadMemory(Gfx, GetRequiredIntermediateSize(UI.Font, 0, 1), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, &Staging);
 
 		D3D12_SUBRESOURCE_DATA TextureData = { Pixels, (LONG_PTR)Width * 4 };
-		UpdateSubresources<1>(Gfx->CmdList, UI.Font, StagingBuffer, 0, 0, 1, &TextureData);
+		UpdateSubresources<1>(Gfx->CmdList, UI.Font, Staging.Buffer, Staging.Offset, 0, 1, &TextureData);
 
 		Gfx->CmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(UI.Font, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
 	}
@@ -646,12 +791,12 @@ mz_CreateMipmapGenerator(mz_GraphicsContext* Gfx, DXGI_FORMAT Format)
 }
 
 void
-mz_DestroyMipmapGenerator(mz_MipmapGenerator* Generator)
+mz_DestroyMipmapGenerator(mz_MipmapGenerator* Generator, mz_GraphicsContext* Gfx)
 {
-	mz_ASSERT(Generator);
+	mz_ASSERT(Generator && Gfx);
 	for (uint32_t Idx = 0; Idx < eastl::size(Generator->ScratchTextures); ++Idx)
 	{
-		mz_ReleaseResource(Generator->ScratchTextures[Idx]);
+		mz_ReleaseResource(Gfx, Generator->ScratchTextures[Idx]);
 	}
 }
 
@@ -740,6 +885,7 @@ mz_GenerateMipmaps(mz_MipmapGenerator* Generator, mz_GraphicsContext* Gfx, mz_DX
 		}
 	}
 }
+#endif // !mz_HEADLESS
 
 eastl::vector<uint8_t>
 mz_LoadFile(const char* Name)
@@ -760,6 +906,7 @@ mz_LoadFile(const char* Name)
 	return Content;
 }
 
+#if !defined(mz_HEADLESS)
 void
 mz_UpdateFrameStats(HWND Window, const char* Name, double* Time, float* DeltaTime)
 {
@@ -789,623 +936,2936 @@ mz_UpdateFrameStats(HWND Window, const char* Name, double* Time, float* DeltaTim
 	}
 	NumFrames++;
 }
+#endif // !mz_HEADLESS
 
-double
-mz_GetTime()
+bool
+mz_MapFile(const char* Name, mz_MappedFile* OutFile)
 {
-	static LARGE_INTEGER StartCounter;
-	static LARGE_INTEGER Frequency;
-	if (StartCounter.QuadPart == 0)
+	*OutFile = {};
+#if defined(_WIN32)
+	HANDLE File = CreateFileA(Name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
 	{
-		QueryPerformanceFrequency(&Frequency);
-		QueryPerformanceCounter(&StartCounter);
+		return false;
+	}
+	LARGE_INTEGER Size;
+	if (!GetFileSizeEx(File, &Size))
+	{
+		CloseHandle(File);
+		return false;
+	}
+	OutFile->File = File;
+	OutFile->Size = (size_t)Size.QuadPart;
+	if (OutFile->Size == 0)
+	{
+		return true;
 	}
-	LARGE_INTEGER Counter;
-	QueryPerformanceCounter(&Counter);
-	return (Counter.QuadPart - StartCounter.QuadPart) / (double)Frequency.QuadPart;
-}
 
-static LRESULT CALLBACK
-mz_ProcessWindowMessage(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam)
-{
-	ImGuiIO* IO = &ImGui::GetIO();
+	OutFile->Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	OutFile->Data = OutFile->Mapping ? (const uint8_t*)MapViewOfFile(OutFile->Mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+	int File = open(Name, O_RDONLY);
+	if (File < 0)
+	{
+		return false;
+	}
+	struct stat Stat;
+	if (fstat(File, &Stat) != 0)
+	{
+		close(File);
+		return false;
+	}
+	OutFile->Size = (size_t)Stat.st_size;
+	if (OutFile->Size == 0)
+	{
+		close(File);
+		return true;
+	}
 
-	switch (Message)
+	void* Addr = mmap(nullptr, OutFile->Size, PROT_READ, MAP_PRIVATE, File, 0);
+	OutFile->Data = Addr != MAP_FAILED ? (const uint8_t*)Addr : nullptr;
+	close(File); // NOTE: Mapping stays valid after the descriptor is closed.
+#endif
+	if (!OutFile->Data)
 	{
-	case WM_LBUTTONDOWN:
-		IO->MouseDown[0] = true;
-		return 0;
-	case WM_LBUTTONUP:
-		IO->MouseDown[0] = false;
-		return 0;
-	case WM_RBUTTONDOWN:
-		IO->MouseDown[1] = true;
-		return 0;
-	case WM_RBUTTONUP:
-		IO->MouseDown[1] = false;
-		return 0;
-	case WM_MBUTTONDOWN:
-		IO->MouseDown[2] = true;
-		return 0;
-	case WM_MBUTTONUP:
-		IO->MouseDown[2] = false;
-		return 0;
-	case WM_MOUSEWHEEL:
-		IO->MouseWheel += GET_WHEEL_DELTA_WPARAM(WParam) > 0 ? 1.0f : -1.0f;
-		return 0;
-	case WM_MOUSEMOVE:
-		IO->MousePos.x = (signed short)LParam;
-		IO->MousePos.y = (signed short)(LParam >> 16);
-		return 0;
-	case WM_DESTROY:
-		PostQuitMessage(0);
-		return 0;
-	case WM_KEYDOWN:
+		mz_UnmapFile(OutFile);
+		return false;
+	}
+	return true;
+}
+
+void
+mz_UnmapFile(mz_MappedFile* File)
+{
+#if defined(_WIN32)
+	if (File->Data)
 	{
-		if (WParam < 256)
-		{
-			IO->KeysDown[WParam] = true;
-			if (WParam == VK_ESCAPE)
-			{
-				PostQuitMessage(0);
-			}
-			return 0;
-		}
+		UnmapViewOfFile(File->Data);
 	}
-	break;
-	case WM_KEYUP:
+	if (File->Mapping)
 	{
-		if (WParam < 256)
-		{
-			IO->KeysDown[WParam] = false;
-			return 0;
-		}
+		CloseHandle(File->Mapping);
 	}
-	break;
-	case WM_CHAR:
+	if (File->File)
 	{
-		if (WParam > 0 && WParam < 0x10000)
-		{
-			IO->AddInputCharacter((unsigned short)WParam);
-			return 0;
-		}
+		CloseHandle(File->File);
 	}
-	break;
+#else
+	if (File->Data)
+	{
+		munmap((void*)File->Data, File->Size);
 	}
-	return DefWindowProc(Window, Message, WParam, LParam);
+#endif
+	*File = {};
 }
 
-HWND
-mz_CreateWindow(const char* Name, uint32_t Width, uint32_t Height)
+bool
+mz_GetFileStamp(const char* Name, uint64_t* OutSize, uint64_t* OutModifiedTime)
 {
-	WNDCLASS WinClass = {};
-	WinClass.lpfnWndProc = mz_ProcessWindowMessage;
-	WinClass.hInstance = GetModuleHandle(nullptr);
-	WinClass.hCursor = LoadCursor(nullptr, IDC_ARROW);
-	WinClass.lpszClassName = Name;
-	if (!RegisterClass(&WinClass))
+#if defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA Attributes;
+	if (!GetFileAttributesExA(Name, GetFileExInfoStandard, &Attributes))
 	{
-		mz_ASSERT(0);
+		return false;
 	}
-
-	RECT Rect = { 0, 0, (LONG)Width, (LONG)Height };
-	if (!AdjustWindowRect(&Rect, WS_OVERLAPPED | WS_SYSMENU | WS_CAPTION | WS_MINIMIZEBOX, 0))
+	*OutSize = ((uint64_t)Attributes.nFileSizeHigh << 32) | Attributes.nFileSizeLow;
+	*OutModifiedTime = ((uint64_t)Attributes.ftLastWriteTime.dwHighDateTime << 32) | Attributes.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat Stat;
+	if (stat(Name, &Stat) != 0)
 	{
-		mz_ASSERT(0);
+		return false;
 	}
+	*OutSize = (uint64_t)Stat.st_size;
+	*OutModifiedTime = (uint64_t)Stat.st_mtim.tv_sec * 1000000000ull + (uint64_t)Stat.st_mtim.tv_nsec;
+#endif
+	return true;
+}
 
-	HWND Window = CreateWindowEx(0, Name, Name, WS_OVERLAPPED | WS_SYSMENU | WS_CAPTION | WS_MINIMIZEBOX | WS_VISIBLE, CW_USEDEFAULT, CW_USEDEFAULT, Rect.right - Rect.left, Rect.bottom - Rect.top, nullptr, nullptr, nullptr, 0);
-	mz_ASSERT(Window);
-	return Window;
+static inline uint64_t
+mz_MixHash(uint64_t X)
+{
+	// SplitMix64 finalizer.
+	X = (X ^ (X >> 30)) * 0xbf58476d1ce4e5b9ull;
+	X = (X ^ (X >> 27)) * 0x94d049bb133111ebull;
+	return X ^ (X >> 31);
 }
 
-mz_DX12Resource*
-mz_AddDX12Resource(mz_GraphicsContext* Gfx, ID3D12Resource* RawResource, D3D12_RESOURCE_STATES InitialState, DXGI_FORMAT Format)
+uint64_t
+mz_HashData(const void* Data, size_t Size, uint64_t Seed)
 {
-	mz_DX12Resource* NewResource = nullptr;
-	for (uint32_t Idx = 0; Idx < mz_MAX_NUM_RESOURCES; ++Idx)
+	const uint8_t* Bytes = (const uint8_t*)Data;
+	uint64_t Hash = mz_MixHash(Seed ^ (Size * 0x9e3779b97f4a7c15ull));
+
+	// Four independent lanes hide multiply latency.
+	uint64_t Lanes[4] = { Hash, Hash ^ 1, Hash ^ 2, Hash ^ 3 };
+	size_t Offset = 0;
+	for (; Offset + 32 <= Size; Offset += 32)
 	{
-		if (Gfx->Resources[Idx].Raw == nullptr)
+		for (uint32_t Idx = 0; Idx < 4; ++Idx)
 		{
-			NewResource = &Gfx->Resources[Idx];
-			NewResource->Raw = RawResource;
-			NewResource->State = InitialState;
-			NewResource->Format = Format;
-			break;
+			uint64_t Word;
+			memcpy(&Word, Bytes + Offset + Idx * 8, 8);
+			Lanes[Idx] = (Lanes[Idx] ^ Word) * 0x9e3779b97f4a7c15ull;
+			Lanes[Idx] ^= Lanes[Idx] >> 29;
 		}
 	}
-	mz_ASSERT(NewResource);
-	return NewResource;
+	for (uint32_t Idx = 0; Idx < 4; ++Idx)
+	{
+		Hash = mz_MixHash(Hash ^ Lanes[Idx]);
+	}
+	for (; Offset < Size; ++Offset)
+	{
+		Hash = (Hash ^ Bytes[Offset]) * 0x100000001b3ull;
+	}
+	return mz_MixHash(Hash);
 }
 
-mz_DX12Resource*
-mz_CreateCommittedResource(mz_GraphicsContext* Gfx, D3D12_HEAP_TYPE HeapType, D3D12_HEAP_FLAGS HeapFlags, D3D12_RESOURCE_DESC* Desc, D3D12_RESOURCE_STATES InitialState, D3D12_CLEAR_VALUE* ClearValue)
+double
+mz_GetTime()
 {
-	ID3D12Resource* RawResource;
-	mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(HeapType), HeapFlags, Desc, InitialState, ClearValue, IID_PPV_ARGS(&RawResource)));
-
-	return mz_AddDX12Resource(Gfx, RawResource, InitialState, Desc->Format);
+#if defined(_WIN32)
+	static LARGE_INTEGER StartCounter;
+	static LARGE_INTEGER Frequency;
+	if (StartCounter.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&Frequency);
+		QueryPerformanceCounter(&StartCounter);
+	}
+	LARGE_INTEGER Counter;
+	QueryPerformanceCounter(&Counter);
+	return (Counter.QuadPart - StartCounter.QuadPart) / (double)Frequency.QuadPart;
+#else
+	static timespec StartCounter;
+	if (StartCounter.tv_sec == 0 && StartCounter.tv_nsec == 0)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &StartCounter);
+	}
+	timespec Counter;
+	clock_gettime(CLOCK_MONOTONIC, &Counter);
+	return (double)(Counter.tv_sec - StartCounter.tv_sec) + (Counter.tv_nsec - StartCounter.tv_nsec) * 1e-9;
+#endif
 }
 
-mz_DX12PipelineState*
-mz_CreateGraphicsPipelineState(mz_GraphicsContext* Gfx, D3D12_GRAPHICS_PIPELINE_STATE_DESC* PSODesc, const char* VSName, const char* PSName)
+//
+// Arenas.
+//
+struct mz_ArenaBlock
 {
-	char Path[MAX_PATH];
+	mz_ArenaBlock* Next;
+	size_t Size; // Of data which follows the header.
+};
 
-	snprintf(Path, sizeof(Path), "Data/Shaders/%s", VSName);
-	eastl::vector<uint8_t> VSBytecode = mz_LoadFile(Path);
+static mz_ArenaBlock*
+mz_AllocateArenaBlock(size_t Size)
+{
+	auto Block = (mz_ArenaBlock*)mz_MALLOC(sizeof(mz_ArenaBlock) + Size);
+	mz_ASSERT(Block);
+	Block->Next = nullptr;
+	Block->Size = Size;
+	return Block;
+}
 
-	snprintf(Path, sizeof(Path), "Data/Shaders/%s", PSName);
-	eastl::vector<uint8_t> PSBytecode = mz_LoadFile(Path);
+static inline uint8_t*
+mz_GetArenaBlockData(mz_ArenaBlock* Block)
+{
+	return (uint8_t*)(Block + 1);
+}
 
-	uint64_t Hash;
-	{
-		meow_state HasherState;
-		MeowBegin(&HasherState, MeowDefaultSeed);
-		MeowAbsorb(&HasherState, VSBytecode.size(), VSBytecode.data());
-		MeowAbsorb(&HasherState, PSBytecode.size(), PSBytecode.data());
-		MeowAbsorb(&HasherState, sizeof(PSODesc->BlendState), &PSODesc->BlendState);
-		MeowAbsorb(&HasherState, sizeof(PSODesc->SampleMask), &PSODesc->SampleMask);
-		MeowAbsorb(&HasherState, sizeof(PSODesc->RasterizerState), &PSODesc->RasterizerState);
-		MeowAbsorb(&HasherState, sizeof(PSODesc->DepthStencilState), &PSODesc->DepthStencilState);
-		for (uint32_t Idx = 0; Idx < PSODesc->InputLayout.NumElements; ++Idx)
-		{
-			MeowAbsorb(&HasherState, sizeof(PSODesc->InputLayout.pInputElementDescs[0]), (void*)&PSODesc->InputLayout.pInputElementDescs[Idx]);
-		}
-		MeowAbsorb(&HasherState, sizeof(PSODesc->PrimitiveTopologyType), &PSODesc->PrimitiveTopologyType);
-		MeowAbsorb(&HasherState, sizeof(PSODesc->NumRenderTargets), &PSODesc->NumRenderTargets);
-		MeowAbsorb(&HasherState, sizeof(PSODesc->RTVFormats), &PSODesc->RTVFormats[0]);
-		MeowAbsorb(&HasherState, sizeof(PSODesc->DSVFormat), &PSODesc->DSVFormat);
-		MeowAbsorb(&HasherState, sizeof(PSODesc->SampleDesc), &PSODesc->SampleDesc);
-		Hash = MeowU64From(MeowEnd(&HasherState, nullptr), 0);
-	}
+void
+mz_InitArena(mz_Arena* OutArena, size_t BlockSize)
+{
+	mz_ASSERT(OutArena && BlockSize > 0);
+	OutArena->FirstBlock = mz_AllocateArenaBlock(BlockSize);
+	OutArena->Block = OutArena->FirstBlock;
+	OutArena->Offset = 0;
+	OutArena->BlockSize = BlockSize;
+}
 
-	auto Found = Gfx->GraphicsPipelinesMap.find(Hash);
-	if (Found != Gfx->GraphicsPipelinesMap.end())
+void
+mz_DestroyArena(mz_Arena* Arena)
+{
+	mz_ASSERT(Arena);
+	for (mz_ArenaBlock* Block = Arena->FirstBlock; Block;)
 	{
-		return Found->second;
+		mz_ArenaBlock* Next = Block->Next;
+		mz_FREE(Block);
+		Block = Next;
 	}
+	*Arena = {};
+}
+
+void*
+mz_AllocateFromArena(mz_Arena* Arena, size_t Size, size_t Alignment)
+{
+	mz_ASSERT(Arena && Arena->Block);
+	mz_ASSERT(mz_IsPowerOf2(Alignment));
 
-	mz_DX12PipelineState* NewPipeline = nullptr;
-	for (uint32_t Idx = 0; Idx < mz_MAX_NUM_PIPELINES; ++Idx)
+	// NOTE: Block data is 16 byte aligned (mz_MALLOC), bigger alignments are done on the address.
+	for (;;)
 	{
-		if (Gfx->Pipelines[Idx].PSO == nullptr && Gfx->Pipelines[Idx].RS == nullptr)
+		uintptr_t Base = (uintptr_t)mz_GetArenaBlockData(Arena->Block);
+		uintptr_t Addr = (Base + Arena->Offset + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+		if (Addr + Size <= Base + Arena->Block->Size)
 		{
-			NewPipeline = &Gfx->Pipelines[Idx];
-			break;
+			Arena->Offset = Addr + Size - Base;
+			return (void*)Addr;
 		}
-	}
-	mz_ASSERT(NewPipeline);
 
-	for (auto Iter = Gfx->GraphicsPipelinesMap.begin(); Iter != Gfx->GraphicsPipelinesMap.end(); ++Iter)
-	{
-		if (Iter->second == NewPipeline)
+		// Blocks kept from before the last reset are reused when big enough, otherwise a new block is inserted after
+		// the current one.
+		mz_ArenaBlock* Next = Arena->Block->Next;
+		if (!Next || Next->Size < Size + Alignment)
 		{
-			Gfx->GraphicsPipelinesMap.erase(Iter);
-			break;
+			mz_ArenaBlock* Block = mz_AllocateArenaBlock(eastl::max(Arena->BlockSize, Size + Alignment));
+			Block->Next = Next;
+			Arena->Block->Next = Block;
+			Next = Block;
 		}
+		Arena->Block = Next;
+		Arena->Offset = 0;
 	}
+}
 
-	// NOTE(mziulek): Root signature has to be defined in HLSL code.
-	mz_VHR(Gfx->Device->CreateRootSignature(0, VSBytecode.data(), VSBytecode.size(), IID_PPV_ARGS(&NewPipeline->RS)));
+void
+mz_FreeToArena(mz_Arena* Arena, void* Addr, size_t Size)
+{
+	mz_ASSERT(Arena);
+	uint8_t* Data = mz_GetArenaBlockData(Arena->Block);
+	if ((uint8_t*)Addr + Size == Data + Arena->Offset)
+	{
+		Arena->Offset = (uint8_t*)Addr - Data;
+	}
+}
+
+void
+mz_ResetArena(mz_Arena* Arena)
+{
+	mz_ASSERT(Arena);
+	Arena->Block = Arena->FirstBlock;
+	Arena->Offset = 0;
+}
+
+mz_ArenaMarker
+mz_GetArenaMarker(const mz_Arena* Arena)
+{
+	mz_ASSERT(Arena);
+	return { Arena->Block, Arena->Offset };
+}
+
+void
+mz_ResetArenaToMarker(mz_Arena* Arena, const mz_ArenaMarker& Marker)
+{
+	mz_ASSERT(Arena && Marker.Block);
+	Arena->Block = Marker.Block;
+	Arena->Offset = Marker.Offset;
+}
+
+//
+// Handle pools.
+//
+static inline uint8_t*
+mz_GetSlotItem(const mz_HandlePool* Pool, uint32_t SlotIdx)
+{
+	uint32_t Mask = (1u << Pool->ChunkShift) - 1;
+	return Pool->Chunks[SlotIdx >> Pool->ChunkShift] + (size_t)(SlotIdx & Mask) * Pool->ItemSize;
+}
+
+void
+mz_InitHandlePool(mz_HandlePool* OutPool, uint32_t ItemSize, uint32_t NumItemsPerChunk)
+{
+	mz_ASSERT(OutPool && ItemSize > 0);
+	mz_ASSERT(NumItemsPerChunk > 0 && mz_IsPowerOf2(NumItemsPerChunk) && NumItemsPerChunk <= (1u << mz_HANDLE_INDEX_BITS));
+
+	OutPool->Chunks.clear();
+	OutPool->Slots.clear();
+	OutPool->ItemSize = (ItemSize + 15) & ~15u;
+	OutPool->ChunkShift = 0;
+	while ((1u << OutPool->ChunkShift) < NumItemsPerChunk)
+	{
+		++OutPool->ChunkShift;
+	}
+	OutPool->FirstFree = ~0u;
+	OutPool->NumLive = 0;
+}
+
+void
+mz_DestroyHandlePool(mz_HandlePool* Pool)
+{
+	mz_ASSERT(Pool);
+	for (uint8_t* Chunk : Pool->Chunks)
+	{
+		mz_FREE(Chunk);
+	}
+	Pool->Chunks.clear();
+	Pool->Slots.clear();
+	Pool->FirstFree = ~0u;
+	Pool->NumLive = 0;
+}
+
+mz_Handle
+mz_AllocateHandle(mz_HandlePool* Pool, void** OutItem)
+{
+	mz_ASSERT(Pool && OutItem);
+
+	if (Pool->FirstFree == ~0u)
+	{
+		uint32_t NumItemsPerChunk = 1u << Pool->ChunkShift;
+		uint32_t FirstSlot = (uint32_t)Pool->Slots.size();
+		mz_ASSERT(FirstSlot + NumItemsPerChunk <= (1u << mz_HANDLE_INDEX_BITS));
+
+		uint8_t* Chunk = (uint8_t*)mz_MALLOC((size_t)NumItemsPerChunk * Pool->ItemSize);
+		mz_ASSERT(Chunk);
+		Pool->Chunks.push_back(Chunk);
+
+		// NOTE: Free list is LIFO, slots of the new chunk are linked so that the lowest one is used first.
+		Pool->Slots.resize(FirstSlot + NumItemsPerChunk);
+		for (uint32_t Idx = 0; Idx < NumItemsPerChunk; ++Idx)
+		{
+			mz_HandleSlot* Slot = &Pool->Slots[FirstSlot + Idx];
+			Slot->NextFree = Idx + 1 < NumItemsPerChunk ? FirstSlot + Idx + 1 : ~0u;
+			Slot->Generation = 1;
+			Slot->bIsLive = false;
+		}
+		Pool->FirstFree = FirstSlot;
+	}
+
+	uint32_t SlotIdx = Pool->FirstFree;
+	mz_HandleSlot* Slot = &Pool->Slots[SlotIdx];
+	Pool->FirstFree = Slot->NextFree;
+	Slot->bIsLive = true;
+	++Pool->NumLive;
+
+	*OutItem = mz_GetSlotItem(Pool, SlotIdx);
+	memset(*OutItem, 0, Pool->ItemSize);
+	return ((mz_Handle)Slot->Generation << mz_HANDLE_INDEX_BITS) | SlotIdx;
+}
+
+void
+mz_FreeHandle(mz_HandlePool* Pool, mz_Handle Handle)
+{
+	mz_ASSERT(mz_IsHandleValid(Pool, Handle));
+
+	uint32_t SlotIdx = Handle & ((1u << mz_HANDLE_INDEX_BITS) - 1);
+	mz_HandleSlot* Slot = &Pool->Slots[SlotIdx];
+	Slot->bIsLive = false;
+	--Pool->NumLive;
+
+#if defined(_DEBUG)
+	memset(mz_GetSlotItem(Pool, SlotIdx), 0xdd, Pool->ItemSize);
+#endif
+
+	if (Slot->Generation < mz_HANDLE_MAX_GENERATION)
+	{
+		++Slot->Generation;
+		Slot->NextFree = Pool->FirstFree;
+		Pool->FirstFree = SlotIdx;
+	}
+}
+
+bool
+mz_IsHandleValid(const mz_HandlePool* Pool, mz_Handle Handle)
+{
+	uint32_t SlotIdx = Handle & ((1u << mz_HANDLE_INDEX_BITS) - 1);
+	if (SlotIdx >= Pool->Slots.size())
+	{
+		return false;
+	}
+	const mz_HandleSlot& Slot = Pool->Slots[SlotIdx];
+	return Slot.bIsLive && Slot.Generation == (Handle >> mz_HANDLE_INDEX_BITS);
+}
+
+void*
+mz_GetHandleItem(const mz_HandlePool* Pool, mz_Handle Handle)
+{
+#if defined(_DEBUG)
+	mz_ASSERT(mz_IsHandleValid(Pool, Handle));
+#endif
+	return mz_GetSlotItem(Pool, Handle & ((1u << mz_HANDLE_INDEX_BITS) - 1));
+}
+
+void*
+mz_GetLiveSlotItem(const mz_HandlePool* Pool, uint32_t SlotIdx)
+{
+	mz_ASSERT(SlotIdx < Pool->Slots.size());
+	return Pool->Slots[SlotIdx].bIsLive ? mz_GetSlotItem(Pool, SlotIdx) : nullptr;
+}
+
+//
+// Upload rings.
+//
+void
+mz_InitUploadRing(mz_UploadRing* OutRing, uint64_t Capacity)
+{
+	mz_ASSERT(OutRing && Capacity > 0);
+	OutRing->Capacity = Capacity;
+	OutRing->Head = 0;
+	OutRing->Tail = 0;
+	OutRing->Submissions.clear();
+}
+
+bool
+mz_AllocateFromUploadRing(mz_UploadRing* Ring, uint64_t Size, uint64_t Alignment, uint64_t* OutOffset)
+{
+	mz_ASSERT(Ring && OutOffset && Size > 0);
+	mz_ASSERT(mz_IsPowerOf2(Alignment) && Ring->Capacity % Alignment == 0);
+
+	uint64_t Position = Ring->Head % Ring->Capacity;
+	uint64_t Offset = mz_AlignUp(Position, Alignment);
+	uint64_t Skipped = Offset - Position;
+	if (Offset + Size > Ring->Capacity)
+	{
+		// NOTE: Would cross the end, the rest of the ring is wasted until this allocation is retired.
+		Offset = 0;
+		Skipped = Ring->Capacity - Position;
+	}
+
+	uint64_t NewHead = Ring->Head + Skipped + Size;
+	if (NewHead - Ring->Tail > Ring->Capacity)
+	{
+		return false;
+	}
+	Ring->Head = NewHead;
+	*OutOffset = Offset;
+	return true;
+}
+
+void
+mz_SubmitUploadRing(mz_UploadRing* Ring, uint64_t FenceValue)
+{
+	mz_ASSERT(Ring);
+	eastl::vector<mz_UploadRingSubmission>& Submissions = Ring->Submissions;
+	uint64_t LastHead = Submissions.empty() ? Ring->Tail : Submissions.back().Head;
+	if (Ring->Head == LastHead)
+	{
+		return;
+	}
+	mz_ASSERT(Submissions.empty() || Submissions.back().FenceValue <= FenceValue);
+
+	if (!Submissions.empty() && Submissions.back().FenceValue == FenceValue)
+	{
+		Submissions.back().Head = Ring->Head;
+	}
+	else
+	{
+		Submissions.push_back({ FenceValue, Ring->Head });
+	}
+}
+
+void
+mz_RetireUploadRing(mz_UploadRing* Ring, uint64_t CompletedFenceValue)
+{
+	mz_ASSERT(Ring);
+	uint32_t NumRetired = 0;
+	while (NumRetired < Ring->Submissions.size() && Ring->Submissions[NumRetired].FenceValue <= CompletedFenceValue)
+	{
+		Ring->Tail = Ring->Submissions[NumRetired].Head;
+		++NumRetired;
+	}
+	Ring->Submissions.erase(Ring->Submissions.begin(), Ring->Submissions.begin() + NumRetired);
+}
+
+uint64_t
+mz_GetOldestUploadRingFence(const mz_UploadRing* Ring)
+{
+	return Ring->Submissions.empty() ? 0 : Ring->Submissions[0].FenceValue;
+}
+
+//
+// Jobs.
+//
+// NOTE: Each queue is guarded by its own spin lock. Owner works at the back (newest job, data still in cache),
+// thieves take the front (oldest job, the biggest half of a split range). Locks are held for a few instructions and
+// almost never contended, so cost per job stays far below 1 us.
+#define mz_JOB_QUEUE_SIZE 1024 // Per thread, jobs that don't fit run immediately.
+#define mz_JOB_SPIN_COUNT 2000 // Pauses before idle thread goes to sleep.
+
+struct mz_JobQueue
+{
+	std::atomic<bool> bIsLocked;
+	std::atomic<uint32_t> Front;
+	std::atomic<uint32_t> Back;
+	mz_Job Jobs[mz_JOB_QUEUE_SIZE];
+};
+
+struct mz_JobSystem
+{
+	mz_JobQueue* Queues; // One per thread, calling thread of mz_InitJobSystem owns the first one.
+	uint32_t NumThreads;
+	eastl::vector<std::thread> Threads;
+	std::atomic<uint32_t> NumQueuedJobs;
+	std::atomic<uint32_t> NumSleepingThreads; // Modified with SleepMutex locked.
+	std::atomic<bool> bShouldQuit;
+	std::mutex SleepMutex;
+	std::condition_variable WakeUp;
+};
+
+static mz_JobSystem* GJobSystem;
+static thread_local uint32_t GJobThreadIdx; // 0 also for threads not created by the job system (queue 0 is shared).
+static thread_local uint32_t GJobRandomState;
+
+static inline void
+mz_LockJobQueue(mz_JobQueue* Queue)
+{
+	while (Queue->bIsLocked.exchange(true, std::memory_order_acquire))
+	{
+		while (Queue->bIsLocked.load(std::memory_order_relaxed))
+		{
+			_mm_pause();
+		}
+	}
+}
+
+static inline void
+mz_UnlockJobQueue(mz_JobQueue* Queue)
+{
+	Queue->bIsLocked.store(false, std::memory_order_release);
+}
+
+static bool
+mz_PushJob(mz_JobQueue* Queue, const mz_Job& Job)
+{
+	mz_LockJobQueue(Queue);
+	uint32_t Back = Queue->Back.load(std::memory_order_relaxed);
+	bool bHasSpace = Back - Queue->Front.load(std::memory_order_relaxed) < mz_JOB_QUEUE_SIZE;
+	if (bHasSpace)
+	{
+		Queue->Jobs[Back % mz_JOB_QUEUE_SIZE] = Job;
+		Queue->Back.store(Back + 1, std::memory_order_relaxed);
+	}
+	mz_UnlockJobQueue(Queue);
+	return bHasSpace;
+}
+
+static bool
+mz_PopJob(mz_JobQueue* Queue, bool bFromFront, mz_Job* OutJob)
+{
+	// Unlocked check keeps idle threads from hammering locks of empty queues.
+	if (Queue->Front.load(std::memory_order_relaxed) == Queue->Back.load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	mz_LockJobQueue(Queue);
+	uint32_t Front = Queue->Front.load(std::memory_order_relaxed);
+	uint32_t Back = Queue->Back.load(std::memory_order_relaxed);
+	bool bIsEmpty = Front == Back;
+	if (!bIsEmpty && bFromFront)
+	{
+		*OutJob = Queue->Jobs[Front % mz_JOB_QUEUE_SIZE];
+		Queue->Front.store(Front + 1, std::memory_order_relaxed);
+	}
+	else if (!bIsEmpty)
+	{
+		*OutJob = Queue->Jobs[(Back - 1) % mz_JOB_QUEUE_SIZE];
+		Queue->Back.store(Back - 1, std::memory_order_relaxed);
+	}
+	mz_UnlockJobQueue(Queue);
+	return !bIsEmpty;
+}
+
+// Returns false when the queue is full, job is not submitted then.
+static bool
+mz_TrySubmitJob(const mz_Job& Job)
+{
+	mz_JobSystem* System = GJobSystem;
+	if (Job.Counter)
+	{
+		Job.Counter->NumJobs.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (!mz_PushJob(&System->Queues[GJobThreadIdx], Job))
+	{
+		if (Job.Counter)
+		{
+			Job.Counter->NumJobs.fetch_sub(1, std::memory_order_relaxed);
+		}
+		return false;
+	}
+
+	// NOTE: Sleeping thread increments NumSleepingThreads before it checks NumQueuedJobs (both sequentially
+	// consistent), so either it sees this job or we see it sleeping.
+	System->NumQueuedJobs.fetch_add(1);
+	if (System->NumSleepingThreads.load() > 0)
+	{
+		std::lock_guard<std::mutex> Lock(System->SleepMutex);
+		System->WakeUp.notify_one();
+	}
+	return true;
+}
+
+static void
+mz_ExecuteJob(mz_Job Job)
+{
+	// Lazy binary splitting: upper half of the range is queued where idle threads can steal it, lower half is split
+	// further. Job that nobody stole is popped back by this thread.
+	uint32_t Granularity = Job.Granularity > 0 ? Job.Granularity : UINT32_MAX;
+	while (GJobSystem && Job.End - Job.Begin > Granularity)
+	{
+		mz_Job UpperHalf = Job;
+		UpperHalf.Begin = Job.Begin + (Job.End - Job.Begin) / 2;
+		if (!mz_TrySubmitJob(UpperHalf))
+		{
+			break;
+		}
+		Job.End = UpperHalf.Begin;
+	}
+
+	Job.Function(Job.Data, Job.Begin, Job.End);
+
+	if (Job.Counter)
+	{
+		Job.Counter->NumJobs.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+// Own queue first, then steals starting from a random thread.
+static bool
+mz_TryRunJob(mz_JobSystem* System)
+{
+	mz_Job Job;
+	bool bHasJob = mz_PopJob(&System->Queues[GJobThreadIdx], /*bFromFront*/false, &Job);
+	if (!bHasJob)
+	{
+		// Xorshift.
+		uint32_t X = GJobRandomState ? GJobRandomState : GJobThreadIdx * 0x9e3779b9u + 1;
+		X ^= X << 13;
+		X ^= X >> 17;
+		X ^= X << 5;
+		GJobRandomState = X;
+
+		for (uint32_t Idx = 0; Idx < System->NumThreads && !bHasJob; ++Idx)
+		{
+			uint32_t VictimIdx = (X + Idx) % System->NumThreads;
+			bHasJob = VictimIdx != GJobThreadIdx && mz_PopJob(&System->Queues[VictimIdx], /*bFromFront*/true, &Job);
+		}
+	}
+	if (!bHasJob)
+	{
+		return false;
+	}
+	System->NumQueuedJobs.fetch_sub(1);
+	mz_ExecuteJob(Job);
+	return true;
+}
+
+static void
+mz_RunJobThread(mz_JobSystem* System, uint32_t ThreadIdx)
+{
+	GJobThreadIdx = ThreadIdx;
+
+	while (!System->bShouldQuit.load())
+	{
+		if (mz_TryRunJob(System))
+		{
+			continue;
+		}
+
+		// Short spin catches jobs submitted in quick succession without the cost of sleeping.
+		for (uint32_t SpinIdx = 0; SpinIdx < mz_JOB_SPIN_COUNT && System->NumQueuedJobs.load(std::memory_order_relaxed) == 0; ++SpinIdx)
+		{
+			_mm_pause();
+		}
+		if (System->NumQueuedJobs.load() > 0)
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> Lock(System->SleepMutex);
+		System->NumSleepingThreads.fetch_add(1);
+		System->WakeUp.wait(Lock, [System]() { return System->NumQueuedJobs.load() > 0 || System->bShouldQuit.load(); });
+		System->NumSleepingThreads.fetch_sub(1);
+	}
+}
+
+void
+mz_InitJobSystem(uint32_t NumThreads)
+{
+	mz_ASSERT(GJobSystem == nullptr);
+
+	if (NumThreads == 0)
+	{
+		NumThreads = eastl::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	mz_JobSystem* System = new mz_JobSystem();
+	System->Queues = new mz_JobQueue[NumThreads]();
+	System->NumThreads = NumThreads;
+	GJobSystem = System;
+	GJobThreadIdx = 0;
+
+	for (uint32_t ThreadIdx = 1; ThreadIdx < NumThreads; ++ThreadIdx)
+	{
+		System->Threads.push_back(std::thread(mz_RunJobThread, System, ThreadIdx));
+	}
+}
+
+void
+mz_ShutdownJobSystem()
+{
+	mz_JobSystem* System = GJobSystem;
+	mz_ASSERT(System && System->NumQueuedJobs.load() == 0);
+
+	{
+		std::lock_guard<std::mutex> Lock(System->SleepMutex);
+		System->bShouldQuit.store(true);
+		System->WakeUp.notify_all();
+	}
+	for (std::thread& Thread : System->Threads)
+	{
+		Thread.join();
+	}
+
+	GJobSystem = nullptr;
+	delete[] System->Queues;
+	delete System;
+}
+
+uint32_t
+mz_GetNumJobThreads()
+{
+	return GJobSystem ? GJobSystem->NumThreads : 1;
+}
+
+void
+mz_SubmitJob(const mz_Job& Job)
+{
+	mz_ASSERT(Job.Function && Job.Begin <= Job.End);
+
+	if (!GJobSystem || !mz_TrySubmitJob(Job))
+	{
+		if (Job.Counter)
+		{
+			Job.Counter->NumJobs.fetch_add(1, std::memory_order_relaxed);
+		}
+		mz_ExecuteJob(Job);
+	}
+}
+
+void
+mz_WaitForCounter(mz_JobCounter* Counter)
+{
+	while (Counter->NumJobs.load(std::memory_order_acquire) > 0)
+	{
+		// NOTE: Yield, the job we wait for may belong to a thread which is not running (more threads than cores).
+		if (!GJobSystem || !mz_TryRunJob(GJobSystem))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+#if !defined(mz_HEADLESS)
+static LRESULT CALLBACK
+mz_ProcessWindowMessage(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam)
+{
+	ImGuiIO* IO = &ImGui::GetIO();
+
+	switch (Message)
+	{
+	case WM_LBUTTONDOWN:
+		IO->MouseDown[0] = true;
+		return 0;
+	case WM_LBUTTONUP:
+		IO->MouseDown[0] = false;
+		return 0;
+	case WM_RBUTTONDOWN:
+		IO->MouseDown[1] = true;
+		return 0;
+	case WM_RBUTTONUP:
+		IO->MouseDown[1] = false;
+		return 0;
+	case WM_MBUTTONDOWN:
+		IO->MouseDown[2] = true;
+		return 0;
+	case WM_MBUTTONUP:
+		IO->MouseDown[2] = false;
+		return 0;
+	case WM_MOUSEWHEEL:
+		IO->MouseWheel += GET_WHEEL_DELTA_WPARAM(WParam) > 0 ? 1.0f : -1.0f;
+		return 0;
+	case WM_MOUSEMOVE:
+		IO->MousePos.x = (signed short)LParam;
+		IO->MousePos.y = (signed short)(LParam >> 16);
+		return 0;
+	case WM_DESTROY:
+		PostQuitMessage(0);
+		return 0;
+	case WM_KEYDOWN:
+	{
+		if (WParam < 256)
+		{
+			IO->KeysDown[WParam] = true;
+			if (WParam == VK_ESCAPE)
+			{
+				PostQuitMessage(0);
+			}
+			return 0;
+		}
+	}
+	break;
+	case WM_KEYUP:
+	{
+		if (WParam < 256)
+		{
+			IO->KeysDown[WParam] = false;
+			return 0;
+		}
+	}
+	break;
+	case WM_CHAR:
+	{
+		if (WParam > 0 && WParam < 0x10000)
+		{
+			IO->AddInputCharacter((unsigned short)WParam);
+			return 0;
+		}
+	}
+	break;
+	}
+	return DefWindowProc(Window, Message, WParam, LParam);
+}
+
+HWND
+mz_CreateWindow(const char* Name, uint32_t Width, uint32_t Height)
+{
+	WNDCLASS WinClass = {};
+	WinClass.lpfnWndProc = mz_ProcessWindowMessage;
+	WinClass.hInstance = GetModuleHandle(nullptr);
+	WinClass.hCursor = LoadCursor(nullptr, IDC_ARROW);
+	WinClass.lpszClassName = Name;
+	if (!RegisterClass(&WinClass))
+	{
+		mz_ASSERT(0);
+	}
+
+	RECT Rect = { 0, 0, (LONG)Width, (LONG)Height };
+	if (!AdjustWindowRect(&Rect, WS_OVERLAPPED | WS_SYSMENU | WS_CAPTION | WS_MINIMIZEBOX, 0))
+	{
+		mz_ASSERT(0);
+	}
+
+	HWND Window = CreateWindowEx(0, Name, Name, WS_OVERLAPPED | WS_SYSMENU | WS_CAPTION | WS_MINIMIZEBOX | WS_VISIBLE, CW_USEDEFAULT, CW_USEDEFAULT, Rect.right - Rect.left, Rect.bottom - Rect.top, nullptr, nullptr, nullptr, 0);
+	mz_ASSERT(Window);
+	return Window;
+}
+
+mz_DX12Resource*
+mz_AddDX12Resource(mz_GraphicsContext* Gfx, ID3D12Resource* RawResource, D3D12_RESOURCE_STATES InitialState, DXGI_FORMAT Format)
+{
+	mz_ASSERT(RawResource);
+
+	mz_DX12Resource* NewResource;
+	mz_Handle Handle = mz_AllocateHandle(&Gfx->ResourcePool, (void**)&NewResource);
+	NewResource->Raw = RawResource;
+	NewResource->State = InitialState;
+	NewResource->Format = Format;
+	NewResource->Handle = Handle;
+	return NewResource;
+}
+
+mz_DX12Resource*
+mz_CreateCommittedResource(mz_GraphicsContext* Gfx, D3D12_HEAP_TYPE HeapType, D3D12_HEAP_FLAGS HeapFlags, D3D12_RESOURCE_DESC* Desc, D3D12_RESOURCE_STATES InitialState, D3D12_CLEAR_VALUE* ClearValue)
+{
+	ID3D12Resource* RawResource;
+	mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(HeapType), HeapFlags, Desc, InitialState, ClearValue, IID_PPV_ARGS(&RawResource)));
+
+	return mz_AddDX12Resource(Gfx, RawResource, InitialState, Desc->Format);
+}
+
+mz_DX12PipelineState*
+mz_CreateGraphicsPipelineState(mz_GraphicsContext* Gfx, D3D12_GRAPHICS_PIPELINE_STATE_DESC* PSODesc, const char* VSName, const char* PSName)
+{
+	char Path[MAX_PATH];
+
+	snprintf(Path, sizeof(Path), "Data/Shaders/%s", VSName);
+	eastl::vector<uint8_t> VSBytecode = mz_LoadFile(Path);
+
+	snprintf(Path, sizeof(Path), "Data/Shaders/%s", PSName);
+	eastl::vector<uint8_t> PSBytecode = mz_LoadFile(Path);
+
+	uint64_t Hash;
+	{
+		meow_state HasherState;
+		MeowBegin(&HasherState, MeowDefaultSeed);
+		MeowAbsorb(&HasherState, VSBytecode.size(), VSBytecode.data());
+		MeowAbsorb(&HasherState, PSBytecode.size(), PSBytecode.data());
+		MeowAbsorb(&HasherState, sizeof(PSODesc->BlendState), &PSODesc->BlendState);
+		MeowAbsorb(&HasherState, sizeof(PSODesc->SampleMask), &PSODesc->SampleMask);
+		MeowAbsorb(&HasherState, sizeof(PSODesc->RasterizerState), &PSODesc->RasterizerState);
+		MeowAbsorb(&HasherState, sizeof(PSODesc->DepthStencilState), &PSODesc->DepthStencilState);
+		for (uint32_t Idx = 0; Idx < PSODesc->InputLayout.NumElements; ++Idx)
+		{
+			MeowAbsorb(&HasherState, sizeof(PSODesc->InputLayout.pInputElementDescs[0]), (void*)&PSODesc->InputLayout.pInputElementDescs[Idx]);
+		}
+		MeowAbsorb(&HasherState, sizeof(PSODesc->PrimitiveTopologyType), &PSODesc->PrimitiveTopologyType);
+		MeowAbsorb(&HasherState, sizeof(PSODesc->NumRenderTargets), &PSODesc->NumRenderTargets);
+		MeowAbsorb(&HasherState, sizeof(PSODesc->RTVFormats), &PSODesc->RTVFormats[0]);
+		MeowAbsorb(&HasherState, sizeof(PSODesc->DSVFormat), &PSODesc->DSVFormat);
+		MeowAbsorb(&HasherState, sizeof(PSODesc->SampleDesc), &PSODesc->SampleDesc);
+		Hash = MeowU64From(MeowEnd(&HasherState, nullptr), 0);
+	}
+
+	auto Found = Gfx->GraphicsPipelinesMap.find(Hash);
+	if (Found != Gfx->GraphicsPipelinesMap.end())
+	{
+		if (mz_IsHandleValid(&Gfx->PipelinePool, Found->second))
+		{
+			return (mz_DX12PipelineState*)mz_GetHandleItem(&Gfx->PipelinePool, Found->second);
+		}
+		Gfx->GraphicsPipelinesMap.erase(Found);
+	}
+
+	mz_DX12PipelineState* NewPipeline;
+	mz_Handle Handle = mz_AllocateHandle(&Gfx->PipelinePool, (void**)&NewPipeline);
+	NewPipeline->Handle = Handle;
+
+	// NOTE(mziulek): Root signature has to be defined in HLSL code.
+	mz_VHR(Gfx->Device->CreateRootSignature(0, VSBytecode.data(), VSBytecode.size(), IID_PPV_ARGS(&NewPipeline->RS)));
+
+	PSODesc->pRootSignature = NewPipeline->RS;
+	PSODesc->VS = { VSBytecode.data(), VSBytecode.size() };
+	PSODesc->PS = { PSBytecode.data(), PSBytecode.size() };
+
+	mz_VHR(Gfx->Device->CreateGraphicsPipelineState(PSODesc, IID_PPV_ARGS(&NewPipeline->PSO)));
+
+	Gfx->GraphicsPipelinesMap.insert(eastl::make_pair(Hash, Handle));
+
+	return NewPipeline;
+}
+
+mz_DX12PipelineState*
+mz_CreateComputePipelineState(mz_GraphicsContext* Gfx, D3D12_COMPUTE_PIPELINE_STATE_DESC* PSODesc, const char* CSName)
+{
+	char Path[MAX_PATH];
+
+	snprintf(Path, sizeof(Path), "Data/Shaders/%s", CSName);
+	eastl::vector<uint8_t> CSBytecode = mz_LoadFile(Path);
+
+	uint64_t Hash = MeowU64From(MeowHash(MeowDefaultSeed, CSBytecode.size(), CSBytecode.data()), 0);
+
+	auto Found = Gfx->ComputePipelinesMap.find(Hash);
+	if (Found != Gfx->ComputePipelinesMap.end())
+	{
+		if (mz_IsHandleValid(&Gfx->PipelinePool, Found->second))
+		{
+			return (mz_DX12PipelineState*)mz_GetHandleItem(&Gfx->PipelinePool, Found->second);
+		}
+		Gfx->ComputePipelinesMap.erase(Found);
+	}
+
+	mz_DX12PipelineState* NewPipeline;
+	mz_Handle Handle = mz_AllocateHandle(&Gfx->PipelinePool, (void**)&NewPipeline);
+	NewPipeline->Handle = Handle;
+
+	// NOTE(mziulek): Root signature has to be defined in HLSL code.
+	mz_VHR(Gfx->Device->CreateRootSignature(0, CSBytecode.data(), CSBytecode.size(), IID_PPV_ARGS(&NewPipeline->RS)));
+
+	PSODesc->pRootSignature = NewPipeline->RS;
+	PSODesc->CS = { CSBytecode.data(), CSBytecode.size() };
+
+	mz_VHR(Gfx->Device->CreateComputePipelineState(PSODesc, IID_PPV_ARGS(&NewPipeline->PSO)));
+
+	Gfx->ComputePipelinesMap.insert(eastl::make_pair(Hash, Handle));
+
+	return NewPipeline;
+}
+#endif // !mz_HEADLESS
+
+//
+// Mesh indices.
+//
+void
+mz_AppendSectionIndices(const uint32_t* Indices, uint32_t NumIndices, mz_MeshSection* InOutSection, eastl::vector<uint8_t>* InOutIndexData)
+{
+	uint32_t IndexSize = InOutSection->NumVertices <= 0x10000 ? 2 : 4;
+	uint32_t Offset = ((uint32_t)InOutIndexData->size() + IndexSize - 1) & ~(IndexSize - 1);
+	InOutIndexData->resize(Offset + NumIndices * IndexSize);
+
+	InOutSection->NumIndices = NumIndices;
+	InOutSection->IndexOffset = Offset;
+	InOutSection->IndexSize = (uint8_t)IndexSize;
+
+	if (IndexSize == 2)
+	{
+		uint16_t* Data = (uint16_t*)&(*InOutIndexData)[Offset];
+		for (uint32_t Idx = 0; Idx < NumIndices; ++Idx)
+		{
+			mz_ASSERT(Indices[Idx] < InOutSection->NumVertices);
+			Data[Idx] = (uint16_t)Indices[Idx];
+		}
+	}
+	else if (NumIndices > 0)
+	{
+		memcpy(&(*InOutIndexData)[Offset], Indices, NumIndices * sizeof(uint32_t));
+	}
+}
+
+void
+mz_GetSectionIndices(const mz_SceneData* Scene, const mz_MeshSection& Section, uint32_t* OutIndices)
+{
+	for (uint32_t Idx = 0; Idx < Section.NumIndices; ++Idx)
+	{
+		OutIndices[Idx] = mz_GetIndex(Scene, Section, Idx);
+	}
+}
+
+uint32_t
+mz_GetNumTriangles(const mz_SceneData* Scene)
+{
+	uint32_t NumTriangles = 0;
+	for (const mz_Mesh& Mesh : Scene->Meshes)
+	{
+		const mz_MeshSection* Sections = mz_GetMeshSections((mz_Mesh*)&Mesh);
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh.NumSections; ++SectionIdx)
+		{
+			NumTriangles += Sections[SectionIdx].NumIndices / 3;
+		}
+	}
+	return NumTriangles;
+}
+
+uint32_t
+mz_SelectMeshLOD(const mz_SceneData* Scene, uint32_t MeshIdx, const XMFLOAT3X4& ObjectToWorld, const XMFLOAT3& CameraPosition, float ErrorToPixels, float MaxPixelError)
+{
+	if (MeshIdx >= Scene->MeshLODChains.size())
+	{
+		return 0;
+	}
+	const mz_MeshLODChain& Chain = Scene->MeshLODChains[MeshIdx];
+
+	// NOTE: Largest axis scale keeps the selection conservative for non-uniformly scaled objects.
+	const XMFLOAT3X4& M = ObjectToWorld;
+	float Scale = 0.0f;
+	float Center[3];
+	for (uint32_t Idx = 0; Idx < 3; ++Idx)
+	{
+		Scale = fmaxf(Scale, sqrtf(M.m[0][Idx] * M.m[0][Idx] + M.m[1][Idx] * M.m[1][Idx] + M.m[2][Idx] * M.m[2][Idx]));
+		Center[Idx] = M.m[Idx][0] * Chain.BoundsCenter.x + M.m[Idx][1] * Chain.BoundsCenter.y + M.m[Idx][2] * Chain.BoundsCenter.z + M.m[Idx][3];
+	}
+	Center[0] -= CameraPosition.x;
+	Center[1] -= CameraPosition.y;
+	Center[2] -= CameraPosition.z;
+	float Distance = sqrtf(Center[0] * Center[0] + Center[1] * Center[1] + Center[2] * Center[2]) - Chain.BoundsRadius * Scale;
+	Distance = fmaxf(Distance, 1.0e-4f);
+
+	uint32_t Level = 0;
+	for (uint32_t LOD = 1; LOD <= Chain.NumLODs; ++LOD)
+	{
+		if (Scene->LODErrors[Chain.FirstLOD + LOD - 1] * Scale * ErrorToPixels / Distance > MaxPixelError)
+		{
+			break;
+		}
+		Level = LOD;
+	}
+	return Level;
+}
+
+mz_Mesh*
+mz_GetMeshLOD(mz_SceneData* Scene, uint32_t MeshIdx, uint32_t Level)
+{
+	if (Level == 0)
+	{
+		return &Scene->Meshes[MeshIdx];
+	}
+	mz_ASSERT(Level <= Scene->MeshLODChains[MeshIdx].NumLODs);
+	return &Scene->LODMeshes[Scene->MeshLODChains[MeshIdx].FirstLOD + Level - 1];
+}
+
+// Temporary arrays are allocated from ScratchArena, caller resets it.
+static void
+mz_LoadGLTFMesh(cgltf_mesh* InMesh, mz_Arena* ScratchArena, mz_Mesh* OutMesh, eastl::vector<mz_Vertex>* InOutVertices, eastl::vector<uint8_t>* InOutIndexData)
+{
+	mz_ASSERT(InMesh);
+
+	OutMesh->NumSections = (uint16_t)InMesh->primitives_count;
+	if (OutMesh->NumSections > 1)
+	{
+		OutMesh->Sections = (mz_MeshSection*)calloc(OutMesh->NumSections, sizeof(mz_MeshSection));
+		if (!OutMesh->Sections)
+		{
+			return;
+		}
+	}
+
+	uint32_t TotalNumVertices = 0;
+	uint32_t TotalNumIndices = 0;
+	uint32_t MaxNumIndices = 0;
+
+	for (uint32_t SectionIdx = 0; SectionIdx < InMesh->primitives_count; ++SectionIdx)
+	{
+		mz_ASSERT(InMesh->primitives[SectionIdx].indices);
+		mz_ASSERT(InMesh->primitives[SectionIdx].attributes);
+
+		TotalNumIndices += (uint32_t)InMesh->primitives[SectionIdx].indices->count;
+		MaxNumIndices = eastl::max(MaxNumIndices, (uint32_t)InMesh->primitives[SectionIdx].indices->count);
+		TotalNumVertices += (uint32_t)InMesh->primitives[SectionIdx].attributes[0].data->count;
+	}
+
+	InOutVertices->reserve(InOutVertices->size() + TotalNumVertices);
+	InOutIndexData->reserve(InOutIndexData->size() + TotalNumIndices * sizeof(uint32_t));
+
+	// NOTE: Reserved once for the biggest section, so the arrays never grow (growth would leave holes in the arena).
+	eastl::vector<uint32_t, mz_ArenaAllocator> Indices(mz_ArenaAllocator{ ScratchArena });
+	eastl::vector<XMFLOAT3, mz_ArenaAllocator> Positions(mz_ArenaAllocator{ ScratchArena });
+	eastl::vector<XMFLOAT3, mz_ArenaAllocator> Normals(mz_ArenaAllocator{ ScratchArena });
+	eastl::vector<XMFLOAT4, mz_ArenaAllocator> Tangents(mz_ArenaAllocator{ ScratchArena });
+	eastl::vector<XMFLOAT2, mz_ArenaAllocator> Texcoords(mz_ArenaAllocator{ ScratchArena });
+	Indices.reserve(MaxNumIndices);
+	Positions.reserve(TotalNumVertices);
+	Normals.reserve(TotalNumVertices);
+	Tangents.reserve(TotalNumVertices);
+	Texcoords.reserve(TotalNumVertices);
+
+	mz_MeshSection* Sections = mz_GetMeshSections(OutMesh);
+
+	for (uint32_t SectionIdx = 0; SectionIdx < InMesh->primitives_count; ++SectionIdx)
+	{
+		// Indices.
+		{
+			cgltf_accessor* Accessor = InMesh->primitives[SectionIdx].indices;
+
+			mz_ASSERT(Accessor->buffer_view);
+			mz_ASSERT(Accessor->stride == Accessor->buffer_view->stride || Accessor->buffer_view->stride == 0);
+			mz_ASSERT((Accessor->stride * Accessor->count) == Accessor->buffer_view->size);
+
+			auto DataAddr = (uint8_t*)Accessor->buffer_view->buffer->data + Accessor->offset + Accessor->buffer_view->offset;
+
+			// NOTE: Widened here, stored as 16-bit again below when vertex count of the section allows it.
+			Indices.resize(Accessor->count);
+
+			if (Accessor->stride == 1)
+			{
+				uint8_t* DataU8 = (uint8_t*)DataAddr;
+				for (uint32_t Idx = 0; Idx < Accessor->count; ++Idx)
+				{
+					Indices[Idx] = (uint32_t)*DataU8++;
+				}
+			}
+			else if (Accessor->stride == 2)
+			{
+				uint16_t* DataU16 = (uint16_t*)DataAddr;
+				for (uint32_t Idx = 0; Idx < Accessor->count; ++Idx)
+				{
+					Indices[Idx] = (uint32_t)*DataU16++;
+				}
+			}
+			else if (Accessor->stride == 4)
+			{
+				memcpy(Indices.data(), DataAddr, Accessor->count * Accessor->stride);
+			}
+			else
+			{
+				mz_ASSERT(0);
+			}
+		}
+
+		// Attributes.
+		{
+			uint32_t NumAttribs = (uint32_t)InMesh->primitives[SectionIdx].attributes_count;
+
+			for (uint32_t AttribIdx = 0; AttribIdx < NumAttribs; ++AttribIdx)
+			{
+				cgltf_attribute* Attrib = &InMesh->primitives[SectionIdx].attributes[AttribIdx];
+				cgltf_accessor* Accessor = Attrib->data;
+
+				mz_ASSERT(Accessor->buffer_view);
+				mz_ASSERT(Accessor->stride == Accessor->buffer_view->stride || Accessor->buffer_view->stride == 0);
+				mz_ASSERT((Accessor->stride * Accessor->count) == Accessor->buffer_view->size);
+
+				auto DataAddr = (uint8_t*)Accessor->buffer_view->buffer->data + Accessor->offset + Accessor->buffer_view->offset;
+
+				if (Attrib->type == cgltf_attribute_type_position)
+				{
+					mz_ASSERT(Accessor->type == cgltf_type_vec3);
+					Positions.resize(Accessor->count);
+					memcpy(Positions.data(), DataAddr, Accessor->count * Accessor->stride);
+				}
+				else if (Attrib->type == cgltf_attribute_type_normal)
+				{
+					mz_ASSERT(Accessor->type == cgltf_type_vec3);
+					Normals.resize(Accessor->count);
+					memcpy(Normals.data(), DataAddr, Accessor->count * Accessor->stride);
+				}
+				else if (Attrib->type == cgltf_attribute_type_tangent)
+				{
+					mz_ASSERT(Accessor->type == cgltf_type_vec4);
+					Tangents.resize(Accessor->count);
+					memcpy(Tangents.data(), DataAddr, Accessor->count * Accessor->stride);
+				}
+				else if (Attrib->type == cgltf_attribute_type_texcoord)
+				{
+					mz_ASSERT(Accessor->type == cgltf_type_vec2);
+					Texcoords.resize(Accessor->count);
+					memcpy(Texcoords.data(), DataAddr, Accessor->count * Accessor->stride);
+				}
+			}
+
+			mz_ASSERT(Positions.size() > 0);
+			mz_ASSERT(Positions.size() == Normals.size());
+
+			if (Tangents.empty())
+			{
+				Tangents.resize(Positions.size());
+			}
+			if (Texcoords.empty())
+			{
+				Texcoords.resize(Positions.size());
+			}
+			mz_ASSERT(Positions.size() == Texcoords.size());
+
+			Sections[SectionIdx].BaseVertex = (uint32_t)InOutVertices->size();
+			Sections[SectionIdx].NumVertices = (uint32_t)Positions.size();
+			mz_AppendSectionIndices(Indices.data(), (uint32_t)Indices.size(), &Sections[SectionIdx], InOutIndexData);
+
+			for (uint32_t Idx = 0; Idx < Positions.size(); ++Idx)
+			{
+				mz_Vertex Vertex;
+				Vertex.Position = Positions[Idx];
+				Vertex.Normal = Normals[Idx];
+				Vertex.Tangent = Tangents[Idx];
+				Vertex.Texcoord = Texcoords[Idx];
+				InOutVertices->push_back(Vertex);
+			}
+
+			Positions.clear();
+			Normals.clear();
+			Texcoords.clear();
+			Tangents.clear();
+		}
+	}
+}
+
+
+//
+// Scene cache.
+//
+// NOTE: Cache file holds the final CPU payload of mz_LoadGLTFSceneData (everything except images), each array
+// is one aligned block that is copied straight from the mapped file. Bump the version whenever any of the stored
+// structures or the conversion code changes. Cache made with and without LODs (or meshlets) is not interchangeable.
+#define mz_SCENE_CACHE_MAGIC 0x43535a4d // 'MZSC'
+#define mz_SCENE_CACHE_VERSION 6
+#define mz_SCENE_CACHE_ALIGNMENT 16
+
+enum mz_SceneCacheArray
+{
+	mz_SCENE_CACHE_VERTICES,
+	mz_SCENE_CACHE_INDEX_DATA,
+	mz_SCENE_CACHE_SECTIONS, // All mz_MeshSection of all meshes followed by all LOD meshes.
+	mz_SCENE_CACHE_NUM_SECTIONS, // uint32_t per mesh and per LOD mesh.
+	mz_SCENE_CACHE_MATERIALS,
+	mz_SCENE_CACHE_OBJECTS,
+	mz_SCENE_CACHE_LOD_CHAINS,
+	mz_SCENE_CACHE_LOD_ERRORS, // One per LOD mesh.
+	mz_SCENE_CACHE_MESHLETS,
+	mz_SCENE_CACHE_MESHLET_VERTICES,
+	mz_SCENE_CACHE_MESHLET_TRIANGLES,
+	mz_SCENE_CACHE_ARRAY_COUNT,
+};
+
+struct mz_SceneCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t SourceHash;
+	uint64_t SourceStamp; // Quick key, when it matches SourceHash is not computed.
+	uint64_t Offsets[mz_SCENE_CACHE_ARRAY_COUNT];
+	uint32_t Counts[mz_SCENE_CACHE_ARRAY_COUNT];
+	uint32_t ElementSizes[mz_SCENE_CACHE_ARRAY_COUNT]; // Catches layout differences between compilers.
+};
+
+static const uint32_t GSceneCacheElementSizes[mz_SCENE_CACHE_ARRAY_COUNT] =
+{
+	sizeof(mz_Vertex), sizeof(uint8_t), sizeof(mz_MeshSection), sizeof(uint32_t), sizeof(mz_Material), sizeof(mz_Object), sizeof(mz_MeshLODChain),
+	sizeof(float), sizeof(mz_Meshlet), sizeof(uint32_t), sizeof(uint8_t),
+};
+
+// Last '/' or '\\' of Path, null when it has neither.
+static const char*
+mz_FindLastPathSeparator(const char* Path)
+{
+	const char* Slash = strrchr(Path, '/');
+	const char* Backslash = strrchr(Path, '\\');
+	return (Backslash && (!Slash || Backslash > Slash)) ? Backslash : Slash;
+}
+
+// Path of a file referenced by the glTF file, URI is relative to its directory. Returns false when it doesn't fit.
+static bool
+mz_GetGLTFResourcePath(const char* FileName, const char* URI, char* OutPath, size_t OutPathSize)
+{
+	const char* C = mz_FindLastPathSeparator(FileName);
+	int DirectoryLength = C ? (int)(C - FileName + 1) : 0;
+	return (size_t)snprintf(OutPath, OutPathSize, "%.*s%s", DirectoryLength, FileName, URI) < OutPathSize;
+}
+
+// Sizes and modification times of the glTF file and all external buffers it references, nothing is read.
+static uint64_t
+mz_GetGLTFSourceStamp(const char* FileName, const cgltf_data* Data)
+{
+	uint64_t Stamp[2] = {};
+	mz_GetFileStamp(FileName, &Stamp[0], &Stamp[1]);
+	uint64_t Hash = mz_HashData(Stamp, sizeof(Stamp), mz_SCENE_CACHE_VERSION);
+
+	for (uint32_t BufferIdx = 0; BufferIdx < (uint32_t)Data->buffers_count; ++BufferIdx)
+	{
+		const char* URI = Data->buffers[BufferIdx].uri;
+		if (!URI || strncmp(URI, "data:", 5) == 0)
+		{
+			continue;
+		}
+
+		char Path[MAX_PATH];
+		Stamp[0] = Stamp[1] = 0;
+		if (mz_GetGLTFResourcePath(FileName, URI, Path, sizeof(Path)))
+		{
+			mz_GetFileStamp(Path, &Stamp[0], &Stamp[1]);
+		}
+		Hash = mz_HashData(URI, strlen(URI), Hash);
+		Hash = mz_HashData(Stamp, sizeof(Stamp), Hash);
+	}
+	return Hash;
+}
+
+// Hash of the glTF file and all external buffers it references (embedded buffers are part of the JSON). Reads every
+// byte, used only when the stamp of the cache does not match (e.g. files were copied).
+static uint64_t
+mz_HashGLTFSource(const char* FileName, const mz_MappedFile& SourceFile, const cgltf_data* Data)
+{
+	// NOTE: Whole file is hashed, not only the JSON, so that binary chunk of .glb files is covered too.
+	uint64_t Hash = mz_SCENE_CACHE_VERSION;
+	Hash = mz_HashData(SourceFile.Data, SourceFile.Size, Hash);
+
+	for (uint32_t BufferIdx = 0; BufferIdx < (uint32_t)Data->buffers_count; ++BufferIdx)
+	{
+		const char* URI = Data->buffers[BufferIdx].uri;
+		if (!URI || strncmp(URI, "data:", 5) == 0)
+		{
+			continue;
+		}
+
+		char Path[MAX_PATH];
+		mz_MappedFile File;
+		if (mz_GetGLTFResourcePath(FileName, URI, Path, sizeof(Path)) && mz_MapFile(Path, &File))
+		{
+			Hash = mz_HashData(File.Data, File.Size, Hash);
+			mz_UnmapFile(&File);
+		}
+		else
+		{
+			Hash = mz_HashData(URI, strlen(URI), Hash);
+		}
+	}
+	return Hash;
+}
+
+// Reads only the header. Returns false when there is no usable cache.
+static bool
+mz_ReadSceneCacheKey(const char* CacheFileName, uint64_t* OutSourceHash, uint64_t* OutSourceStamp)
+{
+	mz_SceneCacheHeader Header;
+	FILE* File = fopen(CacheFileName, "rb");
+	if (!File)
+	{
+		return false;
+	}
+	bool bIsValid = fread(&Header, sizeof(Header), 1, File) == 1 && Header.Magic == mz_SCENE_CACHE_MAGIC && Header.Version == mz_SCENE_CACHE_VERSION;
+	fclose(File);
+
+	*OutSourceHash = Header.SourceHash;
+	*OutSourceStamp = Header.SourceStamp;
+	return bIsValid;
+}
+
+// Content is still valid but source files were touched, next run takes the quick path again.
+static void
+mz_UpdateSceneCacheStamp(const char* CacheFileName, uint64_t SourceStamp)
+{
+	FILE* File = fopen(CacheFileName, "r+b");
+	if (File)
+	{
+		if (fseek(File, offsetof(mz_SceneCacheHeader, SourceStamp), SEEK_SET) == 0)
+		{
+			fwrite(&SourceStamp, sizeof(SourceStamp), 1, File);
+		}
+		fclose(File);
+	}
+}
+
+// Checks every index stored in the cache against the array it points into, so that a corrupt file (with valid array
+// bounds) is converted again instead of crashing the loader. Array bounds must be checked before.
+static bool
+mz_AreSceneCacheIndicesValid(const uint8_t* FileData, const mz_SceneCacheHeader* Header)
+{
+	const uint32_t* Counts = Header->Counts;
+	auto GetArray = [&](mz_SceneCacheArray Array) { return FileData + Header->Offsets[Array]; };
+	const mz_MeshSection* Sections = (const mz_MeshSection*)GetArray(mz_SCENE_CACHE_SECTIONS);
+	const uint32_t* NumSections = (const uint32_t*)GetArray(mz_SCENE_CACHE_NUM_SECTIONS);
+	const mz_Object* Objects = (const mz_Object*)GetArray(mz_SCENE_CACHE_OBJECTS);
+	const mz_MeshLODChain* LODChains = (const mz_MeshLODChain*)GetArray(mz_SCENE_CACHE_LOD_CHAINS);
+	const mz_Meshlet* Meshlets = (const mz_Meshlet*)GetArray(mz_SCENE_CACHE_MESHLETS);
+
+	uint32_t NumLODMeshes = Counts[mz_SCENE_CACHE_LOD_ERRORS];
+	uint32_t NumMeshes = Counts[mz_SCENE_CACHE_NUM_SECTIONS] - NumLODMeshes;
+
+	uint64_t NumAllSections = 0;
+	for (uint32_t MeshIdx = 0; MeshIdx < NumMeshes + NumLODMeshes; ++MeshIdx)
+	{
+		if (NumSections[MeshIdx] == 0 || NumSections[MeshIdx] > 0xffff)
+		{
+			return false;
+		}
+		NumAllSections += NumSections[MeshIdx];
+	}
+	if (NumAllSections != Counts[mz_SCENE_CACHE_SECTIONS])
+	{
+		return false;
+	}
+
+	for (uint32_t SectionIdx = 0; SectionIdx < Counts[mz_SCENE_CACHE_SECTIONS]; ++SectionIdx)
+	{
+		const mz_MeshSection& Section = Sections[SectionIdx];
+		if ((Section.IndexSize != 2 && Section.IndexSize != 4) ||
+			Section.IndexOffset % Section.IndexSize != 0 ||
+			(uint64_t)Section.BaseVertex + Section.NumVertices > Counts[mz_SCENE_CACHE_VERTICES] ||
+			(uint64_t)Section.IndexOffset + (uint64_t)Section.NumIndices * Section.IndexSize > Counts[mz_SCENE_CACHE_INDEX_DATA] ||
+			Section.MaterialIndex >= Counts[mz_SCENE_CACHE_MATERIALS] ||
+			(uint64_t)Section.FirstMeshlet + Section.NumMeshlets > Counts[mz_SCENE_CACHE_MESHLETS])
+		{
+			return false;
+		}
+	}
+
+	for (uint32_t ObjectIdx = 0; ObjectIdx < Counts[mz_SCENE_CACHE_OBJECTS]; ++ObjectIdx)
+	{
+		if (Objects[ObjectIdx].MeshIndex >= NumMeshes)
+		{
+			return false;
+		}
+	}
+
+	for (uint32_t ChainIdx = 0; ChainIdx < Counts[mz_SCENE_CACHE_LOD_CHAINS]; ++ChainIdx)
+	{
+		if ((uint64_t)LODChains[ChainIdx].FirstLOD + LODChains[ChainIdx].NumLODs > NumLODMeshes)
+		{
+			return false;
+		}
+	}
+
+	for (uint32_t MeshletIdx = 0; MeshletIdx < Counts[mz_SCENE_CACHE_MESHLETS]; ++MeshletIdx)
+	{
+		const mz_Meshlet& Meshlet = Meshlets[MeshletIdx];
+		if ((uint64_t)Meshlet.FirstVertex + Meshlet.NumVertices > Counts[mz_SCENE_CACHE_MESHLET_VERTICES] ||
+			((uint64_t)Meshlet.FirstTriangle + Meshlet.NumTriangles) * 3 > Counts[mz_SCENE_CACHE_MESHLET_TRIANGLES])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool
+mz_LoadSceneCache(const char* CacheFileName, uint64_t SourceHash, uint32_t Flags, mz_SceneData* OutScene)
+{
+	mz_MappedFile File;
+	if (!mz_MapFile(CacheFileName, &File))
+	{
+		return false;
+	}
+
+	const mz_SceneCacheHeader* Header = (const mz_SceneCacheHeader*)File.Data;
+	bool bIsValid = File.Size >= sizeof(mz_SceneCacheHeader) &&
+		Header->Magic == mz_SCENE_CACHE_MAGIC &&
+		Header->Version == mz_SCENE_CACHE_VERSION &&
+		Header->SourceHash == SourceHash &&
+		Header->Counts[mz_SCENE_CACHE_NUM_SECTIONS] > Header->Counts[mz_SCENE_CACHE_LOD_ERRORS] &&
+		(Header->Counts[mz_SCENE_CACHE_LOD_CHAINS] > 0) == ((Flags & mz_SCENE_LOAD_GENERATE_LODS) != 0) &&
+		(Header->Counts[mz_SCENE_CACHE_MESHLETS] > 0) == ((Flags & mz_SCENE_LOAD_BUILD_MESHLETS) != 0) &&
+		(Header->Counts[mz_SCENE_CACHE_LOD_CHAINS] == 0 ||
+			Header->Counts[mz_SCENE_CACHE_LOD_CHAINS] == Header->Counts[mz_SCENE_CACHE_NUM_SECTIONS] - Header->Counts[mz_SCENE_CACHE_LOD_ERRORS]);
+
+	for (uint32_t ArrayIdx = 0; bIsValid && ArrayIdx < mz_SCENE_CACHE_ARRAY_COUNT; ++ArrayIdx)
+	{
+		bIsValid = Header->ElementSizes[ArrayIdx] == GSceneCacheElementSizes[ArrayIdx] &&
+			Header->Offsets[ArrayIdx] % mz_SCENE_CACHE_ALIGNMENT == 0 &&
+			Header->Offsets[ArrayIdx] + (uint64_t)Header->Counts[ArrayIdx] * Header->ElementSizes[ArrayIdx] <= File.Size;
+	}
+	if (bIsValid)
+	{
+		bIsValid = mz_AreSceneCacheIndicesValid(File.Data, Header);
+	}
+	if (!bIsValid)
+	{
+		mz_UnmapFile(&File);
+		return false;
+	}
+
+	auto GetArray = [&](mz_SceneCacheArray Array) { return File.Data + Header->Offsets[Array]; };
+	const mz_Vertex* Vertices = (const mz_Vertex*)GetArray(mz_SCENE_CACHE_VERTICES);
+	const uint8_t* IndexData = GetArray(mz_SCENE_CACHE_INDEX_DATA);
+	const mz_MeshSection* Sections = (const mz_MeshSection*)GetArray(mz_SCENE_CACHE_SECTIONS);
+	const uint32_t* NumSections = (const uint32_t*)GetArray(mz_SCENE_CACHE_NUM_SECTIONS);
+	const mz_Material* Materials = (const mz_Material*)GetArray(mz_SCENE_CACHE_MATERIALS);
+	const mz_Object* Objects = (const mz_Object*)GetArray(mz_SCENE_CACHE_OBJECTS);
+	const mz_MeshLODChain* LODChains = (const mz_MeshLODChain*)GetArray(mz_SCENE_CACHE_LOD_CHAINS);
+	const float* LODErrors = (const float*)GetArray(mz_SCENE_CACHE_LOD_ERRORS);
+	const mz_Meshlet* Meshlets = (const mz_Meshlet*)GetArray(mz_SCENE_CACHE_MESHLETS);
+	const uint32_t* MeshletVertices = (const uint32_t*)GetArray(mz_SCENE_CACHE_MESHLET_VERTICES);
+	const uint8_t* MeshletTriangles = GetArray(mz_SCENE_CACHE_MESHLET_TRIANGLES);
+
+	OutScene->Vertices.assign(Vertices, Vertices + Header->Counts[mz_SCENE_CACHE_VERTICES]);
+	OutScene->IndexData.assign(IndexData, IndexData + Header->Counts[mz_SCENE_CACHE_INDEX_DATA]);
+	OutScene->Materials.assign(Materials, Materials + Header->Counts[mz_SCENE_CACHE_MATERIALS]);
+	OutScene->Objects.assign(Objects, Objects + Header->Counts[mz_SCENE_CACHE_OBJECTS]);
+	OutScene->MeshLODChains.assign(LODChains, LODChains + Header->Counts[mz_SCENE_CACHE_LOD_CHAINS]);
+	OutScene->LODErrors.assign(LODErrors, LODErrors + Header->Counts[mz_SCENE_CACHE_LOD_ERRORS]);
+	OutScene->Meshlets.assign(Meshlets, Meshlets + Header->Counts[mz_SCENE_CACHE_MESHLETS]);
+	OutScene->MeshletVertices.assign(MeshletVertices, MeshletVertices + Header->Counts[mz_SCENE_CACHE_MESHLET_VERTICES]);
+	OutScene->MeshletTriangles.assign(MeshletTriangles, MeshletTriangles + Header->Counts[mz_SCENE_CACHE_MESHLET_TRIANGLES]);
+
+	uint32_t NumLODMeshes = Header->Counts[mz_SCENE_CACHE_LOD_ERRORS];
+	uint32_t NumMeshes = Header->Counts[mz_SCENE_CACHE_NUM_SECTIONS] - NumLODMeshes;
+	OutScene->Meshes.reserve(NumMeshes);
+	OutScene->LODMeshes.reserve(NumLODMeshes);
+
+	uint32_t FirstSection = 0;
+	for (uint32_t MeshIdx = 0; MeshIdx < NumMeshes + NumLODMeshes; ++MeshIdx)
+	{
+		mz_Mesh Mesh = {};
+		Mesh.NumSections = (uint16_t)NumSections[MeshIdx];
+
+		if (Mesh.NumSections > 1)
+		{
+			Mesh.Sections = (mz_MeshSection*)calloc(Mesh.NumSections, sizeof(mz_MeshSection));
+			mz_ASSERT(Mesh.Sections);
+		}
+		memcpy(mz_GetMeshSections(&Mesh), &Sections[FirstSection], Mesh.NumSections * sizeof(mz_MeshSection));
+		FirstSection += Mesh.NumSections;
+
+		(MeshIdx < NumMeshes ? OutScene->Meshes : OutScene->LODMeshes).push_back(Mesh);
+	}
+
+	mz_UnmapFile(&File);
+	return true;
+}
+
+// Failures are ignored, scene will be converted again on the next run.
+static void
+mz_WriteSceneCache(const char* CacheFileName, uint64_t SourceHash, uint64_t SourceStamp, const mz_SceneData* Scene)
+{
+	eastl::vector<mz_MeshSection> Sections;
+	eastl::vector<uint32_t> NumSections;
+	NumSections.reserve(Scene->Meshes.size() + Scene->LODMeshes.size());
+	for (const eastl::vector<mz_Mesh>* Meshes : { &Scene->Meshes, &Scene->LODMeshes })
+	{
+		for (const mz_Mesh& Mesh : *Meshes)
+		{
+			const mz_MeshSection* MeshSections = mz_GetMeshSections((mz_Mesh*)&Mesh);
+			Sections.insert(Sections.end(), MeshSections, MeshSections + Mesh.NumSections);
+			NumSections.push_back(Mesh.NumSections);
+		}
+	}
+
+	const void* Arrays[mz_SCENE_CACHE_ARRAY_COUNT] =
+	{
+		Scene->Vertices.data(), Scene->IndexData.data(), Sections.data(), NumSections.data(), Scene->Materials.data(), Scene->Objects.data(),
+		Scene->MeshLODChains.data(), Scene->LODErrors.data(), Scene->Meshlets.data(), Scene->MeshletVertices.data(), Scene->MeshletTriangles.data(),
+	};
+
+	mz_SceneCacheHeader Header = {};
+	Header.Magic = mz_SCENE_CACHE_MAGIC;
+	Header.Version = mz_SCENE_CACHE_VERSION;
+	Header.SourceHash = SourceHash;
+	Header.SourceStamp = SourceStamp;
+	Header.Counts[mz_SCENE_CACHE_VERTICES] = (uint32_t)Scene->Vertices.size();
+	Header.Counts[mz_SCENE_CACHE_INDEX_DATA] = (uint32_t)Scene->IndexData.size();
+	Header.Counts[mz_SCENE_CACHE_SECTIONS] = (uint32_t)Sections.size();
+	Header.Counts[mz_SCENE_CACHE_NUM_SECTIONS] = (uint32_t)NumSections.size();
+	Header.Counts[mz_SCENE_CACHE_MATERIALS] = (uint32_t)Scene->Materials.size();
+	Header.Counts[mz_SCENE_CACHE_OBJECTS] = (uint32_t)Scene->Objects.size();
+	Header.Counts[mz_SCENE_CACHE_LOD_CHAINS] = (uint32_t)Scene->MeshLODChains.size();
+	Header.Counts[mz_SCENE_CACHE_LOD_ERRORS] = (uint32_t)Scene->LODErrors.size();
+	Header.Counts[mz_SCENE_CACHE_MESHLETS] = (uint32_t)Scene->Meshlets.size();
+	Header.Counts[mz_SCENE_CACHE_MESHLET_VERTICES] = (uint32_t)Scene->MeshletVertices.size();
+	Header.Counts[mz_SCENE_CACHE_MESHLET_TRIANGLES] = (uint32_t)Scene->MeshletTriangles.size();
+
+	uint64_t Offset = (sizeof(Header) + mz_SCENE_CACHE_ALIGNMENT - 1) & ~(uint64_t)(mz_SCENE_CACHE_ALIGNMENT - 1);
+	for (uint32_t ArrayIdx = 0; ArrayIdx < mz_SCENE_CACHE_ARRAY_COUNT; ++ArrayIdx)
+	{
+		Header.ElementSizes[ArrayIdx] = GSceneCacheElementSizes[ArrayIdx];
+		Header.Offsets[ArrayIdx] = Offset;
+		Offset += (uint64_t)Header.Counts[ArrayIdx] * Header.ElementSizes[ArrayIdx];
+		Offset = (Offset + mz_SCENE_CACHE_ALIGNMENT - 1) & ~(uint64_t)(mz_SCENE_CACHE_ALIGNMENT - 1);
+	}
+
+	// NOTE: Written to a temporary file first, so that a crash never leaves a truncated cache behind.
+	char TempFileName[MAX_PATH];
+	if ((size_t)snprintf(TempFileName, sizeof(TempFileName), "%s.tmp", CacheFileName) >= sizeof(TempFileName))
+	{
+		return;
+	}
+
+	FILE* File = fopen(TempFileName, "wb");
+	if (!File)
+	{
+		return;
+	}
+
+	static const uint8_t Padding[mz_SCENE_CACHE_ALIGNMENT] = {};
+	bool bHasFailed = fwrite(&Header, sizeof(Header), 1, File) != 1;
+	uint64_t Written = sizeof(Header);
+	for (uint32_t ArrayIdx = 0; ArrayIdx < mz_SCENE_CACHE_ARRAY_COUNT && !bHasFailed; ++ArrayIdx)
+	{
+		bHasFailed |= fwrite(Padding, 1, (size_t)(Header.Offsets[ArrayIdx] - Written), File) != Header.Offsets[ArrayIdx] - Written;
+
+		size_t Size = (size_t)Header.Counts[ArrayIdx] * Header.ElementSizes[ArrayIdx];
+		bHasFailed |= Size > 0 && fwrite(Arrays[ArrayIdx], 1, Size, File) != Size;
+		Written = Header.Offsets[ArrayIdx] + Size;
+	}
+	bHasFailed |= fclose(File) != 0;
+
+	remove(CacheFileName);
+	if (bHasFailed || rename(TempFileName, CacheFileName) != 0)
+	{
+		remove(TempFileName);
+	}
+}
+
+// Meshes, materials and objects (everything that is stored in the scene cache).
+static void
+mz_ConvertGLTFScene(cgltf_data* Data, uint32_t Flags, mz_SceneData* OutScene)
+{
+	bool bNeedsDefaultMaterial = false;
+
+	// Meshes.
+	{
+		uint32_t NumMeshes = (uint32_t)Data->meshes_count;
+		mz_ASSERT(NumMeshes > 0);
+
+		OutScene->Meshes.reserve(NumMeshes);
+
+		mz_Arena ScratchArena;
+		mz_InitArena(&ScratchArena, 4 * 1024 * 1024);
+
+		for (uint32_t MeshIdx = 0; MeshIdx < NumMeshes; ++MeshIdx)
+		{
+			mz_Mesh Mesh = {};
+			mz_LoadGLTFMesh(&Data->meshes[MeshIdx], &ScratchArena, &Mesh, &OutScene->Vertices, &OutScene->IndexData);
+			mz_ResetArena(&ScratchArena);
+
+			cgltf_mesh* SrcMesh = &Data->meshes[MeshIdx];
+
+			mz_MeshSection* Sections = mz_GetMeshSections(&Mesh);
+
+			for (uint32_t SectionIdx = 0; SectionIdx < (uint32_t)SrcMesh->primitives_count; ++SectionIdx)
+			{
+				Sections[SectionIdx].MaterialIndex = (uint16_t)~0;
+
+				// NOTE: Primitives without material use glTF default material which is stored after all other materials.
+				if (!SrcMesh->primitives[SectionIdx].material)
+				{
+					Sections[SectionIdx].MaterialIndex = (uint16_t)Data->materials_count;
+					bNeedsDefaultMaterial = true;
+				}
+
+				for (uint32_t MaterialIdx = 0; MaterialIdx < (uint32_t)Data->materials_count; ++MaterialIdx)
+				{
+					if (&Data->materials[MaterialIdx] == SrcMesh->primitives[SectionIdx].material)
+					{
+						Sections[SectionIdx].MaterialIndex = (uint16_t)MaterialIdx;
+						break;
+					}
+				}
+				mz_ASSERT(Sections[SectionIdx].MaterialIndex != (uint16_t)~0);
+			}
+
+			OutScene->Meshes.push_back(Mesh);
+		}
+		mz_DestroyArena(&ScratchArena);
+
+		if (!(Flags & mz_SCENE_LOAD_SKIP_MESH_OPTIMIZATION))
+		{
+			mz_OptimizeSceneMeshes(OutScene);
+		}
+		if (Flags & mz_SCENE_LOAD_GENERATE_LODS)
+		{
+			mz_GenerateSceneLODs(OutScene);
+		}
+		if (Flags & mz_SCENE_LOAD_BUILD_MESHLETS)
+		{
+			mz_BuildSceneMeshlets(OutScene);
+		}
+	}
+
+	// Materials.
+	{
+		uint32_t NumMaterials = (uint32_t)Data->materials_count;
+		mz_ASSERT(NumMaterials > 0);
+
+		OutScene->Materials.reserve(NumMaterials);
+
+		for (uint32_t MaterialIdx = 0; MaterialIdx < NumMaterials; ++MaterialIdx)
+		{
+			cgltf_material* SrcMaterial = &Data->materials[MaterialIdx];
+			if (SrcMaterial->has_pbr_metallic_roughness)
+			{
+				cgltf_pbr_metallic_roughness* PBR = &SrcMaterial->pbr_metallic_roughness;
+
+				mz_Material Material = {};
+				Material.BaseColorFactor = XMFLOAT4(PBR->base_color_factor);
+				Material.RoughnessFactor = PBR->roughness_factor;
+				Material.MetallicFactor = PBR->metallic_factor;
+
+				Material.BaseColorTextureIndex = (uint16_t)~0;
+				Material.PBRFactorsTextureIndex = (uint16_t)~0;
+				Material.NormalTextureIndex = (uint16_t)~0;
+
+				for (uint32_t ImageIdx = 0; ImageIdx < (uint32_t)Data->images_count; ++ImageIdx)
+				{
+					cgltf_image* Image = &Data->images[ImageIdx];
+
+					if (PBR->base_color_texture.texture && Image->uri == PBR->base_color_texture.texture->image->uri)
+					{
+						mz_ASSERT(Material.BaseColorTextureIndex == (uint16_t)~0);
+						Material.BaseColorTextureIndex = (uint16_t)ImageIdx;
+					}
+					if (PBR->metallic_roughness_texture.texture && Image->uri == PBR->metallic_roughness_texture.texture->image->uri)
+					{
+						mz_ASSERT(Material.PBRFactorsTextureIndex == (uint16_t)~0);
+						Material.PBRFactorsTextureIndex = (uint16_t)ImageIdx;
+					}
+					if (SrcMaterial->normal_texture.texture && Image->uri == SrcMaterial->normal_texture.texture->image->uri)
+					{
+						mz_ASSERT(Material.NormalTextureIndex == (uint16_t)~0);
+						Material.NormalTextureIndex = (uint16_t)ImageIdx;
+					}
+				}
+
+				OutScene->Materials.push_back(Material);
+			}
+		}
+
+		if (bNeedsDefaultMaterial)
+		{
+			mz_Material Material = {};
+			Material.BaseColorFactor = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+			Material.RoughnessFactor = 1.0f;
+			Material.MetallicFactor = 1.0f;
+			Material.BaseColorTextureIndex = (uint16_t)~0;
+			Material.PBRFactorsTextureIndex = (uint16_t)~0;
+			Material.NormalTextureIndex = (uint16_t)~0;
+			OutScene->Materials.push_back(Material);
+		}
+	}
+
+	// Objects.
+	{
+		uint32_t NumNodes = (uint32_t)Data->nodes_count;
+		mz_ASSERT(NumNodes > 0);
+
+		OutScene->Objects.reserve(NumNodes);
+
+		for (uint32_t NodeIdx = 0; NodeIdx < NumNodes; ++NodeIdx)
+		{
+			if (Data->nodes[NodeIdx].mesh)
+			{
+				cgltf_mesh* SrcMesh = Data->nodes[NodeIdx].mesh;
+
+				mz_Object Object = {};
+				Object.MeshIndex = (uint16_t)~0;
+
+				for (uint32_t MeshIdx = 0; MeshIdx < (uint32_t)Data->meshes_count; ++MeshIdx)
+				{
+					if (&Data->meshes[MeshIdx] == SrcMesh)
+					{
+						Object.MeshIndex = (uint16_t)MeshIdx;
+						break;
+					}
+				}
+				mz_ASSERT(Object.MeshIndex != (uint16_t)~0);
+
+				cgltf_float WorldTransform[16];
+				cgltf_node_transform_world(&Data->nodes[NodeIdx], WorldTransform);
+
+				// GLTF matrices are column-major, ObjectToWorld stores first three rows.
+				for (uint32_t Row = 0; Row < 3; ++Row)
+				{
+					for (uint32_t Column = 0; Column < 4; ++Column)
+					{
+						Object.ObjectToWorld.m[Row][Column] = WorldTransform[Column * 4 + Row];
+					}
+				}
+
+				OutScene->Objects.push_back(Object);
+			}
+		}
+	}
+}
+
+//
+// Texture compression.
+//
+// NOTE: Each compressed image is cached next to its source file (<image>.cache), key is hash of the source
+// file. Role is stored too, because it selects the format.
+#define mz_TEXTURE_CACHE_MAGIC 0x43545a4d // 'MZTC'
+
+enum mz_TextureRole
+{
+	mz_TEXTURE_ROLE_COLOR,
+	mz_TEXTURE_ROLE_NORMAL,
+	mz_TEXTURE_ROLE_PBR_FACTORS,
+};
 
-	PSODesc->pRootSignature = NewPipeline->RS;
-	PSODesc->VS = { VSBytecode.data(), VSBytecode.size() };
-	PSODesc->PS = { PSBytecode.data(), PSBytecode.size() };
+struct mz_TextureCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t SourceHash;
+	uint32_t Role;
+	uint32_t Format;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t NumMips;
+	uint32_t Padding;
+	uint64_t DataSize;
+};
 
-	mz_VHR(Gfx->Device->CreateGraphicsPipelineState(PSODesc, IID_PPV_ARGS(&NewPipeline->PSO)));
+// Replaces Image->Pixels with MipData (full mip chain). Returns false when the image can't be compressed, MipData
+// is uncompressed R8G8B8A8 then.
+static bool
+mz_ProcessTexture(mz_TextureRole Role, mz_Image* Image)
+{
+	uint32_t NumMips = mz_GetNumMips(Image->Width, Image->Height);
+	size_t MipChainSize = mz_GetImageDataSize(mz_IMAGE_FORMAT_RGBA8, Image->Width, Image->Height, NumMips);
+	uint8_t* MipChain = (uint8_t*)malloc(MipChainSize);
+	mz_ASSERT(MipChain);
 
-	Gfx->GraphicsPipelinesMap.insert(eastl::make_pair(Hash, NewPipeline));
+	// NOTE: Base color is sRGB (shaders apply gamma 2.2), normal and PBR factor maps are linear.
+	mz_GenerateMipChain(Image->Pixels, Image->Width, Image->Height, Role == mz_TEXTURE_ROLE_COLOR, MipChain);
 
-	return NewPipeline;
+	mz_ImageFormat Format = mz_IMAGE_FORMAT_BC7;
+	if (Image->Width % 4 != 0 || Image->Height % 4 != 0)
+	{
+		// NOTE: D3D12 requires top level of block compressed texture to be a multiple of 4.
+		Format = mz_IMAGE_FORMAT_RGBA8;
+	}
+	else if (Role == mz_TEXTURE_ROLE_NORMAL)
+	{
+		Format = mz_IMAGE_FORMAT_BC5;
+	}
+	else if (Role == mz_TEXTURE_ROLE_COLOR)
+	{
+		Format = mz_IMAGE_FORMAT_BC1;
+		for (size_t Idx = 3; Idx < (size_t)Image->Width * Image->Height * 4; Idx += 4)
+		{
+			if (Image->Pixels[Idx] != 255)
+			{
+				Format = mz_IMAGE_FORMAT_BC3;
+				break;
+			}
+		}
+	}
+
+	stbi_image_free(Image->Pixels);
+	Image->Pixels = nullptr;
+	Image->Format = Format;
+	Image->NumMips = NumMips;
+
+	if (Format == mz_IMAGE_FORMAT_RGBA8)
+	{
+		Image->MipData = MipChain;
+		Image->MipDataSize = MipChainSize;
+		return false;
+	}
+
+	size_t Size = mz_GetImageDataSize(Format, Image->Width, Image->Height, NumMips);
+	uint8_t* MipData = (uint8_t*)malloc(Size);
+	mz_ASSERT(MipData);
+
+	const uint8_t* Pixels = MipChain;
+	uint8_t* Blocks = MipData;
+	for (uint32_t MipIdx = 0; MipIdx < NumMips; ++MipIdx)
+	{
+		uint32_t Width = eastl::max(Image->Width >> MipIdx, 1u);
+		uint32_t Height = eastl::max(Image->Height >> MipIdx, 1u);
+
+		mz_CompressImage(Pixels, Width, Height, Format, Blocks);
+		Pixels += (size_t)Width * Height * 4;
+		Blocks += mz_GetImageDataSize(Format, Width, Height, 1);
+	}
+	mz_ASSERT(Blocks == MipData + Size);
+	free(MipChain);
+
+	Image->MipData = MipData;
+	Image->MipDataSize = Size;
+	return true;
 }
 
-mz_DX12PipelineState*
-mz_CreateComputePipelineState(mz_GraphicsContext* Gfx, D3D12_COMPUTE_PIPELINE_STATE_DESC* PSODesc, const char* CSName)
+static bool
+mz_LoadTextureCache(const char* CacheFileName, uint64_t SourceHash, mz_TextureRole Role, mz_Image* OutImage)
 {
-	char Path[MAX_PATH];
+	mz_MappedFile File;
+	if (!mz_MapFile(CacheFileName, &File))
+	{
+		return false;
+	}
 
-	snprintf(Path, sizeof(Path), "Data/Shaders/%s", CSName);
-	eastl::vector<uint8_t> CSBytecode = mz_LoadFile(Path);
+	const mz_TextureCacheHeader* Header = (const mz_TextureCacheHeader*)File.Data;
+	bool bIsValid = File.Size >= sizeof(mz_TextureCacheHeader) &&
+		Header->Magic == mz_TEXTURE_CACHE_MAGIC &&
+		Header->Version == mz_TEXTURE_COMPRESSION_VERSION &&
+		Header->SourceHash == SourceHash &&
+		Header->Role == (uint32_t)Role &&
+		Header->Format >= mz_IMAGE_FORMAT_BC1 && Header->Format <= mz_IMAGE_FORMAT_BC7 &&
+		Header->NumMips == mz_GetNumMips(Header->Width, Header->Height) &&
+		Header->DataSize == mz_GetImageDataSize((mz_ImageFormat)Header->Format, Header->Width, Header->Height, Header->NumMips) &&
+		File.Size == sizeof(mz_TextureCacheHeader) + Header->DataSize;
+
+	if (bIsValid)
+	{
+		OutImage->Pixels = nullptr;
+		OutImage->Width = Header->Width;
+		OutImage->Height = Header->Height;
+		OutImage->Format = (mz_ImageFormat)Header->Format;
+		OutImage->NumMips = Header->NumMips;
+		OutImage->MipDataSize = (size_t)Header->DataSize;
+		OutImage->MipData = (uint8_t*)malloc(OutImage->MipDataSize);
+		mz_ASSERT(OutImage->MipData);
+		memcpy(OutImage->MipData, Header + 1, OutImage->MipDataSize);
+	}
 
-	uint64_t Hash = MeowU64From(MeowHash(MeowDefaultSeed, CSBytecode.size(), CSBytecode.data()), 0);
+	mz_UnmapFile(&File);
+	return bIsValid;
+}
 
-	auto Found = Gfx->ComputePipelinesMap.find(Hash);
-	if (Found != Gfx->ComputePipelinesMap.end())
+// Failures are ignored, image will be compressed again on the next run.
+static void
+mz_WriteTextureCache(const char* CacheFileName, uint64_t SourceHash, mz_TextureRole Role, const mz_Image* Image)
+{
+	mz_TextureCacheHeader Header = {};
+	Header.Magic = mz_TEXTURE_CACHE_MAGIC;
+	Header.Version = mz_TEXTURE_COMPRESSION_VERSION;
+	Header.SourceHash = SourceHash;
+	Header.Role = (uint32_t)Role;
+	Header.Format = (uint32_t)Image->Format;
+	Header.Width = Image->Width;
+	Header.Height = Image->Height;
+	Header.NumMips = Image->NumMips;
+	Header.DataSize = Image->MipDataSize;
+
+	char TempFileName[MAX_PATH];
+	if ((size_t)snprintf(TempFileName, sizeof(TempFileName), "%s.tmp", CacheFileName) >= sizeof(TempFileName))
+	{
+		return;
+	}
+
+	FILE* File = fopen(TempFileName, "wb");
+	if (!File)
 	{
-		return Found->second;
+		return;
+	}
+	bool bHasFailed = fwrite(&Header, sizeof(Header), 1, File) != 1;
+	bHasFailed |= fwrite(Image->MipData, 1, Image->MipDataSize, File) != Image->MipDataSize;
+	bHasFailed |= fclose(File) != 0;
+
+	remove(CacheFileName);
+	if (bHasFailed || rename(TempFileName, CacheFileName) != 0)
+	{
+		remove(TempFileName);
 	}
+}
+
+// NOTE: External buffers are mapped instead of read (cgltf_load_buffers would copy each one to the heap),
+// so only pages touched by the conversion are read. Buffers set here are skipped by cgltf_load_buffers, which still
+// loads embedded (base64) ones. OutFiles has one entry per buffer, unmapped ones are empty.
+static bool
+mz_LoadGLTFBuffers(const char* FileName, const cgltf_options* Options, cgltf_data* Data, eastl::vector<mz_MappedFile>* OutFiles)
+{
+	OutFiles->resize(Data->buffers_count, mz_MappedFile{});
 
-	mz_DX12PipelineState* NewPipeline = nullptr;
-	for (uint32_t Idx = 0; Idx < mz_MAX_NUM_PIPELINES; ++Idx)
+	for (uint32_t BufferIdx = 0; BufferIdx < (uint32_t)Data->buffers_count; ++BufferIdx)
 	{
-		if (Gfx->Pipelines[Idx].PSO == nullptr && Gfx->Pipelines[Idx].RS == nullptr)
+		cgltf_buffer* Buffer = &Data->buffers[BufferIdx];
+		if (Buffer->data || !Buffer->uri || Buffer->size == 0 || strncmp(Buffer->uri, "data:", 5) == 0 || strstr(Buffer->uri, "://"))
 		{
-			NewPipeline = &Gfx->Pipelines[Idx];
-			break;
+			continue;
 		}
+
+		char Path[MAX_PATH];
+		mz_MappedFile* File = &(*OutFiles)[BufferIdx];
+		if (!mz_GetGLTFResourcePath(FileName, Buffer->uri, Path, sizeof(Path)) || !mz_MapFile(Path, File))
+		{
+			return false;
+		}
+		if (File->Size < Buffer->size)
+		{
+			mz_UnmapFile(File);
+			return false;
+		}
+		Buffer->data = (void*)File->Data;
 	}
-	mz_ASSERT(NewPipeline);
 
-	for (auto Iter = Gfx->ComputePipelinesMap.begin(); Iter != Gfx->ComputePipelinesMap.end(); ++Iter)
+	return cgltf_load_buffers(Options, Data, FileName) == cgltf_result_success;
+}
+
+// Must be called before cgltf_free, which would free mapped buffers otherwise.
+static void
+mz_ReleaseGLTFBuffers(cgltf_data* Data, eastl::vector<mz_MappedFile>* Files)
+{
+	for (uint32_t BufferIdx = 0; BufferIdx < (uint32_t)Files->size(); ++BufferIdx)
 	{
-		if (Iter->second == NewPipeline)
+		if ((*Files)[BufferIdx].Data)
 		{
-			Gfx->ComputePipelinesMap.erase(Iter);
-			break;
+			Data->buffers[BufferIdx].data = nullptr;
+			mz_UnmapFile(&(*Files)[BufferIdx]);
 		}
 	}
+	Files->clear();
+}
 
-	// NOTE(mziulek): Root signature has to be defined in HLSL code.
-	mz_VHR(Gfx->Device->CreateRootSignature(0, CSBytecode.data(), CSBytecode.size(), IID_PPV_ARGS(&NewPipeline->RS)));
+// Parses FileName, fills everything but Images. Returned data is needed to stream images, caller frees it and then
+// unmaps OutSourceFile (parsed data points into it).
+static cgltf_data*
+mz_LoadGLTFSceneGeometry(const char* FileName, uint32_t Flags, mz_SceneData* OutScene, mz_MappedFile* OutSourceFile)
+{
+	mz_ASSERT(OutScene->Meshes.empty() && OutScene->Objects.empty() && OutScene->Materials.empty() && OutScene->Images.empty());
+	mz_ASSERT(OutScene->Vertices.empty() && OutScene->IndexData.empty());
 
-	PSODesc->pRootSignature = NewPipeline->RS;
-	PSODesc->CS = { CSBytecode.data(), CSBytecode.size() };
+	cgltf_options Options = {};
+	cgltf_data* Data = nullptr;
+	{
+		bool bIsMapped = mz_MapFile(FileName, OutSourceFile);
+		mz_ASSERT(bIsMapped);
+		cgltf_result R = cgltf_parse(&Options, OutSourceFile->Data, OutSourceFile->Size, &Data);
+		mz_ASSERT(R == cgltf_result_success);
+		mz_ASSERT(Data->scenes_count == 1);
+	}
 
-	mz_VHR(Gfx->Device->CreateComputePipelineState(PSODesc, IID_PPV_ARGS(&NewPipeline->PSO)));
+	// NOTE: Buffers are loaded and converted only when cache is missing or out of date.
+	// NOTE: Cache always holds optimized meshes, unoptimized ones (for measurements) bypass it. So does a scene whose
+	// cache path doesn't fit (truncated name would point to another file).
+	char CacheFileName[MAX_PATH];
+	bool bUseCache = !(Flags & mz_SCENE_LOAD_SKIP_MESH_OPTIMIZATION) &&
+		(size_t)snprintf(CacheFileName, sizeof(CacheFileName), "%s.cache", FileName) < sizeof(CacheFileName);
+
+	// NOTE: Source files are hashed only when their sizes or modification times differ from the ones in the cache, so
+	// a cache hit does not page in the buffers.
+	uint64_t SourceStamp = mz_GetGLTFSourceStamp(FileName, Data);
+	uint64_t SourceHash = 0;
+	bool bHasSourceHash = false;
+	uint64_t CacheHash, CacheStamp;
+	if (bUseCache && mz_ReadSceneCacheKey(CacheFileName, &CacheHash, &CacheStamp))
+	{
+		if (CacheStamp == SourceStamp)
+		{
+			SourceHash = CacheHash;
+		}
+		else
+		{
+			SourceHash = mz_HashGLTFSource(FileName, *OutSourceFile, Data);
+			if (SourceHash == CacheHash)
+			{
+				mz_UpdateSceneCacheStamp(CacheFileName, SourceStamp);
+			}
+		}
+		bHasSourceHash = true;
+	}
 
-	Gfx->ComputePipelinesMap.insert(eastl::make_pair(Hash, NewPipeline));
+	if (!bHasSourceHash || !mz_LoadSceneCache(CacheFileName, SourceHash, Flags, OutScene))
+	{
+		eastl::vector<mz_MappedFile> BufferFiles;
+		bool bHasBuffers = mz_LoadGLTFBuffers(FileName, &Options, Data, &BufferFiles);
+		mz_ASSERT(bHasBuffers);
 
-	return NewPipeline;
+		mz_ConvertGLTFScene(Data, Flags, OutScene);
+		mz_ReleaseGLTFBuffers(Data, &BufferFiles);
+		if (bUseCache)
+		{
+			if (!bHasSourceHash)
+			{
+				SourceHash = mz_HashGLTFSource(FileName, *OutSourceFile, Data);
+			}
+			mz_WriteSceneCache(CacheFileName, SourceHash, SourceStamp, OutScene);
+		}
+	}
+
+	if (Flags & mz_SCENE_LOAD_COMPACT_VERTICES)
+	{
+		mz_CompactSceneVertices(OutScene);
+	}
+
+	return Data;
 }
 
-static void
-mz_LoadGLTFMesh(cgltf_mesh* InMesh, mz_Mesh* OutMesh, eastl::vector<mz_Vertex>* InOutVertices, eastl::vector<uint32_t>* InOutIndices)
+//
+// Streaming.
+//
+// NOTE: Worker threads decode into Streamer->Images and queue finished indices, images are moved to the scene
+// only by mz_UpdateStreamedImages (on the caller's thread), so the scene is never written concurrently. Blocking load
+// runs the same decoding on all threads and takes every image at the end.
+struct mz_SceneStreamer
 {
-	mz_ASSERT(InMesh);
+	cgltf_data* Data;
+	mz_MappedFile SourceFile; // Parsed glTF file, Data points into it.
+	uint32_t Flags;
+	char Directory[MAX_PATH];
+	eastl::vector<mz_TextureRole> Roles;
+	eastl::vector<mz_MappedFile> Files;
+	eastl::vector<uint32_t> Order;
+	eastl::vector<mz_Image> Images; // Decoded, owned by the streamer until taken.
+	std::atomic<uint32_t> NextImage;
+	std::atomic<bool> bShouldStop;
+	std::mutex ReadyMutex;
+	eastl::vector<uint32_t> ReadyImages; // Guarded by ReadyMutex.
+	uint32_t NumPendingImages;
+	eastl::vector<std::thread> Threads;
+};
 
-	OutMesh->NumSections = (uint16_t)InMesh->primitives_count;
-	if (OutMesh->NumSections > 1)
+static void
+mz_InitImageDecoding(const char* FileName, cgltf_data* Data, const mz_MappedFile& SourceFile, uint32_t Flags, const mz_SceneData* Scene, bool bLargestFirst, mz_SceneStreamer* OutStreamer)
+{
+	OutStreamer->Data = Data;
+	OutStreamer->SourceFile = SourceFile;
+	OutStreamer->Flags = Flags;
+
+	// NOTE: Bare file name is relative to the current directory.
+	const char* C = mz_FindLastPathSeparator(FileName);
+	int DirectoryLength = C ? (int)(C - FileName) : 1;
+	mz_ASSERT((size_t)DirectoryLength < sizeof(OutStreamer->Directory));
+	snprintf(OutStreamer->Directory, sizeof(OutStreamer->Directory), "%.*s", DirectoryLength, C ? FileName : ".");
+
+	uint32_t NumImages = (uint32_t)Data->images_count;
+	OutStreamer->Images.resize(NumImages);
+	OutStreamer->NumPendingImages = NumImages;
+
+	OutStreamer->Roles.resize(NumImages, mz_TEXTURE_ROLE_COLOR);
+	for (const mz_Material& Material : Scene->Materials)
 	{
-		OutMesh->Sections = (mz_MeshSection*)calloc(OutMesh->NumSections, sizeof(mz_MeshSection));
-		if (!OutMesh->Sections)
+		if (Material.NormalTextureIndex != (uint16_t)~0)
 		{
-			return;
+			OutStreamer->Roles[Material.NormalTextureIndex] = mz_TEXTURE_ROLE_NORMAL;
+		}
+		if (Material.PBRFactorsTextureIndex != (uint16_t)~0)
+		{
+			OutStreamer->Roles[Material.PBRFactorsTextureIndex] = mz_TEXTURE_ROLE_PBR_FACTORS;
 		}
 	}
 
-	uint32_t TotalNumVertices = 0;
-	uint32_t TotalNumIndices = 0;
+	// NOTE: Compressed files are mapped and decoded straight into the final mz_Image. Blocking load takes
+	// largest ones first so that a big texture picked up last doesn't keep one thread busy after all others are done,
+	// streaming takes smallest ones first so that most of the scene gets real textures early.
+	OutStreamer->Files.resize(NumImages);
+	OutStreamer->Order.resize(NumImages);
+	for (uint32_t ImageIdx = 0; ImageIdx < NumImages; ++ImageIdx)
+	{
+		char Path[MAX_PATH];
+		bool bIsPathValid = (size_t)snprintf(Path, sizeof(Path), "%s/%s", OutStreamer->Directory, Data->images[ImageIdx].uri) < sizeof(Path);
+		mz_ASSERT(bIsPathValid);
 
-	for (uint32_t SectionIdx = 0; SectionIdx < InMesh->primitives_count; ++SectionIdx)
+		bool bIsMapped = mz_MapFile(Path, &OutStreamer->Files[ImageIdx]);
+		mz_ASSERT(bIsMapped && OutStreamer->Files[ImageIdx].Size > 0);
+		OutStreamer->Order[ImageIdx] = ImageIdx;
+	}
+	const eastl::vector<mz_MappedFile>& Files = OutStreamer->Files;
+	eastl::sort(OutStreamer->Order.begin(), OutStreamer->Order.end(), [&](uint32_t A, uint32_t B)
 	{
-		mz_ASSERT(InMesh->primitives[SectionIdx].indices);
-		mz_ASSERT(InMesh->primitives[SectionIdx].attributes);
+		return bLargestFirst ? Files[A].Size > Files[B].Size : Files[A].Size < Files[B].Size;
+	});
+}
 
-		TotalNumIndices += (uint32_t)InMesh->primitives[SectionIdx].indices->count;
-		TotalNumVertices += (uint32_t)InMesh->primitives[SectionIdx].attributes[0].data->count;
+static void
+mz_DecodeImage(const mz_SceneStreamer* Streamer, uint32_t ImageIdx, mz_Image* OutImage)
+{
+	const mz_MappedFile& File = Streamer->Files[ImageIdx];
+	mz_TextureRole Role = Streamer->Roles[ImageIdx];
+
+	// Cache hit skips decoding completely. Image whose cache path doesn't fit is always decoded and compressed.
+	char CacheFileName[MAX_PATH];
+	uint64_t SourceHash = 0;
+	bool bUseCache = (Streamer->Flags & mz_SCENE_LOAD_COMPRESS_TEXTURES) &&
+		(size_t)snprintf(CacheFileName, sizeof(CacheFileName), "%s/%s.cache", Streamer->Directory, Streamer->Data->images[ImageIdx].uri) < sizeof(CacheFileName);
+	if (bUseCache)
+	{
+		SourceHash = mz_HashData(File.Data, File.Size, mz_TEXTURE_COMPRESSION_VERSION);
+		if (mz_LoadTextureCache(CacheFileName, SourceHash, Role, OutImage))
+		{
+			return;
+		}
 	}
 
-	InOutVertices->reserve(InOutVertices->size() + TotalNumVertices);
-	InOutIndices->reserve(InOutIndices->size() + TotalNumIndices);
+	int Width, Height;
+	uint8_t* Pixels = stbi_load_from_memory(File.Data, (int)File.Size, &Width, &Height, nullptr, 4);
+	mz_ASSERT(Pixels);
 
-	eastl::vector<XMFLOAT3> Positions;
-	eastl::vector<XMFLOAT3> Normals;
-	eastl::vector<XMFLOAT4> Tangents;
-	eastl::vector<XMFLOAT2> Texcoords;
-	Positions.reserve(TotalNumVertices);
-	Normals.reserve(TotalNumVertices);
-	Tangents.reserve(TotalNumVertices);
-	Texcoords.reserve(TotalNumVertices);
+	OutImage->Pixels = Pixels;
+	OutImage->Width = (uint32_t)Width;
+	OutImage->Height = (uint32_t)Height;
 
-	mz_MeshSection* Sections = mz_GetMeshSections(OutMesh);
+	// NOTE: Uncompressed mip chains are cheap to rebuild, only compressed ones are cached.
+	if ((Streamer->Flags & mz_SCENE_LOAD_COMPRESS_TEXTURES) && mz_ProcessTexture(Role, OutImage) && bUseCache)
+	{
+		mz_WriteTextureCache(CacheFileName, SourceHash, Role, OutImage);
+	}
+}
 
-	for (uint32_t SectionIdx = 0; SectionIdx < InMesh->primitives_count; ++SectionIdx)
+// Thread function, returns when all images are taken or streaming is stopped.
+static void
+mz_DecodeImages(mz_SceneStreamer* Streamer)
+{
+	uint32_t NumImages = (uint32_t)Streamer->Order.size();
+	while (!Streamer->bShouldStop.load())
 	{
-		// Indices.
+		uint32_t OrderIdx = Streamer->NextImage.fetch_add(1);
+		if (OrderIdx >= NumImages)
 		{
-			cgltf_accessor* Accessor = InMesh->primitives[SectionIdx].indices;
-
-			mz_ASSERT(Accessor->buffer_view);
-			mz_ASSERT(Accessor->stride == Accessor->buffer_view->stride || Accessor->buffer_view->stride == 0);
-			mz_ASSERT((Accessor->stride * Accessor->count) == Accessor->buffer_view->size);
-
-			auto DataAddr = (uint8_t*)Accessor->buffer_view->buffer->data + Accessor->offset + Accessor->buffer_view->offset;
+			break;
+		}
+		uint32_t ImageIdx = Streamer->Order[OrderIdx];
+		mz_DecodeImage(Streamer, ImageIdx, &Streamer->Images[ImageIdx]);
 
-			Sections[SectionIdx].BaseIndex = (uint32_t)InOutIndices->size();
-			Sections[SectionIdx].NumIndices = (uint32_t)Accessor->count;
+		std::lock_guard<std::mutex> Lock(Streamer->ReadyMutex);
+		Streamer->ReadyImages.push_back(ImageIdx);
+	}
+}
 
-			if (Accessor->stride == 1)
-			{
-				uint8_t* DataU8 = (uint8_t*)DataAddr;
-				for (uint32_t Idx = 0; Idx < Accessor->count; ++Idx)
-				{
-					InOutIndices->push_back((uint32_t)*DataU8++);
-				}
-			}
-			else if (Accessor->stride == 2)
-			{
-				uint16_t* DataU16 = (uint16_t*)DataAddr;
-				for (uint32_t Idx = 0; Idx < Accessor->count; ++Idx)
-				{
-					InOutIndices->push_back((uint32_t)*DataU16++);
-				}
-			}
-			else if (Accessor->stride == 4)
-			{
-				InOutIndices->resize(InOutIndices->size() + Accessor->count);
+// Frees images which were not taken, unmaps image files and frees glTF data.
+static void
+mz_FinishImageDecoding(mz_SceneStreamer* Streamer)
+{
+	for (std::thread& Thread : Streamer->Threads)
+	{
+		Thread.join();
+	}
+	Streamer->Threads.clear();
 
-				memcpy(InOutIndices->data() + (InOutIndices->size() - Accessor->count), DataAddr, Accessor->count * Accessor->stride);
-			}
-			else
-			{
-				mz_ASSERT(0);
-			}
-		}
+	for (mz_Image& Image : Streamer->Images)
+	{
+		stbi_image_free(Image.Pixels);
+		free(Image.MipData);
+	}
+	for (mz_MappedFile& File : Streamer->Files)
+	{
+		mz_UnmapFile(&File);
+	}
+	cgltf_free(Streamer->Data);
+	mz_UnmapFile(&Streamer->SourceFile);
+}
 
-		// Attributes.
-		{
-			uint32_t NumAttribs = (uint32_t)InMesh->primitives[SectionIdx].attributes_count;
+// NOTE: Placeholders are neutral: white base color, flat normal, fully rough dielectric without occlusion.
+static void
+mz_InitPlaceholderImage(mz_TextureRole Role, uint32_t Flags, mz_Image* OutImage)
+{
+	static const uint8_t Texels[][4] =
+	{
+		{ 255, 255, 255, 255 }, { 128, 128, 255, 255 }, { 255, 255, 0, 255 },
+	};
 
-			for (uint32_t AttribIdx = 0; AttribIdx < NumAttribs; ++AttribIdx)
-			{
-				cgltf_attribute* Attrib = &InMesh->primitives[SectionIdx].attributes[AttribIdx];
-				cgltf_accessor* Accessor = Attrib->data;
+	uint8_t* Texel = (uint8_t*)malloc(4);
+	mz_ASSERT(Texel);
+	memcpy(Texel, Texels[Role], 4);
 
-				mz_ASSERT(Accessor->buffer_view);
-				mz_ASSERT(Accessor->stride == Accessor->buffer_view->stride || Accessor->buffer_view->stride == 0);
-				mz_ASSERT((Accessor->stride * Accessor->count) == Accessor->buffer_view->size);
+	*OutImage = {};
+	OutImage->Width = 1;
+	OutImage->Height = 1;
+	OutImage->Format = mz_IMAGE_FORMAT_RGBA8;
+	if (Flags & mz_SCENE_LOAD_COMPRESS_TEXTURES)
+	{
+		OutImage->NumMips = 1;
+		OutImage->MipData = Texel;
+		OutImage->MipDataSize = 4;
+	}
+	else
+	{
+		OutImage->Pixels = Texel;
+	}
+}
 
-				auto DataAddr = (uint8_t*)Accessor->buffer_view->buffer->data + Accessor->offset + Accessor->buffer_view->offset;
+mz_SceneStreamer*
+mz_BeginStreamingGLTFSceneData(const char* FileName, uint32_t Flags, mz_SceneData* OutScene)
+{
+	mz_MappedFile SourceFile;
+	cgltf_data* Data = mz_LoadGLTFSceneGeometry(FileName, Flags, OutScene, &SourceFile);
 
-				if (Attrib->type == cgltf_attribute_type_position)
-				{
-					mz_ASSERT(Accessor->type == cgltf_type_vec3);
-					Positions.resize(Accessor->count);
-					memcpy(Positions.data(), DataAddr, Accessor->count * Accessor->stride);
-				}
-				else if (Attrib->type == cgltf_attribute_type_normal)
-				{
-					mz_ASSERT(Accessor->type == cgltf_type_vec3);
-					Normals.resize(Accessor->count);
-					memcpy(Normals.data(), DataAddr, Accessor->count * Accessor->stride);
-				}
-				else if (Attrib->type == cgltf_attribute_type_tangent)
-				{
-					mz_ASSERT(Accessor->type == cgltf_type_vec4);
-					Tangents.resize(Accessor->count);
-					memcpy(Tangents.data(), DataAddr, Accessor->count * Accessor->stride);
-				}
-				else if (Attrib->type == cgltf_attribute_type_texcoord)
-				{
-					mz_ASSERT(Accessor->type == cgltf_type_vec2);
-					Texcoords.resize(Accessor->count);
-					memcpy(Texcoords.data(), DataAddr, Accessor->count * Accessor->stride);
-				}
-			}
+	mz_SceneStreamer* Streamer = new mz_SceneStreamer();
+	mz_InitImageDecoding(FileName, Data, SourceFile, Flags, OutScene, /*bLargestFirst*/false, Streamer);
 
-			mz_ASSERT(Positions.size() > 0);
-			mz_ASSERT(Positions.size() == Normals.size());
-			mz_ASSERT(Positions.size() == Texcoords.size());
+	uint32_t NumImages = (uint32_t)Streamer->Images.size();
+	OutScene->Images.resize(NumImages);
+	for (uint32_t ImageIdx = 0; ImageIdx < NumImages; ++ImageIdx)
+	{
+		mz_InitPlaceholderImage(Streamer->Roles[ImageIdx], Flags, &OutScene->Images[ImageIdx]);
+	}
 
-			if (Tangents.empty())
-			{
-				Tangents.resize(Positions.size());
-			}
+	// NOTE: One hardware thread is left to the caller, it keeps rendering while images are decoded.
+	uint32_t NumThreads = eastl::min(eastl::max(std::thread::hardware_concurrency(), 2u) - 1, NumImages);
+	for (uint32_t ThreadIdx = 0; ThreadIdx < NumThreads; ++ThreadIdx)
+	{
+		Streamer->Threads.push_back(std::thread(mz_DecodeImages, Streamer));
+	}
+	return Streamer;
+}
 
-			Sections[SectionIdx].BaseVertex = (uint32_t)InOutVertices->size();
-			Sections[SectionIdx].NumVertices = (uint32_t)Positions.size();
+uint32_t
+mz_UpdateStreamedImages(mz_SceneStreamer* Streamer, mz_SceneData* InOutScene, uint32_t* OutImageIndices, uint32_t MaxImages)
+{
+	uint32_t NumImages = 0;
+	{
+		std::lock_guard<std::mutex> Lock(Streamer->ReadyMutex);
+		NumImages = eastl::min((uint32_t)Streamer->ReadyImages.size(), MaxImages);
+		eastl::copy(Streamer->ReadyImages.begin(), Streamer->ReadyImages.begin() + NumImages, OutImageIndices);
+		Streamer->ReadyImages.erase(Streamer->ReadyImages.begin(), Streamer->ReadyImages.begin() + NumImages);
+	}
 
-			for (uint32_t Idx = 0; Idx < Positions.size(); ++Idx)
-			{
-				mz_Vertex Vertex;
-				Vertex.Position = Positions[Idx];
-				Vertex.Normal = Normals[Idx];
-				Vertex.Tangent = Tangents[Idx];
-				Vertex.Texcoord = Texcoords[Idx];
-				InOutVertices->push_back(Vertex);
-			}
+	// Taken images are not touched by worker threads anymore.
+	for (uint32_t Idx = 0; Idx < NumImages; ++Idx)
+	{
+		uint32_t ImageIdx = OutImageIndices[Idx];
+		mz_Image* Image = &InOutScene->Images[ImageIdx];
+		stbi_image_free(Image->Pixels);
+		free(Image->MipData);
 
-			Positions.clear();
-			Normals.clear();
-			Texcoords.clear();
-			Tangents.clear();
-		}
+		*Image = Streamer->Images[ImageIdx];
+		Streamer->Images[ImageIdx] = {};
 	}
+	Streamer->NumPendingImages -= NumImages;
+	return NumImages;
+}
+
+uint32_t
+mz_GetNumPendingImages(const mz_SceneStreamer* Streamer)
+{
+	return Streamer->NumPendingImages;
 }
 
 void
-mz_LoadGLTFScene(const char* FileName, mz_GraphicsContext* Gfx, mz_SceneData* OutScene, eastl::vector<ID3D12Resource*>* OutTempResources)
+mz_EndStreaming(mz_SceneStreamer* Streamer)
 {
-	mz_ASSERT(OutScene->Meshes.empty() && OutScene->Objects.empty() && OutScene->Materials.empty() && OutScene->Textures.empty() && OutScene->TextureSRVs.empty());
+	Streamer->bShouldStop.store(true);
+	mz_FinishImageDecoding(Streamer);
+	delete Streamer;
+}
 
-	cgltf_options Options = {};
-	cgltf_data* Data = nullptr;
-	{
-		cgltf_result R = cgltf_parse_file(&Options, FileName, &Data);
-		mz_ASSERT(R == cgltf_result_success);
+void
+mz_LoadGLTFSceneData(const char* FileName, uint32_t Flags, mz_SceneData* OutScene)
+{
+	mz_MappedFile SourceFile;
+	cgltf_data* Data = mz_LoadGLTFSceneGeometry(FileName, Flags, OutScene, &SourceFile);
 
-		R = cgltf_load_buffers(&Options, Data, FileName);
-		mz_ASSERT(R == cgltf_result_success);
+	// Images (decoded to R8G8B8A8 or block compressed).
+	mz_SceneStreamer Streamer = {};
+	mz_InitImageDecoding(FileName, Data, SourceFile, Flags, OutScene, /*bLargestFirst*/true, &Streamer);
 
-		mz_ASSERT(Data->scenes_count == 1);
-	}
+	uint32_t NumJobs = eastl::min(mz_GetNumJobThreads(), (uint32_t)Streamer.Images.size());
+	mz_ParallelFor(NumJobs, 1, [&Streamer](uint32_t, uint32_t) { mz_DecodeImages(&Streamer); });
 
-	eastl::vector<mz_Vertex> AllVertices;
-	eastl::vector<uint32_t> AllIndices;
+	OutScene->Images.swap(Streamer.Images);
+	mz_FinishImageDecoding(&Streamer);
+}
 
-	// Meshes.
+void
+mz_DestroySceneData(mz_SceneData* Scene)
+{
+	for (uint32_t Idx = 0; Idx < Scene->Meshes.size(); ++Idx)
 	{
-		uint32_t NumMeshes = (uint32_t)Data->meshes_count;
-		mz_ASSERT(NumMeshes > 0);
-
-		OutScene->Meshes.reserve(NumMeshes);
+		mz_DestroyMesh(&Scene->Meshes[Idx]);
+	}
+	for (uint32_t Idx = 0; Idx < Scene->LODMeshes.size(); ++Idx)
+	{
+		mz_DestroyMesh(&Scene->LODMeshes[Idx]);
+	}
+	for (uint32_t Idx = 0; Idx < Scene->Images.size(); ++Idx)
+	{
+		stbi_image_free(Scene->Images[Idx].Pixels);
+		free(Scene->Images[Idx].MipData);
+	}
+	Scene->Vertices.clear();
+	Scene->IndexData.clear();
+	Scene->Meshes.clear();
+	Scene->MeshLODChains.clear();
+	Scene->LODMeshes.clear();
+	Scene->LODErrors.clear();
+	Scene->Meshlets.clear();
+	Scene->MeshletVertices.clear();
+	Scene->MeshletTriangles.clear();
+	Scene->Materials.clear();
+	Scene->Objects.clear();
+	Scene->Images.clear();
+	Scene->CompactVertices.clear();
+	Scene->CompactMeshes.clear();
+}
 
-		for (uint32_t MeshIdx = 0; MeshIdx < NumMeshes; ++MeshIdx)
+static char*
+mz_ReadPLYLine(char** InOutText)
+{
+	char* Line = *InOutText;
+	if (*Line == '\0')
+	{
+		return nullptr;
+	}
+	char* End = strchr(Line, '\n');
+	if (End)
+	{
+		*End = '\0';
+		*InOutText = End + 1;
+		if (End > Line && End[-1] == '\r')
 		{
-			mz_Mesh Mesh = {};
-			mz_LoadGLTFMesh(&Data->meshes[MeshIdx], &Mesh, &AllVertices, &AllIndices);
+			End[-1] = '\0';
+		}
+	}
+	else
+	{
+		*InOutText = Line + strlen(Line);
+	}
+	return Line;
+}
 
-			cgltf_mesh* SrcMesh = &Data->meshes[MeshIdx];
+void
+mz_LoadPLYMeshData(const char* FileName, const XMFLOAT3X4& ObjectToWorld, mz_SceneData* InOutScene)
+{
+	eastl::vector<uint8_t> Content = mz_LoadFile(FileName);
+	Content.push_back('\0');
+	char* Text = (char*)Content.data();
+
+	// NOTE: Only ASCII files with triangle or polygon faces are supported (that's what Houdini exports).
+	enum { PROPERTY_X, PROPERTY_Y, PROPERTY_Z, PROPERTY_NX, PROPERTY_NY, PROPERTY_NZ, PROPERTY_U, PROPERTY_V, PROPERTY_COUNT };
+	static const char* PropertyNames[PROPERTY_COUNT][2] = { { "x", "x" }, { "y", "y" }, { "z", "z" }, { "nx", "nx" }, { "ny", "ny" }, { "nz", "nz" }, { "u", "s" }, { "v", "t" } };
+	int32_t PropertyColumns[PROPERTY_COUNT];
+	for (uint32_t Idx = 0; Idx < PROPERTY_COUNT; ++Idx)
+	{
+		PropertyColumns[Idx] = -1;
+	}
 
-			mz_MeshSection* Sections = mz_GetMeshSections(&Mesh);
+	uint32_t NumVertices = 0;
+	uint32_t NumFaces = 0;
+	uint32_t NumVertexProperties = 0;
+	{
+		char* Line = mz_ReadPLYLine(&Text);
+		mz_ASSERT(Line && strcmp(Line, "ply") == 0);
 
-			for (uint32_t SectionIdx = 0; SectionIdx < (uint32_t)SrcMesh->primitives_count; ++SectionIdx)
+		bool bIsInVertexElement = false;
+		while ((Line = mz_ReadPLYLine(&Text)) != nullptr && strcmp(Line, "end_header") != 0)
+		{
+			char Name[64];
+			if (strncmp(Line, "format ", 7) == 0)
 			{
-				Sections[SectionIdx].MaterialIndex = (uint16_t)~0;
-
-				for (uint32_t MaterialIdx = 0; MaterialIdx < (uint32_t)Data->materials_count; ++MaterialIdx)
+				mz_ASSERT(strncmp(Line + 7, "ascii", 5) == 0);
+			}
+			else if (sscanf(Line, "element vertex %u", &NumVertices) == 1)
+			{
+				bIsInVertexElement = true;
+			}
+			else if (sscanf(Line, "element face %u", &NumFaces) == 1)
+			{
+				bIsInVertexElement = false;
+			}
+			else if (strncmp(Line, "element ", 8) == 0)
+			{
+				mz_ASSERT(0); // Unsupported element.
+			}
+			else if (bIsInVertexElement && sscanf(Line, "property %*s %63s", Name) == 1)
+			{
+				for (uint32_t Idx = 0; Idx < PROPERTY_COUNT; ++Idx)
 				{
-					if (&Data->materials[MaterialIdx] == SrcMesh->primitives[SectionIdx].material)
+					if (strcmp(Name, PropertyNames[Idx][0]) == 0 || strcmp(Name, PropertyNames[Idx][1]) == 0)
 					{
-						Sections[SectionIdx].MaterialIndex = (uint16_t)MaterialIdx;
-						break;
+						PropertyColumns[Idx] = (int32_t)NumVertexProperties;
 					}
 				}
-				mz_ASSERT(Sections[SectionIdx].MaterialIndex != (uint16_t)~0);
+				NumVertexProperties++;
 			}
-
-			OutScene->Meshes.push_back(Mesh);
 		}
+		mz_ASSERT(Line && NumVertices > 0 && NumFaces > 0);
+		mz_ASSERT(PropertyColumns[PROPERTY_X] >= 0 && PropertyColumns[PROPERTY_Y] >= 0 && PropertyColumns[PROPERTY_Z] >= 0);
 	}
 
-	// Materials.
+	mz_Mesh Mesh = {};
+	Mesh.NumSections = 1;
+	Mesh.Section.BaseVertex = (uint32_t)InOutScene->Vertices.size();
+	Mesh.Section.NumVertices = NumVertices;
+	Mesh.Section.MaterialIndex = (uint16_t)InOutScene->Materials.size();
+
+	// Vertices.
 	{
-		uint32_t NumMaterials = (uint32_t)Data->materials_count;
-		mz_ASSERT(NumMaterials > 0);
+		InOutScene->Vertices.reserve(InOutScene->Vertices.size() + NumVertices);
 
-		OutScene->Materials.reserve(NumMaterials);
+		float Values[32];
+		mz_ASSERT(NumVertexProperties <= eastl::size(Values));
 
-		for (uint32_t MaterialIdx = 0; MaterialIdx < NumMaterials; ++MaterialIdx)
+		for (uint32_t VertexIdx = 0; VertexIdx < NumVertices; ++VertexIdx)
 		{
-			cgltf_material* SrcMaterial = &Data->materials[MaterialIdx];
-			if (SrcMaterial->has_pbr_metallic_roughness)
+			for (uint32_t Idx = 0; Idx < NumVertexProperties; ++Idx)
 			{
-				cgltf_pbr_metallic_roughness* PBR = &SrcMaterial->pbr_metallic_roughness;
+				char* End;
+				Values[Idx] = strtof(Text, &End);
+				mz_ASSERT(End != Text);
+				Text = End;
+			}
 
-				mz_Material Material = {};
-				Material.BaseColorFactor = XMFLOAT4(PBR->base_color_factor);
-				Material.RoughnessFactor = PBR->roughness_factor;
-				Material.MetallicFactor = PBR->metallic_factor;
+			auto GetValue = [&](uint32_t Property, float Default) { return PropertyColumns[Property] >= 0 ? Values[PropertyColumns[Property]] : Default; };
 
-				Material.BaseColorTextureIndex = (uint16_t)~0;
-				Material.PBRFactorsTextureIndex = (uint16_t)~0;
-				Material.NormalTextureIndex = (uint16_t)~0;
+			mz_Vertex Vertex = {};
+			Vertex.Position = XMFLOAT3(GetValue(PROPERTY_X, 0.0f), GetValue(PROPERTY_Y, 0.0f), GetValue(PROPERTY_Z, 0.0f));
+			Vertex.Normal = XMFLOAT3(GetValue(PROPERTY_NX, 0.0f), GetValue(PROPERTY_NY, 1.0f), GetValue(PROPERTY_NZ, 0.0f));
+			Vertex.Tangent = XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f);
+			Vertex.Texcoord = XMFLOAT2(GetValue(PROPERTY_U, 0.0f), GetValue(PROPERTY_V, 0.0f));
+			InOutScene->Vertices.push_back(Vertex);
+		}
+	}
 
-				for (uint32_t ImageIdx = 0; ImageIdx < (uint32_t)Data->images_count; ++ImageIdx)
-				{
-					cgltf_image* Image = &Data->images[ImageIdx];
+	// Indices (polygons are triangulated as fans).
+	{
+		eastl::vector<uint32_t> Indices;
+		Indices.reserve(NumFaces * 3);
 
-					if (PBR->base_color_texture.texture && Image->uri == PBR->base_color_texture.texture->image->uri)
-					{
-						mz_ASSERT(Material.BaseColorTextureIndex == (uint16_t)~0);
-						Material.BaseColorTextureIndex = (uint16_t)ImageIdx;
-					}
-					if (PBR->metallic_roughness_texture.texture && Image->uri == PBR->metallic_roughness_texture.texture->image->uri)
-					{
-						mz_ASSERT(Material.PBRFactorsTextureIndex == (uint16_t)~0);
-						Material.PBRFactorsTextureIndex = (uint16_t)ImageIdx;
-					}
-					if (SrcMaterial->normal_texture.texture && Image->uri == SrcMaterial->normal_texture.texture->image->uri)
-					{
-						mz_ASSERT(Material.NormalTextureIndex == (uint16_t)~0);
-						Material.NormalTextureIndex = (uint16_t)ImageIdx;
-					}
-				}
+		for (uint32_t FaceIdx = 0; FaceIdx < NumFaces; ++FaceIdx)
+		{
+			char* End;
+			uint32_t NumFaceVertices = (uint32_t)strtoul(Text, &End, 10);
+			mz_ASSERT(End != Text && NumFaceVertices >= 3);
+			Text = End;
 
-				OutScene->Materials.push_back(Material);
+			uint32_t FaceIndices[3];
+			for (uint32_t Idx = 0; Idx < NumFaceVertices; ++Idx)
+			{
+				uint32_t Index = (uint32_t)strtoul(Text, &End, 10);
+				mz_ASSERT(End != Text && Index < NumVertices);
+				Text = End;
+
+				if (Idx < 2)
+				{
+					FaceIndices[Idx] = Index;
+					continue;
+				}
+				FaceIndices[2] = Index;
+				Indices.push_back(FaceIndices[0]);
+				Indices.push_back(FaceIndices[1]);
+				Indices.push_back(FaceIndices[2]);
+				FaceIndices[1] = Index;
 			}
 		}
+		mz_AppendSectionIndices(Indices.data(), (uint32_t)Indices.size(), &Mesh.Section, &InOutScene->IndexData);
 	}
 
-	uint32_t NumNodes = (uint32_t)Data->nodes_count;
-	mz_ASSERT(NumNodes > 0);
+	mz_Material Material = {};
+	Material.BaseColorFactor = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	Material.RoughnessFactor = 1.0f;
+	Material.MetallicFactor = 0.0f;
+	Material.BaseColorTextureIndex = (uint16_t)~0;
+	Material.PBRFactorsTextureIndex = (uint16_t)~0;
+	Material.NormalTextureIndex = (uint16_t)~0;
+	InOutScene->Materials.push_back(Material);
+
+	mz_Object Object = {};
+	Object.MeshIndex = (uint16_t)InOutScene->Meshes.size();
+	Object.ObjectToWorld = ObjectToWorld;
+	InOutScene->Objects.push_back(Object);
+
+	InOutScene->Meshes.push_back(Mesh);
+}
+
+//
+// Compact vertices.
+//
+static uint32_t
+mz_FloatToHalf(float Value)
+{
+	uint32_t Bits;
+	memcpy(&Bits, &Value, 4);
 
-	OutScene->Objects.reserve(NumNodes);
+	uint32_t Sign = (Bits >> 16) & 0x8000;
+	int32_t Exponent = (int32_t)((Bits >> 23) & 0xff) - 127 + 15;
+	uint32_t Mantissa = Bits & 0x7fffff;
 
-	for (uint32_t NodeIdx = 0; NodeIdx < NumNodes; ++NodeIdx)
+	if (((Bits >> 23) & 0xff) == 0xff)
+	{
+		return Sign | 0x7c00 | (Mantissa ? 0x200 : 0); // Inf or NaN.
+	}
+	if (Exponent >= 31)
 	{
-		if (Data->nodes[NodeIdx].mesh)
+		return Sign | 0x7c00;
+	}
+	if (Exponent <= 0)
+	{
+		if (Exponent < -10)
+		{
+			return Sign;
+		}
+		// Denormal, implicit one becomes explicit.
+		Mantissa |= 0x800000;
+		uint32_t Shift = (uint32_t)(14 - Exponent);
+		uint32_t Half = Mantissa >> Shift;
+		uint32_t Remainder = Mantissa & ((1u << Shift) - 1);
+		uint32_t Midpoint = 1u << (Shift - 1);
+		if (Remainder > Midpoint || (Remainder == Midpoint && (Half & 1)))
 		{
-			cgltf_mesh* SrcMesh = Data->nodes[NodeIdx].mesh;
+			Half++;
+		}
+		return Sign | Half;
+	}
+
+	uint32_t Half = ((uint32_t)Exponent << 10) | (Mantissa >> 13);
+	uint32_t Remainder = Mantissa & 0x1fff;
+	if (Remainder > 0x1000 || (Remainder == 0x1000 && (Half & 1)))
+	{
+		Half++; // May carry into exponent, which is correct rounding.
+	}
+	return Sign | Half;
+}
 
-			mz_Object Object = {};
-			Object.MeshIndex = (uint16_t)~0;
+static float
+mz_HalfToFloat(uint32_t Half)
+{
+	uint32_t Sign = (Half & 0x8000) << 16;
+	uint32_t Exponent = (Half >> 10) & 0x1f;
+	uint32_t Mantissa = Half & 0x3ff;
 
-			for (uint32_t MeshIdx = 0; MeshIdx < (uint32_t)Data->meshes_count; ++MeshIdx)
-			{
-				if (&Data->meshes[MeshIdx] == SrcMesh)
-				{
-					Object.MeshIndex = (uint16_t)MeshIdx;
-					break;
-				}
-			}
-			mz_ASSERT(Object.MeshIndex != (uint16_t)~0);
+	uint32_t Bits;
+	if (Exponent == 0)
+	{
+		float Value = Mantissa * (1.0f / 16777216.0f); // 2^-24
+		return Sign ? -Value : Value;
+	}
+	else if (Exponent == 31)
+	{
+		Bits = Sign | 0x7f800000 | (Mantissa << 13);
+	}
+	else
+	{
+		Bits = Sign | ((Exponent - 15 + 127) << 23) | (Mantissa << 13);
+	}
+	float Value;
+	memcpy(&Value, &Bits, 4);
+	return Value;
+}
 
-			cgltf_float WorldTransform[16];
-			cgltf_node_transform_world(&Data->nodes[NodeIdx], WorldTransform);
+static uint32_t
+mz_PackSNorm16x2(float X, float Y)
+{
+	int32_t IX = (int32_t)lroundf(fminf(fmaxf(X, -1.0f), 1.0f) * 32767.0f);
+	int32_t IY = (int32_t)lroundf(fminf(fmaxf(Y, -1.0f), 1.0f) * 32767.0f);
+	return ((uint32_t)IX & 0xffff) | ((uint32_t)IY << 16);
+}
 
-			memcpy(&Object.ObjectToWorld, &XMMatrixTranspose(XMLoadFloat4x4((XMFLOAT4X4*)&WorldTransform[0])), sizeof(XMFLOAT3X4));
+static void
+mz_UnpackSNorm16x2(uint32_t Packed, float* OutX, float* OutY)
+{
+	*OutX = fmaxf((int16_t)(Packed & 0xffff) / 32767.0f, -1.0f);
+	*OutY = fmaxf((int16_t)(Packed >> 16) / 32767.0f, -1.0f);
+}
 
-			OutScene->Objects.push_back(Object);
-		}
+static uint32_t
+mz_EncodeOctahedral(XMFLOAT3 N)
+{
+	float Sum = fabsf(N.x) + fabsf(N.y) + fabsf(N.z);
+	if (Sum == 0.0f)
+	{
+		return mz_PackSNorm16x2(0.0f, 0.0f);
 	}
-
-	for (uint32_t ImageIdx = 0; ImageIdx < (uint32_t)Data->images_count; ++ImageIdx)
+	float X = N.x / Sum;
+	float Y = N.y / Sum;
+	if (N.z < 0.0f)
 	{
-		cgltf_image* Image = &Data->images[ImageIdx];
+		float FoldedX = (1.0f - fabsf(Y)) * (X >= 0.0f ? 1.0f : -1.0f);
+		float FoldedY = (1.0f - fabsf(X)) * (Y >= 0.0f ? 1.0f : -1.0f);
+		X = FoldedX;
+		Y = FoldedY;
+	}
+	return mz_PackSNorm16x2(X, Y);
+}
 
-		char Path[MAX_PATH];
-		strcpy(Path, FileName);
+static XMFLOAT3
+mz_DecodeOctahedral(uint32_t Packed)
+{
+	float X, Y;
+	mz_UnpackSNorm16x2(Packed, &X, &Y);
+
+	float Z = 1.0f - fabsf(X) - fabsf(Y);
+	float T = fmaxf(-Z, 0.0f);
+	X += X >= 0.0f ? -T : T;
+	Y += Y >= 0.0f ? -T : T;
+
+	float Length = sqrtf(X * X + Y * Y + Z * Z);
+	return XMFLOAT3(X / Length, Y / Length, Z / Length);
+}
+
+void
+mz_EncodeCompactVertex(const mz_Vertex& Vertex, const mz_CompactMesh& Mesh, mz_CompactVertex* OutVertex)
+{
+	float X = (Vertex.Position.x - Mesh.PositionCenter.x) / Mesh.PositionExtent.x;
+	float Y = (Vertex.Position.y - Mesh.PositionCenter.y) / Mesh.PositionExtent.y;
+	float Z = (Vertex.Position.z - Mesh.PositionCenter.z) / Mesh.PositionExtent.z;
+
+	OutVertex->PositionXY = mz_PackSNorm16x2(X, Y);
+	OutVertex->PositionZW = mz_PackSNorm16x2(Z, Vertex.Tangent.w < 0.0f ? -1.0f : 1.0f);
+	OutVertex->Normal = mz_EncodeOctahedral(Vertex.Normal);
+	OutVertex->Tangent = mz_EncodeOctahedral(XMFLOAT3(Vertex.Tangent.x, Vertex.Tangent.y, Vertex.Tangent.z));
+	OutVertex->Texcoord = mz_FloatToHalf(Vertex.Texcoord.x) | (mz_FloatToHalf(Vertex.Texcoord.y) << 16);
+}
+
+void
+mz_DecodeCompactVertex(const mz_CompactVertex& Vertex, const mz_CompactMesh& Mesh, mz_Vertex* OutVertex)
+{
+	float X, Y, Z, W;
+	mz_UnpackSNorm16x2(Vertex.PositionXY, &X, &Y);
+	mz_UnpackSNorm16x2(Vertex.PositionZW, &Z, &W);
+
+	OutVertex->Position.x = Mesh.PositionCenter.x + Mesh.PositionExtent.x * X;
+	OutVertex->Position.y = Mesh.PositionCenter.y + Mesh.PositionExtent.y * Y;
+	OutVertex->Position.z = Mesh.PositionCenter.z + Mesh.PositionExtent.z * Z;
+	OutVertex->Normal = mz_DecodeOctahedral(Vertex.Normal);
+
+	XMFLOAT3 Tangent = mz_DecodeOctahedral(Vertex.Tangent);
+	OutVertex->Tangent = XMFLOAT4(Tangent.x, Tangent.y, Tangent.z, W < 0.0f ? -1.0f : 1.0f);
+	OutVertex->Texcoord = XMFLOAT2(mz_HalfToFloat(Vertex.Texcoord & 0xffff), mz_HalfToFloat(Vertex.Texcoord >> 16));
+}
+
+// Angle between A and normalized B, in degrees.
+static float
+mz_AngleDegrees(const XMFLOAT3& A, const XMFLOAT3& B)
+{
+	float Length = sqrtf(B.x * B.x + B.y * B.y + B.z * B.z);
+	if (Length == 0.0f)
+	{
+		return 0.0f;
+	}
+	float CosAngle = (A.x * B.x + A.y * B.y + A.z * B.z) / Length;
+	return acosf(fminf(fmaxf(CosAngle, -1.0f), 1.0f)) * (180.0f / 3.1415926f);
+}
 
-		char* C = strrchr(Path, '/');
-		mz_ASSERT(C);
-		*C = '\0';
+void
+mz_CompactSceneVertices(mz_SceneData* InOutScene)
+{
+	mz_ASSERT(InOutScene->CompactVertices.empty() && InOutScene->CompactMeshes.empty());
 
-		snprintf(Path, sizeof(Path), "%s/%s", Path, Image->uri);
+	const eastl::vector<mz_Vertex>& Vertices = InOutScene->Vertices;
+	InOutScene->CompactVertices.resize(Vertices.size());
+	InOutScene->CompactMeshes.resize(InOutScene->Meshes.size());
 
-		int Width, Height;
-		uint8_t* ImageData = stbi_load(Path, &Width, &Height, nullptr, 4);
-		mz_ASSERT(ImageData);
+	for (uint32_t MeshIdx = 0; MeshIdx < InOutScene->Meshes.size(); ++MeshIdx)
+	{
+		mz_Mesh* Mesh = &InOutScene->Meshes[MeshIdx];
+		const mz_MeshSection* Sections = mz_GetMeshSections(Mesh);
+		mz_CompactMesh* CompactMesh = &InOutScene->CompactMeshes[MeshIdx];
 
-		mz_DX12Resource* Texture = nullptr;
+		float BoundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float BoundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
 		{
-			auto Desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, (uint64_t)Width, (uint32_t)Height);
-			Texture = mz_CreateCommittedResource(Gfx, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr);
-			OutScene->Textures.push_back(Texture);
+			for (uint32_t Idx = 0; Idx < Sections[SectionIdx].NumVertices; ++Idx)
+			{
+				const XMFLOAT3& Position = Vertices[Sections[SectionIdx].BaseVertex + Idx].Position;
+				const float P[3] = { Position.x, Position.y, Position.z };
+				for (uint32_t Axis = 0; Axis < 3; ++Axis)
+				{
+					BoundsMin[Axis] = fminf(BoundsMin[Axis], P[Axis]);
+					BoundsMax[Axis] = fmaxf(BoundsMax[Axis], P[Axis]);
+				}
+			}
+		}
 
-			D3D12_CPU_DESCRIPTOR_HANDLE CPUHandle = mz_AllocateDescriptors(Gfx, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
-			Gfx->Device->CreateShaderResourceView(Texture->Raw, nullptr, CPUHandle);
-			OutScene->TextureSRVs.push_back(CPUHandle);
+		// NOTE: Flat axis still needs non-zero extent, positions on it decode exactly to the center.
+		float Center[3], Extent[3];
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			Center[Axis] = BoundsMin[Axis] <= BoundsMax[Axis] ? 0.5f * (BoundsMin[Axis] + BoundsMax[Axis]) : 0.0f;
+			Extent[Axis] = BoundsMin[Axis] < BoundsMax[Axis] ? 0.5f * (BoundsMax[Axis] - BoundsMin[Axis]) : 1.0f;
 		}
+		CompactMesh->PositionCenter = XMFLOAT3(Center[0], Center[1], Center[2]);
+		CompactMesh->PositionExtent = XMFLOAT3(Extent[0], Extent[1], Extent[2]);
 
+		mz_CompactVertexError Error = {};
+		uint32_t NumVertices = 0;
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
 		{
-			ID3D12Resource* UploadBuffer;
-			auto Desc = CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(Texture->Raw, 0, 1));
-			mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&UploadBuffer)));
-			OutTempResources->push_back(UploadBuffer);
+			for (uint32_t Idx = 0; Idx < Sections[SectionIdx].NumVertices; ++Idx)
+			{
+				uint32_t VertexIdx = Sections[SectionIdx].BaseVertex + Idx;
+				const mz_Vertex& Vertex = Vertices[VertexIdx];
+				mz_EncodeCompactVertex(Vertex, *CompactMesh, &InOutScene->CompactVertices[VertexIdx]);
+
+				mz_Vertex Decoded;
+				mz_DecodeCompactVertex(InOutScene->CompactVertices[VertexIdx], *CompactMesh, &Decoded);
+
+				float DX = Decoded.Position.x - Vertex.Position.x;
+				float DY = Decoded.Position.y - Vertex.Position.y;
+				float DZ = Decoded.Position.z - Vertex.Position.z;
+				float PositionError = sqrtf(DX * DX + DY * DY + DZ * DZ);
+				XMFLOAT3 Tangent(Vertex.Tangent.x, Vertex.Tangent.y, Vertex.Tangent.z);
+				XMFLOAT3 DecodedTangent(Decoded.Tangent.x, Decoded.Tangent.y, Decoded.Tangent.z);
+
+				Error.MaxPositionError = fmaxf(Error.MaxPositionError, PositionError);
+				Error.AveragePositionError += PositionError;
+				Error.MaxNormalError = fmaxf(Error.MaxNormalError, mz_AngleDegrees(Decoded.Normal, Vertex.Normal));
+				Error.MaxTangentError = fmaxf(Error.MaxTangentError, mz_AngleDegrees(DecodedTangent, Tangent));
+				Error.MaxTexcoordError = fmaxf(Error.MaxTexcoordError, fabsf(Decoded.Texcoord.x - Vertex.Texcoord.x));
+				Error.MaxTexcoordError = fmaxf(Error.MaxTexcoordError, fabsf(Decoded.Texcoord.y - Vertex.Texcoord.y));
+				NumVertices++;
+			}
+		}
+		Error.AveragePositionError /= eastl::max(NumVertices, 1u);
+		CompactMesh->Error = Error;
+	}
+
+	InOutScene->Vertices.clear();
+	InOutScene->Vertices.shrink_to_fit();
+}
+
+void
+mz_DecodeSceneVertices(mz_SceneData* InOutScene)
+{
+	mz_ASSERT(InOutScene->CompactMeshes.size() == InOutScene->Meshes.size());
+
+	InOutScene->Vertices.resize(InOutScene->CompactVertices.size());
+
+	for (uint32_t MeshIdx = 0; MeshIdx < InOutScene->Meshes.size(); ++MeshIdx)
+	{
+		mz_Mesh* Mesh = &InOutScene->Meshes[MeshIdx];
+		const mz_MeshSection* Sections = mz_GetMeshSections(Mesh);
 
-			D3D12_SUBRESOURCE_DATA SrcData = {};
-			SrcData.pData = ImageData;
-			SrcData.RowPitch = 4 * Width;
-			UpdateSubresources<1>(Gfx->CmdList, Texture->Raw, UploadBuffer, 0, 0, 1, &SrcData);
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
+		{
+			for (uint32_t Idx = 0; Idx < Sections[SectionIdx].NumVertices; ++Idx)
+			{
+				uint32_t VertexIdx = Sections[SectionIdx].BaseVertex + Idx;
+				mz_DecodeCompactVertex(InOutScene->CompactVertices[VertexIdx], InOutScene->CompactMeshes[MeshIdx], &InOutScene->Vertices[VertexIdx]);
+			}
 		}
+	}
+}
+
+#if !defined(mz_HEADLESS)
+// Records the upload on Gfx->CmdList, texture ends in NON_PIXEL_SHADER_RESOURCE state.
+static mz_DX12Resource*
+mz_CreateImageTexture(mz_GraphicsContext* Gfx, const mz_Image* Image)
+{
+	mz_ASSERT(Image->MipData);
+
+	static const DXGI_FORMAT Formats[] =
+	{
+		DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_BC5_UNORM, DXGI_FORMAT_BC7_UNORM,
+	};
+
+	mz_DX12Resource* Texture = nullptr;
+	{
+		auto Desc = CD3DX12_RESOURCE_DESC::Tex2D(Formats[Image->Format], (uint64_t)Image->Width, Image->Height, 1, (uint16_t)Image->NumMips);
+		Texture = mz_CreateCommittedResource(Gfx, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr);
+	}
 
-		mz_CmdTransitionBarrier(Gfx->CmdList, Texture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	{
+		mz_UploadAllocation Staging;
+		mz_AllocateUploadMemory(Gfx, GetRequiredIntermediateSize(Texture->Raw, 0, Image->NumMips), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, &Staging);
 
-		stbi_image_free(ImageData);
+		uint32_t BlockDim = Image->Format == mz_IMAGE_FORMAT_RGBA8 ? 1 : 4;
+		eastl::vector<D3D12_SUBRESOURCE_DATA> SrcData(Image->NumMips);
+		const uint8_t* Data = Image->MipData;
+		for (uint32_t MipIdx = 0; MipIdx < Image->NumMips; ++MipIdx)
+		{
+			uint32_t NumBlocksX = (eastl::max(Image->Width >> MipIdx, 1u) + BlockDim - 1) / BlockDim;
+			uint32_t NumBlocksY = (eastl::max(Image->Height >> MipIdx, 1u) + BlockDim - 1) / BlockDim;
+			SrcData[MipIdx].pData = Data;
+			SrcData[MipIdx].RowPitch = NumBlocksX * mz_GetBlockSize(Image->Format);
+			SrcData[MipIdx].SlicePitch = SrcData[MipIdx].RowPitch * NumBlocksY;
+			Data += SrcData[MipIdx].SlicePitch;
+		}
+		UpdateSubresources(Gfx->CmdList, Texture->Raw, Staging.Buffer, Staging.Offset, 0, Image->NumMips, SrcData.data());
 	}
 
-	cgltf_free(Data);
+	mz_CmdTransitionBarrier(Gfx->CmdList, Texture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	return Texture;
+}
+
+// NOTE: Pixels are in the upload buffer, GPU path does not need CPU copy.
+static void
+mz_FreeImageData(mz_Image* Image)
+{
+	stbi_image_free(Image->Pixels);
+	free(Image->MipData);
+	Image->Pixels = nullptr;
+	Image->MipData = nullptr;
+}
 
+static void
+mz_CreateSceneGeometryBuffers(mz_GraphicsContext* Gfx, mz_SceneData* OutScene)
+{
+#if mz_USE_COMPACT_VERTICES
+	const eastl::vector<mz_CompactVertex>& AllVertices = OutScene->CompactVertices;
+#else
+	const eastl::vector<mz_Vertex>& AllVertices = OutScene->Vertices;
+#endif
+	// NOTE: Raw buffer, sections mix 16-bit and 32-bit indices. Size is padded to whole 32-bit words.
+	const eastl::vector<uint8_t>& IndexData = OutScene->IndexData;
+	uint32_t IndexBufferSize = ((uint32_t)IndexData.size() + 3) & ~3u;
 
 	// Static geometry vertex buffer (single buffer for all static meshes).
 	{
-		ID3D12Resource* TempVertexBuffer;
-		D3D12_RESOURCE_DESC Desc = CD3DX12_RESOURCE_DESC::Buffer(AllVertices.size() * sizeof(mz_Vertex));
-		{
-			mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&TempVertexBuffer)));
-			OutTempResources->push_back(TempVertexBuffer);
+		uint64_t Size = AllVertices.size() * sizeof(AllVertices[0]);
+		D3D12_RESOURCE_DESC Desc = CD3DX12_RESOURCE_DESC::Buffer(Size);
 
-			void* Addr;
-			mz_VHR(TempVertexBuffer->Map(0, &CD3DX12_RANGE(0, 0), &Addr));
-			memcpy(Addr, AllVertices.data(), AllVertices.size() * sizeof(mz_Vertex));
-			TempVertexBuffer->Unmap(0, nullptr);
-		}
+		mz_UploadAllocation Staging;
+		mz_AllocateUploadMemory(Gfx, Size, 16, &Staging);
+		memcpy(Staging.CPUAddress, AllVertices.data(), Size);
 
 		OutScene->VertexBuffer = mz_CreateCommittedResource(Gfx, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr);
 
-		Gfx->CmdList->CopyResource(OutScene->VertexBuffer->Raw, TempVertexBuffer);
+		Gfx->CmdList->CopyBufferRegion(OutScene->VertexBuffer->Raw, 0, Staging.Buffer, Staging.Offset, Size);
 
 		mz_CmdTransitionBarrier(Gfx->CmdList, OutScene->VertexBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
@@ -1416,37 +3876,115 @@ mz_LoadGLTFScene(const char* FileName, mz_GraphicsContext* Gfx, mz_SceneData* Ou
 		SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
 		SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 		SRVDesc.Buffer.NumElements = (uint32_t)AllVertices.size();
-		SRVDesc.Buffer.StructureByteStride = sizeof(mz_Vertex);
+		SRVDesc.Buffer.StructureByteStride = sizeof(AllVertices[0]);
 		Gfx->Device->CreateShaderResourceView(OutScene->VertexBuffer->Raw, &SRVDesc, OutScene->VertexBufferSRV);
 	}
 
 	// Static geometry index buffer (single buffer for all static meshes).
 	{
-		ID3D12Resource* TempIndexBuffer;
-		D3D12_RESOURCE_DESC Desc = CD3DX12_RESOURCE_DESC::Buffer(AllIndices.size() * sizeof(uint32_t));
-		{
-			mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&TempIndexBuffer)));
-			OutTempResources->push_back(TempIndexBuffer);
+		D3D12_RESOURCE_DESC Desc = CD3DX12_RESOURCE_DESC::Buffer(IndexBufferSize);
 
-			void* Addr;
-			mz_VHR(TempIndexBuffer->Map(0, &CD3DX12_RANGE(0, 0), &Addr));
-			memcpy(Addr, AllIndices.data(), AllIndices.size() * sizeof(uint32_t));
-			TempIndexBuffer->Unmap(0, nullptr);
-		}
+		mz_UploadAllocation Staging;
+		mz_AllocateUploadMemory(Gfx, IndexBufferSize, 16, &Staging);
+		memcpy(Staging.CPUAddress, IndexData.data(), IndexData.size());
+		memset(Staging.CPUAddress + IndexData.size(), 0, IndexBufferSize - IndexData.size());
 
 		OutScene->IndexBuffer = mz_CreateCommittedResource(Gfx, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr);
 
-		Gfx->CmdList->CopyResource(OutScene->IndexBuffer->Raw, TempIndexBuffer);
+		Gfx->CmdList->CopyBufferRegion(OutScene->IndexBuffer->Raw, 0, Staging.Buffer, Staging.Offset, IndexBufferSize);
 
 		mz_CmdTransitionBarrier(Gfx->CmdList, OutScene->IndexBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
 		OutScene->IndexBufferSRV = mz_AllocateDescriptors(Gfx, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
 
 		D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
-		SRVDesc.Format = DXGI_FORMAT_R32G32B32_UINT;
+		SRVDesc.Format = DXGI_FORMAT_R32_TYPELESS;
 		SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
 		SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		SRVDesc.Buffer.NumElements = (uint32_t)AllIndices.size() / 3;
+		SRVDesc.Buffer.NumElements = IndexBufferSize / 4;
+		SRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
 		Gfx->Device->CreateShaderResourceView(OutScene->IndexBuffer->Raw, &SRVDesc, OutScene->IndexBufferSRV);
 	}
 }
+
+#define mz_GPU_SCENE_LOAD_FLAGS (mz_SCENE_LOAD_COMPRESS_TEXTURES | (mz_USE_COMPACT_VERTICES ? mz_SCENE_LOAD_COMPACT_VERTICES : 0))
+
+void
+mz_LoadGLTFScene(const char* FileName, mz_GraphicsContext* Gfx, mz_SceneData* OutScene)
+{
+	mz_ASSERT(OutScene->Textures.empty() && OutScene->TextureSRVs.empty());
+
+	mz_LoadGLTFSceneData(FileName, mz_GPU_SCENE_LOAD_FLAGS, OutScene);
+
+	for (uint32_t ImageIdx = 0; ImageIdx < OutScene->Images.size(); ++ImageIdx)
+	{
+		mz_Image* Image = &OutScene->Images[ImageIdx];
+
+		mz_DX12Resource* Texture = mz_CreateImageTexture(Gfx, Image);
+		OutScene->Textures.push_back(Texture->Handle);
+
+		D3D12_CPU_DESCRIPTOR_HANDLE CPUHandle = mz_AllocateDescriptors(Gfx, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
+		Gfx->Device->CreateShaderResourceView(Texture->Raw, nullptr, CPUHandle);
+		OutScene->TextureSRVs.push_back(CPUHandle);
+
+		mz_FreeImageData(Image);
+	}
+
+	mz_CreateSceneGeometryBuffers(Gfx, OutScene);
+}
+
+// NOTE: Large enough for a few 2k BC7 mip chains, small enough to not cause a visible hitch.
+#define mz_STREAMING_UPLOAD_BUDGET (32 * 1024 * 1024)
+
+mz_SceneStreamer*
+mz_BeginStreamingGLTFScene(const char* FileName, mz_GraphicsContext* Gfx, mz_SceneData* OutScene)
+{
+	mz_ASSERT(OutScene->Textures.empty() && OutScene->TextureSRVs.empty());
+
+	mz_SceneStreamer* Streamer = mz_BeginStreamingGLTFSceneData(FileName, mz_GPU_SCENE_LOAD_FLAGS, OutScene);
+
+	// NOTE: Placeholders of one role are identical, images of the role share one texture until they arrive.
+	mz_DX12Resource* Placeholders[3] = {};
+	for (uint32_t ImageIdx = 0; ImageIdx < OutScene->Images.size(); ++ImageIdx)
+	{
+		mz_Image* Image = &OutScene->Images[ImageIdx];
+		mz_TextureRole Role = Streamer->Roles[ImageIdx];
+		if (!Placeholders[Role])
+		{
+			Placeholders[Role] = mz_CreateImageTexture(Gfx, Image);
+		}
+		OutScene->Textures.push_back(Placeholders[Role]->Handle);
+
+		D3D12_CPU_DESCRIPTOR_HANDLE CPUHandle = mz_AllocateDescriptors(Gfx, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
+		Gfx->Device->CreateShaderResourceView(Placeholders[Role]->Raw, nullptr, CPUHandle);
+		OutScene->TextureSRVs.push_back(CPUHandle);
+
+		mz_FreeImageData(Image);
+	}
+
+	mz_CreateSceneGeometryBuffers(Gfx, OutScene);
+	return Streamer;
+}
+
+void
+mz_UpdateStreamedScene(mz_SceneStreamer* Streamer, mz_GraphicsContext* Gfx, mz_SceneData* InOutScene, mz_SceneTables* InOutTables)
+{
+	size_t NumUploadedBytes = 0;
+	uint32_t ImageIdx;
+	while (NumUploadedBytes < mz_STREAMING_UPLOAD_BUDGET && mz_UpdateStreamedImages(Streamer, InOutScene, &ImageIdx, 1) == 1)
+	{
+		mz_Image* Image = &InOutScene->Images[ImageIdx];
+
+		mz_DX12Resource* Texture = mz_CreateImageTexture(Gfx, Image);
+
+		// NOTE: Each GPU heap copies the descriptor when its frame replays the change, so frames in flight keep
+		// the placeholder.
+		InOutScene->Textures[ImageIdx] = Texture->Handle;
+		Gfx->Device->CreateShaderResourceView(Texture->Raw, nullptr, InOutScene->TextureSRVs[ImageIdx]);
+		mz_MarkImageChanged(InOutTables, ImageIdx);
+
+		NumUploadedBytes += Image->MipDataSize;
+		mz_FreeImageData(Image);
+	}
+}
+#endif // !mz_HEADLESS
@@ -1,18 +1,39 @@
 #pragma once
 
 #include <stdint.h>
-#include <dxgi1_4.h>
-#include <d3d12.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
 #include "EASTL/vector.h"
 #include "EASTL/hash_map.h"
-#include "DirectXMath/DirectXMath.h"
+#include "CPUAndGPUCommon.h"
+
+// NOTE: mz_HEADLESS builds contain only platform-neutral code (scene loading, CPU raytracing). No D3D12, no window.
+#if !defined(_WIN32) && !defined(mz_HEADLESS)
+#define mz_HEADLESS
+#endif
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+#if !defined(mz_HEADLESS)
+#include <dxgi1_4.h>
+#include <d3d12.h>
 #include "d3dx12.h"
-using namespace DirectX;
+#endif
 
-#define mz_ASSERT(Expression) { if (!(Expression)) __debugbreak(); }
+#if defined(_WIN32)
+#define mz_DEBUGBREAK() __debugbreak()
+#else
+#define mz_DEBUGBREAK() __builtin_trap()
+#define MAX_PATH 260
+#endif
+
+#define mz_ASSERT(Expression) { if (!(Expression)) mz_DEBUGBREAK(); }
 #define mz_VHR(hr) if (FAILED(hr)) { mz_ASSERT(0); }
 #define mz_SAFE_RELEASE(obj) if ((obj)) { (obj)->Release(); (obj) = nullptr; }
 
+#if defined(_WIN32)
 #ifdef _DEBUG
 #define mz_MALLOC_ALIGNED_OFFSET(Size, Alignment, Offset) _aligned_offset_malloc_dbg((Size), (Alignment), (Offset), __FILE__, __LINE__)
 #define mz_FREE(Addr) if ((Addr)) { _aligned_free_dbg((Addr)); }
@@ -20,16 +41,145 @@ using namespace DirectX;
 #define mz_MALLOC_ALIGNED_OFFSET(Size, Alignment, Offset) _aligned_offset_malloc((Size), (Alignment), (Offset))
 #define mz_FREE(Addr) if ((Addr)) { _aligned_free_dbg((Addr)); }
 #endif
+#else
+void* mz_AlignedOffsetMalloc(size_t Size, size_t Alignment, size_t Offset);
+void mz_AlignedFree(void* Addr);
+#define mz_MALLOC_ALIGNED_OFFSET(Size, Alignment, Offset) mz_AlignedOffsetMalloc((Size), (Alignment), (Offset))
+#define mz_FREE(Addr) if ((Addr)) { mz_AlignedFree((Addr)); }
+#endif
 #define mz_MALLOC_ALIGNED(Size, Alignment) mz_MALLOC_ALIGNED_OFFSET((Size), (Alignment), 0)
-#define mz_MALLOC(Size) mz_MALLOC_ALIGNED((Size), 8)
+#define mz_MALLOC(Size) mz_MALLOC_ALIGNED((Size), 16) // EASTL expects at least EA_PLATFORM_MIN_MALLOC_ALIGNMENT (16 on x64).
+
+//
+// Arenas.
+//
+// Linear allocator: allocation bumps an offset, memory is released all at once (mz_ResetArena) or back to a marker.
+// Blocks are kept after reset, so an arena that is reset every frame stops calling malloc once it has grown to its
+// working size. Not thread safe.
+struct mz_ArenaBlock;
+
+struct mz_Arena
+{
+	mz_ArenaBlock* FirstBlock;
+	mz_ArenaBlock* Block; // Current one, earlier blocks are full.
+	size_t Offset; // Into the current block.
+	size_t BlockSize; // Of new blocks, bigger allocations get a block of their own size.
+};
+
+struct mz_ArenaMarker
+{
+	mz_ArenaBlock* Block;
+	size_t Offset;
+};
+
+void mz_InitArena(mz_Arena* OutArena, size_t BlockSize);
+void mz_DestroyArena(mz_Arena* Arena);
+void* mz_AllocateFromArena(mz_Arena* Arena, size_t Size, size_t Alignment);
+void mz_FreeToArena(mz_Arena* Arena, void* Addr, size_t Size); // Reclaims memory only of the last allocation.
+void mz_ResetArena(mz_Arena* Arena);
+mz_ArenaMarker mz_GetArenaMarker(const mz_Arena* Arena);
+void mz_ResetArenaToMarker(mz_Arena* Arena, const mz_ArenaMarker& Marker); // Frees everything allocated after the marker.
+
+// EASTL allocator for temporary containers, they must be destroyed before the arena is reset.
+struct mz_ArenaAllocator
+{
+	explicit mz_ArenaAllocator(const char* /*Name*/) : Arena(nullptr) {}
+	explicit mz_ArenaAllocator(mz_Arena* InArena) : Arena(InArena) {}
+
+	void* allocate(size_t Size) { return mz_AllocateFromArena(Arena, Size, 16); }
+	void* allocate(size_t Size, int /*Flags*/) { return mz_AllocateFromArena(Arena, Size, 16); }
+	void* allocate(size_t Size, size_t Alignment, size_t Offset) { mz_ASSERT(Offset == 0); return mz_AllocateFromArena(Arena, Size, Alignment); }
+	void* allocate(size_t Size, size_t Alignment, size_t Offset, int /*Flags*/) { return allocate(Size, Alignment, Offset); }
+	void deallocate(void* Addr, size_t Size) { mz_FreeToArena(Arena, Addr, Size); }
+	const char* get_name() const { return "mz_ArenaAllocator"; }
+	void set_name(const char* /*Name*/) {}
+
+	mz_Arena* Arena;
+};
+
+inline bool operator==(const mz_ArenaAllocator& A, const mz_ArenaAllocator& B) { return A.Arena == B.Arena; }
+inline bool operator!=(const mz_ArenaAllocator& A, const mz_ArenaAllocator& B) { return A.Arena != B.Arena; }
+
+//
+// Handle pools.
+//
+// Fixed size items stored in chunks which never move, so pointers to items stay valid while the pool grows. Free slots
+// form a list (allocation and release are O(1)). Handle is 32 bits: slot index in the low 20 bits, slot generation in
+// the high 12 bits. Generation changes every time the slot is released, so a stale handle is detected instead of
+// reaching a new item. Slot whose generation would wrap is retired. Handle 0 is never returned. Not thread safe.
+typedef uint32_t mz_Handle;
+
+#define mz_HANDLE_INDEX_BITS 20
+#define mz_HANDLE_MAX_GENERATION ((1u << (32 - mz_HANDLE_INDEX_BITS)) - 1)
+
+struct mz_HandleSlot
+{
+	uint32_t NextFree; // Valid only when the slot is free.
+	uint16_t Generation; // 1 to mz_HANDLE_MAX_GENERATION.
+	bool bIsLive;
+};
+
+struct mz_HandlePool
+{
+	eastl::vector<uint8_t*> Chunks;
+	eastl::vector<mz_HandleSlot> Slots;
+	uint32_t ItemSize;
+	uint32_t ChunkShift; // log2 of items per chunk.
+	uint32_t FirstFree; // ~0 when every slot is live (or retired).
+	uint32_t NumLive;
+};
+
+void mz_InitHandlePool(mz_HandlePool* OutPool, uint32_t ItemSize, uint32_t NumItemsPerChunk); // NumItemsPerChunk is a power of 2.
+void mz_DestroyHandlePool(mz_HandlePool* Pool);
+// Item is zeroed.
+mz_Handle mz_AllocateHandle(mz_HandlePool* Pool, void** OutItem);
+void mz_FreeHandle(mz_HandlePool* Pool, mz_Handle Handle); // Debug builds fill the item with garbage.
+bool mz_IsHandleValid(const mz_HandlePool* Pool, mz_Handle Handle);
+// Debug builds break on a stale or invalid handle.
+void* mz_GetHandleItem(const mz_HandlePool* Pool, mz_Handle Handle);
+// For walking all items: slot indices go from 0 to Slots.size(), returns null for free slots.
+void* mz_GetLiveSlotItem(const mz_HandlePool* Pool, uint32_t SlotIdx);
+
+//
+// Upload rings.
+//
+// Byte ring for staging memory read by the GPU. Allocations are contiguous, one which would cross the end starts at 0
+// and the skipped tail is freed together with it. mz_SubmitUploadRing closes allocations made so far under a fence
+// value and mz_RetireUploadRing frees every closed batch whose fence value was reached. Fence is just a number here, so
+// the ring is platform neutral. Not thread safe.
+struct mz_UploadRingSubmission
+{
+	uint64_t FenceValue;
+	uint64_t Head; // Allocations before it belong to the submission.
+};
+
+struct mz_UploadRing
+{
+	uint64_t Capacity; // In bytes.
+	uint64_t Head; // Bytes allocated since init (including skipped tails), Head % Capacity is the next free byte.
+	uint64_t Tail; // Bytes retired since init.
+	eastl::vector<mz_UploadRingSubmission> Submissions; // Oldest first, not retired yet.
+};
+
+void mz_InitUploadRing(mz_UploadRing* OutRing, uint64_t Capacity);
+// Returns false when free space is too small (caller retires, waits for mz_GetOldestUploadRingFence or allocates
+// elsewhere). Capacity has to be a multiple of Alignment.
+bool mz_AllocateFromUploadRing(mz_UploadRing* Ring, uint64_t Size, uint64_t Alignment, uint64_t* OutOffset);
+void mz_SubmitUploadRing(mz_UploadRing* Ring, uint64_t FenceValue);
+void mz_RetireUploadRing(mz_UploadRing* Ring, uint64_t CompletedFenceValue);
+// Fence value which frees the oldest submitted memory, 0 when nothing is in flight.
+uint64_t mz_GetOldestUploadRingFence(const mz_UploadRing* Ring);
 
 struct mz_MeshSection
 {
 	uint32_t NumVertices;
 	uint32_t BaseVertex;
 	uint32_t NumIndices;
-	uint32_t BaseIndex;
+	uint32_t IndexOffset; // In bytes, into mz_SceneData::IndexData (multiple of IndexSize).
 	uint16_t MaterialIndex;
+	uint8_t IndexSize; // 2 when NumVertices fits in 16 bits, 4 otherwise. Indices are relative to BaseVertex.
+	uint32_t FirstMeshlet; // Into mz_SceneData::Meshlets, only with mz_SCENE_LOAD_BUILD_MESHLETS.
+	uint32_t NumMeshlets;
 };
 
 struct mz_Mesh
@@ -58,17 +208,40 @@ struct mz_Object
 	XMFLOAT3X4 ObjectToWorld;
 };
 
+enum mz_ImageFormat
+{
+	mz_IMAGE_FORMAT_RGBA8, // Also used when size is not a multiple of 4.
+	mz_IMAGE_FORMAT_BC1, // Opaque base color.
+	mz_IMAGE_FORMAT_BC3, // Base color with alpha.
+	mz_IMAGE_FORMAT_BC5, // Normal map (XY, Z is reconstructed in the shader).
+	mz_IMAGE_FORMAT_BC7, // Occlusion/roughness/metallic.
+};
+
+struct mz_Image
+{
+	uint8_t* Pixels; // R8G8B8A8, tightly packed. Null when the image was loaded for GPU (MipData).
+	uint32_t Width;
+	uint32_t Height;
+	mz_ImageFormat Format; // Format of MipData.
+	uint32_t NumMips;
+	uint8_t* MipData; // All mip levels, mip 0 first, tightly packed (rows of 4x4 blocks for BC formats).
+	size_t MipDataSize;
+};
+
+#if !defined(mz_HEADLESS)
 struct mz_DX12Resource
 {
 	ID3D12Resource* Raw;
 	D3D12_RESOURCE_STATES State;
 	DXGI_FORMAT Format;
+	mz_Handle Handle; // In mz_GraphicsContext::ResourcePool.
 };
 
 struct mz_DX12PipelineState
 {
 	ID3D12PipelineState* PSO;
 	ID3D12RootSignature* RS;
+	mz_Handle Handle; // In mz_GraphicsContext::PipelinePool.
 };
 
 struct mz_DescriptorHeap
@@ -80,28 +253,99 @@ struct mz_DescriptorHeap
 	uint32_t Capacity;
 };
 
-struct mz_GPUMemoryHeap
+// Staging memory valid until the GPU finishes commands recorded in the current frame (see mz_AllocateUploadMemory).
+struct mz_UploadAllocation
 {
-	ID3D12Resource* Heap;
-	uint8_t* CPUStart;
-	D3D12_GPU_VIRTUAL_ADDRESS GPUStart;
-	uint32_t Size;
-	uint32_t Capacity;
+	ID3D12Resource* Buffer; // Ring buffer or a dedicated one for big allocations, CPU address stays mapped.
+	uint64_t Offset; // Into Buffer.
+	uint8_t* CPUAddress;
+	D3D12_GPU_VIRTUAL_ADDRESS GPUAddress;
+};
+
+#endif // !mz_HEADLESS
+
+struct mz_CompactVertexError
+{
+	float MaxPositionError; // Object space distance.
+	float AveragePositionError;
+	float MaxNormalError; // Degrees.
+	float MaxTangentError; // Degrees.
+	float MaxTexcoordError;
+};
+
+struct mz_CompactMesh
+{
+	XMFLOAT3 PositionCenter;
+	XMFLOAT3 PositionExtent; // Half size of the mesh bounds.
+	mz_CompactVertexError Error; // Of all vertices of the mesh, measured at encode time.
+};
+
+#define mz_MESHLET_MAX_VERTICES 64
+#define mz_MESHLET_MAX_TRIANGLES 124
+
+// Cluster of neighbouring triangles of one mz_MeshSection (see mz_BuildSceneMeshlets). Bounds are in object space.
+struct mz_Meshlet
+{
+	XMFLOAT3 BoundsCenter;
+	float BoundsRadius;
+	XMFLOAT3 BoundsMin;
+	uint32_t FirstVertex; // Into mz_SceneData::MeshletVertices.
+	XMFLOAT3 BoundsMax;
+	uint32_t FirstTriangle; // Into mz_SceneData::MeshletTriangles, 3 bytes per triangle.
+	XMFLOAT3 ConeApex;
+	float ConeCutoff; // 1 when normals are spread too much to ever cull (see mz_IsMeshletBackFacing).
+	XMFLOAT3 ConeAxis;
+	uint8_t NumVertices;
+	uint8_t NumTriangles;
+};
+
+// Simplified versions of one mz_Mesh (see mz_GenerateSceneLODs). Level 0 is the mesh itself, levels 1..NumLODs are
+// LODMeshes[FirstLOD..FirstLOD + NumLODs), each coarser than the previous one.
+struct mz_MeshLODChain
+{
+	XMFLOAT3 BoundsCenter; // Object space bounding sphere of the mesh.
+	float BoundsRadius;
+	uint32_t FirstLOD;
+	uint32_t NumLODs;
+};
+
+struct mz_MappedFile
+{
+	const uint8_t* Data;
+	size_t Size;
+#if defined(_WIN32)
+	HANDLE File;
+	HANDLE Mapping;
+#endif
 };
 
 struct mz_SceneData
 {
+	eastl::vector<mz_Vertex> Vertices;
+	eastl::vector<uint8_t> IndexData; // 16-bit or 32-bit indices of every section, see mz_GetIndex.
+	eastl::vector<mz_Mesh> Meshes;
+	eastl::vector<mz_Material> Materials;
+	eastl::vector<mz_Object> Objects;
+	eastl::vector<mz_Image> Images;
+	eastl::vector<mz_CompactVertex> CompactVertices; // Only with mz_SCENE_LOAD_COMPACT_VERTICES, Vertices are empty then.
+	eastl::vector<mz_CompactMesh> CompactMeshes; // One per mesh.
+	eastl::vector<mz_MeshLODChain> MeshLODChains; // One per mesh, only with mz_SCENE_LOAD_GENERATE_LODS.
+	eastl::vector<mz_Mesh> LODMeshes; // Sections index Vertices of the source mesh, only indices are new.
+	eastl::vector<float> LODErrors; // Per LODMeshes entry, object space distance from the full resolution surface.
+	eastl::vector<mz_Meshlet> Meshlets; // Of all sections of Meshes and LODMeshes, only with mz_SCENE_LOAD_BUILD_MESHLETS.
+	eastl::vector<uint32_t> MeshletVertices; // Relative to BaseVertex of the section.
+	eastl::vector<uint8_t> MeshletTriangles; // Triangle corners, index into vertices of the meshlet.
+#if !defined(mz_HEADLESS)
 	mz_DX12Resource* VertexBuffer;
 	mz_DX12Resource* IndexBuffer;
 	D3D12_CPU_DESCRIPTOR_HANDLE VertexBufferSRV;
 	D3D12_CPU_DESCRIPTOR_HANDLE IndexBufferSRV;
-	eastl::vector<mz_Mesh> Meshes;
-	eastl::vector<mz_Material> Materials;
-	eastl::vector<mz_Object> Objects;
-	eastl::vector<mz_DX12Resource*> Textures;
+	eastl::vector<mz_Handle> Textures; // In mz_GraphicsContext::ResourcePool, placeholders are shared by many images.
 	eastl::vector<D3D12_CPU_DESCRIPTOR_HANDLE> TextureSRVs;
+#endif
 };
 
+#if !defined(mz_HEADLESS)
 struct mz_GraphicsContext
 {
 	ID3D12Device6* Device;
@@ -120,15 +364,21 @@ struct mz_GraphicsContext
 	mz_DescriptorHeap DSVHeap;
 	mz_DescriptorHeap CPUDescriptorHeap;
 	mz_DescriptorHeap GPUDescriptorHeaps[2];
-	mz_GPUMemoryHeap GPUUploadMemoryHeaps[2];
-	mz_DX12Resource* Resources;
-	mz_DX12PipelineState* Pipelines;
-	eastl::hash_map<uint64_t, mz_DX12PipelineState*> GraphicsPipelinesMap;
-	eastl::hash_map<uint64_t, mz_DX12PipelineState*> ComputePipelinesMap;
+	mz_UploadRing UploadRing; // Submitted with NumFrames by mz_PresentFrame and mz_WaitForGPU.
+	ID3D12Resource* UploadRingBuffer;
+	uint8_t* UploadRingCPUStart;
+	D3D12_GPU_VIRTUAL_ADDRESS UploadRingGPUStart;
+	eastl::vector<ID3D12Resource*> PendingUploadBuffers; // Dedicated ones, released when FrameFence reaches the value.
+	eastl::vector<uint64_t> PendingUploadFenceValues;
+	mz_HandlePool ResourcePool; // mz_DX12Resource items, released by mz_ReleaseResource.
+	mz_HandlePool PipelinePool; // mz_DX12PipelineState items.
+	eastl::hash_map<uint64_t, mz_Handle> GraphicsPipelinesMap; // Entries of released pipelines are dropped on lookup.
+	eastl::hash_map<uint64_t, mz_Handle> ComputePipelinesMap;
 	ID3D12Fence* FrameFence;
 	HANDLE FrameFenceEvent;
 	uint64_t NumFrames;
 	HWND Window;
+	mz_Arena FrameArena; // CPU memory for temporary data of one frame, reset by mz_PresentFrame.
 };
 
 //
@@ -139,6 +389,8 @@ void mz_DestroyGraphicsContext(mz_GraphicsContext* Gfx);
 mz_DescriptorHeap* mz_GetDescriptorHeap(mz_GraphicsContext* Gfx, D3D12_DESCRIPTOR_HEAP_TYPE Type, D3D12_DESCRIPTOR_HEAP_FLAGS Flags, uint32_t* OutDescriptorSize);
 void mz_PresentFrame(mz_GraphicsContext* Gfx, uint32_t SwapInterval);
 void mz_WaitForGPU(mz_GraphicsContext* Gfx);
+// Never fails: waits for the GPU when the ring is full, too big allocations get a dedicated upload buffer.
+void mz_AllocateUploadMemory(mz_GraphicsContext* Gfx, uint64_t Size, uint64_t Alignment, mz_UploadAllocation* OutAllocation);
 mz_DX12Resource* mz_AddDX12Resource(mz_GraphicsContext* Gfx, ID3D12Resource* RawResource, D3D12_RESOURCE_STATES InitialState, DXGI_FORMAT Format);
 mz_DX12Resource* mz_CreateCommittedResource(mz_GraphicsContext* Gfx, D3D12_HEAP_TYPE HeapType, D3D12_HEAP_FLAGS HeapFlags, D3D12_RESOURCE_DESC* Desc, D3D12_RESOURCE_STATES InitialState, D3D12_CLEAR_VALUE* ClearValue);
 mz_DX12PipelineState* mz_CreateGraphicsPipelineState(mz_GraphicsContext* Gfx, D3D12_GRAPHICS_PIPELINE_STATE_DESC* PSODesc, const char* VSName, const char* PSName);
@@ -149,35 +401,158 @@ mz_DX12PipelineState* mz_CreateComputePipelineState(mz_GraphicsContext* Gfx, D3D
 //
 struct mz_MipmapGenerator;
 mz_MipmapGenerator* mz_CreateMipmapGenerator(mz_GraphicsContext* Gfx, DXGI_FORMAT Format);
-void mz_DestroyMipmapGenerator(mz_MipmapGenerator* Generator);
+void mz_DestroyMipmapGenerator(mz_MipmapGenerator* Generator, mz_GraphicsContext* Gfx);
 void mz_GenerateMipmaps(mz_MipmapGenerator* Generator, mz_GraphicsContext* Gfx, mz_DX12Resource* Texture);
 
 //
 // UI.
 //
 struct mz_UIContext;
-mz_UIContext* mz_CreateUIContext(mz_GraphicsContext* Gfx, uint32_t NumSamples, eastl::vector<ID3D12Resource*>* OutTempResources);
+mz_UIContext* mz_CreateUIContext(mz_GraphicsContext* Gfx, uint32_t NumSamples);
 void mz_DestroyUIContext(mz_UIContext* UI);
 void mz_UpdateUI(float DeltaTime);
 void mz_DrawUI(mz_UIContext* UI, mz_GraphicsContext* Gfx);
+#endif // !mz_HEADLESS
 
 //
 // GLTF.
 //
-void mz_LoadGLTFScene(const char* FileName, mz_GraphicsContext* Gfx, mz_SceneData* OutScene, eastl::vector<ID3D12Resource*>* OutTempResources);
+enum mz_SceneLoadFlags
+{
+	mz_SCENE_LOAD_COMPRESS_TEXTURES = 0x1, // Full mip chain, BC compressed when possible (cached as <image>.cache), no Pixels.
+	mz_SCENE_LOAD_COMPACT_VERTICES = 0x2, // CompactVertices instead of Vertices (see mz_CompactSceneVertices).
+	mz_SCENE_LOAD_SKIP_MESH_OPTIMIZATION = 0x4, // Keep glTF vertices and triangle order (see mz_OptimizeSceneMeshes), bypasses scene cache.
+	mz_SCENE_LOAD_GENERATE_LODS = 0x8, // Fills MeshLODChains, LODMeshes and LODErrors (cached on disk).
+	mz_SCENE_LOAD_BUILD_MESHLETS = 0x10, // Fills Meshlets, MeshletVertices and MeshletTriangles (cached on disk).
+};
+
+// Unless mz_SCENE_LOAD_SKIP_MESH_OPTIMIZATION is set, the converted scene is cached next to FileName as
+// <FileName>.cache and mapped on later runs. Cache is keyed by sizes and modification times of the glTF file and its
+// buffers, contents are hashed only when those differ, so it is rebuilt whenever a source changes. It is also rebuilt
+// when it lacks LODs or meshlets that Flags request (or has ones they don't). Sources are mapped, not copied, and
+// unmapped after conversion. Images are not part of the scene cache.
+void mz_LoadGLTFSceneData(const char* FileName, uint32_t Flags, mz_SceneData* OutScene);
+void mz_DestroySceneData(mz_SceneData* Scene);
+#if !defined(mz_HEADLESS)
+void mz_LoadGLTFScene(const char* FileName, mz_GraphicsContext* Gfx, mz_SceneData* OutScene);
+#endif
+
+//
+// Streaming.
+//
+// Geometry and materials are loaded before Begin returns, every image starts as 1x1 placeholder and is replaced when
+// background threads finish decoding it (smallest files first). Scene must not be destroyed before mz_EndStreaming.
+struct mz_SceneStreamer;
+struct mz_SceneTables;
+
+mz_SceneStreamer* mz_BeginStreamingGLTFSceneData(const char* FileName, uint32_t Flags, mz_SceneData* OutScene);
+// Replaces placeholders of at most MaxImages decoded images, returns their number (indices go to OutImageIndices).
+uint32_t mz_UpdateStreamedImages(mz_SceneStreamer* Streamer, mz_SceneData* InOutScene, uint32_t* OutImageIndices, uint32_t MaxImages);
+uint32_t mz_GetNumPendingImages(const mz_SceneStreamer* Streamer); // Not yet taken by mz_UpdateStreamedImages.
+// Stops decoding (images still pending stay placeholders) and frees the streamer.
+void mz_EndStreaming(mz_SceneStreamer* Streamer);
+#if !defined(mz_HEADLESS)
+// Placeholder textures are shared, TextureSRVs are final descriptors (rewritten in place when real texture arrives).
+mz_SceneStreamer* mz_BeginStreamingGLTFScene(const char* FileName, mz_GraphicsContext* Gfx, mz_SceneData* OutScene);
+// Records uploads of arrived textures (within per frame budget) on Gfx->CmdList and marks their images changed in
+// InOutTables, call before the scene is used in the frame.
+void mz_UpdateStreamedScene(mz_SceneStreamer* Streamer, mz_GraphicsContext* Gfx, mz_SceneData* InOutScene, mz_SceneTables* InOutTables);
+#endif
+
+//
+// Mesh indices.
+//
+// Appends indices (relative to InOutSection->BaseVertex) as 16-bit when InOutSection->NumVertices allows it, fills
+// NumIndices, IndexOffset and IndexSize.
+void mz_AppendSectionIndices(const uint32_t* Indices, uint32_t NumIndices, mz_MeshSection* InOutSection, eastl::vector<uint8_t>* InOutIndexData);
+void mz_GetSectionIndices(const mz_SceneData* Scene, const mz_MeshSection& Section, uint32_t* OutIndices); // Widened to 32 bits.
+uint32_t mz_GetNumTriangles(const mz_SceneData* Scene);
+
+//
+// Mesh LODs.
+//
+// Coarsest level whose error, projected to the screen, is at most MaxPixelError. ErrorToPixels converts error at unit
+// distance to pixels: ScreenHeight / (2 * tan(FovY / 2)). Returns 0 when the scene has no LODs.
+uint32_t mz_SelectMeshLOD(const mz_SceneData* Scene, uint32_t MeshIdx, const XMFLOAT3X4& ObjectToWorld, const XMFLOAT3& CameraPosition, float ErrorToPixels, float MaxPixelError);
+mz_Mesh* mz_GetMeshLOD(mz_SceneData* Scene, uint32_t MeshIdx, uint32_t Level);
+
+//
+// Meshlets.
+//
+// True when every triangle of the meshlet faces away from Eye (object space), so that rays from Eye with
+// RAY_FLAG_CULL_BACK_FACING_TRIANGLES can't hit it.
+inline bool
+mz_IsMeshletBackFacing(const mz_Meshlet& Meshlet, const XMFLOAT3& Eye)
+{
+	if (Meshlet.ConeCutoff >= 1.0f)
+	{
+		return false;
+	}
+	float D[3] = { Meshlet.ConeApex.x - Eye.x, Meshlet.ConeApex.y - Eye.y, Meshlet.ConeApex.z - Eye.z };
+	float Dot = D[0] * Meshlet.ConeAxis.x + D[1] * Meshlet.ConeAxis.y + D[2] * Meshlet.ConeAxis.z;
+	return Dot >= Meshlet.ConeCutoff * sqrtf(D[0] * D[0] + D[1] * D[1] + D[2] * D[2]);
+}
+
+//
+// PLY.
+//
+void mz_LoadPLYMeshData(const char* FileName, const XMFLOAT3X4& ObjectToWorld, mz_SceneData* InOutScene); // Appends one mesh, one object and a default material.
+
+//
+// Compact vertices.
+//
+void mz_EncodeCompactVertex(const mz_Vertex& Vertex, const mz_CompactMesh& Mesh, mz_CompactVertex* OutVertex);
+void mz_DecodeCompactVertex(const mz_CompactVertex& Vertex, const mz_CompactMesh& Mesh, mz_Vertex* OutVertex);
+void mz_CompactSceneVertices(mz_SceneData* InOutScene); // Replaces Vertices with CompactVertices, fills CompactMeshes.
+void mz_DecodeSceneVertices(mz_SceneData* InOutScene); // Rebuilds Vertices from CompactVertices (e.g. for the CPU renderer).
+
+//
+// Jobs.
+//
+// Fixed pool of threads, each with its own queue of jobs, idle threads steal the oldest jobs of others. Waiting for a
+// counter runs other jobs meanwhile, so a job can submit more jobs and wait for them. Without mz_InitJobSystem jobs run
+// immediately on the calling thread.
+struct mz_JobCounter
+{
+	std::atomic<uint32_t> NumJobs; // Submitted and not yet finished.
+};
+
+struct mz_Job
+{
+	void (*Function)(void* Data, uint32_t Begin, uint32_t End);
+	void* Data;
+	uint32_t Begin;
+	uint32_t End;
+	uint32_t Granularity; // Bigger ranges are split in halves so that other threads can steal them (0 - never split).
+	mz_JobCounter* Counter; // Can be null.
+};
+
+void mz_InitJobSystem(uint32_t NumThreads); // 0 - all hardware threads, calling thread is one of them.
+void mz_ShutdownJobSystem();
+uint32_t mz_GetNumJobThreads(); // 1 when the job system is not running.
+void mz_SubmitJob(const mz_Job& Job); // Increments Job.Counter, Data must stay valid until the job is done.
+void mz_WaitForCounter(mz_JobCounter* Counter); // Until it reaches zero.
+template<typename F> void mz_ParallelFor(uint32_t Count, uint32_t Granularity, const F& Body); // Body(Begin, End), blocks.
 
 //
 // Misc.
 //
 eastl::vector<uint8_t> mz_LoadFile(const char* Name);
-void mz_UpdateFrameStats(HWND Window, const char* Name, double* Time, float* DeltaTime);
+bool mz_MapFile(const char* Name, mz_MappedFile* OutFile); // Read-only view of the whole file. Returns false if it can't be opened.
+void mz_UnmapFile(mz_MappedFile* File);
+bool mz_GetFileStamp(const char* Name, uint64_t* OutSize, uint64_t* OutModifiedTime); // Without reading it. Time units are platform specific.
+uint64_t mz_HashData(const void* Data, size_t Size, uint64_t Seed); // Fast, not cryptographic (cache keys).
 double mz_GetTime();
+#if !defined(mz_HEADLESS)
+void mz_UpdateFrameStats(HWND Window, const char* Name, double* Time, float* DeltaTime);
 HWND mz_CreateWindow(const char* Name, uint32_t Width, uint32_t Height);
+#endif
 
 
 //
 // Inline implementation.
 //
+#if !defined(mz_HEADLESS)
 inline bool
 mz_IsValid(mz_DX12Resource* Resource)
 {
@@ -190,22 +565,41 @@ mz_IsValid(mz_DX12PipelineState* Pipeline)
 	return Pipeline && Pipeline->PSO != nullptr && Pipeline->RS != nullptr;
 }
 
+inline mz_DX12Resource*
+mz_GetResource(mz_GraphicsContext* Gfx, mz_Handle Handle)
+{
+	return (mz_DX12Resource*)mz_GetHandleItem(&Gfx->ResourcePool, Handle);
+}
+
+// NOTE: Slot goes back to the pool when the last reference is gone, pointers to the resource must not be used
+// after that (debug builds fill the slot with garbage).
 inline void
-mz_ReleaseResource(mz_DX12Resource* Resource)
+mz_ReleaseResource(mz_GraphicsContext* Gfx, mz_DX12Resource* Resource)
 {
-	if (mz_IsValid(Resource) && Resource->Raw->Release() == 0)
+	if (!mz_IsValid(Resource))
+	{
+		return;
+	}
+#if defined(_DEBUG)
+	mz_ASSERT(mz_GetHandleItem(&Gfx->ResourcePool, Resource->Handle) == Resource);
+#endif
+	if (Resource->Raw->Release() == 0)
 	{
 		Resource->Raw = nullptr;
 		Resource->State = (D3D12_RESOURCE_STATES)~0;
 		Resource->Format = (DXGI_FORMAT)~0;
+		mz_FreeHandle(&Gfx->ResourcePool, Resource->Handle);
 	}
 }
 
 inline void
-mz_ReleasePipeline(mz_DX12PipelineState* Pipeline)
+mz_ReleasePipeline(mz_GraphicsContext* Gfx, mz_DX12PipelineState* Pipeline)
 {
 	if (mz_IsValid(Pipeline))
 	{
+#if defined(_DEBUG)
+		mz_ASSERT(mz_GetHandleItem(&Gfx->PipelinePool, Pipeline->Handle) == Pipeline);
+#endif
 		ULONG PSONumRef = Pipeline->PSO->Release();
 		ULONG RSNumRef = Pipeline->RS->Release();
 		mz_ASSERT(PSONumRef == RSNumRef);
@@ -214,6 +608,7 @@ mz_ReleasePipeline(mz_DX12PipelineState* Pipeline)
 		{
 			Pipeline->PSO = nullptr;
 			Pipeline->RS = nullptr;
+			mz_FreeHandle(&Gfx->PipelinePool, Pipeline->Handle);
 		}
 	}
 }
@@ -286,6 +681,30 @@ mz_AllocateGPUDescriptors(mz_GraphicsContext* Gfx, uint32_t Count, D3D12_CPU_DES
 	Heap->Size += Count;
 }
 
+// Reserves the same range at the end of both shader visible heaps, descriptors there are not reset with the frame.
+// Returns index of the first descriptor.
+inline uint32_t
+mz_AllocatePersistentGPUDescriptors(mz_GraphicsContext* Gfx, uint32_t Count)
+{
+	for (mz_DescriptorHeap& Heap : Gfx->GPUDescriptorHeaps)
+	{
+		mz_ASSERT((Heap.Size + Count) < Heap.Capacity);
+		Heap.Capacity -= Count;
+	}
+	mz_ASSERT(Gfx->GPUDescriptorHeaps[0].Capacity == Gfx->GPUDescriptorHeaps[1].Capacity);
+	return Gfx->GPUDescriptorHeaps[0].Capacity;
+}
+
+// Handles of a persistent descriptor in the shader visible heap of the current frame.
+inline void
+mz_GetPersistentGPUDescriptor(mz_GraphicsContext* Gfx, uint32_t Idx, D3D12_CPU_DESCRIPTOR_HANDLE* OutCPUHandle, D3D12_GPU_DESCRIPTOR_HANDLE* OutGPUHandle)
+{
+	const mz_DescriptorHeap& Heap = Gfx->GPUDescriptorHeaps[Gfx->FrameIndex];
+	mz_ASSERT(Idx >= Heap.Capacity);
+	OutCPUHandle->ptr = Heap.CPUStart.ptr + (size_t)Idx * Gfx->DescriptorSize;
+	OutGPUHandle->ptr = Heap.GPUStart.ptr + (size_t)Idx * Gfx->DescriptorSize;
+}
+
 inline D3D12_GPU_DESCRIPTOR_HANDLE
 mz_CopyDescriptorsToGPUHeap(mz_GraphicsContext* Gfx, uint32_t Count, D3D12_CPU_DESCRIPTOR_HANDLE SrcBaseHandle)
 {
@@ -301,20 +720,12 @@ mz_AllocateGPUMemory(mz_GraphicsContext* Gfx, uint32_t Size, D3D12_GPU_VIRTUAL_A
 {
 	mz_ASSERT(Size > 0);
 
-	if (Size & 0xff)
-	{
-		// Always align to 256 bytes.
-		Size = (Size + 255) & ~0xff;
-	}
-
-	mz_GPUMemoryHeap& UploadHeap = Gfx->GPUUploadMemoryHeaps[Gfx->FrameIndex];
-	mz_ASSERT((UploadHeap.Size + Size) < UploadHeap.Capacity);
-
-	void* CPUAddress = UploadHeap.CPUStart + UploadHeap.Size;
-	*OutGPUAddress = UploadHeap.GPUStart + UploadHeap.Size;
+	// Always align to 256 bytes (constant buffers).
+	mz_UploadAllocation Allocation;
+	mz_AllocateUploadMemory(Gfx, Size, 256, &Allocation);
 
-	UploadHeap.Size += Size;
-	return CPUAddress;
+	*OutGPUAddress = Allocation.GPUAddress;
+	return Allocation.CPUAddress;
 }
 
 inline void
@@ -334,6 +745,7 @@ mz_GetDepthStencilBuffer(mz_GraphicsContext* Gfx, mz_DX12Resource** OutBuffer, D
 	*OutBuffer = Gfx->DepthStencilBuffer;
 	*OutHandle = Gfx->DSVHeap.CPUStart;
 }
+#endif // !mz_HEADLESS
 
 inline mz_MeshSection*
 mz_GetMeshSections(mz_Mesh* Mesh)
@@ -347,6 +759,13 @@ mz_GetMeshSections(mz_Mesh* Mesh)
 	return Mesh->Sections;
 }
 
+inline uint32_t
+mz_GetIndex(const mz_SceneData* Scene, const mz_MeshSection& Section, uint32_t Idx)
+{
+	const uint8_t* Data = &Scene->IndexData[Section.IndexOffset];
+	return Section.IndexSize == 2 ? ((const uint16_t*)Data)[Idx] : ((const uint32_t*)Data)[Idx];
+}
+
 inline void
 mz_DestroyMesh(mz_Mesh* Mesh)
 {
@@ -359,8 +778,33 @@ mz_DestroyMesh(mz_Mesh* Mesh)
 	Mesh->NumSections = 0;
 }
 
+template<typename F> inline void
+mz_ParallelFor(uint32_t Count, uint32_t Granularity, const F& Body)
+{
+	if (Count == 0)
+	{
+		return;
+	}
+	mz_JobCounter Counter = {};
+	mz_Job Job = {};
+	Job.Function = [](void* Data, uint32_t Begin, uint32_t End) { (*(const F*)Data)(Begin, End); };
+	Job.Data = (void*)&Body;
+	Job.End = Count;
+	Job.Granularity = Granularity;
+	Job.Counter = &Counter;
+	mz_SubmitJob(Job);
+	mz_WaitForCounter(&Counter);
+}
+
 template <typename T> inline bool
 mz_IsPowerOf2(T X)
 {
 	return (X & (X - 1)) == 0;
 }
+
+template <typename T> inline T
+mz_AlignUp(T X, T Alignment)
+{
+	mz_ASSERT(mz_IsPowerOf2(Alignment));
+	return (X + Alignment - 1) & ~(Alignment - 1);
+}
@@ -0,0 +1,1222 @@
+#include "MeshOptimization.h"
+#include <math.h>
+#include <float.h>
+#include "EASTL/sort.h"
+#include <atomic>
+
+//
+// Statistics.
+//
+void
+mz_AnalyzeVertexCache(const uint32_t* Indices, uint32_t NumIndices, uint32_t NumVertices, mz_VertexCacheStats* InOutStats)
+{
+	mz_ASSERT(Indices && NumIndices % 3 == 0);
+
+	// NOTE: FIFO cache, vertex is in the cache when less than mz_VERTEX_CACHE_SIZE misses happened since it was
+	// fetched.
+	eastl::vector<uint32_t> FetchTimes(NumVertices, 0);
+	uint32_t NumMisses = 0;
+	uint32_t NumReferenced = 0;
+	uint32_t LastFetched = 0;
+	uint64_t FetchDistance = 0;
+
+	for (uint32_t Idx = 0; Idx < NumIndices; ++Idx)
+	{
+		uint32_t Vertex = Indices[Idx];
+		mz_ASSERT(Vertex < NumVertices);
+
+		if (FetchTimes[Vertex] == 0 || NumMisses + 1 - FetchTimes[Vertex] >= mz_VERTEX_CACHE_SIZE)
+		{
+			NumReferenced += FetchTimes[Vertex] == 0 ? 1 : 0;
+			FetchDistance += NumMisses > 0 ? (Vertex > LastFetched ? Vertex - LastFetched : LastFetched - Vertex) : 0;
+			FetchTimes[Vertex] = ++NumMisses;
+			LastFetched = Vertex;
+		}
+	}
+
+	InOutStats->NumTriangles += NumIndices / 3;
+	InOutStats->NumVertices += NumReferenced;
+	InOutStats->NumCacheMisses += NumMisses;
+	InOutStats->FetchDistance += FetchDistance;
+}
+
+//
+// Triangle order.
+//
+// NOTE: Scoring follows Tom Forsyth's "Linear-Speed Vertex Cache Optimisation". LRU cache of 32 entries is
+// modeled, it is larger than the FIFO used for statistics on purpose (score must keep decaying past the real cache).
+#define mz_FORSYTH_CACHE_SIZE 32
+#define mz_FORSYTH_MAX_VALENCE 32
+
+static float GForsythCacheScores[mz_FORSYTH_CACHE_SIZE];
+static float GForsythValenceScores[mz_FORSYTH_MAX_VALENCE];
+
+static void
+mz_InitForsythScores()
+{
+	for (uint32_t Position = 0; Position < mz_FORSYTH_CACHE_SIZE; ++Position)
+	{
+		// Vertices of the last triangle get fixed score so that strips are not preferred over fans.
+		GForsythCacheScores[Position] = Position < 3 ? 0.75f : powf(1.0f - (Position - 3) / (float)(mz_FORSYTH_CACHE_SIZE - 3), 1.5f);
+	}
+	GForsythValenceScores[0] = -1.0f;
+	for (uint32_t Valence = 1; Valence < mz_FORSYTH_MAX_VALENCE; ++Valence)
+	{
+		GForsythValenceScores[Valence] = 2.0f / sqrtf((float)Valence);
+	}
+}
+
+static inline float
+mz_GetForsythScore(int32_t CachePosition, uint32_t NumActiveTriangles)
+{
+	if (NumActiveTriangles == 0)
+	{
+		return -1.0f;
+	}
+	float Score = CachePosition >= 0 && CachePosition < mz_FORSYTH_CACHE_SIZE ? GForsythCacheScores[CachePosition] : 0.0f;
+	Score += NumActiveTriangles < mz_FORSYTH_MAX_VALENCE ? GForsythValenceScores[NumActiveTriangles] : 2.0f / sqrtf((float)NumActiveTriangles);
+	return Score;
+}
+
+static inline uint32_t
+mz_SpreadBits10(uint32_t Value)
+{
+	Value &= 0x3ff;
+	Value = (Value | (Value << 16)) & 0x030000ff;
+	Value = (Value | (Value << 8)) & 0x0300f00f;
+	Value = (Value | (Value << 4)) & 0x030c30c3;
+	Value = (Value | (Value << 2)) & 0x09249249;
+	return Value;
+}
+
+// Triangles sorted by Morton code of their centroids (quantized to 1024 steps along each axis of the section bounds).
+static void
+mz_SortTrianglesSpatially(const mz_Vertex* Vertices, const uint32_t* Indices, uint32_t NumTriangles, eastl::vector<uint32_t>* OutOrder)
+{
+	float BoundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float BoundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	eastl::vector<XMFLOAT3> Centroids(NumTriangles);
+
+	for (uint32_t TriIdx = 0; TriIdx < NumTriangles; ++TriIdx)
+	{
+		const XMFLOAT3& P0 = Vertices[Indices[TriIdx * 3 + 0]].Position;
+		const XMFLOAT3& P1 = Vertices[Indices[TriIdx * 3 + 1]].Position;
+		const XMFLOAT3& P2 = Vertices[Indices[TriIdx * 3 + 2]].Position;
+		const float C[3] = { (P0.x + P1.x + P2.x) / 3.0f, (P0.y + P1.y + P2.y) / 3.0f, (P0.z + P1.z + P2.z) / 3.0f };
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			BoundsMin[Axis] = fminf(BoundsMin[Axis], C[Axis]);
+			BoundsMax[Axis] = fmaxf(BoundsMax[Axis], C[Axis]);
+		}
+		Centroids[TriIdx] = XMFLOAT3(C[0], C[1], C[2]);
+	}
+
+	float Scale[3];
+	for (uint32_t Axis = 0; Axis < 3; ++Axis)
+	{
+		Scale[Axis] = BoundsMax[Axis] > BoundsMin[Axis] ? 1023.0f / (BoundsMax[Axis] - BoundsMin[Axis]) : 0.0f;
+	}
+
+	eastl::vector<eastl::pair<uint32_t, uint32_t>> Keys(NumTriangles);
+	for (uint32_t TriIdx = 0; TriIdx < NumTriangles; ++TriIdx)
+	{
+		uint32_t X = (uint32_t)((Centroids[TriIdx].x - BoundsMin[0]) * Scale[0]);
+		uint32_t Y = (uint32_t)((Centroids[TriIdx].y - BoundsMin[1]) * Scale[1]);
+		uint32_t Z = (uint32_t)((Centroids[TriIdx].z - BoundsMin[2]) * Scale[2]);
+		Keys[TriIdx] = eastl::make_pair(mz_SpreadBits10(X) | (mz_SpreadBits10(Y) << 1) | (mz_SpreadBits10(Z) << 2), TriIdx);
+	}
+	eastl::sort(Keys.begin(), Keys.end());
+
+	OutOrder->resize(NumTriangles);
+	for (uint32_t Idx = 0; Idx < NumTriangles; ++Idx)
+	{
+		(*OutOrder)[Idx] = Keys[Idx].second;
+	}
+}
+
+void
+mz_OptimizeTriangleOrder(const mz_Vertex* Vertices, uint32_t NumVertices, uint32_t* InOutIndices, uint32_t NumIndices)
+{
+	static const bool bScoresInitialized = (mz_InitForsythScores(), true); // Thread-safe, sections can be optimized in parallel.
+	(void)bScoresInitialized;
+
+	uint32_t NumTriangles = NumIndices / 3;
+
+	// Triangles that use each vertex, only first NumActiveTriangles[Vertex] entries are not emitted yet.
+	eastl::vector<uint32_t> NumActiveTriangles(NumVertices, 0);
+	eastl::vector<uint32_t> FirstTriangle(NumVertices + 1, 0);
+	eastl::vector<uint32_t> VertexTriangles(NumIndices);
+	for (uint32_t Idx = 0; Idx < NumIndices; ++Idx)
+	{
+		NumActiveTriangles[InOutIndices[Idx]]++;
+	}
+	for (uint32_t Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		FirstTriangle[Vertex + 1] = FirstTriangle[Vertex] + NumActiveTriangles[Vertex];
+		NumActiveTriangles[Vertex] = 0;
+	}
+	for (uint32_t Idx = 0; Idx < NumIndices; ++Idx)
+	{
+		uint32_t Vertex = InOutIndices[Idx];
+		VertexTriangles[FirstTriangle[Vertex] + NumActiveTriangles[Vertex]++] = Idx / 3;
+	}
+
+	eastl::vector<int32_t> CachePositions(NumVertices, -1);
+	eastl::vector<float> VertexScores(NumVertices);
+	for (uint32_t Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		VertexScores[Vertex] = mz_GetForsythScore(-1, NumActiveTriangles[Vertex]);
+	}
+
+	eastl::vector<bool> bIsEmitted(NumTriangles, false);
+
+	// NOTE: When no triangle in the cache is left, optimization restarts from the next triangle in Morton
+	// order instead of searching all triangles for the best score; that's linear and keeps clusters spatially close.
+	eastl::vector<uint32_t> RestartOrder;
+	mz_SortTrianglesSpatially(Vertices, InOutIndices, NumTriangles, &RestartOrder);
+	uint32_t RestartCursor = 0;
+
+	eastl::vector<uint32_t> NewIndices(NumIndices);
+	uint32_t Cache[mz_FORSYTH_CACHE_SIZE + 3];
+	uint32_t NewCache[mz_FORSYTH_CACHE_SIZE + 3];
+	uint32_t CacheSize = 0;
+	uint32_t BestTriangle = ~0u;
+
+	for (uint32_t EmitIdx = 0; EmitIdx < NumTriangles; ++EmitIdx)
+	{
+		if (BestTriangle == ~0u)
+		{
+			while (bIsEmitted[RestartOrder[RestartCursor]])
+			{
+				RestartCursor++;
+			}
+			BestTriangle = RestartOrder[RestartCursor];
+		}
+
+		const uint32_t Tri[3] = { InOutIndices[BestTriangle * 3 + 0], InOutIndices[BestTriangle * 3 + 1], InOutIndices[BestTriangle * 3 + 2] };
+		NewIndices[EmitIdx * 3 + 0] = Tri[0];
+		NewIndices[EmitIdx * 3 + 1] = Tri[1];
+		NewIndices[EmitIdx * 3 + 2] = Tri[2];
+		bIsEmitted[BestTriangle] = true;
+
+		// Remove emitted triangle from active triangles of its vertices.
+		uint32_t NewCacheSize = 0;
+		for (uint32_t Corner = 0; Corner < 3; ++Corner)
+		{
+			uint32_t Vertex = Tri[Corner];
+			uint32_t* Triangles = &VertexTriangles[FirstTriangle[Vertex]];
+			for (uint32_t Idx = 0; Idx < NumActiveTriangles[Vertex]; ++Idx)
+			{
+				if (Triangles[Idx] == BestTriangle)
+				{
+					Triangles[Idx] = Triangles[--NumActiveTriangles[Vertex]];
+					break;
+				}
+			}
+
+			bool bIsDuplicate = false;
+			for (uint32_t Idx = 0; Idx < NewCacheSize; ++Idx)
+			{
+				bIsDuplicate |= NewCache[Idx] == Vertex;
+			}
+			if (!bIsDuplicate)
+			{
+				NewCache[NewCacheSize++] = Vertex;
+			}
+		}
+
+		// Vertices of the emitted triangle move to the front of the cache, last 3 entries are evicted.
+		uint32_t NumTriangleVertices = NewCacheSize;
+		for (uint32_t Idx = 0; Idx < CacheSize; ++Idx)
+		{
+			uint32_t Vertex = Cache[Idx];
+			if (Vertex != NewCache[0] && Vertex != NewCache[NumTriangleVertices > 1 ? 1 : 0] && Vertex != NewCache[NumTriangleVertices - 1])
+			{
+				NewCache[NewCacheSize++] = Vertex;
+			}
+		}
+
+		for (uint32_t Idx = 0; Idx < NewCacheSize; ++Idx)
+		{
+			uint32_t Vertex = NewCache[Idx];
+			CachePositions[Vertex] = Idx < mz_FORSYTH_CACHE_SIZE ? (int32_t)Idx : -1;
+			VertexScores[Vertex] = mz_GetForsythScore(CachePositions[Vertex], NumActiveTriangles[Vertex]);
+		}
+
+		BestTriangle = ~0u;
+		float BestScore = -FLT_MAX;
+		for (uint32_t Idx = 0; Idx < NewCacheSize; ++Idx)
+		{
+			uint32_t Vertex = NewCache[Idx];
+			const uint32_t* Triangles = &VertexTriangles[FirstTriangle[Vertex]];
+			for (uint32_t TriIdx = 0; TriIdx < NumActiveTriangles[Vertex]; ++TriIdx)
+			{
+				uint32_t Triangle = Triangles[TriIdx];
+				const uint32_t* T = &InOutIndices[Triangle * 3];
+				float Score = VertexScores[T[0]] + VertexScores[T[1]] + VertexScores[T[2]];
+				if (Idx < mz_FORSYTH_CACHE_SIZE && Score > BestScore)
+				{
+					BestScore = Score;
+					BestTriangle = Triangle;
+				}
+			}
+		}
+
+		CacheSize = eastl::min(NewCacheSize, (uint32_t)mz_FORSYTH_CACHE_SIZE);
+		memcpy(Cache, NewCache, CacheSize * sizeof(Cache[0]));
+	}
+
+	memcpy(InOutIndices, NewIndices.data(), NumIndices * sizeof(InOutIndices[0]));
+}
+
+//
+// Vertex order.
+//
+uint32_t
+mz_WeldVertices(mz_Vertex* Vertices, uint32_t NumVertices, uint32_t* Indices, uint32_t NumIndices)
+{
+	uint32_t TableSize = 64;
+	while (TableSize < NumVertices * 2)
+	{
+		TableSize *= 2;
+	}
+
+	// NOTE: Open addressing, table holds indices of unique vertices (already moved to the front).
+	eastl::vector<uint32_t> Table(TableSize, ~0u);
+	eastl::vector<uint32_t> Remap(NumVertices);
+	uint32_t NumUnique = 0;
+
+	for (uint32_t Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		uint32_t Slot = (uint32_t)mz_HashData(&Vertices[Vertex], sizeof(mz_Vertex), 0) & (TableSize - 1);
+		while (Table[Slot] != ~0u && memcmp(&Vertices[Table[Slot]], &Vertices[Vertex], sizeof(mz_Vertex)) != 0)
+		{
+			Slot = (Slot + 1) & (TableSize - 1);
+		}
+
+		if (Table[Slot] == ~0u)
+		{
+			Vertices[NumUnique] = Vertices[Vertex];
+			Table[Slot] = NumUnique++;
+		}
+		Remap[Vertex] = Table[Slot];
+	}
+
+	for (uint32_t Idx = 0; Idx < NumIndices; ++Idx)
+	{
+		Indices[Idx] = Remap[Indices[Idx]];
+	}
+	return NumUnique;
+}
+
+uint32_t
+mz_OptimizeVertexOrder(mz_Vertex* InOutVertices, uint32_t NumVertices, uint32_t* InOutIndices, uint32_t NumIndices)
+{
+	eastl::vector<uint32_t> Remap(NumVertices, ~0u);
+	uint32_t NextVertex = 0;
+	for (uint32_t Idx = 0; Idx < NumIndices; ++Idx)
+	{
+		uint32_t& Vertex = Remap[InOutIndices[Idx]];
+		if (Vertex == ~0u)
+		{
+			Vertex = NextVertex++;
+		}
+		InOutIndices[Idx] = Vertex;
+	}
+
+	uint32_t NumReferenced = NextVertex;
+	for (uint32_t Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		if (Remap[Vertex] == ~0u)
+		{
+			Remap[Vertex] = NextVertex++;
+		}
+	}
+
+	eastl::vector<mz_Vertex> Vertices(InOutVertices, InOutVertices + NumVertices);
+	for (uint32_t Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		InOutVertices[Remap[Vertex]] = Vertices[Vertex];
+	}
+	return NumReferenced;
+}
+
+//
+// Simplification.
+//
+// NOTE: Garland-Heckbert plane quadrics weighted by triangle area. Weight is the sum of areas, error divided by
+// it is mean squared distance to the planes (so it can be turned back into distance).
+struct mz_Quadric
+{
+	double A00, A01, A02, A11, A12, A22;
+	double B0, B1, B2;
+	double C;
+	double Weight;
+};
+
+static void
+mz_AddQuadric(mz_Quadric* InOutQuadric, const mz_Quadric& Quadric)
+{
+	double* Dest = &InOutQuadric->A00;
+	const double* Src = &Quadric.A00;
+	for (uint32_t Idx = 0; Idx < sizeof(mz_Quadric) / sizeof(double); ++Idx)
+	{
+		Dest[Idx] += Src[Idx];
+	}
+}
+
+static double
+mz_EvaluateQuadric(const mz_Quadric& Q, const mz_Quadric& Q1, const XMFLOAT3& P)
+{
+	double X = P.x, Y = P.y, Z = P.z;
+	double Error = 0.0;
+	const mz_Quadric* Quadrics[2] = { &Q, &Q1 };
+	for (const mz_Quadric* R : Quadrics)
+	{
+		Error += R->A00 * X * X + R->A11 * Y * Y + R->A22 * Z * Z + 2.0 * (R->A01 * X * Y + R->A02 * X * Z + R->A12 * Y * Z);
+		Error += 2.0 * (R->B0 * X + R->B1 * Y + R->B2 * Z) + R->C;
+	}
+	double Weight = Q.Weight + Q1.Weight;
+	return Weight > 0.0 && Error > 0.0 ? Error / Weight : 0.0;
+}
+
+static void
+mz_ComputeTriangleQuadric(const XMFLOAT3& P0, const XMFLOAT3& P1, const XMFLOAT3& P2, mz_Quadric* OutQuadric)
+{
+	*OutQuadric = {};
+
+	double E1[3] = { (double)P1.x - P0.x, (double)P1.y - P0.y, (double)P1.z - P0.z };
+	double E2[3] = { (double)P2.x - P0.x, (double)P2.y - P0.y, (double)P2.z - P0.z };
+	double N[3] = { E1[1] * E2[2] - E1[2] * E2[1], E1[2] * E2[0] - E1[0] * E2[2], E1[0] * E2[1] - E1[1] * E2[0] };
+	double Length = sqrt(N[0] * N[0] + N[1] * N[1] + N[2] * N[2]);
+	if (Length == 0.0)
+	{
+		return;
+	}
+
+	double Area = 0.5 * Length;
+	N[0] /= Length;
+	N[1] /= Length;
+	N[2] /= Length;
+	double D = -(N[0] * P0.x + N[1] * P0.y + N[2] * P0.z);
+
+	OutQuadric->A00 = N[0] * N[0] * Area;
+	OutQuadric->A01 = N[0] * N[1] * Area;
+	OutQuadric->A02 = N[0] * N[2] * Area;
+	OutQuadric->A11 = N[1] * N[1] * Area;
+	OutQuadric->A12 = N[1] * N[2] * Area;
+	OutQuadric->A22 = N[2] * N[2] * Area;
+	OutQuadric->B0 = N[0] * D * Area;
+	OutQuadric->B1 = N[1] * D * Area;
+	OutQuadric->B2 = N[2] * D * Area;
+	OutQuadric->C = D * D * Area;
+	OutQuadric->Weight = Area;
+}
+
+static inline void
+mz_ComputeNormal(const XMFLOAT3& P0, const XMFLOAT3& P1, const XMFLOAT3& P2, float* OutNormal)
+{
+	float E1[3] = { P1.x - P0.x, P1.y - P0.y, P1.z - P0.z };
+	float E2[3] = { P2.x - P0.x, P2.y - P0.y, P2.z - P0.z };
+	OutNormal[0] = E1[1] * E2[2] - E1[2] * E2[1];
+	OutNormal[1] = E1[2] * E2[0] - E1[0] * E2[2];
+	OutNormal[2] = E1[0] * E2[1] - E1[1] * E2[0];
+}
+
+// NOTE: Vertices at one position (attribute seams) form a group, collapses move whole groups. Group id is the
+// first vertex of the group, OutSiblings lists vertices of group G in [OutFirstSibling[G], OutFirstSibling[G + 1]).
+static void
+mz_GroupVerticesByPosition(const mz_Vertex* Vertices, uint32_t NumVertices, eastl::vector<uint32_t>* OutGroups, eastl::vector<uint32_t>* OutFirstSibling, eastl::vector<uint32_t>* OutSiblings)
+{
+	uint32_t TableSize = 64;
+	while (TableSize < NumVertices * 2)
+	{
+		TableSize *= 2;
+	}
+
+	eastl::vector<uint32_t> Table(TableSize, ~0u);
+	OutGroups->resize(NumVertices);
+	OutFirstSibling->assign(NumVertices + 1, 0);
+	for (uint32_t Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		const XMFLOAT3& P = Vertices[Vertex].Position;
+		uint32_t Slot = (uint32_t)mz_HashData(&P, sizeof(P), 0) & (TableSize - 1);
+		while (Table[Slot] != ~0u && memcmp(&Vertices[Table[Slot]].Position, &P, sizeof(P)) != 0)
+		{
+			Slot = (Slot + 1) & (TableSize - 1);
+		}
+		if (Table[Slot] == ~0u)
+		{
+			Table[Slot] = Vertex;
+		}
+		(*OutGroups)[Vertex] = Table[Slot];
+		(*OutFirstSibling)[Table[Slot] + 1]++;
+	}
+	for (uint32_t Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		(*OutFirstSibling)[Vertex + 1] += (*OutFirstSibling)[Vertex];
+	}
+
+	OutSiblings->resize(NumVertices);
+	eastl::vector<uint32_t> Fill(OutFirstSibling->begin(), OutFirstSibling->end() - 1);
+	for (uint32_t Vertex = 0; Vertex < NumVertices; ++Vertex)
+	{
+		(*OutSiblings)[Fill[(*OutGroups)[Vertex]]++] = Vertex;
+	}
+}
+
+// Groups that must not move: border and non-manifold edges and boundaries between sections.
+static void
+mz_FindLockedGroups(const uint32_t* Groups, uint32_t NumVertices, const uint32_t* Indices, const uint32_t* TriangleSections, uint32_t NumIndices, eastl::vector<uint8_t>* OutLocked)
+{
+	OutLocked->assign(NumVertices, 0);
+
+	eastl::vector<uint32_t> GroupSections(NumVertices, ~0u);
+	for (uint32_t Idx = 0; Idx < NumIndices; ++Idx)
+	{
+		uint32_t Group = Groups[Indices[Idx]];
+		uint32_t Section = TriangleSections[Idx / 3];
+		if (GroupSections[Group] != ~0u && GroupSections[Group] != Section)
+		{
+			(*OutLocked)[Group] = 1;
+		}
+		GroupSections[Group] = Section;
+	}
+
+	// Manifold interior edge is used by exactly two triangles.
+	eastl::vector<uint64_t> Edges(NumIndices);
+	for (uint32_t Idx = 0; Idx < NumIndices; ++Idx)
+	{
+		uint32_t G0 = Groups[Indices[Idx]];
+		uint32_t G1 = Groups[Indices[Idx % 3 == 2 ? Idx - 2 : Idx + 1]];
+		Edges[Idx] = G0 < G1 ? ((uint64_t)G0 << 32) | G1 : ((uint64_t)G1 << 32) | G0;
+	}
+	eastl::sort(Edges.begin(), Edges.end());
+	for (uint32_t First = 0; First < NumIndices;)
+	{
+		uint32_t Last = First + 1;
+		while (Last < NumIndices && Edges[Last] == Edges[First])
+		{
+			Last++;
+		}
+		if (Last - First != 2)
+		{
+			(*OutLocked)[(uint32_t)(Edges[First] >> 32)] = 1;
+			(*OutLocked)[(uint32_t)Edges[First]] = 1;
+		}
+		First = Last;
+	}
+}
+
+static inline float
+mz_TexcoordDistance(const mz_Vertex& A, const mz_Vertex& B)
+{
+	float DU = A.Texcoord.x - B.Texcoord.x;
+	float DV = A.Texcoord.y - B.Texcoord.y;
+	return sqrtf(DU * DU + DV * DV);
+}
+
+// Vertex of group To that continues attributes of Vertex (triangle corner that moves there), ~0u if there is none.
+// NOTE: Texcoord jump larger than twice the texcoord length of edges of the triangle means the corner would
+// cross a texture seam.
+static uint32_t
+mz_FindCollapseTarget(const mz_Vertex* Vertices, const uint32_t* Tri, uint32_t Vertex, const uint32_t* Siblings, uint32_t NumSiblings)
+{
+	const mz_Vertex& V = Vertices[Vertex];
+
+	float MaxTexcoordDistance = 0.0f;
+	for (uint32_t Corner = 0; Corner < 3; ++Corner)
+	{
+		MaxTexcoordDistance = fmaxf(MaxTexcoordDistance, mz_TexcoordDistance(V, Vertices[Tri[Corner]]));
+	}
+
+	uint32_t BestTarget = ~0u;
+	float BestScore = FLT_MAX;
+	for (uint32_t Idx = 0; Idx < NumSiblings; ++Idx)
+	{
+		const mz_Vertex& T = Vertices[Siblings[Idx]];
+		float NormalDot = V.Normal.x * T.Normal.x + V.Normal.y * T.Normal.y + V.Normal.z * T.Normal.z;
+		float TexcoordDistance = mz_TexcoordDistance(V, T);
+		if (NormalDot < 0.7f || TexcoordDistance > 2.0f * MaxTexcoordDistance + 1.0e-6f)
+		{
+			continue;
+		}
+
+		float Score = (1.0f - NormalDot) + TexcoordDistance;
+		if (Score < BestScore)
+		{
+			BestScore = Score;
+			BestTarget = Siblings[Idx];
+		}
+	}
+	return BestTarget;
+}
+
+struct mz_EdgeCollapse
+{
+	double Cost;
+	uint32_t From;
+	uint32_t To;
+};
+
+uint32_t
+mz_SimplifyMesh(const mz_Vertex* Vertices, uint32_t NumVertices, uint32_t* Indices, uint32_t* SectionNumIndices, uint32_t NumSections, uint32_t TargetNumIndices, float* OutError)
+{
+	mz_ASSERT(Vertices && Indices && SectionNumIndices && OutError);
+
+	eastl::vector<uint32_t> Triangles;
+	eastl::vector<uint32_t> TriangleSections;
+	for (uint32_t SectionIdx = 0, Offset = 0; SectionIdx < NumSections; Offset += SectionNumIndices[SectionIdx++])
+	{
+		Triangles.insert(Triangles.end(), Indices + Offset, Indices + Offset + SectionNumIndices[SectionIdx]);
+		TriangleSections.insert(TriangleSections.end(), SectionNumIndices[SectionIdx] / 3, SectionIdx);
+	}
+
+	eastl::vector<uint32_t> Groups, FirstSibling, Siblings;
+	mz_GroupVerticesByPosition(Vertices, NumVertices, &Groups, &FirstSibling, &Siblings);
+
+	eastl::vector<uint8_t> bIsLocked;
+	mz_FindLockedGroups(Groups.data(), NumVertices, Triangles.data(), TriangleSections.data(), (uint32_t)Triangles.size(), &bIsLocked);
+
+	// Quadrics, adjacency, touched flags and collapse candidates are per group.
+	eastl::vector<mz_Quadric> Quadrics(NumVertices);
+	memset(Quadrics.data(), 0, NumVertices * sizeof(mz_Quadric));
+	for (uint32_t Idx = 0; Idx < Triangles.size(); Idx += 3)
+	{
+		mz_Quadric Quadric;
+		mz_ComputeTriangleQuadric(Vertices[Triangles[Idx]].Position, Vertices[Triangles[Idx + 1]].Position, Vertices[Triangles[Idx + 2]].Position, &Quadric);
+		for (uint32_t Corner = 0; Corner < 3; ++Corner)
+		{
+			mz_AddQuadric(&Quadrics[Groups[Triangles[Idx + Corner]]], Quadric);
+		}
+	}
+
+	eastl::vector<uint32_t> FirstTriangle(NumVertices + 1);
+	eastl::vector<uint32_t> GroupTriangles;
+	eastl::vector<mz_EdgeCollapse> Collapses;
+	eastl::vector<uint8_t> bIsTouched(NumVertices);
+	eastl::vector<uint32_t> Remap(NumVertices);
+	eastl::vector<uint32_t> CollapseRemap; // (Vertex, Target) pairs of one collapse.
+	double MaxCost = 0.0;
+
+	// NOTE: Every pass collapses the cheapest third of candidate edges that don't touch triangles modified in
+	// the same pass, then costs are evaluated again.
+	while (Triangles.size() > TargetNumIndices)
+	{
+		uint32_t NumTriangles = (uint32_t)Triangles.size() / 3;
+
+		eastl::fill(FirstTriangle.begin(), FirstTriangle.end(), 0u);
+		for (uint32_t Idx = 0; Idx < Triangles.size(); ++Idx)
+		{
+			FirstTriangle[Groups[Triangles[Idx]] + 1]++;
+		}
+		for (uint32_t Group = 0; Group < NumVertices; ++Group)
+		{
+			FirstTriangle[Group + 1] += FirstTriangle[Group];
+		}
+		GroupTriangles.resize(Triangles.size());
+		{
+			eastl::vector<uint32_t> Fill(FirstTriangle.begin(), FirstTriangle.end() - 1);
+			for (uint32_t Idx = 0; Idx < Triangles.size(); ++Idx)
+			{
+				GroupTriangles[Fill[Groups[Triangles[Idx]]]++] = Idx / 3;
+			}
+		}
+
+		Collapses.clear();
+		for (uint32_t Idx = 0; Idx < Triangles.size(); ++Idx)
+		{
+			uint32_t G0 = Groups[Triangles[Idx]];
+			uint32_t G1 = Groups[Triangles[Idx % 3 == 2 ? Idx - 2 : Idx + 1]];
+			const uint32_t Edge[2][2] = { { G0, G1 }, { G1, G0 } };
+			for (uint32_t Direction = 0; Direction < 2; ++Direction)
+			{
+				uint32_t From = Edge[Direction][0];
+				uint32_t To = Edge[Direction][1];
+				if (!bIsLocked[From] && From != To)
+				{
+					Collapses.push_back({ mz_EvaluateQuadric(Quadrics[From], Quadrics[To], Vertices[To].Position), From, To });
+				}
+			}
+		}
+		if (Collapses.empty())
+		{
+			break;
+		}
+		eastl::sort(Collapses.begin(), Collapses.end(), [](const mz_EdgeCollapse& A, const mz_EdgeCollapse& B) { return A.Cost < B.Cost; });
+
+		eastl::fill(bIsTouched.begin(), bIsTouched.end(), (uint8_t)0);
+		for (uint32_t Vertex = 0; Vertex < NumVertices; ++Vertex)
+		{
+			Remap[Vertex] = Vertex;
+		}
+
+		uint32_t NumTrianglesToRemove = (NumTriangles * 3 - TargetNumIndices + 2) / 3;
+		uint32_t NumRemoved = 0;
+		uint32_t NumCollapses = 0;
+		uint32_t MaxCandidates = eastl::max((uint32_t)Collapses.size() / 3, 1u);
+
+		for (uint32_t CandidateIdx = 0; CandidateIdx < MaxCandidates && NumRemoved < NumTrianglesToRemove; ++CandidateIdx)
+		{
+			const mz_EdgeCollapse& Collapse = Collapses[CandidateIdx];
+			if (bIsTouched[Collapse.From] || bIsTouched[Collapse.To])
+			{
+				continue;
+			}
+
+			// Triangles that stay must not flip or turn too much and every moved corner needs a matching vertex.
+			const XMFLOAT3& NewPosition = Vertices[Collapse.To].Position;
+			bool bIsValid = true;
+			uint32_t NumDegenerate = 0;
+			CollapseRemap.clear();
+			for (uint32_t Idx = FirstTriangle[Collapse.From]; bIsValid && Idx < FirstTriangle[Collapse.From + 1]; ++Idx)
+			{
+				const uint32_t* Tri = &Triangles[GroupTriangles[Idx] * 3];
+				if (Groups[Tri[0]] == Collapse.To || Groups[Tri[1]] == Collapse.To || Groups[Tri[2]] == Collapse.To)
+				{
+					NumDegenerate++;
+					continue;
+				}
+
+				const XMFLOAT3* P[3] = { &Vertices[Tri[0]].Position, &Vertices[Tri[1]].Position, &Vertices[Tri[2]].Position };
+				float OldNormal[3], NewNormal[3];
+				mz_ComputeNormal(*P[0], *P[1], *P[2], OldNormal);
+				for (uint32_t Corner = 0; Corner < 3; ++Corner)
+				{
+					if (Groups[Tri[Corner]] != Collapse.From)
+					{
+						continue;
+					}
+					P[Corner] = &NewPosition;
+
+					uint32_t Target = mz_FindCollapseTarget(Vertices, Tri, Tri[Corner], &Siblings[FirstSibling[Collapse.To]], FirstSibling[Collapse.To + 1] - FirstSibling[Collapse.To]);
+					bIsValid = Target != ~0u;
+					CollapseRemap.push_back(Tri[Corner]);
+					CollapseRemap.push_back(Target);
+				}
+				mz_ComputeNormal(*P[0], *P[1], *P[2], NewNormal);
+
+				float Dot = OldNormal[0] * NewNormal[0] + OldNormal[1] * NewNormal[1] + OldNormal[2] * NewNormal[2];
+				float OldLengthSq = OldNormal[0] * OldNormal[0] + OldNormal[1] * OldNormal[1] + OldNormal[2] * OldNormal[2];
+				float NewLengthSq = NewNormal[0] * NewNormal[0] + NewNormal[1] * NewNormal[1] + NewNormal[2] * NewNormal[2];
+				bIsValid = bIsValid && Dot > 0.0f && Dot * Dot >= 0.04f * OldLengthSq * NewLengthSq;
+			}
+			if (!bIsValid || NumDegenerate == 0)
+			{
+				continue;
+			}
+
+			// NOTE: Vertices used only by removed triangles go anywhere in the group. Corner shared by more
+			// triangles may pick different targets, first one wins.
+			for (uint32_t Idx = FirstSibling[Collapse.From]; Idx < FirstSibling[Collapse.From + 1]; ++Idx)
+			{
+				Remap[Siblings[Idx]] = Collapse.To;
+			}
+			for (uint32_t Idx = CollapseRemap.size(); Idx > 0; Idx -= 2)
+			{
+				Remap[CollapseRemap[Idx - 2]] = CollapseRemap[Idx - 1];
+			}
+			mz_AddQuadric(&Quadrics[Collapse.To], Quadrics[Collapse.From]);
+			for (uint32_t Idx = FirstTriangle[Collapse.From]; Idx < FirstTriangle[Collapse.From + 1]; ++Idx)
+			{
+				const uint32_t* Tri = &Triangles[GroupTriangles[Idx] * 3];
+				bIsTouched[Groups[Tri[0]]] = bIsTouched[Groups[Tri[1]]] = bIsTouched[Groups[Tri[2]]] = 1;
+			}
+			MaxCost = eastl::max(MaxCost, Collapse.Cost);
+			NumRemoved += NumDegenerate;
+			NumCollapses++;
+		}
+		if (NumCollapses == 0)
+		{
+			break;
+		}
+
+		uint32_t NumKept = 0;
+		for (uint32_t TriIdx = 0; TriIdx < NumTriangles; ++TriIdx)
+		{
+			uint32_t V0 = Remap[Triangles[TriIdx * 3 + 0]];
+			uint32_t V1 = Remap[Triangles[TriIdx * 3 + 1]];
+			uint32_t V2 = Remap[Triangles[TriIdx * 3 + 2]];
+			if (Groups[V0] != Groups[V1] && Groups[V1] != Groups[V2] && Groups[V2] != Groups[V0])
+			{
+				Triangles[NumKept * 3 + 0] = V0;
+				Triangles[NumKept * 3 + 1] = V1;
+				Triangles[NumKept * 3 + 2] = V2;
+				TriangleSections[NumKept++] = TriangleSections[TriIdx];
+			}
+		}
+		Triangles.resize(NumKept * 3);
+		TriangleSections.resize(NumKept);
+	}
+
+	// Triangles never change section and keep their relative order, so sections stay sorted.
+	for (uint32_t SectionIdx = 0; SectionIdx < NumSections; ++SectionIdx)
+	{
+		SectionNumIndices[SectionIdx] = 0;
+	}
+	for (uint32_t TriIdx = 0; TriIdx < TriangleSections.size(); ++TriIdx)
+	{
+		SectionNumIndices[TriangleSections[TriIdx]] += 3;
+	}
+	memcpy(Indices, Triangles.data(), Triangles.size() * sizeof(uint32_t));
+
+	*OutError = (float)sqrt(MaxCost);
+	return (uint32_t)Triangles.size();
+}
+
+//
+// Scene.
+//
+void
+mz_OptimizeSceneMeshes(mz_SceneData* InOutScene)
+{
+	mz_ASSERT(InOutScene->CompactVertices.empty());
+
+	eastl::vector<mz_Vertex> NewVertices;
+	eastl::vector<uint8_t> NewIndexData;
+	NewVertices.reserve(InOutScene->Vertices.size());
+	NewIndexData.reserve(InOutScene->IndexData.size());
+
+	eastl::vector<mz_Vertex> MeshVertices;
+	eastl::vector<uint32_t> MeshIndices;
+
+	for (mz_Mesh& Mesh : InOutScene->Meshes)
+	{
+		mz_MeshSection* Sections = mz_GetMeshSections(&Mesh);
+
+		// Indices of all sections, relative to the first vertex of the mesh.
+		uint32_t FirstVertex = ~0u;
+		uint32_t EndVertex = 0;
+		uint32_t NumMeshIndices = 0;
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh.NumSections; ++SectionIdx)
+		{
+			FirstVertex = eastl::min(FirstVertex, Sections[SectionIdx].BaseVertex);
+			EndVertex = eastl::max(EndVertex, Sections[SectionIdx].BaseVertex + Sections[SectionIdx].NumVertices);
+			NumMeshIndices += Sections[SectionIdx].NumIndices;
+		}
+		FirstVertex = eastl::min(FirstVertex, EndVertex);
+
+		MeshVertices.assign(InOutScene->Vertices.begin() + FirstVertex, InOutScene->Vertices.begin() + EndVertex);
+		MeshIndices.resize(NumMeshIndices);
+
+		uint32_t* SectionIndices = MeshIndices.data();
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh.NumSections; ++SectionIdx)
+		{
+			const mz_MeshSection& Section = Sections[SectionIdx];
+			mz_GetSectionIndices(InOutScene, Section, SectionIndices);
+			for (uint32_t Idx = 0; Idx < Section.NumIndices; ++Idx)
+			{
+				SectionIndices[Idx] += Section.BaseVertex - FirstVertex;
+			}
+			SectionIndices += Section.NumIndices;
+		}
+
+		uint32_t NumMeshVertices = mz_WeldVertices(MeshVertices.data(), (uint32_t)MeshVertices.size(), MeshIndices.data(), NumMeshIndices);
+
+		SectionIndices = MeshIndices.data();
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh.NumSections; ++SectionIdx)
+		{
+			mz_OptimizeTriangleOrder(MeshVertices.data(), NumMeshVertices, SectionIndices, Sections[SectionIdx].NumIndices);
+			SectionIndices += Sections[SectionIdx].NumIndices;
+		}
+
+		// NOTE: First use order over all sections makes vertex range of each section nearly contiguous, only
+		// vertices shared with previous sections lie before it.
+		NumMeshVertices = mz_OptimizeVertexOrder(MeshVertices.data(), NumMeshVertices, MeshIndices.data(), NumMeshIndices);
+
+		uint32_t BaseVertex = (uint32_t)NewVertices.size();
+		NewVertices.insert(NewVertices.end(), MeshVertices.begin(), MeshVertices.begin() + NumMeshVertices);
+
+		SectionIndices = MeshIndices.data();
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh.NumSections; ++SectionIdx)
+		{
+			mz_MeshSection* Section = &Sections[SectionIdx];
+
+			uint32_t MinVertex = ~0u;
+			uint32_t MaxVertex = 0;
+			for (uint32_t Idx = 0; Idx < Section->NumIndices; ++Idx)
+			{
+				MinVertex = eastl::min(MinVertex, SectionIndices[Idx]);
+				MaxVertex = eastl::max(MaxVertex, SectionIndices[Idx]);
+			}
+			if (Section->NumIndices == 0)
+			{
+				MinVertex = MaxVertex = 0;
+			}
+			for (uint32_t Idx = 0; Idx < Section->NumIndices; ++Idx)
+			{
+				SectionIndices[Idx] -= MinVertex;
+			}
+
+			Section->BaseVertex = BaseVertex + MinVertex;
+			Section->NumVertices = Section->NumIndices > 0 ? MaxVertex - MinVertex + 1 : 0;
+			mz_AppendSectionIndices(SectionIndices, Section->NumIndices, Section, &NewIndexData);
+			SectionIndices += Section->NumIndices;
+		}
+	}
+
+	InOutScene->Vertices.swap(NewVertices);
+	InOutScene->IndexData.swap(NewIndexData);
+}
+
+#define mz_MAX_MESH_LODS 8
+#define mz_MIN_LOD_TRIANGLES 64
+
+void
+mz_GenerateSceneLODs(mz_SceneData* InOutScene)
+{
+	mz_ASSERT(InOutScene->MeshLODChains.empty() && InOutScene->LODMeshes.empty());
+
+	InOutScene->MeshLODChains.resize(InOutScene->Meshes.size());
+
+	eastl::vector<uint32_t> MeshIndices;
+	eastl::vector<uint32_t> SectionNumIndices;
+	eastl::vector<uint32_t> LODIndices;
+
+	for (uint32_t MeshIdx = 0; MeshIdx < InOutScene->Meshes.size(); ++MeshIdx)
+	{
+		mz_MeshSection* Sections = mz_GetMeshSections(&InOutScene->Meshes[MeshIdx]);
+		uint32_t NumSections = InOutScene->Meshes[MeshIdx].NumSections;
+
+		uint32_t FirstVertex = ~0u;
+		uint32_t EndVertex = 0;
+		uint32_t NumIndices = 0;
+		for (uint32_t SectionIdx = 0; SectionIdx < NumSections; ++SectionIdx)
+		{
+			FirstVertex = eastl::min(FirstVertex, Sections[SectionIdx].BaseVertex);
+			EndVertex = eastl::max(EndVertex, Sections[SectionIdx].BaseVertex + Sections[SectionIdx].NumVertices);
+			NumIndices += Sections[SectionIdx].NumIndices;
+		}
+		FirstVertex = eastl::min(FirstVertex, EndVertex);
+		const mz_Vertex* MeshVertices = &InOutScene->Vertices[FirstVertex];
+		uint32_t NumMeshVertices = EndVertex - FirstVertex;
+
+		mz_MeshLODChain* Chain = &InOutScene->MeshLODChains[MeshIdx];
+		Chain->FirstLOD = (uint32_t)InOutScene->LODMeshes.size();
+		Chain->NumLODs = 0;
+		{
+			float BoundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float BoundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (uint32_t Vertex = 0; Vertex < NumMeshVertices; ++Vertex)
+			{
+				const float P[3] = { MeshVertices[Vertex].Position.x, MeshVertices[Vertex].Position.y, MeshVertices[Vertex].Position.z };
+				for (uint32_t Axis = 0; Axis < 3; ++Axis)
+				{
+					BoundsMin[Axis] = fminf(BoundsMin[Axis], P[Axis]);
+					BoundsMax[Axis] = fmaxf(BoundsMax[Axis], P[Axis]);
+				}
+			}
+			Chain->BoundsCenter = NumMeshVertices > 0 ? XMFLOAT3(0.5f * (BoundsMin[0] + BoundsMax[0]), 0.5f * (BoundsMin[1] + BoundsMax[1]), 0.5f * (BoundsMin[2] + BoundsMax[2])) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+			Chain->BoundsRadius = 0.0f;
+			for (uint32_t Vertex = 0; Vertex < NumMeshVertices; ++Vertex)
+			{
+				float DX = MeshVertices[Vertex].Position.x - Chain->BoundsCenter.x;
+				float DY = MeshVertices[Vertex].Position.y - Chain->BoundsCenter.y;
+				float DZ = MeshVertices[Vertex].Position.z - Chain->BoundsCenter.z;
+				Chain->BoundsRadius = fmaxf(Chain->BoundsRadius, sqrtf(DX * DX + DY * DY + DZ * DZ));
+			}
+		}
+
+		MeshIndices.resize(NumIndices);
+		SectionNumIndices.resize(NumSections);
+		for (uint32_t SectionIdx = 0, Offset = 0; SectionIdx < NumSections; Offset += Sections[SectionIdx++].NumIndices)
+		{
+			mz_GetSectionIndices(InOutScene, Sections[SectionIdx], &MeshIndices[Offset]);
+			for (uint32_t Idx = 0; Idx < Sections[SectionIdx].NumIndices; ++Idx)
+			{
+				MeshIndices[Offset + Idx] += Sections[SectionIdx].BaseVertex - FirstVertex;
+			}
+			SectionNumIndices[SectionIdx] = Sections[SectionIdx].NumIndices;
+		}
+
+		// NOTE: Every level is simplified from the previous one, errors add up.
+		float Error = 0.0f;
+		for (uint32_t Level = 1; Level <= mz_MAX_MESH_LODS && NumIndices / 3 >= mz_MIN_LOD_TRIANGLES; ++Level)
+		{
+			float LevelError;
+			uint32_t TargetNumIndices = NumIndices / 6 * 3;
+			uint32_t NewNumIndices = mz_SimplifyMesh(MeshVertices, NumMeshVertices, MeshIndices.data(), SectionNumIndices.data(), NumSections, TargetNumIndices, &LevelError);
+			if (NewNumIndices > NumIndices / 4 * 3)
+			{
+				break;
+			}
+			NumIndices = NewNumIndices;
+			Error += LevelError;
+
+			mz_Mesh LOD = {};
+			LOD.NumSections = (uint16_t)NumSections;
+			if (NumSections > 1)
+			{
+				LOD.Sections = (mz_MeshSection*)calloc(NumSections, sizeof(mz_MeshSection));
+				mz_ASSERT(LOD.Sections);
+			}
+			mz_MeshSection* LODSections = mz_GetMeshSections(&LOD);
+
+			for (uint32_t SectionIdx = 0, Offset = 0; SectionIdx < NumSections; Offset += SectionNumIndices[SectionIdx++])
+			{
+				uint32_t* SectionIndices = &MeshIndices[Offset];
+				uint32_t NumSectionIndices = SectionNumIndices[SectionIdx];
+				if (NumSectionIndices > 0)
+				{
+					mz_OptimizeTriangleOrder(MeshVertices, NumMeshVertices, SectionIndices, NumSectionIndices);
+				}
+
+				uint32_t MinVertex = NumSectionIndices > 0 ? ~0u : 0;
+				uint32_t MaxVertex = 0;
+				for (uint32_t Idx = 0; Idx < NumSectionIndices; ++Idx)
+				{
+					MinVertex = eastl::min(MinVertex, SectionIndices[Idx]);
+					MaxVertex = eastl::max(MaxVertex, SectionIndices[Idx]);
+				}
+				LODIndices.resize(NumSectionIndices);
+				for (uint32_t Idx = 0; Idx < NumSectionIndices; ++Idx)
+				{
+					LODIndices[Idx] = SectionIndices[Idx] - MinVertex;
+				}
+
+				LODSections[SectionIdx].MaterialIndex = Sections[SectionIdx].MaterialIndex;
+				LODSections[SectionIdx].BaseVertex = FirstVertex + MinVertex;
+				LODSections[SectionIdx].NumVertices = NumSectionIndices > 0 ? MaxVertex - MinVertex + 1 : 0;
+				mz_AppendSectionIndices(LODIndices.data(), NumSectionIndices, &LODSections[SectionIdx], &InOutScene->IndexData);
+			}
+
+			InOutScene->LODMeshes.push_back(LOD);
+			InOutScene->LODErrors.push_back(Error);
+			Chain->NumLODs++;
+		}
+	}
+}
+
+//
+// Meshlets.
+//
+static inline float
+mz_Dot3(const float* A, const float* B)
+{
+	return A[0] * B[0] + A[1] * B[1] + A[2] * B[2];
+}
+
+static void
+mz_ComputeMeshletBounds(const mz_Vertex* Vertices, const uint32_t* MeshletVertices, const uint8_t* MeshletTriangles, mz_Meshlet* InOutMeshlet)
+{
+	float Min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float Max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t Idx = 0; Idx < InOutMeshlet->NumVertices; ++Idx)
+	{
+		const float* P = &Vertices[MeshletVertices[Idx]].Position.x;
+		for (uint32_t Axis = 0; Axis < 3; ++Axis)
+		{
+			Min[Axis] = fminf(Min[Axis], P[Axis]);
+			Max[Axis] = fmaxf(Max[Axis], P[Axis]);
+		}
+	}
+	float Center[3] = { 0.5f * (Min[0] + Max[0]), 0.5f * (Min[1] + Max[1]), 0.5f * (Min[2] + Max[2]) };
+	InOutMeshlet->BoundsMin = XMFLOAT3(Min[0], Min[1], Min[2]);
+	InOutMeshlet->BoundsMax = XMFLOAT3(Max[0], Max[1], Max[2]);
+	InOutMeshlet->BoundsCenter = XMFLOAT3(Center[0], Center[1], Center[2]);
+
+	float RadiusSq = 0.0f;
+	for (uint32_t Idx = 0; Idx < InOutMeshlet->NumVertices; ++Idx)
+	{
+		const float* P = &Vertices[MeshletVertices[Idx]].Position.x;
+		float D[3] = { P[0] - Center[0], P[1] - Center[1], P[2] - Center[2] };
+		RadiusSq = fmaxf(RadiusSq, mz_Dot3(D, D));
+	}
+	InOutMeshlet->BoundsRadius = sqrtf(RadiusSq);
+
+	// NOTE: Cone axis is the average of triangle normals, cutoff is the sine of the smallest angle between the
+	// axis and a triangle plane. Apex is moved back along the axis until it is behind all triangle planes, so the test
+	// is conservative for eye positions close to the meshlet.
+	float Normals[mz_MESHLET_MAX_TRIANGLES][3];
+	const float* Corners[mz_MESHLET_MAX_TRIANGLES];
+	uint32_t NumNormals = 0;
+	float Axis[3] = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t TriIdx = 0; TriIdx < InOutMeshlet->NumTriangles; ++TriIdx)
+	{
+		const uint8_t* Tri = &MeshletTriangles[TriIdx * 3];
+		const XMFLOAT3& P0 = Vertices[MeshletVertices[Tri[0]]].Position;
+		float* N = Normals[NumNormals];
+		mz_ComputeNormal(P0, Vertices[MeshletVertices[Tri[1]]].Position, Vertices[MeshletVertices[Tri[2]]].Position, N);
+		float Length = sqrtf(mz_Dot3(N, N));
+		if (Length == 0.0f)
+		{
+			continue;
+		}
+		for (uint32_t Component = 0; Component < 3; ++Component)
+		{
+			N[Component] /= Length;
+			Axis[Component] += N[Component];
+		}
+		Corners[NumNormals++] = &P0.x;
+	}
+
+	InOutMeshlet->ConeApex = InOutMeshlet->BoundsCenter;
+	InOutMeshlet->ConeAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	InOutMeshlet->ConeCutoff = 1.0f;
+
+	float AxisLength = sqrtf(mz_Dot3(Axis, Axis));
+	if (NumNormals == 0 || AxisLength == 0.0f)
+	{
+		return;
+	}
+	Axis[0] /= AxisLength;
+	Axis[1] /= AxisLength;
+	Axis[2] /= AxisLength;
+	InOutMeshlet->ConeAxis = XMFLOAT3(Axis[0], Axis[1], Axis[2]);
+
+	float MinDot = 1.0f;
+	for (uint32_t Idx = 0; Idx < NumNormals; ++Idx)
+	{
+		MinDot = fminf(MinDot, mz_Dot3(Normals[Idx], Axis));
+	}
+	if (MinDot <= 0.1f)
+	{
+		return;
+	}
+
+	float MaxT = 0.0f;
+	for (uint32_t Idx = 0; Idx < NumNormals; ++Idx)
+	{
+		float D[3] = { Center[0] - Corners[Idx][0], Center[1] - Corners[Idx][1], Center[2] - Corners[Idx][2] };
+		MaxT = fmaxf(MaxT, mz_Dot3(D, Normals[Idx]) / mz_Dot3(Axis, Normals[Idx]));
+	}
+	InOutMeshlet->ConeApex = XMFLOAT3(Center[0] - Axis[0] * MaxT, Center[1] - Axis[1] * MaxT, Center[2] - Axis[2] * MaxT);
+	InOutMeshlet->ConeCutoff = sqrtf(1.0f - MinDot * MinDot);
+}
+
+void
+mz_BuildMeshlets(const mz_Vertex* Vertices, uint32_t NumVertices, const uint32_t* Indices, uint32_t NumIndices, eastl::vector<mz_Meshlet>* InOutMeshlets, eastl::vector<uint32_t>* InOutMeshletVertices, eastl::vector<uint8_t>* InOutMeshletTriangles)
+{
+	mz_ASSERT(Vertices && Indices && NumIndices % 3 == 0);
+	static_assert(mz_MESHLET_MAX_VERTICES < 0xff && mz_MESHLET_MAX_TRIANGLES <= 0xff, "Meshlet counts are stored in 8 bits.");
+
+	// NOTE: Linear scan, triangles are already ordered for vertex cache and spatially, so consecutive triangles
+	// share vertices and a new meshlet starts only when one of the limits is hit.
+	eastl::vector<uint8_t> LocalIndices(NumVertices, 0xff);
+	mz_Meshlet Meshlet = {};
+	Meshlet.FirstVertex = (uint32_t)InOutMeshletVertices->size();
+	Meshlet.FirstTriangle = (uint32_t)InOutMeshletTriangles->size() / 3;
+
+	auto FinishMeshlet = [&]()
+	{
+		for (uint32_t Idx = Meshlet.FirstVertex; Idx < InOutMeshletVertices->size(); ++Idx)
+		{
+			LocalIndices[(*InOutMeshletVertices)[Idx]] = 0xff;
+		}
+		mz_ComputeMeshletBounds(Vertices, &(*InOutMeshletVertices)[Meshlet.FirstVertex], &(*InOutMeshletTriangles)[Meshlet.FirstTriangle * 3], &Meshlet);
+		InOutMeshlets->push_back(Meshlet);
+
+		Meshlet = {};
+		Meshlet.FirstVertex = (uint32_t)InOutMeshletVertices->size();
+		Meshlet.FirstTriangle = (uint32_t)InOutMeshletTriangles->size() / 3;
+	};
+
+	for (uint32_t Idx = 0; Idx < NumIndices; Idx += 3)
+	{
+		uint32_t NumNew = 0;
+		for (uint32_t Corner = 0; Corner < 3; ++Corner)
+		{
+			mz_ASSERT(Indices[Idx + Corner] < NumVertices);
+			NumNew += LocalIndices[Indices[Idx + Corner]] == 0xff ? 1 : 0;
+		}
+		// Repeated corners of a degenerate triangle are counted twice, limit is still never exceeded.
+		if (Meshlet.NumVertices + NumNew > mz_MESHLET_MAX_VERTICES || Meshlet.NumTriangles + 1 > mz_MESHLET_MAX_TRIANGLES)
+		{
+			FinishMeshlet();
+		}
+
+		for (uint32_t Corner = 0; Corner < 3; ++Corner)
+		{
+			uint32_t Vertex = Indices[Idx + Corner];
+			if (LocalIndices[Vertex] == 0xff)
+			{
+				LocalIndices[Vertex] = Meshlet.NumVertices++;
+				InOutMeshletVertices->push_back(Vertex);
+			}
+			InOutMeshletTriangles->push_back(LocalIndices[Vertex]);
+		}
+		Meshlet.NumTriangles++;
+	}
+	if (Meshlet.NumTriangles > 0)
+	{
+		FinishMeshlet();
+	}
+}
+
+void
+mz_BuildSceneMeshlets(mz_SceneData* InOutScene)
+{
+	mz_ASSERT(InOutScene->Meshlets.empty() && !InOutScene->Vertices.empty());
+
+	eastl::vector<mz_MeshSection*> Sections;
+	for (eastl::vector<mz_Mesh>* Meshes : { &InOutScene->Meshes, &InOutScene->LODMeshes })
+	{
+		for (mz_Mesh& Mesh : *Meshes)
+		{
+			mz_MeshSection* MeshSections = mz_GetMeshSections(&Mesh);
+			for (uint32_t SectionIdx = 0; SectionIdx < Mesh.NumSections; ++SectionIdx)
+			{
+				Sections.push_back(&MeshSections[SectionIdx]);
+			}
+		}
+	}
+	uint32_t NumSections = (uint32_t)Sections.size();
+
+	// Every section is built into its own arrays, largest first, and concatenated in section order afterwards so that
+	// the result doesn't depend on the number of threads.
+	struct mz_SectionMeshlets
+	{
+		eastl::vector<mz_Meshlet> Meshlets;
+		eastl::vector<uint32_t> Vertices;
+		eastl::vector<uint8_t> Triangles;
+	};
+	eastl::vector<mz_SectionMeshlets> Results(NumSections);
+
+	eastl::vector<uint32_t> Order(NumSections);
+	for (uint32_t Idx = 0; Idx < NumSections; ++Idx)
+	{
+		Order[Idx] = Idx;
+	}
+	eastl::sort(Order.begin(), Order.end(), [&](uint32_t A, uint32_t B) { return Sections[A]->NumIndices > Sections[B]->NumIndices; });
+
+	std::atomic<uint32_t> NextSection(0);
+	auto BuildSections = [&]()
+	{
+		eastl::vector<uint32_t> Indices;
+		for (;;)
+		{
+			uint32_t OrderIdx = NextSection.fetch_add(1);
+			if (OrderIdx >= NumSections)
+			{
+				break;
+			}
+			const mz_MeshSection& Section = *Sections[Order[OrderIdx]];
+			mz_SectionMeshlets* Result = &Results[Order[OrderIdx]];
+
+			Indices.resize(Section.NumIndices);
+			mz_GetSectionIndices(InOutScene, Section, Indices.data());
+			mz_BuildMeshlets(&InOutScene->Vertices[Section.BaseVertex], Section.NumVertices, Indices.data(), Section.NumIndices, &Result->Meshlets, &Result->Vertices, &Result->Triangles);
+		}
+	};
+
+	uint32_t NumJobs = eastl::min(mz_GetNumJobThreads(), eastl::max(NumSections, 1u));
+	mz_ParallelFor(NumJobs, 1, [&BuildSections](uint32_t, uint32_t) { BuildSections(); });
+
+	for (uint32_t SectionIdx = 0; SectionIdx < NumSections; ++SectionIdx)
+	{
+		mz_SectionMeshlets* Result = &Results[SectionIdx];
+		uint32_t VertexOffset = (uint32_t)InOutScene->MeshletVertices.size();
+		uint32_t TriangleOffset = (uint32_t)InOutScene->MeshletTriangles.size() / 3;
+
+		Sections[SectionIdx]->FirstMeshlet = (uint32_t)InOutScene->Meshlets.size();
+		Sections[SectionIdx]->NumMeshlets = (uint32_t)Result->Meshlets.size();
+		for (mz_Meshlet& Meshlet : Result->Meshlets)
+		{
+			Meshlet.FirstVertex += VertexOffset;
+			Meshlet.FirstTriangle += TriangleOffset;
+			InOutScene->Meshlets.push_back(Meshlet);
+		}
+		InOutScene->MeshletVertices.insert(InOutScene->MeshletVertices.end(), Result->Vertices.begin(), Result->Vertices.end());
+		InOutScene->MeshletTriangles.insert(InOutScene->MeshletTriangles.end(), Result->Triangles.begin(), Result->Triangles.end());
+	}
+}
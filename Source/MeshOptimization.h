@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Library.h"
+
+// NOTE: Functions that take Indices work on 32-bit indices relative to the first of NumVertices vertices.
+
+#define mz_VERTEX_CACHE_SIZE 16 // FIFO cache used for statistics (typical post-transform cache of current GPUs).
+
+struct mz_VertexCacheStats
+{
+	uint64_t NumTriangles;
+	uint64_t NumVertices; // Referenced by at least one triangle.
+	uint64_t NumCacheMisses; // Vertex fetches.
+	uint64_t FetchDistance; // Sum of distances (in vertices) between consecutive fetches.
+};
+
+// Accumulates, so statistics of many sections can be combined. ACMR = NumCacheMisses / NumTriangles (0.5 is the
+// ideal for large regular meshes, 3 is the worst), ATVR = NumCacheMisses / NumVertices (1 is the ideal), average fetch
+// distance = FetchDistance / NumCacheMisses (small value means vertex reads are close to sequential).
+void mz_AnalyzeVertexCache(const uint32_t* Indices, uint32_t NumIndices, uint32_t NumVertices, mz_VertexCacheStats* InOutStats);
+
+// Merges bitwise identical vertices (first occurrence is kept, order is preserved) and remaps indices. Returns the
+// number of unique vertices, they are moved to the front of Vertices.
+uint32_t mz_WeldVertices(mz_Vertex* Vertices, uint32_t NumVertices, uint32_t* Indices, uint32_t NumIndices);
+
+// Reorders triangles for post-transform cache (Forsyth's linear-speed algorithm, restarts follow Morton order of
+// triangle centroids so that consecutive triangles stay spatially close).
+void mz_OptimizeTriangleOrder(const mz_Vertex* Vertices, uint32_t NumVertices, uint32_t* Indices, uint32_t NumIndices);
+
+// Reorders vertices in order of first use. Returns the number of referenced vertices, unreferenced ones are moved to
+// the end.
+uint32_t mz_OptimizeVertexOrder(mz_Vertex* Vertices, uint32_t NumVertices, uint32_t* Indices, uint32_t NumIndices);
+
+// Whole post-load pass: vertices are welded across all sections of a mesh, triangles of every section are reordered,
+// vertices are reordered by first use and every section gets the tightest vertex range (16-bit indices when it fits).
+// Sections of a mesh may share vertices afterwards. Rebuilds Vertices and IndexData, must run before compaction.
+void mz_OptimizeSceneMeshes(mz_SceneData* InOutScene);
+
+// Quadric error edge collapse of all sections of a mesh together (sections may share vertices). Vertices only move
+// onto other existing vertices, so simplified mesh needs new indices only. Vertices at one position move together, each
+// onto the vertex with matching normal and texcoord, borders and vertices shared by more sections never move. Indices
+// of every section are compacted in place and SectionNumIndices is updated.
+// Returns total number of indices left, OutError is object space distance from the input surface (estimated from
+// quadrics).
+uint32_t mz_SimplifyMesh(const mz_Vertex* Vertices, uint32_t NumVertices, uint32_t* Indices, uint32_t* SectionNumIndices, uint32_t NumSections, uint32_t TargetNumIndices, float* OutError);
+
+// LOD chain of every mesh (each level has about half the triangles of the previous one). Must run after
+// mz_OptimizeSceneMeshes.
+void mz_GenerateSceneLODs(mz_SceneData* InOutScene);
+
+// Splits triangles (in their current order, which should be cache optimized) into meshlets of at most
+// mz_MESHLET_MAX_VERTICES vertices and mz_MESHLET_MAX_TRIANGLES triangles. Appends to the output arrays, meshlet
+// vertices are Indices values.
+void mz_BuildMeshlets(const mz_Vertex* Vertices, uint32_t NumVertices, const uint32_t* Indices, uint32_t NumIndices, eastl::vector<mz_Meshlet>* InOutMeshlets, eastl::vector<uint32_t>* InOutMeshletVertices, eastl::vector<uint8_t>* InOutMeshletTriangles);
+
+// Meshlets of every section of Meshes and LODMeshes, sections are processed in parallel. Must run after
+// mz_GenerateSceneLODs and before compaction.
+void mz_BuildSceneMeshlets(mz_SceneData* InOutScene);
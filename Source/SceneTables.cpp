@@ -0,0 +1,207 @@
+#include "SceneTables.h"
+#include "EASTL/algorithm.h"
+
+// NOTE: Materials without PBR factors or normal texture use the base color texture in their place (shaders
+// don't sample those slots then), so every descriptor table has the same layout.
+static void
+mz_ResolveMaterialTextures(const mz_Material& Material, uint32_t* OutTextures)
+{
+	mz_ASSERT(Material.BaseColorTextureIndex != (uint16_t)~0);
+	OutTextures[0] = Material.BaseColorTextureIndex;
+	OutTextures[1] = Material.PBRFactorsTextureIndex != (uint16_t)~0 ? Material.PBRFactorsTextureIndex : Material.BaseColorTextureIndex;
+	OutTextures[2] = Material.NormalTextureIndex != (uint16_t)~0 ? Material.NormalTextureIndex : Material.BaseColorTextureIndex;
+}
+
+static void
+mz_InitHitGroupData(const mz_SceneData* Scene, uint32_t MeshIdx, const mz_MeshSection& Section, mz_HitGroupData* OutHitGroup)
+{
+	mz_ASSERT(Section.MaterialIndex != (uint16_t)~0);
+
+	mz_PerGeometryRootData* Geometry = &OutHitGroup->Geometry;
+	Geometry->BaseVertex = Section.BaseVertex;
+	Geometry->IndexOffset = Section.IndexOffset;
+	Geometry->IndexSize = Section.IndexSize;
+	Geometry->Unused = 0;
+	if (!Scene->CompactMeshes.empty())
+	{
+		Geometry->PositionCenter = Scene->CompactMeshes[MeshIdx].PositionCenter;
+		Geometry->PositionExtent = Scene->CompactMeshes[MeshIdx].PositionExtent;
+	}
+	else
+	{
+		Geometry->PositionCenter = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		Geometry->PositionExtent = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	}
+	OutHitGroup->MaterialIndex = Section.MaterialIndex;
+}
+
+// Inverse of MaterialTextures, each material is listed once per image even when it uses the image in more slots.
+static void
+mz_BuildImageMaterials(uint32_t NumImages, mz_SceneTables* InOutTables)
+{
+	uint32_t NumMaterials = (uint32_t)InOutTables->MaterialTextures.size() / mz_MATERIAL_NUM_TEXTURES;
+	eastl::vector<uint32_t>& FirstMaterial = InOutTables->ImageFirstMaterial;
+
+	FirstMaterial.assign(NumImages + 1, 0);
+	for (uint32_t Pass = 0; Pass < 2; ++Pass)
+	{
+		for (uint32_t MaterialIdx = 0; MaterialIdx < NumMaterials; ++MaterialIdx)
+		{
+			const uint32_t* Textures = &InOutTables->MaterialTextures[MaterialIdx * mz_MATERIAL_NUM_TEXTURES];
+			for (uint32_t Slot = 0; Slot < mz_MATERIAL_NUM_TEXTURES; ++Slot)
+			{
+				if (eastl::find(Textures, Textures + Slot, Textures[Slot]) != Textures + Slot)
+				{
+					continue;
+				}
+				mz_ASSERT(Textures[Slot] < NumImages);
+				if (Pass == 0)
+				{
+					FirstMaterial[Textures[Slot] + 1]++;
+				}
+				else
+				{
+					InOutTables->ImageMaterials[FirstMaterial[Textures[Slot]]++] = MaterialIdx;
+				}
+			}
+		}
+
+		if (Pass == 0)
+		{
+			for (uint32_t ImageIdx = 0; ImageIdx < NumImages; ++ImageIdx)
+			{
+				FirstMaterial[ImageIdx + 1] += FirstMaterial[ImageIdx];
+			}
+			InOutTables->ImageMaterials.resize(FirstMaterial[NumImages]);
+		}
+	}
+
+	// Second pass advanced every start to the start of the next image.
+	for (uint32_t ImageIdx = NumImages; ImageIdx > 0; --ImageIdx)
+	{
+		FirstMaterial[ImageIdx] = FirstMaterial[ImageIdx - 1];
+	}
+	FirstMaterial[0] = 0;
+}
+
+static void
+mz_LogSceneTableChange(mz_SceneTables* Tables, mz_SceneTableChangeType Type, uint32_t Index)
+{
+	Tables->Changes.push_back({ Tables->Version, (uint32_t)Type, Index });
+}
+
+void
+mz_BuildSceneTables(const mz_SceneData* Scene, mz_SceneTables* OutTables)
+{
+	mz_ASSERT(Scene && OutTables);
+
+	uint32_t NumMaterials = (uint32_t)Scene->Materials.size();
+	OutTables->MaterialTextures.resize(NumMaterials * mz_MATERIAL_NUM_TEXTURES);
+	for (uint32_t MaterialIdx = 0; MaterialIdx < NumMaterials; ++MaterialIdx)
+	{
+		mz_ResolveMaterialTextures(Scene->Materials[MaterialIdx], &OutTables->MaterialTextures[MaterialIdx * mz_MATERIAL_NUM_TEXTURES]);
+	}
+
+	uint32_t NumMeshes = (uint32_t)Scene->Meshes.size();
+	OutTables->MeshFirstHitGroup.resize(NumMeshes);
+	OutTables->HitGroups.clear();
+	for (uint32_t MeshIdx = 0; MeshIdx < NumMeshes; ++MeshIdx)
+	{
+		const mz_Mesh* Mesh = &Scene->Meshes[MeshIdx];
+		const mz_MeshSection* Sections = mz_GetMeshSections((mz_Mesh*)Mesh);
+
+		OutTables->MeshFirstHitGroup[MeshIdx] = (uint32_t)OutTables->HitGroups.size();
+		for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
+		{
+			mz_InitHitGroupData(Scene, MeshIdx, Sections[SectionIdx], &OutTables->HitGroups.push_back());
+		}
+	}
+
+	mz_BuildImageMaterials((uint32_t)Scene->Images.size(), OutTables);
+
+	OutTables->Changes.clear();
+	OutTables->BaseVersion = 1;
+	OutTables->Version = 1;
+}
+
+void
+mz_MarkImageChanged(mz_SceneTables* Tables, uint32_t ImageIdx)
+{
+	mz_ASSERT(ImageIdx + 1 < Tables->ImageFirstMaterial.size());
+
+	uint32_t First = Tables->ImageFirstMaterial[ImageIdx];
+	uint32_t Last = Tables->ImageFirstMaterial[ImageIdx + 1];
+	if (First == Last)
+	{
+		return;
+	}
+
+	++Tables->Version;
+	for (uint32_t Idx = First; Idx < Last; ++Idx)
+	{
+		mz_LogSceneTableChange(Tables, mz_SCENE_TABLE_CHANGE_MATERIAL, Tables->ImageMaterials[Idx]);
+	}
+}
+
+void
+mz_UpdateSceneMaterial(mz_SceneTables* Tables, const mz_SceneData* Scene, uint32_t MaterialIdx)
+{
+	mz_ASSERT(MaterialIdx < Scene->Materials.size());
+
+	mz_ResolveMaterialTextures(Scene->Materials[MaterialIdx], &Tables->MaterialTextures[MaterialIdx * mz_MATERIAL_NUM_TEXTURES]);
+	mz_BuildImageMaterials((uint32_t)Scene->Images.size(), Tables);
+
+	++Tables->Version;
+	mz_LogSceneTableChange(Tables, mz_SCENE_TABLE_CHANGE_MATERIAL, MaterialIdx);
+}
+
+void
+mz_SetSectionMaterial(mz_SceneTables* Tables, mz_SceneData* InOutScene, uint32_t MeshIdx, uint32_t SectionIdx, uint16_t MaterialIdx)
+{
+	mz_ASSERT(MeshIdx < InOutScene->Meshes.size() && MaterialIdx < InOutScene->Materials.size());
+	mz_ASSERT(SectionIdx < InOutScene->Meshes[MeshIdx].NumSections);
+
+	mz_GetMeshSections(&InOutScene->Meshes[MeshIdx])[SectionIdx].MaterialIndex = MaterialIdx;
+
+	uint32_t HitGroupIdx = Tables->MeshFirstHitGroup[MeshIdx] + SectionIdx;
+	Tables->HitGroups[HitGroupIdx].MaterialIndex = MaterialIdx;
+
+	++Tables->Version;
+	mz_LogSceneTableChange(Tables, mz_SCENE_TABLE_CHANGE_HIT_GROUP, HitGroupIdx);
+}
+
+bool
+mz_GetSceneTableChanges(const mz_SceneTables* Tables, uint64_t AppliedVersion, const mz_SceneTableChange** OutChanges, uint32_t* OutNumChanges)
+{
+	mz_ASSERT(AppliedVersion <= Tables->Version);
+
+	*OutChanges = nullptr;
+	*OutNumChanges = 0;
+	if (AppliedVersion < Tables->BaseVersion)
+	{
+		return false;
+	}
+
+	const mz_SceneTableChange* First = eastl::upper_bound(Tables->Changes.begin(), Tables->Changes.end(), AppliedVersion,
+		[](uint64_t Version, const mz_SceneTableChange& Change) { return Version < Change.Version; });
+
+	*OutChanges = First;
+	*OutNumChanges = (uint32_t)(Tables->Changes.end() - First);
+	return true;
+}
+
+void
+mz_TrimSceneTableChanges(mz_SceneTables* Tables, uint64_t MinAppliedVersion)
+{
+	mz_ASSERT(MinAppliedVersion <= Tables->Version);
+	if (MinAppliedVersion <= Tables->BaseVersion)
+	{
+		return;
+	}
+
+	mz_SceneTableChange* First = eastl::upper_bound(Tables->Changes.begin(), Tables->Changes.end(), MinAppliedVersion,
+		[](uint64_t Version, const mz_SceneTableChange& Change) { return Version < Change.Version; });
+
+	Tables->Changes.erase(Tables->Changes.begin(), First);
+	Tables->BaseVersion = MinAppliedVersion;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Library.h"
+
+// NOTE: Per-material texture tables and per-section hit group data are compiled once from the scene and then
+// only patched. Every change bumps Version and is logged. Each consumer (one GPU descriptor heap and one shader table
+// per frame in flight) remembers the version it has applied and replays only newer changes, so a frame touches only
+// what changed.
+
+#define mz_MATERIAL_NUM_TEXTURES 3 // Base color, PBR factors, normal (descriptor table of the radiance hit group).
+
+enum mz_SceneTableChangeType
+{
+	mz_SCENE_TABLE_CHANGE_MATERIAL, // Textures of a material, its descriptor table has to be rewritten.
+	mz_SCENE_TABLE_CHANGE_HIT_GROUP, // Root data of a hit group, its shader records have to be rewritten.
+};
+
+struct mz_SceneTableChange
+{
+	uint64_t Version;
+	uint32_t Type; // mz_SceneTableChangeType.
+	uint32_t Index; // Material or hit group.
+};
+
+struct mz_HitGroupData
+{
+	mz_PerGeometryRootData Geometry;
+	uint32_t MaterialIndex; // Selects the descriptor table.
+};
+
+struct mz_SceneTables
+{
+	eastl::vector<uint32_t> MaterialTextures; // mz_MATERIAL_NUM_TEXTURES image indices per material, fallbacks resolved.
+	eastl::vector<mz_HitGroupData> HitGroups; // One per (mesh, section) pair, in mesh order.
+	eastl::vector<uint32_t> MeshFirstHitGroup; // One per mesh.
+	eastl::vector<uint32_t> ImageFirstMaterial; // Materials that use image I are ImageMaterials[ImageFirstMaterial[I], ImageFirstMaterial[I + 1]).
+	eastl::vector<uint32_t> ImageMaterials;
+	eastl::vector<mz_SceneTableChange> Changes; // Ordered by Version, all changes after BaseVersion.
+	uint64_t BaseVersion; // Consumers which applied an older version have to rewrite everything.
+	uint64_t Version;
+};
+
+// Version of the result is 1, consumers start at version 0 (nothing applied).
+void mz_BuildSceneTables(const mz_SceneData* Scene, mz_SceneTables* OutTables);
+// Logs every material that uses the image, call when texture (or descriptor) of the image is replaced.
+void mz_MarkImageChanged(mz_SceneTables* Tables, uint32_t ImageIdx);
+// Re-resolves textures of the material after Scene->Materials[MaterialIdx] was modified.
+void mz_UpdateSceneMaterial(mz_SceneTables* Tables, const mz_SceneData* Scene, uint32_t MaterialIdx);
+// Assigns a material to the section (in Scene too).
+void mz_SetSectionMaterial(mz_SceneTables* Tables, mz_SceneData* InOutScene, uint32_t MeshIdx, uint32_t SectionIdx, uint16_t MaterialIdx);
+// Changes newer than AppliedVersion. Returns false when they are not logged anymore (or nothing was applied yet),
+// consumer has to rewrite everything then.
+bool mz_GetSceneTableChanges(const mz_SceneTables* Tables, uint64_t AppliedVersion, const mz_SceneTableChange** OutChanges, uint32_t* OutNumChanges);
+// Forgets changes which every consumer has applied, MinAppliedVersion is the oldest version a consumer holds.
+void mz_TrimSceneTableChanges(mz_SceneTables* Tables, uint64_t MinAppliedVersion);
@@ -0,0 +1,137 @@
+#include "ShaderTable.h"
+#include "EASTL/algorithm.h"
+
+void
+mz_ComputeShaderTableLayout(uint32_t RayGenerationArgsSize, uint32_t NumMissRecords, uint32_t MissArgsSize, uint32_t NumHitGroupRecords, uint32_t HitGroupArgsSize, mz_ShaderTableLayout* OutLayout)
+{
+	*OutLayout = {};
+	OutLayout->RayGenerationOffset = 0;
+	OutLayout->RayGenerationSize = mz_SHADER_IDENTIFIER_SIZE + RayGenerationArgsSize;
+
+	OutLayout->MissOffset = mz_AlignUp(OutLayout->RayGenerationOffset + OutLayout->RayGenerationSize, (uint32_t)mz_SHADER_TABLE_ALIGNMENT);
+	OutLayout->MissStride = mz_AlignUp(mz_SHADER_IDENTIFIER_SIZE + MissArgsSize, (uint32_t)mz_SHADER_RECORD_ALIGNMENT);
+	OutLayout->NumMissRecords = NumMissRecords;
+
+	OutLayout->HitGroupOffset = mz_AlignUp(OutLayout->MissOffset + OutLayout->MissStride * NumMissRecords, (uint32_t)mz_SHADER_TABLE_ALIGNMENT);
+	OutLayout->HitGroupStride = mz_AlignUp(mz_SHADER_IDENTIFIER_SIZE + HitGroupArgsSize, (uint32_t)mz_SHADER_RECORD_ALIGNMENT);
+	OutLayout->NumHitGroupRecords = NumHitGroupRecords;
+
+	OutLayout->Size = OutLayout->HitGroupOffset + OutLayout->HitGroupStride * NumHitGroupRecords;
+}
+
+bool
+mz_SetShaderTableLayout(mz_ShaderTable* Table, const mz_ShaderTableLayout& Layout)
+{
+	if (!Table->Data.empty() && memcmp(&Table->Layout, &Layout, sizeof(Layout)) == 0)
+	{
+		return false;
+	}
+
+	Table->Layout = Layout;
+	Table->Data.assign(Layout.Size, 0);
+	Table->DirtyRanges.clear();
+	mz_MarkShaderTableDirty(Table, 0, Layout.Size);
+	return true;
+}
+
+uint32_t
+mz_GetMissRecordOffset(const mz_ShaderTable* Table, uint32_t Idx)
+{
+	mz_ASSERT(Idx < Table->Layout.NumMissRecords);
+	return Table->Layout.MissOffset + Idx * Table->Layout.MissStride;
+}
+
+uint32_t
+mz_GetHitGroupRecordOffset(const mz_ShaderTable* Table, uint32_t Idx)
+{
+	mz_ASSERT(Idx < Table->Layout.NumHitGroupRecords);
+	return Table->Layout.HitGroupOffset + Idx * Table->Layout.HitGroupStride;
+}
+
+void
+mz_WriteShaderRecord(mz_ShaderTable* Table, uint32_t Offset, const void* Data, uint32_t Size)
+{
+	mz_ASSERT(Offset + Size <= Table->Data.size());
+
+	const uint8_t* Src = (const uint8_t*)Data;
+	uint8_t* Dst = &Table->Data[Offset];
+
+	uint32_t First = 0;
+	while (First < Size && Src[First] == Dst[First])
+	{
+		++First;
+	}
+	if (First == Size)
+	{
+		return;
+	}
+	uint32_t Last = Size - 1;
+	while (Src[Last] == Dst[Last])
+	{
+		--Last;
+	}
+
+	memcpy(Dst + First, Src + First, Last + 1 - First);
+	mz_MarkShaderTableDirty(Table, Offset + First, Last + 1 - First);
+}
+
+void
+mz_MarkShaderTableDirty(mz_ShaderTable* Table, uint32_t Offset, uint32_t Size)
+{
+	mz_ASSERT(Offset + Size <= Table->Data.size());
+	if (Size == 0)
+	{
+		return;
+	}
+
+	uint32_t Begin = Offset;
+	uint32_t End = Offset + Size;
+
+	// First range which ends at or after Begin, it and following ranges that start before End (or touch it) merge with
+	// the new one.
+	eastl::vector<mz_ByteRange>& Ranges = Table->DirtyRanges;
+	mz_ByteRange* First = eastl::lower_bound(Ranges.begin(), Ranges.end(), Begin,
+		[](const mz_ByteRange& Range, uint32_t Value) { return Range.Offset + Range.Size < Value; });
+
+	mz_ByteRange* Last = First;
+	while (Last != Ranges.end() && Last->Offset <= End)
+	{
+		Begin = eastl::min(Begin, Last->Offset);
+		End = eastl::max(End, Last->Offset + Last->Size);
+		++Last;
+	}
+
+	if (First == Last)
+	{
+		Ranges.insert(First, mz_ByteRange{ Begin, End - Begin });
+	}
+	else
+	{
+		*First = { Begin, End - Begin };
+		Ranges.erase(First + 1, Last);
+	}
+}
+
+uint32_t
+mz_TakeShaderTableDirtyRanges(mz_ShaderTable* Table, eastl::vector<mz_ByteRange>* OutRanges)
+{
+	OutRanges->clear();
+	uint32_t NumBytes = 0;
+	for (const mz_ByteRange& Range : Table->DirtyRanges)
+	{
+		if (!OutRanges->empty() && Range.Offset - (OutRanges->back().Offset + OutRanges->back().Size) < mz_SHADER_TABLE_MERGE_DISTANCE)
+		{
+			OutRanges->back().Size = Range.Offset + Range.Size - OutRanges->back().Offset;
+		}
+		else
+		{
+			OutRanges->push_back(Range);
+		}
+	}
+	for (const mz_ByteRange& Range : *OutRanges)
+	{
+		NumBytes += Range.Size;
+	}
+	Table->DirtyRanges.clear();
+	return NumBytes;
+}
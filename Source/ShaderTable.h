@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Library.h"
+
+// NOTE: CPU copy of one raytracing shader table (ray generation record, miss records, hit group records) with dirty
+// tracking. Records are written through mz_WriteShaderRecord, which marks only bytes that really changed, so the GPU
+// buffer is updated with a few small copies instead of the whole table. The demo keeps one table per frame in flight
+// and grows the GPU buffer when the layout needs more space. Platform neutral, D3D12 constants are repeated here
+// (SimpleRaytracer.cpp checks that they match).
+
+#define mz_SHADER_IDENTIFIER_SIZE 32 // D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES
+#define mz_SHADER_RECORD_ALIGNMENT 32 // D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT
+#define mz_SHADER_TABLE_ALIGNMENT 64 // D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT
+#define mz_SHADER_TABLE_MERGE_DISTANCE 256 // Dirty ranges closer than this are uploaded as one.
+
+// All offsets and sizes in bytes. Each record is the shader identifier followed by its local root arguments.
+struct mz_ShaderTableLayout
+{
+	uint32_t RayGenerationOffset;
+	uint32_t RayGenerationSize;
+	uint32_t MissOffset;
+	uint32_t MissStride;
+	uint32_t NumMissRecords;
+	uint32_t HitGroupOffset;
+	uint32_t HitGroupStride;
+	uint32_t NumHitGroupRecords;
+	uint32_t Size;
+};
+
+struct mz_ByteRange
+{
+	uint32_t Offset;
+	uint32_t Size;
+};
+
+struct mz_ShaderTable
+{
+	mz_ShaderTableLayout Layout;
+	eastl::vector<uint8_t> Data; // Layout.Size bytes.
+	eastl::vector<mz_ByteRange> DirtyRanges; // Sorted and disjoint, changed since the last mz_TakeShaderTableDirtyRanges.
+};
+
+// Strides are the biggest record of each table rounded up to the record alignment, tables start aligned.
+void mz_ComputeShaderTableLayout(uint32_t RayGenerationArgsSize, uint32_t NumMissRecords, uint32_t MissArgsSize, uint32_t NumHitGroupRecords, uint32_t HitGroupArgsSize, mz_ShaderTableLayout* OutLayout);
+// Returns true when the layout is different from the current one, Data is cleared and everything is dirty then (every
+// record has to be written again).
+bool mz_SetShaderTableLayout(mz_ShaderTable* Table, const mz_ShaderTableLayout& Layout);
+uint32_t mz_GetMissRecordOffset(const mz_ShaderTable* Table, uint32_t Idx);
+uint32_t mz_GetHitGroupRecordOffset(const mz_ShaderTable* Table, uint32_t Idx);
+// Copies Size bytes to Offset, marks dirty only the part which is different.
+void mz_WriteShaderRecord(mz_ShaderTable* Table, uint32_t Offset, const void* Data, uint32_t Size);
+void mz_MarkShaderTableDirty(mz_ShaderTable* Table, uint32_t Offset, uint32_t Size);
+// Moves dirty ranges to OutRanges (ranges closer than mz_SHADER_TABLE_MERGE_DISTANCE are merged). Returns number of
+// dirty bytes.
+uint32_t mz_TakeShaderTableDirtyRanges(mz_ShaderTable* Table, eastl::vector<mz_ByteRange>* OutRanges);
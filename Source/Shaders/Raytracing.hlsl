@@ -14,7 +14,7 @@ GlobalRootSignature GlobalSignature =
 
 LocalRootSignature RadianceSignature =
 {
-	"RootConstants(num32BitConstants = 3, b1),"
+	"RootConstants(num32BitConstants = 10, b1),"
 	"DescriptorTable(SRV(t4, numDescriptors = 3)),"
 	"StaticSampler(s0, filter = FILTER_ANISOTROPIC, maxAnisotropy = 16),"
 };
@@ -48,8 +48,12 @@ RaytracingPipelineConfig PipelineConfig =
 RaytracingAccelerationStructure GScene : register(t0);
 RWTexture2D<float4> GOutput : register(u0);
 ConstantBuffer<mz_PerFrameConstantData> GPerFrameCB : register(b0);
+#if mz_USE_COMPACT_VERTICES
+StructuredBuffer<mz_CompactVertex> GVertexBuffer : register(t1);
+#else
 StructuredBuffer<mz_Vertex> GVertexBuffer : register(t1);
-Buffer<uint3> GIndexBuffer : register(t2);
+#endif
+ByteAddressBuffer GIndexBuffer : register(t2); // 16-bit or 32-bit indices, see LoadIndices().
 StructuredBuffer<mz_Transform4x3> GObjectToWorld : register(t3);
 
 ConstantBuffer<mz_PerGeometryRootData> GPerGeometryCB : register(b1);
@@ -181,6 +185,49 @@ float3 FresnelSchlick(float CosTheta, float3 F0)
 	return saturate(F0 + (1.0f - F0) * pow(1.0f - CosTheta, 5.0f));
 }
 
+float2 UnpackSNorm16x2(uint Packed)
+{
+	return max(float2(asint(Packed << 16) >> 16, asint(Packed) >> 16) / 32767.0f, -1.0f);
+}
+
+float3 DecodeOctahedral(uint Packed)
+{
+	float2 E = UnpackSNorm16x2(Packed);
+	float3 N = float3(E, 1.0f - abs(E.x) - abs(E.y));
+	float T = max(-N.z, 0.0f);
+	N.xy += (N.xy >= 0.0f) ? -T : T;
+	return normalize(N);
+}
+
+uint3 LoadIndices(uint PrimitiveIdx)
+{
+	if (GPerGeometryCB.IndexSize == 2)
+	{
+		uint Offset = GPerGeometryCB.IndexOffset + PrimitiveIdx * 6;
+		uint2 Words = GIndexBuffer.Load2(Offset & ~3);
+		return (Offset & 2) ? uint3(Words.x >> 16, Words.y & 0xffff, Words.y >> 16) : uint3(Words.x & 0xffff, Words.x >> 16, Words.y & 0xffff);
+	}
+	return GIndexBuffer.Load3(GPerGeometryCB.IndexOffset + PrimitiveIdx * 12);
+}
+
+mz_Vertex LoadVertex(uint Index)
+{
+#if mz_USE_COMPACT_VERTICES
+	mz_CompactVertex Compact = GVertexBuffer[Index];
+	float2 PositionXY = UnpackSNorm16x2(Compact.PositionXY);
+	float2 PositionZW = UnpackSNorm16x2(Compact.PositionZW);
+
+	mz_Vertex Vertex;
+	Vertex.Position = GPerGeometryCB.PositionCenter + GPerGeometryCB.PositionExtent * float3(PositionXY, PositionZW.x);
+	Vertex.Normal = DecodeOctahedral(Compact.Normal);
+	Vertex.Tangent = float4(DecodeOctahedral(Compact.Tangent), PositionZW.y < 0.0f ? -1.0f : 1.0f);
+	Vertex.Texcoord = float2(f16tof32(Compact.Texcoord), f16tof32(Compact.Texcoord >> 16));
+	return Vertex;
+#else
+	return GVertexBuffer[Index];
+#endif
+}
+
 [shader("closesthit")]
 void ShadowClosestHit(inout FShadowPayload Payload, in FAttributes Attribs)
 {
@@ -190,31 +237,35 @@ void ShadowClosestHit(inout FShadowPayload Payload, in FAttributes Attribs)
 [shader("closesthit")]
 void RadianceClosestHit(inout FPayload Payload, in FAttributes Attribs)
 {
-	float4x3 ObjectToWorld = GObjectToWorld[GPerGeometryCB.ObjectIndex].Transform;
+	float4x3 ObjectToWorld = GObjectToWorld[InstanceID()].Transform;
 
 	float3 N, PositionWS;
 	float2 Texcoord;
 	{
-		uint3 Indices = GIndexBuffer[GPerGeometryCB.BaseIndex / 3 + PrimitiveIndex()] + GPerGeometryCB.BaseVertex;
+		uint3 Indices = LoadIndices(PrimitiveIndex()) + GPerGeometryCB.BaseVertex;
 
 		float3 Bary = float3(1.0f - Attribs.barycentrics.x - Attribs.barycentrics.y, Attribs.barycentrics.x, Attribs.barycentrics.y);
 
-		float3 Positions[3] = { GVertexBuffer[Indices[0]].Position, GVertexBuffer[Indices[1]].Position, GVertexBuffer[Indices[2]].Position };
-		float2 Texcoords[3] = { GVertexBuffer[Indices[0]].Texcoord, GVertexBuffer[Indices[1]].Texcoord, GVertexBuffer[Indices[2]].Texcoord };
+		mz_Vertex Vertices[3] = { LoadVertex(Indices[0]), LoadVertex(Indices[1]), LoadVertex(Indices[2]) };
+
+		float3 Positions[3] = { Vertices[0].Position, Vertices[1].Position, Vertices[2].Position };
+		float2 Texcoords[3] = { Vertices[0].Texcoord, Vertices[1].Texcoord, Vertices[2].Texcoord };
 
 		PositionWS = Positions[0] * Bary.x + Positions[1] * Bary.y + Positions[2] * Bary.z;
 		Texcoord = Texcoords[0] * Bary.x + Texcoords[1] * Bary.y + Texcoords[2] * Bary.z;
 
 		PositionWS = mul(float4(PositionWS, 1.0f), ObjectToWorld);
 
-		float3 Normals[3] = { GVertexBuffer[Indices[0]].Normal, GVertexBuffer[Indices[1]].Normal, GVertexBuffer[Indices[2]].Normal };
-		float3 Tangents[3] = { GVertexBuffer[Indices[0]].Tangent.xyz, GVertexBuffer[Indices[1]].Tangent.xyz, GVertexBuffer[Indices[2]].Tangent.xyz };
+		float3 Normals[3] = { Vertices[0].Normal, Vertices[1].Normal, Vertices[2].Normal };
+		float3 Tangents[3] = { Vertices[0].Tangent.xyz, Vertices[1].Tangent.xyz, Vertices[2].Tangent.xyz };
 
 		float3 Normal = normalize(Normals[0] * Bary.x + Normals[1] * Bary.y + Normals[2] * Bary.z);
 		float3 Tangent = normalize(Tangents[0] * Bary.x + Tangents[1] * Bary.y + Tangents[2] * Bary.z);
-		float3 Bitangent = normalize(cross(Normal, Tangent)) * GVertexBuffer[Indices[0]].Tangent.w;
+		float3 Bitangent = normalize(cross(Normal, Tangent)) * Vertices[0].Tangent.w;
 
-		N = normalize(GNormalTexture.SampleLevel(GSampler, Texcoord, 0).rgb * 2.0f - 1.0f);
+		// NOTE: Normal maps may be BC5 compressed (XY only), Z is always reconstructed.
+		float2 NormalXY = GNormalTexture.SampleLevel(GSampler, Texcoord, 0).rg * 2.0f - 1.0f;
+		N = normalize(float3(NormalXY, sqrt(saturate(1.0f - dot(NormalXY, NormalXY)))));
 
 		float3x3 TBN = float3x3(Tangent, Bitangent, Normal);
 		N = mul(N, TBN);
@@ -1,30 +1,52 @@
 #include "Library.h"
 #include <stdio.h>
 #include "CPUAndGPUCommon.h"
+#include "SceneTables.h"
+#include "ShaderTable.h"
 #include "imgui/imgui.h"
 #include "DirectXMath/DirectXPackedVector.h"
 using namespace DirectX::PackedVector;
 
 #define mz_DEMO_NAME "SimpleRaytracer"
 
+static_assert(mz_SHADER_IDENTIFIER_SIZE == D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, "");
+static_assert(mz_SHADER_RECORD_ALIGNMENT == D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT, "");
+static_assert(mz_SHADER_TABLE_ALIGNMENT == D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT, "");
+
+enum mz_ShaderID
+{
+	mz_SHADER_ID_CAMERA_RAY_GENERATION,
+	mz_SHADER_ID_RADIANCE_MISS,
+	mz_SHADER_ID_SHADOW_MISS,
+	mz_SHADER_ID_RADIANCE_HIT_GROUP,
+	mz_SHADER_ID_SHADOW_HIT_GROUP,
+	mz_SHADER_ID_COUNT,
+};
+
 struct mz_DemoRoot
 {
 	mz_GraphicsContext* Gfx;
 	mz_UIContext* UI;
 	ID3D12StateObject* RTPipeline;
 	ID3D12RootSignature* RTGlobalSignature;
-	mz_DX12Resource* BLASBuffer;
+	eastl::vector<mz_DX12Resource*> BLASBuffers; // One per mz_Mesh.
 	mz_DX12Resource* TLASBuffer;
-	mz_DX12Resource* ShaderTables[2];
-	mz_DX12Resource* UploadShaderTables[2];
+	mz_DX12Resource* ShaderTables[2]; // Created (and grown) by mz_UploadShaderTable.
+	mz_ShaderTable CPUShaderTables[2]; // Descriptor table handles in hit group records differ per GPU heap.
+	eastl::vector<mz_ByteRange> ShaderTableUploadRanges;
 	mz_DX12Resource* RTOutput;
 	D3D12_CPU_DESCRIPTOR_HANDLE RTOutputUAV;
 	XMFLOAT3 CameraPosition;
 	float CameraRotation[2];
 	XMFLOAT3 LightPosition;
 	mz_SceneData Scene;
+	mz_SceneStreamer* SceneStreamer;
 	mz_DX12Resource* ObjectTransforms;
 	D3D12_CPU_DESCRIPTOR_HANDLE ObjectTransformsSRV;
+	uint8_t ShaderIDs[mz_SHADER_ID_COUNT][D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES]; // Queried once from RTPipeline.
+	mz_SceneTables SceneTables;
+	uint32_t MaterialDescriptorsBase; // Persistent GPU descriptors, mz_MATERIAL_NUM_TEXTURES per material.
+	uint64_t AppliedTableVersions[2]; // Version of SceneTables in the GPU heap and shader table of each frame index.
 };
 
 static void
@@ -70,106 +92,170 @@ mz_Update(mz_DemoRoot* Root)
 		XMStoreFloat3(&Root->CameraPosition, Position);
 	}
 
+	uint32_t NumPendingImages = mz_GetNumPendingImages(Root->SceneStreamer);
+	if (NumPendingImages > 0)
+	{
+		ImGui::Text("Streaming textures: %u of %u left", NumPendingImages, (uint32_t)Root->Scene.Images.size());
+	}
+
 	ImGui::ShowDemoWindow();
 }
 
 static void
-mz_Draw(mz_DemoRoot* Root)
+mz_WriteMaterialDescriptors(mz_DemoRoot* Root, uint32_t MaterialIdx)
 {
 	mz_GraphicsContext* Gfx = Root->Gfx;
-	ID3D12GraphicsCommandList5* CmdList = mz_CmdInit(Gfx);
-
-	mz_DX12Resource* BackBuffer;
-	D3D12_CPU_DESCRIPTOR_HANDLE BackBufferRTV;
-	mz_GetBackBuffer(Gfx, &BackBuffer, &BackBufferRTV);
-
-	// Update shader table.
-	uint32_t NumRecordsInHitGroup = 0;
-	uint32_t HitGroupRecordSize = 64;
+	const uint32_t* Textures = &Root->SceneTables.MaterialTextures[MaterialIdx * mz_MATERIAL_NUM_TEXTURES];
+	for (uint32_t Slot = 0; Slot < mz_MATERIAL_NUM_TEXTURES; ++Slot)
 	{
-		uint8_t* ShaderTableAddr;
-		mz_VHR(Root->UploadShaderTables[Gfx->FrameIndex]->Raw->Map(0, &CD3DX12_RANGE(0, 0), (void**)&ShaderTableAddr));
-
-		ID3D12StateObject* Pipeline = Root->RTPipeline;
-		ID3D12StateObjectProperties* Props;
-		mz_VHR(Pipeline->QueryInterface(IID_PPV_ARGS(&Props)));
-
-		memcpy(ShaderTableAddr + 0, Props->GetShaderIdentifier(L"CameraRayGeneration"), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-
-		memcpy(ShaderTableAddr + 64, Props->GetShaderIdentifier(L"RadianceMiss"), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-		memcpy(ShaderTableAddr + 64 + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, Props->GetShaderIdentifier(L"ShadowMiss"), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+		D3D12_CPU_DESCRIPTOR_HANDLE CPUHandle;
+		D3D12_GPU_DESCRIPTOR_HANDLE GPUHandle;
+		mz_GetPersistentGPUDescriptor(Gfx, Root->MaterialDescriptorsBase + MaterialIdx * mz_MATERIAL_NUM_TEXTURES + Slot, &CPUHandle, &GPUHandle);
+		Gfx->Device->CopyDescriptorsSimple(1, CPUHandle, Root->Scene.TextureSRVs[Textures[Slot]], D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	}
+}
 
-		void* RadianceHitGroupID = Props->GetShaderIdentifier(L"RadianceHitGroup");
-		void* ShadowHitGroupID = Props->GetShaderIdentifier(L"ShadowHitGroup");
+static void
+mz_WriteHitGroupRecords(mz_DemoRoot* Root, mz_ShaderTable* Table, uint32_t HitGroupIdx)
+{
+	const mz_HitGroupData& HitGroup = Root->SceneTables.HitGroups[HitGroupIdx];
 
-		uint8_t* Base = ShaderTableAddr + 128;
+	// Shader Record 0 (RadianceHitGroup), descriptor table is the persistent one of the material.
+	D3D12_CPU_DESCRIPTOR_HANDLE CPUHandle;
+	D3D12_GPU_DESCRIPTOR_HANDLE TableBase;
+	mz_GetPersistentGPUDescriptor(Root->Gfx, Root->MaterialDescriptorsBase + HitGroup.MaterialIndex * mz_MATERIAL_NUM_TEXTURES, &CPUHandle, &TableBase);
 
-		mz_SceneData* Scene = &Root->Scene;
+	uint8_t Record[D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + sizeof(mz_PerGeometryRootData) + sizeof(D3D12_GPU_DESCRIPTOR_HANDLE)];
+	memcpy(Record, Root->ShaderIDs[mz_SHADER_ID_RADIANCE_HIT_GROUP], D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+	memcpy(Record + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, &HitGroup.Geometry, sizeof(mz_PerGeometryRootData));
+	memcpy(Record + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + sizeof(mz_PerGeometryRootData), &TableBase, sizeof(TableBase));
+	mz_WriteShaderRecord(Table, mz_GetHitGroupRecordOffset(Table, HitGroupIdx * 2 + 0), Record, sizeof(Record));
 
-		for (uint32_t ObjectIdx = 0; ObjectIdx < Scene->Objects.size(); ++ObjectIdx)
-		{
-			mz_Object* Object = &Scene->Objects[ObjectIdx];
-			mz_Mesh* Mesh = &Scene->Meshes[Object->MeshIndex];
+	// Shader Record 1 (ShadowHitGroup).
+	mz_WriteShaderRecord(Table, mz_GetHitGroupRecordOffset(Table, HitGroupIdx * 2 + 1), Root->ShaderIDs[mz_SHADER_ID_SHADOW_HIT_GROUP], D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+}
 
-			mz_MeshSection* Sections = mz_GetMeshSections(Mesh);
+static void
+mz_WriteShaderTable(mz_DemoRoot* Root, mz_ShaderTable* Table)
+{
+	mz_WriteShaderRecord(Table, Table->Layout.RayGenerationOffset, Root->ShaderIDs[mz_SHADER_ID_CAMERA_RAY_GENERATION], D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+	mz_WriteShaderRecord(Table, mz_GetMissRecordOffset(Table, 0), Root->ShaderIDs[mz_SHADER_ID_RADIANCE_MISS], D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+	mz_WriteShaderRecord(Table, mz_GetMissRecordOffset(Table, 1), Root->ShaderIDs[mz_SHADER_ID_SHADOW_MISS], D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
 
-			for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
-			{
-				mz_ASSERT(Sections[SectionIdx].MaterialIndex != (uint16_t)~0);
+	// Records are per (mesh, section) pair, all instances of a mesh share them (see mz_CreateTLAS).
+	for (uint32_t HitGroupIdx = 0; HitGroupIdx < Root->SceneTables.HitGroups.size(); ++HitGroupIdx)
+	{
+		mz_WriteHitGroupRecords(Root, Table, HitGroupIdx);
+	}
+}
 
-				uint32_t MaterialIdx = (uint32_t)Sections[SectionIdx].MaterialIndex;
-				mz_Material* Material = &Scene->Materials[MaterialIdx];
+// NOTE: Only dirty ranges of the CPU table are packed into one upload allocation and copied to the GPU table.
+// Table of the frame index is not used by the GPU anymore (mz_PresentFrame waited), so it can be replaced when too small.
+static void
+mz_UploadShaderTable(mz_DemoRoot* Root)
+{
+	mz_GraphicsContext* Gfx = Root->Gfx;
+	mz_ShaderTable* Table = &Root->CPUShaderTables[Gfx->FrameIndex];
+	mz_DX12Resource** Buffer = &Root->ShaderTables[Gfx->FrameIndex];
 
-				// Shader Record 0 (RadianceHitGroup).
-				memcpy(Base, RadianceHitGroupID, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+	uint64_t Capacity = *Buffer ? (*Buffer)->Raw->GetDesc().Width : 0;
+	if (Capacity < Table->Layout.Size)
+	{
+		if (*Buffer)
+		{
+			mz_ReleaseResource(Gfx, *Buffer);
+		}
+		Capacity = eastl::max(Capacity * 2, mz_AlignUp((uint64_t)Table->Layout.Size, (uint64_t)(64 * 1024)));
 
-				auto GeometryCB = (mz_PerGeometryRootData*)(Base + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+		auto Desc = CD3DX12_RESOURCE_DESC::Buffer(Capacity);
+		*Buffer = mz_CreateCommittedResource(Gfx, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr);
+		mz_MarkShaderTableDirty(Table, 0, Table->Layout.Size);
+	}
 
-				GeometryCB->ObjectIndex = ObjectIdx;
-				GeometryCB->BaseVertex = Sections[SectionIdx].BaseVertex;
-				GeometryCB->BaseIndex = Sections[SectionIdx].BaseIndex;
+	eastl::vector<mz_ByteRange>& Ranges = Root->ShaderTableUploadRanges;
+	if (mz_TakeShaderTableDirtyRanges(Table, &Ranges) == 0)
+	{
+		return;
+	}
 
-				D3D12_GPU_DESCRIPTOR_HANDLE TableBase = mz_CopyDescriptorsToGPUHeap(Gfx, 1, Scene->TextureSRVs[Material->BaseColorTextureIndex]);
-				if (Material->PBRFactorsTextureIndex != (uint16_t)~0)
-				{
-					mz_CopyDescriptorsToGPUHeap(Gfx, 1, Scene->TextureSRVs[Material->PBRFactorsTextureIndex]);
-				}
-				else
-				{
-					mz_CopyDescriptorsToGPUHeap(Gfx, 1, Scene->TextureSRVs[Material->BaseColorTextureIndex]);
-				}
+	uint64_t UploadSize = 0;
+	for (const mz_ByteRange& Range : Ranges)
+	{
+		UploadSize += Range.Size;
+	}
+	mz_UploadAllocation Staging;
+	mz_AllocateUploadMemory(Gfx, UploadSize, 16, &Staging);
 
-				if (Material->NormalTextureIndex != (uint16_t)~0)
-				{
-					mz_CopyDescriptorsToGPUHeap(Gfx, 1, Scene->TextureSRVs[Material->NormalTextureIndex]);
-				}
-				else
-				{
-					mz_CopyDescriptorsToGPUHeap(Gfx, 1, Scene->TextureSRVs[Material->BaseColorTextureIndex]);
-				}
+	mz_CmdTransitionBarrier(Gfx->CmdList, *Buffer, D3D12_RESOURCE_STATE_COPY_DEST);
+	uint64_t StagingOffset = 0;
+	for (const mz_ByteRange& Range : Ranges)
+	{
+		memcpy(Staging.CPUAddress + StagingOffset, &Table->Data[Range.Offset], Range.Size);
+		Gfx->CmdList->CopyBufferRegion((*Buffer)->Raw, Range.Offset, Staging.Buffer, Staging.Offset + StagingOffset, Range.Size);
+		StagingOffset += Range.Size;
+	}
+	mz_CmdTransitionBarrier(Gfx->CmdList, *Buffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
 
-				*(D3D12_GPU_DESCRIPTOR_HANDLE*)(Base + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 16) = TableBase;
-				Base += HitGroupRecordSize;
+// NOTE: GPU heap and shader table of a frame index are written only while that frame is recorded (the other
+// one may be in flight), each of them replays changes of SceneTables since the version it has applied.
+static void
+mz_UpdateSceneTables(mz_DemoRoot* Root)
+{
+	mz_GraphicsContext* Gfx = Root->Gfx;
+	mz_SceneTables* Tables = &Root->SceneTables;
+	uint64_t* AppliedVersion = &Root->AppliedTableVersions[Gfx->FrameIndex];
 
+	mz_ShaderTable* ShaderTable = &Root->CPUShaderTables[Gfx->FrameIndex];
 
-				// Shader Record 1 (ShadowHitGroup).
-				memcpy(Base, ShadowHitGroupID, D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-				Base += HitGroupRecordSize;
+	// Ray generation and miss records have no local root arguments, two hit group records per mz_HitGroupData.
+	mz_ShaderTableLayout Layout;
+	mz_ComputeShaderTableLayout(0, 2, 0, (uint32_t)Tables->HitGroups.size() * 2, sizeof(mz_PerGeometryRootData) + sizeof(D3D12_GPU_DESCRIPTOR_HANDLE), &Layout);
+	bool bIsLayoutChanged = mz_SetShaderTableLayout(ShaderTable, Layout);
 
-				NumRecordsInHitGroup += 2;
+	const mz_SceneTableChange* Changes;
+	uint32_t NumChanges;
+	if (!bIsLayoutChanged && mz_GetSceneTableChanges(Tables, *AppliedVersion, &Changes, &NumChanges))
+	{
+		for (uint32_t Idx = 0; Idx < NumChanges; ++Idx)
+		{
+			if (Changes[Idx].Type == mz_SCENE_TABLE_CHANGE_MATERIAL)
+			{
+				mz_WriteMaterialDescriptors(Root, Changes[Idx].Index);
+			}
+			else
+			{
+				mz_WriteHitGroupRecords(Root, ShaderTable, Changes[Idx].Index);
 			}
 		}
+	}
+	else
+	{
+		for (uint32_t MaterialIdx = 0; MaterialIdx < Root->Scene.Materials.size(); ++MaterialIdx)
+		{
+			mz_WriteMaterialDescriptors(Root, MaterialIdx);
+		}
+		mz_WriteShaderTable(Root, ShaderTable);
+	}
+	*AppliedVersion = Tables->Version;
+	mz_TrimSceneTableChanges(Tables, eastl::min(Root->AppliedTableVersions[0], Root->AppliedTableVersions[1]));
 
-		mz_SAFE_RELEASE(Props);
-		Root->UploadShaderTables[Gfx->FrameIndex]->Raw->Unmap(0, nullptr);
+	mz_UploadShaderTable(Root);
+}
 
+static void
+mz_Draw(mz_DemoRoot* Root)
+{
+	mz_GraphicsContext* Gfx = Root->Gfx;
+	ID3D12GraphicsCommandList5* CmdList = mz_CmdInit(Gfx);
 
-		mz_CmdTransitionBarrier(Gfx->CmdList, Root->ShaderTables[Gfx->FrameIndex], D3D12_RESOURCE_STATE_COPY_DEST);
+	mz_UpdateStreamedScene(Root->SceneStreamer, Gfx, &Root->Scene, &Root->SceneTables);
 
-		Gfx->CmdList->CopyResource(Root->ShaderTables[Gfx->FrameIndex]->Raw, Root->UploadShaderTables[Gfx->FrameIndex]->Raw);
+	mz_DX12Resource* BackBuffer;
+	D3D12_CPU_DESCRIPTOR_HANDLE BackBufferRTV;
+	mz_GetBackBuffer(Gfx, &BackBuffer, &BackBufferRTV);
 
-		mz_CmdTransitionBarrier(Gfx->CmdList, Root->ShaderTables[Gfx->FrameIndex], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-	}
+	mz_UpdateSceneTables(Root);
 
 	// Raytrace and copy result to the back buffer.
 	{
@@ -204,11 +290,12 @@ mz_Draw(mz_DemoRoot* Root)
 		}
 
 		{
+			const mz_ShaderTableLayout& Layout = Root->CPUShaderTables[Gfx->FrameIndex].Layout;
 			D3D12_GPU_VIRTUAL_ADDRESS Base = Root->ShaderTables[Gfx->FrameIndex]->Raw->GetGPUVirtualAddress();
 			D3D12_DISPATCH_RAYS_DESC DispatchDesc = {};
-			DispatchDesc.RayGenerationShaderRecord = { Base, 32 };
-			DispatchDesc.MissShaderTable = { Base + 64, 64, 32 };
-			DispatchDesc.HitGroupTable = { Base + 128, NumRecordsInHitGroup * HitGroupRecordSize, HitGroupRecordSize };
+			DispatchDesc.RayGenerationShaderRecord = { Base + Layout.RayGenerationOffset, Layout.RayGenerationSize };
+			DispatchDesc.MissShaderTable = { Base + Layout.MissOffset, (uint64_t)Layout.MissStride * Layout.NumMissRecords, Layout.MissStride };
+			DispatchDesc.HitGroupTable = { Base + Layout.HitGroupOffset, (uint64_t)Layout.HitGroupStride * Layout.NumHitGroupRecords, Layout.HitGroupStride };
 			DispatchDesc.Width = Gfx->Resolution[0];
 			DispatchDesc.Height = Gfx->Resolution[1];
 			DispatchDesc.Depth = 1;
@@ -252,66 +339,53 @@ mz_Draw(mz_DemoRoot* Root)
 }
 
 static void
-mz_CreateBLAS(mz_SceneData* Scene, mz_GraphicsContext* Gfx, mz_DX12Resource** OutBLASBuffer, eastl::vector<ID3D12Resource*>* OutTempResources)
+mz_CreateBLAS(mz_SceneData* Scene, uint32_t MeshIdx, mz_GraphicsContext* Gfx, mz_DX12Resource** OutBLASBuffer, eastl::vector<ID3D12Resource*>* OutTempResources)
 {
 	D3D12_RAYTRACING_GEOMETRY_DESC GeometryDescTemplate = {};
 	GeometryDescTemplate.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
 	GeometryDescTemplate.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-	GeometryDescTemplate.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-	GeometryDescTemplate.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
-	GeometryDescTemplate.Triangles.VertexBuffer.StrideInBytes = (uint32_t)sizeof(mz_Vertex);
-
-	eastl::vector<D3D12_RAYTRACING_GEOMETRY_DESC> GeometryDescs;
-	eastl::vector<XMFLOAT3X4> Transforms;
-
-	for (uint32_t ObjectIdx = 0; ObjectIdx < Scene->Objects.size(); ++ObjectIdx)
+#if mz_USE_COMPACT_VERTICES
+	// NOTE: Positions are quantized to mesh bounds, geometry transform maps them back to object space.
+	typedef mz_CompactVertex mz_BLASVertex;
+	GeometryDescTemplate.Triangles.VertexFormat = DXGI_FORMAT_R16G16B16A16_SNORM;
 	{
-		mz_Object* Object = &Scene->Objects[ObjectIdx];
-		mz_Mesh* Mesh = &Scene->Meshes[Object->MeshIndex];
+		const mz_CompactMesh* CompactMesh = &Scene->CompactMeshes[MeshIdx];
+		const float Dequantize[3][4] =
+		{
+			{ CompactMesh->PositionExtent.x, 0.0f, 0.0f, CompactMesh->PositionCenter.x },
+			{ 0.0f, CompactMesh->PositionExtent.y, 0.0f, CompactMesh->PositionCenter.y },
+			{ 0.0f, 0.0f, CompactMesh->PositionExtent.z, CompactMesh->PositionCenter.z },
+		};
 
-		mz_MeshSection* Sections = mz_GetMeshSections(Mesh);
+		// NOTE: Build reads the transform from upload memory, it stays valid until the build is done.
+		mz_UploadAllocation Transform;
+		mz_AllocateUploadMemory(Gfx, sizeof(Dequantize), D3D12_RAYTRACING_TRANSFORM3X4_BYTE_ALIGNMENT, &Transform);
+		memcpy(Transform.CPUAddress, Dequantize, sizeof(Dequantize));
 
-		for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
-		{
-			GeometryDescs.push_back(GeometryDescTemplate);
-			D3D12_RAYTRACING_GEOMETRY_DESC* GeometryDesc = &GeometryDescs.back();
-			GeometryDesc->Triangles.VertexBuffer.StartAddress = Scene->VertexBuffer->Raw->GetGPUVirtualAddress() + Sections[SectionIdx].BaseVertex * sizeof(mz_Vertex);
-			GeometryDesc->Triangles.VertexCount = Sections[SectionIdx].NumVertices;
-			GeometryDesc->Triangles.IndexBuffer = Scene->IndexBuffer->Raw->GetGPUVirtualAddress() + Sections[SectionIdx].BaseIndex * sizeof(uint32_t);
-			GeometryDesc->Triangles.IndexCount = Sections[SectionIdx].NumIndices;
-			Transforms.emplace_back(XMFLOAT3X4{});
-			memcpy(&Transforms.back(), &Object->ObjectToWorld, sizeof(XMFLOAT3X4));
-		}
+		GeometryDescTemplate.Triangles.Transform3x4 = Transform.GPUAddress;
 	}
+#else
+	typedef mz_Vertex mz_BLASVertex;
+	GeometryDescTemplate.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+#endif
+	GeometryDescTemplate.Triangles.VertexBuffer.StrideInBytes = (uint32_t)sizeof(mz_BLASVertex);
 
-	ID3D12Resource* TransformBuffer;
-	{
-		ID3D12Resource* TempTransformBuffer;
-		{
-			CD3DX12_RESOURCE_DESC Desc = CD3DX12_RESOURCE_DESC::Buffer(Transforms.size() * sizeof(Transforms[0]));
-			mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&TempTransformBuffer)));
-			OutTempResources->push_back(TempTransformBuffer);
-
-			void* Addr;
-			mz_VHR(TempTransformBuffer->Map(0, &CD3DX12_RANGE(0, 0), &Addr));
-			memcpy(Addr, Transforms.data(), Transforms.size() * sizeof(Transforms[0]));
-			TempTransformBuffer->Unmap(0, nullptr);
-		}
-
-		// Create TransformBuffer.
-		{
-			CD3DX12_RESOURCE_DESC Desc = CD3DX12_RESOURCE_DESC::Buffer(Transforms.size() * sizeof(Transforms[0]));
-			mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT), D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&TransformBuffer)));
-			OutTempResources->push_back(TransformBuffer);
+	mz_Mesh* Mesh = &Scene->Meshes[MeshIdx];
+	mz_MeshSection* Sections = mz_GetMeshSections(Mesh);
 
-			Gfx->CmdList->CopyResource(TransformBuffer, TempTransformBuffer);
-			Gfx->CmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(TransformBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
-		}
-	}
+	// One geometry per section, in object space. Instance transform is applied by the TLAS.
+	eastl::vector<D3D12_RAYTRACING_GEOMETRY_DESC, mz_ArenaAllocator> GeometryDescs(mz_ArenaAllocator{ &Gfx->FrameArena });
+	GeometryDescs.reserve(Mesh->NumSections);
 
-	for (uint32_t GeometryIdx = 0; GeometryIdx < GeometryDescs.size(); ++GeometryIdx)
+	for (uint32_t SectionIdx = 0; SectionIdx < Mesh->NumSections; ++SectionIdx)
 	{
-		GeometryDescs[GeometryIdx].Triangles.Transform3x4 = TransformBuffer->GetGPUVirtualAddress() + GeometryIdx * sizeof(XMFLOAT3X4);
+		GeometryDescs.push_back(GeometryDescTemplate);
+		D3D12_RAYTRACING_GEOMETRY_DESC* GeometryDesc = &GeometryDescs.back();
+		GeometryDesc->Triangles.VertexBuffer.StartAddress = Scene->VertexBuffer->Raw->GetGPUVirtualAddress() + Sections[SectionIdx].BaseVertex * sizeof(mz_BLASVertex);
+		GeometryDesc->Triangles.VertexCount = Sections[SectionIdx].NumVertices;
+		GeometryDesc->Triangles.IndexFormat = Sections[SectionIdx].IndexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		GeometryDesc->Triangles.IndexBuffer = Scene->IndexBuffer->Raw->GetGPUVirtualAddress() + Sections[SectionIdx].IndexOffset;
+		GeometryDesc->Triangles.IndexCount = Sections[SectionIdx].NumIndices;
 	}
 
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS BLASInputs = {};
@@ -347,44 +421,45 @@ mz_CreateBLAS(mz_SceneData* Scene, mz_GraphicsContext* Gfx, mz_DX12Resource** Ou
 }
 
 static void
-mz_CreateTLAS(mz_DX12Resource* BLASBuffer, mz_GraphicsContext* Gfx, mz_DX12Resource** OutTLASBuffer, eastl::vector<ID3D12Resource*>* OutTempResources)
+mz_CreateTLAS(mz_SceneData* Scene, const eastl::vector<mz_DX12Resource*>& BLASBuffers, mz_GraphicsContext* Gfx, mz_DX12Resource** OutTLASBuffer, eastl::vector<ID3D12Resource*>* OutTempResources)
 {
-	ID3D12Resource* InstanceBuffer;
+	// Hit group records of mesh N start after records of all sections of meshes [0, N), two records (radiance, shadow) per section.
+	eastl::vector<uint32_t, mz_ArenaAllocator> FirstRecord(Scene->Meshes.size(), mz_ArenaAllocator{ &Gfx->FrameArena });
 	{
-		D3D12_RAYTRACING_INSTANCE_DESC InstanceDesc = {};
-		InstanceDesc.InstanceMask = 1;
-		InstanceDesc.AccelerationStructure = BLASBuffer->Raw->GetGPUVirtualAddress();
-		memcpy(&InstanceDesc.Transform, &XMMatrixTranspose(XMMatrixIdentity()), sizeof(InstanceDesc.Transform));
-
-		ID3D12Resource* TempInstanceBuffer;
+		uint32_t NumRecords = 0;
+		for (uint32_t MeshIdx = 0; MeshIdx < Scene->Meshes.size(); ++MeshIdx)
 		{
-			CD3DX12_RESOURCE_DESC Desc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(InstanceDesc));
-			mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&TempInstanceBuffer)));
-			OutTempResources->push_back(TempInstanceBuffer);
-
-			void* Addr;
-			mz_VHR(TempInstanceBuffer->Map(0, &CD3DX12_RANGE(0, 0), &Addr));
-			memcpy(Addr, &InstanceDesc, sizeof(InstanceDesc));
-			TempInstanceBuffer->Unmap(0, nullptr);
+			FirstRecord[MeshIdx] = NumRecords;
+			NumRecords += Scene->Meshes[MeshIdx].NumSections * 2;
 		}
+	}
 
-		// Create InstanceBuffer.
-		{
-			CD3DX12_RESOURCE_DESC Desc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(InstanceDesc));
-			mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT), D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&InstanceBuffer)));
-			OutTempResources->push_back(InstanceBuffer);
-
-			Gfx->CmdList->CopyResource(InstanceBuffer, TempInstanceBuffer);
-			Gfx->CmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(InstanceBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
-		}
+	// One instance per object, InstanceID() is the object index.
+	eastl::vector<D3D12_RAYTRACING_INSTANCE_DESC, mz_ArenaAllocator> InstanceDescs(Scene->Objects.size(), mz_ArenaAllocator{ &Gfx->FrameArena });
+	for (uint32_t ObjectIdx = 0; ObjectIdx < Scene->Objects.size(); ++ObjectIdx)
+	{
+		const mz_Object* Object = &Scene->Objects[ObjectIdx];
+		D3D12_RAYTRACING_INSTANCE_DESC* InstanceDesc = &InstanceDescs[ObjectIdx];
+		memset(InstanceDesc, 0, sizeof(*InstanceDesc));
+		InstanceDesc->InstanceID = ObjectIdx;
+		InstanceDesc->InstanceMask = 1;
+		InstanceDesc->InstanceContributionToHitGroupIndex = FirstRecord[Object->MeshIndex];
+		InstanceDesc->AccelerationStructure = BLASBuffers[Object->MeshIndex]->Raw->GetGPUVirtualAddress();
+		memcpy(&InstanceDesc->Transform, &Object->ObjectToWorld, sizeof(InstanceDesc->Transform));
 	}
+	uint32_t InstanceBufferSize = (uint32_t)(InstanceDescs.size() * sizeof(InstanceDescs[0]));
+
+	// NOTE: Instances are read once by the build, straight from upload memory (no default heap copy).
+	mz_UploadAllocation Instances;
+	mz_AllocateUploadMemory(Gfx, InstanceBufferSize, D3D12_RAYTRACING_INSTANCE_DESCS_BYTE_ALIGNMENT, &Instances);
+	memcpy(Instances.CPUAddress, InstanceDescs.data(), InstanceBufferSize);
 
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS TLASInputs = {};
 	TLASInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
 	TLASInputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
-	TLASInputs.NumDescs = 1;
+	TLASInputs.NumDescs = (uint32_t)InstanceDescs.size();
 	TLASInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-	TLASInputs.InstanceDescs = InstanceBuffer->GetGPUVirtualAddress();
+	TLASInputs.InstanceDescs = Instances.GPUAddress;
 
 	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO TLASBuildInfo = {};
 	Gfx->Device->GetRaytracingAccelerationStructurePrebuildInfo(&TLASInputs, &TLASBuildInfo);
@@ -412,38 +487,32 @@ mz_CreateTLAS(mz_DX12Resource* BLASBuffer, mz_GraphicsContext* Gfx, mz_DX12Resou
 }
 
 static void
-mz_CreateStaticGeometry(mz_DemoRoot* Root, eastl::vector<ID3D12Resource*>* OutTempResources, eastl::vector<mz_DX12Resource*>* OutTexturesThatNeedMipmaps)
+mz_CreateStaticGeometry(mz_DemoRoot* Root, eastl::vector<ID3D12Resource*>* OutTempResources)
 {
 	mz_GraphicsContext* Gfx = Root->Gfx;
 
-	mz_LoadGLTFScene("Data/Sponza/Sponza.gltf", Gfx, &Root->Scene, OutTempResources);
-
-	for (uint32_t Idx = 0; Idx < Root->Scene.Textures.size(); ++Idx)
-	{
-		OutTexturesThatNeedMipmaps->push_back(Root->Scene.Textures[Idx]);
-	}
+	// NOTE: Scene textures come with full mip chains built on the CPU. They are streamed in, first frames are
+	// rendered with placeholders.
+	Root->SceneStreamer = mz_BeginStreamingGLTFScene("Data/Sponza/Sponza.gltf", Gfx, &Root->Scene);
 
 	// ObjectToWorld transformation matrix for each object in the world.
 	{
 		mz_SceneData* Scene = &Root->Scene;
-		ID3D12Resource* TempBuffer;
-		D3D12_RESOURCE_DESC Desc = CD3DX12_RESOURCE_DESC::Buffer(Scene->Objects.size() * sizeof(mz_Transform4x3));
+		uint64_t Size = Scene->Objects.size() * sizeof(mz_Transform4x3);
+		D3D12_RESOURCE_DESC Desc = CD3DX12_RESOURCE_DESC::Buffer(Size);
 		{
-			mz_VHR(Gfx->Device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&TempBuffer)));
-			OutTempResources->push_back(TempBuffer);
+			mz_UploadAllocation Staging;
+			mz_AllocateUploadMemory(Gfx, Size, 16, &Staging);
 
-			mz_Transform4x3* Addr;
-			mz_VHR(TempBuffer->Map(0, &CD3DX12_RANGE(0, 0), (void**)&Addr));
+			auto* Addr = (mz_Transform4x3*)Staging.CPUAddress;
 			for (uint32_t ObjectIdx = 0; ObjectIdx < Scene->Objects.size(); ++ObjectIdx)
 			{
 				memcpy(&Addr[ObjectIdx], &Scene->Objects[ObjectIdx].ObjectToWorld, sizeof(*Addr));
 			}
-			TempBuffer->Unmap(0, nullptr);
-		}
 
-		Root->ObjectTransforms = mz_CreateCommittedResource(Gfx, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr);
-
-		Gfx->CmdList->CopyResource(Root->ObjectTransforms->Raw, TempBuffer);
+			Root->ObjectTransforms = mz_CreateCommittedResource(Gfx, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr);
+			Gfx->CmdList->CopyBufferRegion(Root->ObjectTransforms->Raw, 0, Staging.Buffer, Staging.Offset, Size);
+		}
 
 		mz_CmdTransitionBarrier(Gfx->CmdList, Root->ObjectTransforms, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
@@ -458,8 +527,13 @@ mz_CreateStaticGeometry(mz_DemoRoot* Root, eastl::vector<ID3D12Resource*>* OutTe
 		Gfx->Device->CreateShaderResourceView(Root->ObjectTransforms->Raw, &SRVDesc, Root->ObjectTransformsSRV);
 	}
 
-	mz_CreateBLAS(&Root->Scene, Gfx, &Root->BLASBuffer, OutTempResources);
-	mz_CreateTLAS(Root->BLASBuffer, Gfx, &Root->TLASBuffer, OutTempResources);
+	// NOTE: BLAS memory scales with unique meshes, moving an object only needs TLAS rebuild.
+	Root->BLASBuffers.resize(Root->Scene.Meshes.size());
+	for (uint32_t MeshIdx = 0; MeshIdx < Root->Scene.Meshes.size(); ++MeshIdx)
+	{
+		mz_CreateBLAS(&Root->Scene, MeshIdx, Gfx, &Root->BLASBuffers[MeshIdx], OutTempResources);
+	}
+	mz_CreateTLAS(&Root->Scene, Root->BLASBuffers, Gfx, &Root->TLASBuffer, OutTempResources);
 }
 
 static bool
@@ -478,9 +552,8 @@ mz_Init(mz_DemoRoot* Root)
 	}
 
 	eastl::vector<ID3D12Resource*> TempResources;
-	eastl::vector<mz_DX12Resource*> TexturesThatNeedMipmaps;
 
-	Root->UI = mz_CreateUIContext(Gfx, 1, &TempResources);
+	Root->UI = mz_CreateUIContext(Gfx, 1);
 
 	// Raytracing pipeline.
 	{
@@ -502,21 +575,24 @@ mz_Init(mz_DemoRoot* Root)
 
 		mz_VHR(Gfx->Device->CreateStateObject(&Desc, IID_PPV_ARGS(&Root->RTPipeline)));
 		mz_VHR(Gfx->Device->CreateRootSignature(0, DXIL.data(), DXIL.size(), IID_PPV_ARGS(&Root->RTGlobalSignature)));
-	}
-
-	mz_CreateStaticGeometry(Root, &TempResources, &TexturesThatNeedMipmaps);
 
-	// Create Shader Table.
-	{
-		auto Desc = CD3DX12_RESOURCE_DESC::Buffer(64 * 1024);
-
-		for (uint32_t Idx = 0; Idx < eastl::size(Root->UploadShaderTables); ++Idx)
+		ID3D12StateObjectProperties* Props;
+		mz_VHR(Root->RTPipeline->QueryInterface(IID_PPV_ARGS(&Props)));
+		static const wchar_t* ShaderNames[mz_SHADER_ID_COUNT] = { L"CameraRayGeneration", L"RadianceMiss", L"ShadowMiss", L"RadianceHitGroup", L"ShadowHitGroup" };
+		for (uint32_t Idx = 0; Idx < mz_SHADER_ID_COUNT; ++Idx)
 		{
-			Root->UploadShaderTables[Idx] = mz_CreateCommittedResource(Gfx, D3D12_HEAP_TYPE_UPLOAD, D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr);
-			Root->ShaderTables[Idx] = mz_CreateCommittedResource(Gfx, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_NONE, &Desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr);
+			memcpy(Root->ShaderIDs[Idx], Props->GetShaderIdentifier(ShaderNames[Idx]), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
 		}
+		mz_SAFE_RELEASE(Props);
 	}
 
+	mz_CreateStaticGeometry(Root, &TempResources);
+
+	// NOTE: Tables (and shader table buffers) are written to the GPU by the first frame of each frame index
+	// (applied versions are 0).
+	mz_BuildSceneTables(&Root->Scene, &Root->SceneTables);
+	Root->MaterialDescriptorsBase = mz_AllocatePersistentGPUDescriptors(Gfx, (uint32_t)Root->Scene.Materials.size() * mz_MATERIAL_NUM_TEXTURES);
+
 	// Create output texture for raytracing stage.
 	{
 		auto Desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, Gfx->Resolution[0], Gfx->Resolution[1], 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
@@ -527,29 +603,8 @@ mz_Init(mz_DemoRoot* Root)
 		Gfx->Device->CreateUnorderedAccessView(Root->RTOutput->Raw, nullptr, nullptr, Root->RTOutputUAV);
 	}
 
-	// Execute "data upload" and "data generation" GPU commands, create mipmaps etc. Destroy temp resources when GPU is done.
+	// Execute "data upload" and "data generation" GPU commands. Destroy temp resources when GPU is done.
 	{
-		DXGI_FORMAT Formats[] = { DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R8G8B8A8_UNORM };
-		mz_MipmapGenerator* MipmapGenerators[eastl::size(Formats)] = {};
-		for (uint32_t Idx = 0; Idx < eastl::size(Formats); ++Idx)
-		{
-			MipmapGenerators[Idx] = mz_CreateMipmapGenerator(Root->Gfx, Formats[Idx]);
-		}
-
-		for (mz_DX12Resource* Texture : TexturesThatNeedMipmaps)
-		{
-			D3D12_RESOURCE_DESC Desc = Texture->Raw->GetDesc();
-
-			for (uint32_t Idx = 0; Idx < eastl::size(Formats); ++Idx)
-			{
-				if (Desc.Format == Formats[Idx])
-				{
-					mz_GenerateMipmaps(MipmapGenerators[Idx], Root->Gfx, Texture);
-					break;
-				}
-			}
-		}
-
 		Root->Gfx->CmdList->Close();
 		Root->Gfx->CmdQueue->ExecuteCommandLists(1, CommandListCast(&Root->Gfx->CmdList));
 		mz_WaitForGPU(Root->Gfx);
@@ -558,10 +613,6 @@ mz_Init(mz_DemoRoot* Root)
 		{
 			mz_SAFE_RELEASE(Resource);
 		}
-		for (uint32_t Idx = 0; Idx < eastl::size(MipmapGenerators); ++Idx)
-		{
-			mz_DestroyMipmapGenerator(MipmapGenerators[Idx]);
-		}
 	}
 
 	Root->CameraPosition = XMFLOAT3(0.0f, 0.5f, 0.0f);
@@ -575,10 +626,11 @@ mz_Shutdown(mz_DemoRoot* Root)
 {
 	mz_SAFE_RELEASE(Root->RTPipeline);
 	mz_SAFE_RELEASE(Root->RTGlobalSignature);
-	for (uint32_t Idx = 0; Idx < Root->Scene.Meshes.size(); ++Idx)
+	if (Root->SceneStreamer)
 	{
-		mz_DestroyMesh(&Root->Scene.Meshes[Idx]);
+		mz_EndStreaming(Root->SceneStreamer);
 	}
+	mz_DestroySceneData(&Root->Scene);
 	mz_DestroyUIContext(Root->UI);
 }
 
@@ -586,6 +638,7 @@ static int32_t
 mz_Run(mz_DemoRoot* Root)
 {
 	ImGui::CreateContext();
+	mz_InitJobSystem(0);
 
 	HWND Window = mz_CreateWindow(mz_DEMO_NAME, 1920, 1080);
 	Root->Gfx = mz_CreateGraphicsContext(Window, /*bShouldCreateDepthBuffer*/false);
@@ -615,6 +668,7 @@ mz_Run(mz_DemoRoot* Root)
 	mz_WaitForGPU(Root->Gfx);
 	mz_Shutdown(Root);
 	mz_DestroyGraphicsContext(Root->Gfx);
+	mz_ShutdownJobSystem();
 	ImGui::DestroyContext();
 
 	return 0;
@@ -0,0 +1,746 @@
+#include "TextureCompression.h"
+#include <math.h>
+#include <float.h>
+#include <emmintrin.h>
+
+//
+// Common.
+//
+// Principal axis of the points (power iteration on covariance matrix), used as the line along which endpoints are
+// searched. Falls back to the diagonal when all points are equal.
+static void
+mz_ComputePrincipalAxis(const float (*Points)[4], uint32_t NumChannels, const float* Mean, float* OutAxis)
+{
+	float Covariance[4][4] = {};
+	for (uint32_t Idx = 0; Idx < 16; ++Idx)
+	{
+		for (uint32_t Row = 0; Row < NumChannels; ++Row)
+		{
+			for (uint32_t Column = 0; Column < NumChannels; ++Column)
+			{
+				Covariance[Row][Column] += (Points[Idx][Row] - Mean[Row]) * (Points[Idx][Column] - Mean[Column]);
+			}
+		}
+	}
+
+	float Axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (uint32_t Iteration = 0; Iteration < 8; ++Iteration)
+	{
+		float NewAxis[4] = {};
+		float MaxComponent = 0.0f;
+		for (uint32_t Row = 0; Row < NumChannels; ++Row)
+		{
+			for (uint32_t Column = 0; Column < NumChannels; ++Column)
+			{
+				NewAxis[Row] += Covariance[Row][Column] * Axis[Column];
+			}
+			MaxComponent = fmaxf(MaxComponent, fabsf(NewAxis[Row]));
+		}
+		if (MaxComponent < 1.0e-6f)
+		{
+			break;
+		}
+		for (uint32_t Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			Axis[Channel] = NewAxis[Channel] / MaxComponent;
+		}
+	}
+
+	float Length = 0.0f;
+	for (uint32_t Channel = 0; Channel < NumChannels; ++Channel)
+	{
+		Length += Axis[Channel] * Axis[Channel];
+	}
+	Length = sqrtf(Length);
+	for (uint32_t Channel = 0; Channel < NumChannels; ++Channel)
+	{
+		OutAxis[Channel] = Axis[Channel] / Length;
+	}
+}
+
+// Initial endpoints: extremes of the points projected on the principal axis.
+static void
+mz_ComputeEndpoints(const float (*Points)[4], uint32_t NumChannels, float* OutEndpoint0, float* OutEndpoint1)
+{
+	float Mean[4] = {};
+	for (uint32_t Idx = 0; Idx < 16; ++Idx)
+	{
+		for (uint32_t Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			Mean[Channel] += Points[Idx][Channel] * (1.0f / 16.0f);
+		}
+	}
+
+	float Axis[4];
+	mz_ComputePrincipalAxis(Points, NumChannels, Mean, Axis);
+
+	float MinT = FLT_MAX;
+	float MaxT = -FLT_MAX;
+	for (uint32_t Idx = 0; Idx < 16; ++Idx)
+	{
+		float T = 0.0f;
+		for (uint32_t Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			T += (Points[Idx][Channel] - Mean[Channel]) * Axis[Channel];
+		}
+		MinT = fminf(MinT, T);
+		MaxT = fmaxf(MaxT, T);
+	}
+
+	for (uint32_t Channel = 0; Channel < NumChannels; ++Channel)
+	{
+		OutEndpoint0[Channel] = Mean[Channel] + Axis[Channel] * MinT;
+		OutEndpoint1[Channel] = Mean[Channel] + Axis[Channel] * MaxT;
+	}
+}
+
+// Least squares endpoints for fixed indices, Weights[Idx] is interpolation factor of texel Idx (0 - Endpoint0).
+// Returns false when the system is degenerate (all texels use the same weight).
+static bool
+mz_RefineEndpoints(const float (*Points)[4], uint32_t NumChannels, const float* Weights, float* OutEndpoint0, float* OutEndpoint1)
+{
+	float A = 0.0f, B = 0.0f, C = 0.0f;
+	float Rhs0[4] = {};
+	float Rhs1[4] = {};
+	for (uint32_t Idx = 0; Idx < 16; ++Idx)
+	{
+		float W1 = Weights[Idx];
+		float W0 = 1.0f - W1;
+		A += W0 * W0;
+		B += W0 * W1;
+		C += W1 * W1;
+		for (uint32_t Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			Rhs0[Channel] += W0 * Points[Idx][Channel];
+			Rhs1[Channel] += W1 * Points[Idx][Channel];
+		}
+	}
+
+	float Determinant = A * C - B * B;
+	if (fabsf(Determinant) < 1.0e-6f)
+	{
+		return false;
+	}
+	for (uint32_t Channel = 0; Channel < NumChannels; ++Channel)
+	{
+		OutEndpoint0[Channel] = fminf(fmaxf((C * Rhs0[Channel] - B * Rhs1[Channel]) / Determinant, 0.0f), 255.0f);
+		OutEndpoint1[Channel] = fminf(fmaxf((A * Rhs1[Channel] - B * Rhs0[Channel]) / Determinant, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+static void
+mz_LoadBlockPoints(const uint8_t* Texels, uint32_t NumChannels, float (*OutPoints)[4])
+{
+	for (uint32_t Idx = 0; Idx < 16; ++Idx)
+	{
+		for (uint32_t Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			OutPoints[Idx][Channel] = (float)Texels[Idx * 4 + Channel];
+		}
+	}
+}
+
+//
+// BC1.
+//
+static uint16_t
+mz_QuantizeRGB565(const float* Color)
+{
+	uint32_t R = (uint32_t)fminf(fmaxf(Color[0] * (31.0f / 255.0f) + 0.5f, 0.0f), 31.0f);
+	uint32_t G = (uint32_t)fminf(fmaxf(Color[1] * (63.0f / 255.0f) + 0.5f, 0.0f), 63.0f);
+	uint32_t B = (uint32_t)fminf(fmaxf(Color[2] * (31.0f / 255.0f) + 0.5f, 0.0f), 31.0f);
+	return (uint16_t)((R << 11) | (G << 5) | B);
+}
+
+static void
+mz_ExpandRGB565(uint16_t Color, int32_t* OutColor)
+{
+	uint32_t R = (Color >> 11) & 31;
+	uint32_t G = (Color >> 5) & 63;
+	uint32_t B = Color & 31;
+	OutColor[0] = (int32_t)((R << 3) | (R >> 2));
+	OutColor[1] = (int32_t)((G << 2) | (G >> 4));
+	OutColor[2] = (int32_t)((B << 3) | (B >> 2));
+}
+
+// Indices and squared error of the block encoded with given endpoints (4 color mode, Color0 > Color1).
+static uint32_t
+mz_EvaluateBC1(const uint8_t* Texels, uint16_t Color0, uint16_t Color1, uint32_t* OutIndices)
+{
+	int32_t Palette[4][3];
+	mz_ExpandRGB565(Color0, Palette[0]);
+	mz_ExpandRGB565(Color1, Palette[1]);
+	for (uint32_t Channel = 0; Channel < 3; ++Channel)
+	{
+		Palette[2][Channel] = (2 * Palette[0][Channel] + Palette[1][Channel] + 1) / 3;
+		Palette[3][Channel] = (Palette[0][Channel] + 2 * Palette[1][Channel] + 1) / 3;
+	}
+
+	uint32_t Indices = 0;
+	uint32_t Error = 0;
+	for (uint32_t Idx = 0; Idx < 16; ++Idx)
+	{
+		uint32_t BestIndex = 0;
+		uint32_t BestError = UINT32_MAX;
+		for (uint32_t PaletteIdx = 0; PaletteIdx < 4; ++PaletteIdx)
+		{
+			uint32_t TexelError = 0;
+			for (uint32_t Channel = 0; Channel < 3; ++Channel)
+			{
+				int32_t D = (int32_t)Texels[Idx * 4 + Channel] - Palette[PaletteIdx][Channel];
+				TexelError += (uint32_t)(D * D);
+			}
+			if (TexelError < BestError)
+			{
+				BestError = TexelError;
+				BestIndex = PaletteIdx;
+			}
+		}
+		Indices |= BestIndex << (Idx * 2);
+		Error += BestError;
+	}
+	*OutIndices = Indices;
+	return Error;
+}
+
+void
+mz_EncodeBC1Block(const uint8_t* Texels, uint8_t* OutBlock)
+{
+	float Points[16][4];
+	mz_LoadBlockPoints(Texels, 3, Points);
+
+	float Endpoint0[4], Endpoint1[4];
+	mz_ComputeEndpoints(Points, 3, Endpoint1, Endpoint0);
+
+	uint16_t BestColor0 = 0;
+	uint16_t BestColor1 = 0;
+	uint32_t BestIndices = 0;
+	uint32_t BestError = UINT32_MAX;
+
+	for (uint32_t Iteration = 0; Iteration < 3; ++Iteration)
+	{
+		uint16_t Color0 = mz_QuantizeRGB565(Endpoint0);
+		uint16_t Color1 = mz_QuantizeRGB565(Endpoint1);
+		if (Color0 < Color1)
+		{
+			uint16_t T = Color0; Color0 = Color1; Color1 = T;
+		}
+		else if (Color0 == Color1)
+		{
+			// NOTE: 3 color mode, index 0 selects Color0.
+			int32_t Color[3];
+			mz_ExpandRGB565(Color0, Color);
+			uint32_t Error = 0;
+			for (uint32_t Idx = 0; Idx < 16; ++Idx)
+			{
+				for (uint32_t Channel = 0; Channel < 3; ++Channel)
+				{
+					int32_t D = (int32_t)Texels[Idx * 4 + Channel] - Color[Channel];
+					Error += (uint32_t)(D * D);
+				}
+			}
+			if (Error < BestError)
+			{
+				BestColor0 = BestColor1 = Color0;
+				BestIndices = 0;
+				BestError = Error;
+			}
+			break;
+		}
+
+		uint32_t Indices;
+		uint32_t Error = mz_EvaluateBC1(Texels, Color0, Color1, &Indices);
+		if (Error < BestError)
+		{
+			BestColor0 = Color0;
+			BestColor1 = Color1;
+			BestIndices = Indices;
+			BestError = Error;
+		}
+		if (Error == 0)
+		{
+			break;
+		}
+
+		static const float IndexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		float Weights[16];
+		for (uint32_t Idx = 0; Idx < 16; ++Idx)
+		{
+			Weights[Idx] = IndexWeights[(Indices >> (Idx * 2)) & 3];
+		}
+		if (!mz_RefineEndpoints(Points, 3, Weights, Endpoint0, Endpoint1))
+		{
+			break;
+		}
+	}
+
+	OutBlock[0] = (uint8_t)BestColor0;
+	OutBlock[1] = (uint8_t)(BestColor0 >> 8);
+	OutBlock[2] = (uint8_t)BestColor1;
+	OutBlock[3] = (uint8_t)(BestColor1 >> 8);
+	memcpy(&OutBlock[4], &BestIndices, 4);
+}
+
+//
+// BC4, BC3 and BC5.
+//
+void
+mz_EncodeBC4Block(const uint8_t* Texels, uint32_t Channel, uint8_t* OutBlock)
+{
+	uint32_t MinValue = 255;
+	uint32_t MaxValue = 0;
+	for (uint32_t Idx = 0; Idx < 16; ++Idx)
+	{
+		uint32_t Value = Texels[Idx * 4 + Channel];
+		MinValue = Value < MinValue ? Value : MinValue;
+		MaxValue = Value > MaxValue ? Value : MaxValue;
+	}
+
+	// 8 value mode (Value0 > Value1), indices 2-7 interpolate between the endpoints.
+	int32_t Palette[8];
+	Palette[0] = (int32_t)MaxValue;
+	Palette[1] = (int32_t)MinValue;
+	for (int32_t Idx = 2; Idx < 8; ++Idx)
+	{
+		Palette[Idx] = ((8 - Idx) * Palette[0] + (Idx - 1) * Palette[1] + 3) / 7;
+	}
+
+	uint64_t Indices = 0;
+	if (MinValue != MaxValue)
+	{
+		for (uint32_t Idx = 0; Idx < 16; ++Idx)
+		{
+			int32_t Value = Texels[Idx * 4 + Channel];
+			uint64_t BestIndex = 0;
+			int32_t BestError = INT32_MAX;
+			for (uint32_t PaletteIdx = 0; PaletteIdx < 8; ++PaletteIdx)
+			{
+				int32_t Error = abs(Value - Palette[PaletteIdx]);
+				if (Error < BestError)
+				{
+					BestError = Error;
+					BestIndex = PaletteIdx;
+				}
+			}
+			Indices |= BestIndex << (Idx * 3);
+		}
+	}
+
+	OutBlock[0] = (uint8_t)MaxValue;
+	OutBlock[1] = (uint8_t)MinValue;
+	for (uint32_t Idx = 0; Idx < 6; ++Idx)
+	{
+		OutBlock[2 + Idx] = (uint8_t)(Indices >> (Idx * 8));
+	}
+}
+
+void
+mz_EncodeBC3Block(const uint8_t* Texels, uint8_t* OutBlock)
+{
+	mz_EncodeBC4Block(Texels, 3, &OutBlock[0]);
+	mz_EncodeBC1Block(Texels, &OutBlock[8]);
+}
+
+void
+mz_EncodeBC5Block(const uint8_t* Texels, uint8_t* OutBlock)
+{
+	mz_EncodeBC4Block(Texels, 0, &OutBlock[0]);
+	mz_EncodeBC4Block(Texels, 1, &OutBlock[8]);
+}
+
+//
+// BC7.
+//
+// NOTE: Only mode 6 is used (single subset, RGBA 7.7.7.7 endpoints + unique p-bit, 4-bit indices). It is not
+// as good as an exhaustive search over all modes and partitions but it is fast and handles ORM maps and gradients much
+// better than BC1.
+static const uint32_t GBC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static void
+mz_WriteBits(uint8_t* Block, uint32_t* InOutOffset, uint32_t Value, uint32_t NumBits)
+{
+	for (uint32_t Bit = 0; Bit < NumBits; ++Bit, ++*InOutOffset)
+	{
+		Block[*InOutOffset >> 3] |= (uint8_t)(((Value >> Bit) & 1) << (*InOutOffset & 7));
+	}
+}
+
+// Picks p-bit that gives the smallest endpoint error, outputs 7-bit values.
+static uint32_t
+mz_QuantizeBC7Endpoint(const float* Endpoint, uint32_t* OutValues)
+{
+	uint32_t BestPBit = 0;
+	float BestError = FLT_MAX;
+	for (uint32_t PBit = 0; PBit < 2; ++PBit)
+	{
+		uint32_t Values[4];
+		float Error = 0.0f;
+		for (uint32_t Channel = 0; Channel < 4; ++Channel)
+		{
+			Values[Channel] = (uint32_t)fminf(fmaxf((Endpoint[Channel] - PBit) * 0.5f + 0.5f, 0.0f), 127.0f);
+			float D = (float)((Values[Channel] << 1) | PBit) - Endpoint[Channel];
+			Error += D * D;
+		}
+		if (Error < BestError)
+		{
+			BestError = Error;
+			BestPBit = PBit;
+			memcpy(OutValues, Values, sizeof(Values));
+		}
+	}
+	return BestPBit;
+}
+
+static uint32_t
+mz_EvaluateBC7Mode6(const uint8_t* Texels, const uint32_t* Values0, uint32_t PBit0, const uint32_t* Values1, uint32_t PBit1, uint8_t* OutIndices)
+{
+	int32_t Palette[16][4];
+	for (uint32_t Channel = 0; Channel < 4; ++Channel)
+	{
+		uint32_t E0 = (Values0[Channel] << 1) | PBit0;
+		uint32_t E1 = (Values1[Channel] << 1) | PBit1;
+		for (uint32_t PaletteIdx = 0; PaletteIdx < 16; ++PaletteIdx)
+		{
+			Palette[PaletteIdx][Channel] = (int32_t)(((64 - GBC7Weights4[PaletteIdx]) * E0 + GBC7Weights4[PaletteIdx] * E1 + 32) >> 6);
+		}
+	}
+
+	uint32_t Error = 0;
+	for (uint32_t Idx = 0; Idx < 16; ++Idx)
+	{
+		uint32_t BestIndex = 0;
+		uint32_t BestError = UINT32_MAX;
+		for (uint32_t PaletteIdx = 0; PaletteIdx < 16; ++PaletteIdx)
+		{
+			uint32_t TexelError = 0;
+			for (uint32_t Channel = 0; Channel < 4; ++Channel)
+			{
+				int32_t D = (int32_t)Texels[Idx * 4 + Channel] - Palette[PaletteIdx][Channel];
+				TexelError += (uint32_t)(D * D);
+			}
+			if (TexelError < BestError)
+			{
+				BestError = TexelError;
+				BestIndex = PaletteIdx;
+			}
+		}
+		OutIndices[Idx] = (uint8_t)BestIndex;
+		Error += BestError;
+	}
+	return Error;
+}
+
+void
+mz_EncodeBC7Block(const uint8_t* Texels, uint8_t* OutBlock)
+{
+	float Points[16][4];
+	mz_LoadBlockPoints(Texels, 4, Points);
+
+	float Endpoint0[4], Endpoint1[4];
+	mz_ComputeEndpoints(Points, 4, Endpoint0, Endpoint1);
+
+	uint32_t BestValues[2][4] = {};
+	uint32_t BestPBits[2] = {};
+	uint8_t BestIndices[16] = {};
+	uint32_t BestError = UINT32_MAX;
+
+	for (uint32_t Iteration = 0; Iteration < 3; ++Iteration)
+	{
+		uint32_t Values[2][4];
+		uint32_t PBits[2];
+		PBits[0] = mz_QuantizeBC7Endpoint(Endpoint0, Values[0]);
+		PBits[1] = mz_QuantizeBC7Endpoint(Endpoint1, Values[1]);
+
+		uint8_t Indices[16];
+		uint32_t Error = mz_EvaluateBC7Mode6(Texels, Values[0], PBits[0], Values[1], PBits[1], Indices);
+		if (Error < BestError)
+		{
+			memcpy(BestValues, Values, sizeof(Values));
+			memcpy(BestPBits, PBits, sizeof(PBits));
+			memcpy(BestIndices, Indices, sizeof(Indices));
+			BestError = Error;
+		}
+		if (Error == 0)
+		{
+			break;
+		}
+
+		float Weights[16];
+		for (uint32_t Idx = 0; Idx < 16; ++Idx)
+		{
+			Weights[Idx] = GBC7Weights4[Indices[Idx]] * (1.0f / 64.0f);
+		}
+		if (!mz_RefineEndpoints(Points, 4, Weights, Endpoint0, Endpoint1))
+		{
+			break;
+		}
+	}
+
+	// NOTE: MSB of the first index is implicitly zero, endpoints are swapped when it would be set.
+	uint32_t First = 0;
+	uint32_t Second = 1;
+	if (BestIndices[0] >= 8)
+	{
+		First = 1;
+		Second = 0;
+		for (uint32_t Idx = 0; Idx < 16; ++Idx)
+		{
+			BestIndices[Idx] = (uint8_t)(15 - BestIndices[Idx]);
+		}
+	}
+
+	memset(OutBlock, 0, 16);
+	uint32_t Offset = 0;
+	mz_WriteBits(OutBlock, &Offset, 1 << 6, 7);
+	for (uint32_t Channel = 0; Channel < 4; ++Channel)
+	{
+		mz_WriteBits(OutBlock, &Offset, BestValues[First][Channel], 7);
+		mz_WriteBits(OutBlock, &Offset, BestValues[Second][Channel], 7);
+	}
+	mz_WriteBits(OutBlock, &Offset, BestPBits[First], 1);
+	mz_WriteBits(OutBlock, &Offset, BestPBits[Second], 1);
+	mz_WriteBits(OutBlock, &Offset, BestIndices[0], 3);
+	for (uint32_t Idx = 1; Idx < 16; ++Idx)
+	{
+		mz_WriteBits(OutBlock, &Offset, BestIndices[Idx], 4);
+	}
+	mz_ASSERT(Offset == 128);
+}
+
+//
+// Images.
+//
+uint32_t
+mz_GetBlockSize(mz_ImageFormat Format)
+{
+	switch (Format)
+	{
+	case mz_IMAGE_FORMAT_RGBA8: return 4;
+	case mz_IMAGE_FORMAT_BC1: return 8;
+	case mz_IMAGE_FORMAT_BC3: return 16;
+	case mz_IMAGE_FORMAT_BC5: return 16;
+	case mz_IMAGE_FORMAT_BC7: return 16;
+	}
+	mz_ASSERT(0);
+	return 0;
+}
+
+uint32_t
+mz_GetNumMips(uint32_t Width, uint32_t Height)
+{
+	uint32_t NumMips = 1;
+	while (Width > 1 || Height > 1)
+	{
+		Width = Width > 1 ? Width / 2 : 1;
+		Height = Height > 1 ? Height / 2 : 1;
+		NumMips++;
+	}
+	return NumMips;
+}
+
+size_t
+mz_GetImageDataSize(mz_ImageFormat Format, uint32_t Width, uint32_t Height, uint32_t NumMips)
+{
+	uint32_t BlockDim = Format == mz_IMAGE_FORMAT_RGBA8 ? 1 : 4;
+	size_t Size = 0;
+	for (uint32_t MipIdx = 0; MipIdx < NumMips; ++MipIdx)
+	{
+		uint32_t MipWidth = eastl::max(Width >> MipIdx, 1u);
+		uint32_t MipHeight = eastl::max(Height >> MipIdx, 1u);
+		Size += (size_t)((MipWidth + BlockDim - 1) / BlockDim) * ((MipHeight + BlockDim - 1) / BlockDim) * mz_GetBlockSize(Format);
+	}
+	return Size;
+}
+
+void
+mz_CompressImage(const uint8_t* Pixels, uint32_t Width, uint32_t Height, mz_ImageFormat Format, uint8_t* OutData)
+{
+	if (Format == mz_IMAGE_FORMAT_RGBA8)
+	{
+		memcpy(OutData, Pixels, (size_t)Width * Height * 4);
+		return;
+	}
+
+	uint32_t BlockSize = mz_GetBlockSize(Format);
+	uint32_t NumBlocksX = (Width + 3) / 4;
+	uint32_t NumBlocksY = (Height + 3) / 4;
+
+	for (uint32_t BlockY = 0; BlockY < NumBlocksY; ++BlockY)
+	{
+		for (uint32_t BlockX = 0; BlockX < NumBlocksX; ++BlockX)
+		{
+			uint8_t Texels[16 * 4];
+			for (uint32_t Y = 0; Y < 4; ++Y)
+			{
+				uint32_t SrcY = eastl::min(BlockY * 4 + Y, Height - 1);
+				for (uint32_t X = 0; X < 4; ++X)
+				{
+					uint32_t SrcX = eastl::min(BlockX * 4 + X, Width - 1);
+					memcpy(&Texels[(Y * 4 + X) * 4], &Pixels[((size_t)SrcY * Width + SrcX) * 4], 4);
+				}
+			}
+
+			uint8_t* Block = &OutData[((size_t)BlockY * NumBlocksX + BlockX) * BlockSize];
+			switch (Format)
+			{
+			case mz_IMAGE_FORMAT_BC1: mz_EncodeBC1Block(Texels, Block); break;
+			case mz_IMAGE_FORMAT_BC3: mz_EncodeBC3Block(Texels, Block); break;
+			case mz_IMAGE_FORMAT_BC5: mz_EncodeBC5Block(Texels, Block); break;
+			case mz_IMAGE_FORMAT_BC7: mz_EncodeBC7Block(Texels, Block); break;
+			default: mz_ASSERT(0);
+			}
+		}
+	}
+}
+
+//
+// Mipmaps.
+//
+// NOTE: sRGB data is filtered in linear space (gamma 2.2, the same curve the shaders use). Encoding table is
+// indexed by square root of the linear value, which keeps enough precision for dark colors.
+#define mz_LINEAR_TO_SRGB_TABLE_SIZE 4096
+
+struct mz_MipTables
+{
+	float SRGBToLinear[256];
+	float UNormToFloat[256];
+	uint8_t LinearToSRGB[mz_LINEAR_TO_SRGB_TABLE_SIZE];
+};
+
+static mz_MipTables
+mz_CreateMipTables()
+{
+	mz_MipTables Tables;
+	for (uint32_t Idx = 0; Idx < 256; ++Idx)
+	{
+		Tables.SRGBToLinear[Idx] = powf(Idx / 255.0f, 2.2f);
+		Tables.UNormToFloat[Idx] = Idx / 255.0f;
+	}
+	for (uint32_t Idx = 0; Idx < mz_LINEAR_TO_SRGB_TABLE_SIZE; ++Idx)
+	{
+		float T = Idx / (float)(mz_LINEAR_TO_SRGB_TABLE_SIZE - 1);
+		Tables.LinearToSRGB[Idx] = (uint8_t)(powf(T * T, 1.0f / 2.2f) * 255.0f + 0.5f);
+	}
+	return Tables;
+}
+
+static inline __m128
+mz_LoadTexel(const uint8_t* Texel, const float* ToFloat)
+{
+	return _mm_set_ps(Texel[3] * (1.0f / 255.0f), ToFloat[Texel[2]], ToFloat[Texel[1]], ToFloat[Texel[0]]);
+}
+
+static inline void
+mz_StoreTexel(__m128 Color, const uint8_t* LinearToSRGB, uint8_t* OutTexel)
+{
+	Color = _mm_min_ps(_mm_max_ps(Color, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+	__m128i UNorm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(Color, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+	UNorm = _mm_packs_epi32(UNorm, UNorm);
+	uint32_t Packed = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(UNorm, UNorm));
+	memcpy(OutTexel, &Packed, 4);
+
+	if (LinearToSRGB)
+	{
+		const float Scale = (float)(mz_LINEAR_TO_SRGB_TABLE_SIZE - 1);
+		__m128i Index = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(Color), _mm_set1_ps(Scale)), _mm_set1_ps(0.5f)));
+		alignas(16) int32_t Indices[4];
+		_mm_store_si128((__m128i*)Indices, Index);
+		OutTexel[0] = LinearToSRGB[Indices[0]];
+		OutTexel[1] = LinearToSRGB[Indices[1]];
+		OutTexel[2] = LinearToSRGB[Indices[2]];
+	}
+}
+
+// Box filter footprint of destination texel. Odd source sizes use 3 taps so that every source texel contributes
+// equally (2 * DstSize + 1 source texels over DstSize destination texels).
+struct mz_MipTaps
+{
+	uint32_t First;
+	uint32_t Count;
+	float Weights[3];
+};
+
+static void
+mz_ComputeMipTaps(uint32_t SrcSize, uint32_t DstSize, uint32_t DstIdx, mz_MipTaps* OutTaps)
+{
+	if (SrcSize == 1)
+	{
+		*OutTaps = { 0, 1, { 1.0f, 0.0f, 0.0f } };
+	}
+	else if (SrcSize % 2 == 0)
+	{
+		*OutTaps = { DstIdx * 2, 2, { 0.5f, 0.5f, 0.0f } };
+	}
+	else
+	{
+		float Scale = 1.0f / (2 * DstSize + 1);
+		*OutTaps = { DstIdx * 2, 3, { (DstSize - DstIdx) * Scale, DstSize * Scale, (DstIdx + 1) * Scale } };
+	}
+}
+
+static void
+mz_GenerateMip(const uint8_t* Src, uint32_t SrcWidth, uint32_t SrcHeight, const mz_MipTables& Tables, bool bIsSRGB, uint8_t* Dst)
+{
+	uint32_t DstWidth = eastl::max(SrcWidth / 2, 1u);
+	uint32_t DstHeight = eastl::max(SrcHeight / 2, 1u);
+	const float* ToFloat = bIsSRGB ? Tables.SRGBToLinear : Tables.UNormToFloat;
+	const uint8_t* LinearToSRGB = bIsSRGB ? Tables.LinearToSRGB : nullptr;
+
+	eastl::vector<mz_MipTaps> ColumnTaps(DstWidth);
+	for (uint32_t X = 0; X < DstWidth; ++X)
+	{
+		mz_ComputeMipTaps(SrcWidth, DstWidth, X, &ColumnTaps[X]);
+	}
+
+	// Vertical pass into one row of linear colors, then horizontal pass.
+	eastl::vector<float> Row((size_t)SrcWidth * 4);
+
+	for (uint32_t Y = 0; Y < DstHeight; ++Y)
+	{
+		mz_MipTaps RowTaps;
+		mz_ComputeMipTaps(SrcHeight, DstHeight, Y, &RowTaps);
+
+		for (uint32_t X = 0; X < SrcWidth; ++X)
+		{
+			__m128 Sum = _mm_setzero_ps();
+			for (uint32_t Tap = 0; Tap < RowTaps.Count; ++Tap)
+			{
+				const uint8_t* Texel = &Src[((size_t)(RowTaps.First + Tap) * SrcWidth + X) * 4];
+				Sum = _mm_add_ps(Sum, _mm_mul_ps(mz_LoadTexel(Texel, ToFloat), _mm_set1_ps(RowTaps.Weights[Tap])));
+			}
+			_mm_storeu_ps(&Row[(size_t)X * 4], Sum);
+		}
+
+		for (uint32_t X = 0; X < DstWidth; ++X)
+		{
+			const mz_MipTaps& Taps = ColumnTaps[X];
+			__m128 Sum = _mm_setzero_ps();
+			for (uint32_t Tap = 0; Tap < Taps.Count; ++Tap)
+			{
+				Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(&Row[(size_t)(Taps.First + Tap) * 4]), _mm_set1_ps(Taps.Weights[Tap])));
+			}
+			mz_StoreTexel(Sum, LinearToSRGB, &Dst[((size_t)Y * DstWidth + X) * 4]);
+		}
+	}
+}
+
+void
+mz_GenerateMipChain(const uint8_t* Pixels, uint32_t Width, uint32_t Height, bool bIsSRGB, uint8_t* OutMips)
+{
+	static const mz_MipTables Tables = mz_CreateMipTables();
+
+	memcpy(OutMips, Pixels, (size_t)Width * Height * 4);
+
+	uint32_t NumMips = mz_GetNumMips(Width, Height);
+	for (uint32_t MipIdx = 1; MipIdx < NumMips; ++MipIdx)
+	{
+		uint8_t* Mip = OutMips + (size_t)Width * Height * 4;
+		mz_GenerateMip(OutMips, Width, Height, Tables, bIsSRGB, Mip);
+
+		OutMips = Mip;
+		Width = eastl::max(Width / 2, 1u);
+		Height = eastl::max(Height / 2, 1u);
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Library.h"
+
+// NOTE: All encoders take 4x4 block of R8G8B8A8 texels (64 bytes, row by row). Images are padded to whole
+// blocks by replicating edge texels.
+
+#define mz_TEXTURE_COMPRESSION_VERSION 2
+
+void mz_EncodeBC1Block(const uint8_t* Texels, uint8_t* OutBlock); // RGB, 8 bytes.
+void mz_EncodeBC4Block(const uint8_t* Texels, uint32_t Channel, uint8_t* OutBlock); // Single channel, 8 bytes.
+void mz_EncodeBC3Block(const uint8_t* Texels, uint8_t* OutBlock); // RGBA, 16 bytes.
+void mz_EncodeBC5Block(const uint8_t* Texels, uint8_t* OutBlock); // RG, 16 bytes.
+void mz_EncodeBC7Block(const uint8_t* Texels, uint8_t* OutBlock); // RGBA, 16 bytes (mode 6 only).
+
+uint32_t mz_GetBlockSize(mz_ImageFormat Format); // In bytes, 4 for mz_IMAGE_FORMAT_RGBA8 (single texel).
+uint32_t mz_GetNumMips(uint32_t Width, uint32_t Height); // Full chain, down to 1x1.
+size_t mz_GetImageDataSize(mz_ImageFormat Format, uint32_t Width, uint32_t Height, uint32_t NumMips);
+
+// Compresses single mip level. OutData must hold mz_GetImageDataSize(Format, Width, Height, 1) bytes.
+void mz_CompressImage(const uint8_t* Pixels, uint32_t Width, uint32_t Height, mz_ImageFormat Format, uint8_t* OutData);
+
+// Full R8G8B8A8 mip chain of any size, mip 0 first, tightly packed (mz_GetImageDataSize(mz_IMAGE_FORMAT_RGBA8, Width,
+// Height, mz_GetNumMips(Width, Height)) bytes). sRGB images are filtered in linear space.
+void mz_GenerateMipChain(const uint8_t* Pixels, uint32_t Width, uint32_t Height, bool bIsSRGB, uint8_t* OutMips);